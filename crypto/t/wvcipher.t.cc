@@ -0,0 +1,160 @@
+#include "wvtest.h"
+#include "wvcipher.h"
+#include "wvhex.h"
+
+
+static WvString hex(WvBuf &buf)
+{
+    return WvHexEncoder().strflushbuf(buf, true);
+}
+
+
+static void unhex(WvStringParm str, WvBuf &buf)
+{
+    WvHexDecoder().flushstrbuf(str, buf, true);
+}
+
+
+// encode 'in' a few bytes at a time, sometimes in place and sometimes not
+static bool dribble(WvEncoder &enc, WvBuf &in, WvBuf &out, bool finish)
+{
+    bool ok = true;
+    for (int i = 0; in.used(); i++)
+    {
+	size_t len = in.used() < 7 ? in.used() : 7;
+	WvDynBuf piece;
+	piece.merge(in, len);
+	ok = (i % 2 ? enc.encode_inplace(piece, out)
+	      : enc.encode(piece, out)) && ok;
+    }
+    if (finish)
+	ok = enc.finish(out) && ok;
+    return ok;
+}
+
+
+WVTEST_MAIN("aes-ctr")
+{
+    // NIST SP 800-38A, F.5.1
+    WvDynBuf key, iv, in, out;
+    unhex("2b7e151628aed2a6abf7158809cf4f3c", key);
+    unhex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", iv);
+    unhex("6bc1bee22e409f96e93d7e117393172a"
+	  "ae2d8a571e03ac9c9eb76fac45af8e51", in);
+
+    WvAESCTREncoder enc(WvAESCTREncoder::Encrypt,
+			key.peek(0, 16), 16, iv.peek(0, 16));
+    WVPASS(enc.isok());
+    WVFAIL(enc.isaead());
+    WVPASSEQ(enc.getivsize(), 16);
+    WVPASS(dribble(enc, in, out, true));
+    WVPASSEQ(hex(out), "874d6191b620e3261bef6864990db6ce"
+	     "9806f66b7970fdff8617187bb9fffdff");
+
+    WvAESCTREncoder bad(WvAESCTREncoder::Encrypt, key.peek(0, 16), 15);
+    WVFAIL(bad.isok());
+}
+
+
+WVTEST_MAIN("aes-gcm")
+{
+    // McGrew & Viega's GCM spec, test case 2: all zeroes
+    unsigned char zero[16];
+    memset(zero, 0, sizeof(zero));
+    WvDynBuf in, out, back;
+    in.put(zero, 16);
+
+    WvAESGCMEncoder enc(WvAESGCMEncoder::Encrypt, zero, 16);
+    WVPASS(enc.isaead());
+    WVPASSEQ(enc.getivsize(), 12);
+    WVPASS(enc.encode_inplace(in, out));
+    WVPASS(enc.finish(out));
+    WVPASSEQ(out.used(), 32);
+    WvDynBuf sealed;
+    sealed.put(out.peek(0, out.used()), out.used());
+    WVPASSEQ(hex(out), "0388dace60b6a392f328c2b971b2fe78"
+	     "ab6e47d42cec13bdf53a67b21257bddf");
+
+    // a little at a time, holding back the tag
+    WvAESGCMEncoder dec(WvAESGCMEncoder::Decrypt, zero, 16);
+    WvDynBuf copy;
+    copy.put(sealed.peek(0, sealed.used()), sealed.used());
+    WVPASS(dribble(dec, copy, back, false));
+    WVPASSEQ(back.used(), 16);
+    WVPASS(dec.finish(back));
+    WVPASS(dec.isok());
+    WVPASSEQ(hex(back), "00000000000000000000000000000000");
+
+    // anything out of place gets caught
+    WVPASS(dec.reset());
+    unsigned char *p = sealed.mutablepeek(3, 1);
+    *p ^= 1;
+    WVPASS(dec.encode(sealed, back));
+    WVFAIL(dec.finish(back));
+    WVFAIL(dec.isok());
+    WVPASSEQ(dec.geterror(), "message failed authentication");
+
+    // and so does a message too short to even have a tag
+    WVPASS(dec.reset());
+    in.put(zero, 5);
+    WVPASS(dec.encode(in, back));
+    WVFAIL(dec.finish(back));
+}
+
+
+WVTEST_MAIN("chacha20-poly1305")
+{
+    unsigned char key[32], iv[12];
+    for (int i = 0; i < 32; i++)
+	key[i] = 0x80 + i;
+    for (int i = 0; i < 12; i++)
+	iv[i] = i;
+
+    WvChaCha20Poly1305Encoder enc(WvEVPCipherEncoder::Encrypt, key, iv);
+    WvChaCha20Poly1305Encoder dec(WvEVPCipherEncoder::Decrypt, key, iv);
+    WVPASS(enc.isok());
+    enc.setaad("header", 6);
+    dec.setaad("header", 6);
+
+    WvDynBuf in, out, back;
+    WvString text("Ladies and Gentlemen of the class of '99: "
+		  "If I could offer you only one tip for the future, "
+		  "sunscreen would be it.");
+    in.putstr(text);
+    WVPASS(dribble(enc, in, out, true));
+    WVPASSEQ(out.used(), text.len() + WvEVPCipherEncoder::TAGSIZE);
+    WVPASS(dribble(dec, out, back, true));
+    WVPASSEQ(back.getstr(), text);
+
+    // the additional data is checked too
+    in.putstr(text);
+    WVPASS(enc.reset());
+    WVPASS(enc.flush(in, out, true));
+    dec.setaad("footer", 6);
+    WVPASS(dec.flush(out, back));
+    WVFAIL(dec.finish(back));
+}
+
+
+WVTEST_MAIN("ciphers in an encoder chain")
+{
+    unsigned char key[32];
+    memset(key, 0x42, sizeof(key));
+    WvEncoderChain chain;
+    chain.append(new WvAESGCMEncoder(WvEVPCipherEncoder::Encrypt,
+				     key, 32), true);
+    chain.append(new WvAESGCMEncoder(WvEVPCipherEncoder::Decrypt,
+				     key, 32), true);
+    WVPASS(chain.isinplace());
+
+    WvDynBuf in, out;
+    for (int i = 0; i < 10000; i++)
+	in.putstr("abcdefghijklmnop");
+    size_t len = in.used();
+    WVPASS(chain.encode_inplace(in, out, true));
+    WVPASS(chain.finish(out));
+    WVPASS(chain.isok());
+    WVPASSEQ(out.used(), len);
+    WVPASS(!memcmp(out.peek(0, 16), "abcdefghijklmnop", 16));
+    WVPASS(!memcmp(out.peek(len - 16, 16), "abcdefghijklmnop", 16));
+}
@@ -106,3 +106,45 @@ WVTEST_MAIN("Loading/unloading from file")
     WVPASS(test_encode_load_file(WvCRL::CRLPEM));
     WVPASS(test_encode_load_file(WvCRL::CRLDER));
 }
+
+
+WVTEST_MAIN("revocation index")
+{
+    WvX509Mgr ca("cn=testca.ca,dc=testca,dc=ca", DEFAULT_KEYLEN, true);
+    WvCRL crl(ca);
+
+    WvX509 users[3];
+    for (int i = 0; i < 3; i++)
+    {
+        WvRSAKey rsakey(DEFAULT_KEYLEN);
+        WvString certreq = WvX509Mgr::certreq(
+            WvString("cn=test%s.signed.com,dc=signed,dc=com", i), rsakey);
+        users[i].decode(WvX509::CertPEM, ca.signreq(certreq));
+        users[i].set_serial(1000 + i); // signreq() picks the same ones
+        WVFAIL(crl.isrevoked(users[i]));
+    }
+
+    // adding a certificate after the index was built changes the answer
+    unsigned long ver = crl.version();
+    crl.addcert(users[0]);
+    WVPASS(crl.version() != ver);
+    WVPASS(crl.isrevoked(users[0]));
+    WVFAIL(crl.isrevoked(users[1]));
+    crl.addcert(users[2]);
+    WVPASS(crl.isrevoked(users[0]));
+    WVFAIL(crl.isrevoked(users[1]));
+    WVPASS(crl.isrevoked(users[2]));
+    WVPASS(crl.isrevoked(WvString("00%s", users[2].get_serial())));
+    WVFAIL(crl.isrevoked("not a number"));
+
+    // so does decoding a different one
+    WvCRL crl2;
+    WVPASS(crl2.version() != crl.version());
+    crl2.decode(WvCRL::CRLPEM, crl.encode(WvCRL::CRLPEM));
+    WVPASS(crl2.isrevoked(users[0]));
+    WVFAIL(crl2.isrevoked(users[1]));
+    ver = crl2.version();
+    crl2.decode(WvCRL::CRLPEM, WvCRL(ca).encode(WvCRL::CRLPEM));
+    WVPASS(crl2.version() != ver);
+    WVFAIL(crl2.isrevoked(users[0]));
+}
@@ -84,3 +84,33 @@ WVTEST_MAIN("Adler32 Test")
 
     WVPASSEQ(adler32str, "11e60398");
 }
+
+
+WVTEST_MAIN("CRC32C Test")
+{
+    WvCrc32cDigest crc32c;
+    WvDynBuf inbuf, crc32cbuf;
+    inbuf.put("123456789", 9);
+    crc32c.encode(inbuf, crc32cbuf);
+    crc32c.finish(crc32cbuf);
+    WVPASSEQ(WvHexEncoder().strflushbuf(crc32cbuf, true), "e3069283");
+
+    // from RFC 3720, B.4
+    unsigned char block[32];
+    memset(block, 0, sizeof(block));
+    WVPASSEQ(WvCrc32cDigest::update(0, block, 32), 0x8a9136aa);
+    memset(block, 0xff, sizeof(block));
+    WVPASSEQ(WvCrc32cDigest::update(0, block, 32), 0x62a8ab43);
+
+    // in bits and pieces, at every alignment
+    unsigned char data[1000];
+    for (size_t i = 0; i < sizeof(data); i++)
+	data[i] = i * 13;
+    uint32_t whole = WvCrc32cDigest::update(0, data, sizeof(data));
+    for (size_t split = 0; split < 20; split++)
+    {
+	uint32_t crc = WvCrc32cDigest::update(0, data, split);
+	crc = WvCrc32cDigest::update(crc, data + split, sizeof(data) - split);
+	WVPASSEQ(crc, whole);
+    }
+}
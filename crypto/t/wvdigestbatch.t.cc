@@ -0,0 +1,108 @@
+#include "wvtest.h"
+#include "wvdigestbatch.h"
+#include "wvfileutils.h"
+#include "wvhex.h"
+#include "wvfile.h"
+#include <unistd.h>
+
+
+static WvString digest_of(WvDigest &digest, const void *data, size_t len)
+{
+    WvDynBuf in, out;
+    in.put(data, len);
+    digest.flush(in, out, true);
+    return WvHexEncoder().strflushbuf(out, true);
+}
+
+
+static void write_file(WvStringParm filename, const void *data, size_t len)
+{
+    WvFile f(filename, O_WRONLY | O_CREAT | O_TRUNC);
+    f.write(data, len);
+}
+
+
+WVTEST_MAIN("digest batch")
+{
+    unsigned char data[100000];
+    for (size_t i = 0; i < sizeof(data); i++)
+	data[i] = i * 7 + (i >> 8);
+
+    WvDigestBatch batch(WvDigestBatch::maker<WvSHA1Digest>, 4);
+    for (int i = 0; i < 50; i++)
+	WVPASSEQ(batch.add(data + i, i * 1000), i);
+    WVPASSEQ(batch.count(), 50);
+    WVPASS(batch.run());
+    for (int i = 0; i < 50; i++)
+    {
+	WvSHA1Digest sha1;
+	WVPASS(batch.isok(i));
+	WVPASSEQ(batch.hexdigest(i), digest_of(sha1, data + i, i * 1000));
+    }
+
+    // files too, including ones that aren't there
+    WvString prefix = wvtmpfilename("wvtest-digestbatch-");
+    WvString a("%s-a", prefix), b("%s-b", prefix), none("%s-none", prefix);
+    write_file(a, data, sizeof(data));
+    write_file(b, data, 0);
+    batch.zap();
+    batch.add(a);
+    batch.add(none);
+    batch.add(b);
+    WVFAIL(batch.run());
+    WvSHA1Digest sha1;
+    WVPASS(batch.isok(0));
+    WVPASSEQ(batch.hexdigest(0), digest_of(sha1, data, sizeof(data)));
+    WVFAIL(batch.isok(1));
+    WVPASSEQ(batch.geterror(1), strerror(ENOENT));
+    WVPASS(batch.isok(2));
+    WVPASSEQ(batch.hexdigest(2), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+    // only the new ones run next time
+    batch.add(data, 10);
+    WVPASS(!batch.isok(3));
+    WVPASS(batch.run());
+    WVPASS(batch.isok(3));
+
+    unlink(a);
+    unlink(b);
+}
+
+
+WVTEST_MAIN("digest batch segments")
+{
+    unsigned char data[100000];
+    for (size_t i = 0; i < sizeof(data); i++)
+	data[i] = i * 3;
+
+    // the digest of the segments' digests
+    WvDynBuf digests;
+    for (size_t off = 0; off < sizeof(data); off += 30000)
+    {
+	WvMD5Digest md5;
+	WvDynBuf in;
+	in.put(data + off, sizeof(data) - off < 30000
+	       ? sizeof(data) - off : 30000);
+	md5.flush(in, digests, true);
+    }
+    WvMD5Digest md5;
+    WVPASSEQ(digests.used(), 4 * 16);
+    WvString expect = digest_of(md5, digests.peek(0, digests.used()),
+				digests.used());
+
+    WvString filename = wvtmpfilename("wvtest-digestbatch-");
+    write_file(filename, data, sizeof(data));
+
+    WvDigestBatch batch(WvDigestBatch::maker<WvMD5Digest>);
+    batch.segment_size = 30000;
+    batch.add(data, sizeof(data));
+    batch.add(filename);
+    batch.add(data, 30000); // just fits in one
+    WVPASS(batch.run());
+    WVPASSEQ(batch.hexdigest(0), expect);
+    WVPASSEQ(batch.hexdigest(1), expect);
+    WvMD5Digest md5b;
+    WVPASSEQ(batch.hexdigest(2), digest_of(md5b, data, 30000));
+
+    unlink(filename);
+}
@@ -6,6 +6,7 @@
 #include "wvtcp.h"
 #include "wvtcplistener.h"
 #include "wvistreamlist.h"
+#include "wvstreamclone.h"
 #include "wvstrutils.h"
 #include <signal.h>
 
@@ -321,6 +322,99 @@ WVTEST_MAIN("ssl establish connection")
 }
 
 
+WVTEST_MAIN("session resumption")
+{
+    WvX509Mgr x509("cn=random_stupid_dn", 1024);
+    
+    for (int i = 0; i < 3; i++)
+    {
+	WvIStreamList list;
+	WvSSLStream *s1, *s2;
+	sslloop(list, x509, s1, s2);
+	s2->set_session_key("resumption test");
+	
+	s1->print("hello %s\n", i);
+	run(list, s1, s2);
+	WVPASSEQ(s2->blocking_getline(10000), WvString("hello %s", i));
+	s2->print("hi\n");
+	run(list, s1, s2);
+	WVPASSEQ(s1->blocking_getline(10000), "hi");
+	
+	// only the first connection needs a full handshake
+	WVPASSEQ(s1->resumed(), i > 0);
+	WVPASSEQ(s2->resumed(), i > 0);
+    }
+    
+    // a different server certificate can't resume the old sessions
+    WvX509Mgr other("cn=another_stupid_dn", 1024);
+    WvIStreamList list;
+    WvSSLStream *s1, *s2;
+    sslloop(list, other, s1, s2);
+    s2->set_session_key("resumption test");
+    s1->print("hello\n");
+    run(list, s1, s2);
+    WVPASSEQ(s2->blocking_getline(10000), "hello");
+    WVFAIL(s2->resumed());
+    WVPASS(s2->isok());
+}
+
+
+// a transport that isn't an fd stream, and counts the writes it gets
+class CountingClone : public WvStreamClone
+{
+public:
+    int writes;
+    
+    CountingClone(IWvStream *s) : WvStreamClone(s), writes(0) { }
+    virtual size_t uwrite(const void *buf, size_t len)
+    {
+	writes++;
+	return WvStreamClone::uwrite(buf, len);
+    }
+};
+
+
+WVTEST_MAIN("large writes over any stream")
+{
+    signal(SIGPIPE, SIG_IGN);
+    WvX509Mgr x509("cn=random_stupid_dn", 1024);
+    IWvStream *_s1, *_s2;
+    wvloopback2(_s1, _s2);
+    CountingClone *c1 = new CountingClone(_s1);
+    
+    WvIStreamList list;
+    list.auto_prune = false;
+    WvSSLStream *s1 = new WvSSLStream(c1, &x509, 0, true);
+    WvSSLStream *s2 = new WvSSLStream(new WvStreamClone(_s2));
+    list.append(s1, true, "s1");
+    list.append(s2, true, "s2");
+    
+    s2->print("hello\n");
+    run(list, s1, s2);
+    WVPASSEQ(s1->blocking_getline(10000), "hello");
+    
+    // many records, but only one write on the transport
+    const size_t size = 256*1024;
+    char *data = new char[size];
+    for (size_t i = 0; i < size; i++)
+	data[i] = i % 251;
+    int before = c1->writes;
+    WVPASSEQ(s1->write(data, size), size);
+    WVPASSEQ(c1->writes, before + 1);
+    
+    WvDynBuf buf;
+    for (int i = 0; i < 1000 && buf.used() < size; i++)
+    {
+	list.runonce(10);
+	s2->read(buf, size);
+    }
+    WVPASSEQ(buf.used(), size);
+    if (buf.used() == size)
+	WVPASS(!memcmp(buf.get(size), data, size));
+    deletev data;
+}
+
+
 WVTEST_MAIN("x509 refcounting")
 {
     WvX509Mgr *x509 = new WvX509Mgr("cn=random_stupid_dn,dn=foo", 1536);
@@ -0,0 +1,110 @@
+#include "wvtest.h"
+#include "wvx509cache.h"
+#include "wvx509mgr.h"
+#include "wvcrl.h"
+
+// default keylen for where we're not using pre-existing certs
+const static int DEFAULT_KEYLEN = 512;
+
+
+static void signed_cert(WvX509Mgr &ca, WvStringParm dn, WvX509 &cert)
+{
+    WvRSAKey rsakey(DEFAULT_KEYLEN);
+    WvString certreq = WvX509Mgr::certreq(dn, rsakey);
+    cert.decode(WvX509::CertPEM, ca.signreq(certreq));
+
+    // signreq() picks the same serial number for everything it signs in
+    // the same second, and CRLs go by serial number
+    static int serial = 1000;
+    cert.set_serial(serial++);
+    ca.signcert(cert);
+}
+
+
+WVTEST_MAIN("validation cache")
+{
+    WvX509Mgr ca("cn=testca.ca,dc=testca,dc=ca", DEFAULT_KEYLEN, true);
+    WvX509Mgr otherca("cn=otherca.ca,dc=otherca,dc=ca", DEFAULT_KEYLEN, true);
+    WvX509 user, user2;
+    signed_cert(ca, "cn=test.signed.com,dc=signed,dc=com", user);
+    signed_cert(ca, "cn=test2.signed.com,dc=signed,dc=com", user2);
+
+    WvX509Cache cache;
+    WVPASS(cache.validate(user, ca));
+    WVPASSEQ(cache.misses, 1);
+    WVPASS(cache.validate(user, ca));
+    WVPASSEQ(cache.hits, 1);
+
+    // failures are remembered too
+    WVFAIL(cache.validate(user, otherca));
+    WVFAIL(cache.validate(user, otherca));
+    WVPASSEQ(cache.misses, 2);
+    WVPASSEQ(cache.hits, 2);
+    WVPASSEQ(cache.count(), 2);
+
+    // blank certificates never make it into the cache
+    WvX509 blank;
+    WVFAIL(cache.validate(blank, ca));
+    WVPASSEQ(cache.count(), 2);
+
+    // checking a CRL is a different question, and changing it makes us
+    // ask again
+    WvCRL crl(ca);
+    WVPASS(cache.validate(user, ca, &crl));
+    WVPASS(cache.validate(user2, ca, &crl));
+    WVPASSEQ(cache.misses, 4);
+    WVPASS(cache.validate(user, ca, &crl));
+    WVPASSEQ(cache.hits, 3);
+    crl.addcert(user);
+    WVFAIL(cache.validate(user, ca, &crl));
+    WVPASS(cache.validate(user2, ca, &crl));
+    WVPASSEQ(cache.misses, 6);
+    WVFAIL(cache.validate(user, ca, &crl));
+    WVPASSEQ(cache.hits, 4);
+    WVPASS(cache.validate(user, ca));
+    WVPASSEQ(cache.misses, 7);
+
+    cache.zap();
+    WVPASSEQ(cache.count(), 0);
+    WVPASS(cache.validate(user, ca));
+    WVPASSEQ(cache.misses, 8);
+}
+
+
+WVTEST_MAIN("validation cache eviction")
+{
+    WvX509Mgr ca("cn=testca.ca,dc=testca,dc=ca", DEFAULT_KEYLEN, true);
+    WvX509 users[3];
+    for (int i = 0; i < 3; i++)
+        signed_cert(ca, WvString("cn=test%s.signed.com,dc=signed,dc=com", i),
+                    users[i]);
+
+    WvX509Cache cache(2);
+    WVPASS(cache.validate(users[0], ca));
+    WVPASS(cache.validate(users[1], ca));
+    WVPASS(cache.validate(users[0], ca)); // users[0] gets a second chance
+    WVPASS(cache.validate(users[2], ca)); // so users[1] goes
+    WVPASSEQ(cache.count(), 2);
+    WVPASSEQ(cache.evictions, 1);
+    WVPASS(cache.validate(users[0], ca));
+    WVPASSEQ(cache.hits, 2);
+    WVPASS(cache.validate(users[1], ca));
+    WVPASSEQ(cache.misses, 4);
+}
+
+
+WVTEST_MAIN("validation cache with a silly size")
+{
+    WvX509Mgr ca("cn=testca.ca,dc=testca,dc=ca", DEFAULT_KEYLEN, true);
+    WvX509 users[2];
+    for (int i = 0; i < 2; i++)
+        signed_cert(ca, WvString("cn=test%s.signed.com,dc=signed,dc=com", i),
+                    users[i]);
+
+    // anything less than one entry means one
+    WvX509Cache cache(-1000000);
+    WVPASS(cache.validate(users[0], ca));
+    WVPASS(cache.validate(users[1], ca));
+    WVPASSEQ(cache.count(), 1);
+    WVPASSEQ(cache.evictions, 1);
+}
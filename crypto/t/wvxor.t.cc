@@ -0,0 +1,113 @@
+#include "wvtest.h"
+#include "wvxor.h"
+#include "wvcountermode.h"
+#include "wvhex.h"
+
+
+// enough to need a few subbuffers, so the in-place code has to walk them
+static void fill(WvDynBuf &buf)
+{
+    unsigned char block[1001];
+    for (size_t i = 0; i < sizeof(block); i++)
+	block[i] = i * 7;
+    for (int i = 0; i < 100; i++)
+	buf.put(block, sizeof(block));
+}
+
+
+WVTEST_MAIN("xor in place")
+{
+    WvDynBuf a, b, outa, outb;
+    fill(a);
+    fill(b);
+    size_t len = a.used();
+
+    WvXOREncoder x1("abc", 3), x2("abc", 3);
+    WVPASS(x1.isinplace());
+    WVPASS(x1.encode(a, outa, true));
+    WVPASS(x2.encode_inplace(b, outb, true));
+    WVPASSEQ(b.used(), 0);
+    WVPASSEQ(outb.used(), len);
+    WVPASS(!memcmp(outa.peek(0, len), outb.peek(0, len), len));
+
+    // nothing moved: the data we get back is where we put it
+    b.putstr("hello");
+    const unsigned char *where = b.peek(0, 5);
+    WvDynBuf outc;
+    WVPASS(x2.encode_inplace(b, outc));
+    WVPASS(outc.peek(0, 5) == where);
+}
+
+
+WVTEST_MAIN("encoder chain in place")
+{
+    WvEncoderChain chain;
+    chain.append(new WvPassthroughEncoder, true);
+    chain.append(new WvXOREncoder("key", 3), true);
+    chain.append(new WvXOREncoder("other key", 9), true);
+    WVPASS(chain.isinplace());
+
+    WvDynBuf in, check, out;
+    fill(in);
+    fill(check);
+    size_t len = in.used();
+    WVPASS(chain.encode(in, out, true));
+    WVPASSEQ(out.used(), len);
+
+    WvXOREncoder undo1("key", 3), undo2("other key", 9);
+    WvDynBuf tmp, back;
+    WVPASS(undo2.flush(out, tmp));
+    WVPASS(undo1.flush(tmp, back));
+    WVPASS(!memcmp(back.peek(0, len), check.peek(0, len), len));
+
+    // stages that can't work in place don't get in the way of the ones
+    // that can
+    WvEncoderChain chain2;
+    chain2.append(new WvHexEncoder, true);
+    chain2.append(new WvXOREncoder("key", 3), true);
+    chain2.append(new WvXOREncoder("key", 3), true);
+    chain2.append(new WvHexDecoder, true);
+    WVFAIL(chain2.isinplace());
+    in.putstr("abcdef");
+    WVPASS(chain2.flush(in, out));
+    WVPASSEQ(out.getstr(), "abcdef");
+}
+
+
+WVTEST_MAIN("counter mode in place")
+{
+    unsigned char counter[4] = { 1, 2, 3, 4 };
+    WvCounterModeEncoder c1(new WvXOREncoder("abcd", 4), counter, 4);
+    WvCounterModeEncoder c2(new WvXOREncoder("abcd", 4), counter, 4);
+    WVPASS(c1.isinplace());
+
+    // without a flush, a partial block stays behind in both cases
+    WvDynBuf a, b, outa, outb;
+    fill(a);
+    fill(b);
+    size_t len = a.used();
+    WVPASS(c1.encode(a, outa));
+    WVPASS(c2.encode_inplace(b, outb));
+    WVPASSEQ(a.used(), len % 4);
+    WVPASSEQ(b.used(), len % 4);
+    WVPASSEQ(outa.used(), outb.used());
+    WVPASS(!memcmp(outa.peek(0, outa.used()), outb.peek(0, outb.used()),
+		   outa.used()));
+
+    WVPASS(c1.flush(a, outa));
+    WVPASS(c2.encode_inplace(b, outb, true));
+    WVPASSEQ(outa.used(), len);
+    WVPASSEQ(outb.used(), len);
+    WVPASS(!memcmp(outa.peek(0, len), outb.peek(0, len), len));
+
+    // and it decodes again inside a chain
+    WvEncoderChain chain;
+    chain.append(new WvPassthroughEncoder, true);
+    chain.append(new WvCounterModeEncoder(new WvXOREncoder("abcd", 4),
+					  counter, 4), true);
+    WvDynBuf back, check;
+    fill(check);
+    WVPASS(chain.flush(outb, back));
+    WVPASSEQ(back.used(), len);
+    WVPASS(!memcmp(back.peek(0, len), check.peek(0, len), len));
+}
@@ -0,0 +1,82 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast the EVP cipher encoders encrypt and decrypt, in MB/s,
+ * both copying into the output buffer and working in place.
+ *
+ * usage: cipherbench [megabytes] [block size]
+ */
+#include "wvcipher.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static double bench(WvEncoder &enc, bool inplace, size_t size,
+		    size_t blocksize)
+{
+    unsigned char *block = new unsigned char[blocksize];
+    memset(block, 0x55, blocksize);
+    WvDynBuf in, out;
+    WvTime start = wvtime();
+    for (size_t done = 0; done < size; done += blocksize)
+    {
+	in.put(block, blocksize);
+	if (inplace)
+	    enc.encode_inplace(in, out);
+	else
+	    enc.encode(in, out);
+	out.zap();
+    }
+    enc.finish(out);
+    time_t ms = msecdiff(wvtime(), start);
+    deletev block;
+    return ms ? size / 1048576.0 * 1000 / ms : 0.0;
+}
+
+
+static void run(const char *name, WvEVPCipherEncoder &enc,
+		WvEVPCipherEncoder &dec, size_t size, size_t blocksize)
+{
+    printf("%-20s", name);
+    printf(" %8.1f", bench(enc, false, size, blocksize));
+    enc.reset();
+    printf(" %8.1f", bench(enc, true, size, blocksize));
+    printf(" %8.1f", bench(dec, false, size, blocksize));
+    dec.reset();
+    printf(" %8.1f MB/s\n", bench(dec, true, size, blocksize));
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? atoi(argv[1]) : 256) * 1024 * 1024;
+    size_t blocksize = argc > 2 ? atoi(argv[2]) : 16384;
+    unsigned char key[32];
+    memset(key, 0x42, sizeof(key));
+
+    printf("%-20s %8s %8s %8s %8s\n", "",
+	   "encrypt", "in place", "decrypt", "in place");
+    {
+	WvAESCTREncoder e(WvEVPCipherEncoder::Encrypt, key, 16);
+	WvAESCTREncoder d(WvEVPCipherEncoder::Decrypt, key, 16);
+	run("aes-128-ctr", e, d, size, blocksize);
+    }
+    {
+	WvAESGCMEncoder e(WvEVPCipherEncoder::Encrypt, key, 16);
+	WvAESGCMEncoder d(WvEVPCipherEncoder::Decrypt, key, 16);
+	run("aes-128-gcm", e, d, size, blocksize);
+    }
+    {
+	WvAESGCMEncoder e(WvEVPCipherEncoder::Encrypt, key, 32);
+	WvAESGCMEncoder d(WvEVPCipherEncoder::Decrypt, key, 32);
+	run("aes-256-gcm", e, d, size, blocksize);
+    }
+    {
+	WvChaCha20Poly1305Encoder e(WvEVPCipherEncoder::Encrypt, key);
+	WvChaCha20Poly1305Encoder d(WvEVPCipherEncoder::Decrypt, key);
+	run("chacha20-poly1305", e, d, size, blocksize);
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Compares digesting lots of files one after another with the plain
+ * digest encoders against doing them all at once with WvDigestBatch, and
+ * the same for one big file, in MB/s.  The files are written first, so
+ * they're probably all in the page cache; this measures the CPU side.
+ *
+ * usage: digestbench [files] [kbytes per file] [threads]
+ */
+#include "wvdigestbatch.h"
+#include "wvfileutils.h"
+#include "wvtimeutils.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+static double mbps(size_t bytes, const WvTime &start)
+{
+    time_t ms = msecdiff(wvtime(), start);
+    return ms ? bytes / 1048576.0 * 1000 / ms : 0.0;
+}
+
+
+// the way you'd do it without WvDigestBatch
+static double sequential(WvDigestBatch::DigestMaker maker,
+			 WvStringList &files, size_t bytes)
+{
+    static unsigned char buf[1024*1024];
+    WvTime start = wvtime();
+    WvStringList::Iter i(files);
+    for (i.rewind(); i.next(); )
+    {
+	WvDigest *digest = maker();
+	WvDynBuf out;
+	int fd = open(*i, O_RDONLY);
+	ssize_t len;
+	while ((len = read(fd, buf, sizeof(buf))) > 0)
+	{
+	    WvConstInPlaceBuf in(buf, len);
+	    digest->encode(in, out);
+	}
+	close(fd);
+	digest->finish(out);
+	delete digest;
+    }
+    return mbps(bytes, start);
+}
+
+
+static double batched(WvDigestBatch::DigestMaker maker, WvStringList &files,
+		      size_t bytes, int threads, size_t segment_size = 0)
+{
+    WvTime start = wvtime();
+    WvDigestBatch batch(maker, threads);
+    batch.segment_size = segment_size;
+    WvStringList::Iter i(files);
+    for (i.rewind(); i.next(); )
+	batch.add(*i);
+    batch.run();
+    return mbps(bytes, start);
+}
+
+
+int main(int argc, char **argv)
+{
+    int nfiles = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t filesize = (argc > 2 ? atoi(argv[2]) : 128) * 1024;
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+    unsigned char *data = new unsigned char[filesize];
+    for (size_t i = 0; i < filesize; i++)
+	data[i] = random();
+
+    WvString prefix = wvtmpfilename("digestbench-");
+    WvStringList files, bigfile;
+    for (int i = 0; i < nfiles; i++)
+    {
+	WvString name("%s-%s", prefix, i);
+	int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	write(fd, data, filesize);
+	close(fd);
+	files.append(name);
+    }
+    WvString bigname("%s-big", prefix);
+    int fd = open(bigname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    for (int i = 0; i < nfiles; i++)
+	write(fd, data, filesize);
+    close(fd);
+    bigfile.append(bigname);
+    size_t total = nfiles * filesize;
+
+    printf("%d files of %dk:     one by one    batched\n",
+	   nfiles, (int)filesize / 1024);
+    printf("md5             %10.1f %10.1f MB/s\n",
+	   sequential(WvDigestBatch::maker<WvMD5Digest>, files, total),
+	   batched(WvDigestBatch::maker<WvMD5Digest>, files, total,
+		   threads));
+    printf("sha1            %10.1f %10.1f MB/s\n",
+	   sequential(WvDigestBatch::maker<WvSHA1Digest>, files, total),
+	   batched(WvDigestBatch::maker<WvSHA1Digest>, files, total,
+		   threads));
+    printf("crc32c          %10.1f %10.1f MB/s\n",
+	   sequential(WvDigestBatch::maker<WvCrc32cDigest>, files, total),
+	   batched(WvDigestBatch::maker<WvCrc32cDigest>, files, total,
+		   threads));
+
+    printf("\none %dM file:     in one go   8M segments\n",
+	   (int)(total / 1048576));
+    printf("sha1            %10.1f %10.1f MB/s\n",
+	   sequential(WvDigestBatch::maker<WvSHA1Digest>, bigfile, total),
+	   batched(WvDigestBatch::maker<WvSHA1Digest>, bigfile, total,
+		   threads, 8*1024*1024));
+    printf("crc32           %10.1f %10.1f MB/s\n",
+	   sequential(WvDigestBatch::maker<WvCrc32Digest>, bigfile, total),
+	   batched(WvDigestBatch::maker<WvCrc32Digest>, bigfile, total,
+		   threads, 8*1024*1024));
+    printf("crc32c          %10.1f %10.1f MB/s\n",
+	   sequential(WvDigestBatch::maker<WvCrc32cDigest>, bigfile, total),
+	   batched(WvDigestBatch::maker<WvCrc32cDigest>, bigfile, total,
+		   threads, 8*1024*1024));
+
+    WvStringList::Iter i(files);
+    for (i.rewind(); i.next(); )
+	unlink(*i);
+    unlink(bigname);
+    deletev data;
+    return 0;
+}
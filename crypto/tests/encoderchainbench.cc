@@ -0,0 +1,64 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast data goes through a WvEncoderChain of XOR encoders,
+ * in MB/s, for chains of different depths, with the encoders working in
+ * place and with them copying from one stage's buffer to the next.
+ *
+ * usage: encoderchainbench [megabytes] [max depth]
+ */
+#include "wvxor.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// the same thing, but it has to copy
+class CopyingXOREncoder : public WvXOREncoder
+{
+public:
+    CopyingXOREncoder(const void *key, size_t keylen)
+	: WvXOREncoder(key, keylen) { }
+protected:
+    virtual bool _isinplace() const
+        { return false; }
+};
+
+
+static double bench(int depth, bool inplace, size_t size)
+{
+    WvEncoderChain chain;
+    for (int i = 0; i < depth; i++)
+    {
+	if (inplace)
+	    chain.append(new WvXOREncoder("key", 3), true);
+	else
+	    chain.append(new CopyingXOREncoder("key", 3), true);
+    }
+
+    static unsigned char block[65536];
+    WvDynBuf in, out;
+    WvTime start = wvtime();
+    for (size_t done = 0; done < size; done += sizeof(block))
+    {
+	in.put(block, sizeof(block));
+	chain.encode_inplace(in, out);
+	out.zap();
+    }
+    time_t ms = msecdiff(wvtime(), start);
+    return ms ? size / 1048576.0 * 1000 / ms : 0.0;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? atoi(argv[1]) : 256) * 1024 * 1024;
+    int maxdepth = argc > 2 ? atoi(argv[2]) : 8;
+
+    printf("depth    copying   in place\n");
+    for (int depth = 1; depth <= maxdepth; depth *= 2)
+	printf("%5d %8.1f MB/s %8.1f MB/s\n", depth,
+	       bench(depth, false, size), bench(depth, true, size));
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Measures how many SSL connections per second we can make to ourselves
+ * over loopback, with and without resuming sessions.  Each connection
+ * sends one line and waits for the server to echo it back.
+ */
+#include "wvistreamlist.h"
+#include "wvsslstream.h"
+#include "wvtcp.h"
+#include "wvtcplistener.h"
+#include "wvtimeutils.h"
+#include "wvx509mgr.h"
+#include <signal.h>
+
+static WvX509Mgr *x509;
+
+
+static void echo(WvSSLStream *ssl)
+{
+    WvString line = ssl->getline(0);
+    if (!!line)
+    {
+	ssl->print("%s\n", line);
+	ssl->close();
+    }
+}
+
+
+static void incoming(IWvStream *conn)
+{
+    WvSSLStream *ssl = new WvSSLStream(conn, x509, 0, true);
+    ssl->setcallback(wv::bind(echo, ssl));
+    WvIStreamList::globallist.append(ssl, true, "server");
+}
+
+
+static bool connect_once(const WvIPPortAddr &addr, int &resumed)
+{
+    WvSSLStream *ssl = new WvSSLStream(new WvTCPConn(addr), NULL);
+    WvIStreamList::globallist.append(ssl, false, "client");
+    ssl->print("ping\n");
+    
+    WvString line;
+    while (ssl->isok() && !line)
+    {
+	WvIStreamList::globallist.runonce(100);
+	line = ssl->getline(0);
+    }
+    if (ssl->resumed())
+	resumed++;
+    
+    WvIStreamList::globallist.unlink(ssl);
+    WVRELEASE(ssl);
+    return line == "ping";
+}
+
+
+static void run(const WvIPPortAddr &addr, int count, bool resume)
+{
+    WvSSLStream::resume_sessions = resume;
+    int ok = 0, resumed = 0;
+    WvTime start = wvtime();
+    for (int i = 0; i < count; i++)
+	if (connect_once(addr, resumed))
+	    ok++;
+    time_t ms = msecdiff(wvtime(), start);
+    
+    wvcon->print("%s: %s/%s connections (%s resumed) in %s ms, "
+		 "%s per second\n",
+		 resume ? "resuming" : "full handshakes", ok, count, resumed,
+		 ms, ms ? ok * 1000 / ms : 0);
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 200;
+    signal(SIGPIPE, SIG_IGN);
+    
+    x509 = new WvX509Mgr("cn=localhost", 2048);
+    WvTCPListener listener(WvIPPortAddr("127.0.0.1", 0));
+    listener.onaccept(incoming);
+    WvIStreamList::globallist.append(&listener, false, "listener");
+    WvIPPortAddr addr("127.0.0.1", listener.src()->port);
+    
+    run(addr, count, false);
+    run(addr, count, true);
+    
+    WvIStreamList::globallist.zap();
+    WVRELEASE(x509);
+    return 0;
+}
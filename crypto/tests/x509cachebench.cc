@@ -0,0 +1,99 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2007 Net Integration Technologies, Inc. and others.
+ *
+ * Measures revocation lookups in a big CRL, OpenSSL's way and with
+ * WvCRL's index, and validating the same certificate over and over with
+ * and without WvX509Cache, in lookups per second.
+ *
+ * usage: x509cachebench [revoked certificates] [lookups] [keylen]
+ */
+#include "wvx509cache.h"
+#include "wvx509mgr.h"
+#include "wvcrl.h"
+#include "wvlogrcv.h"
+#include "wvtimeutils.h"
+#include <openssl/x509.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static double persec(int count, const WvTime &start)
+{
+    time_t ms = msecdiff(wvtime(), start);
+    return ms ? count * 1000.0 / ms : 0.0;
+}
+
+
+int main(int argc, char **argv)
+{
+    int nrevoked = argc > 1 ? atoi(argv[1]) : 100000;
+    int lookups = argc > 2 ? atoi(argv[2]) : 100000;
+    int keylen = argc > 3 ? atoi(argv[3]) : 2048;
+    WvLogConsole log(2, WvLog::Info);
+
+    WvX509Mgr ca("cn=benchca.ca,dc=benchca,dc=ca", keylen, true);
+    WvRSAKey rsakey(keylen);
+    WvX509 user;
+    user.decode(WvX509::CertPEM,
+                ca.signreq(WvX509Mgr::certreq("cn=bench.user,dc=user",
+                                              rsakey)));
+
+    // the serial numbers don't have to belong to real certificates
+    WvCRL crl(ca);
+    WvX509 revoked(user);
+    for (int i = 0; i < nrevoked; i++)
+    {
+        revoked.set_serial(2 * i);
+        crl.addcert(revoked);
+    }
+    // a decoded CRL, like one we'd really have
+    WvDynBuf der;
+    crl.encode(WvCRL::CRLDER, der);
+    WvCRL bigcrl;
+    bigcrl.decode(WvCRL::CRLDER, der);
+    printf("%d revoked certificates\n", bigcrl.numcerts());
+
+    // what isrevoked() used to do, without the logging
+    WvTime start = wvtime();
+    int found = 0;
+    for (int i = 0; i < lookups; i++)
+    {
+        BIGNUM *bn = NULL;
+        BN_dec2bn(&bn, WvString(i % nrevoked));
+        ASN1_INTEGER *serial = BN_to_ASN1_INTEGER(bn, NULL);
+        BN_free(bn);
+        X509_REVOKED *rev;
+        found += X509_CRL_get0_by_serial(bigcrl.getcrl(), &rev, serial) == 1;
+        ASN1_INTEGER_free(serial);
+    }
+    printf("stack search    %12.0f lookups/s (%d revoked)\n",
+           persec(lookups, start), found);
+
+    start = wvtime();
+    bigcrl.isrevoked("1");
+    printf("building index  %12.0f ms\n", (double)msecdiff(wvtime(), start));
+
+    start = wvtime();
+    found = 0;
+    for (int i = 0; i < lookups; i++)
+        found += bigcrl.isrevoked(WvString(i % nrevoked));
+    printf("index           %12.0f lookups/s (%d revoked)\n",
+           persec(lookups, start), found);
+
+    int validations = lookups / 100 + 1;
+    start = wvtime();
+    for (int i = 0; i < validations; i++)
+        user.validate(&ca);
+    printf("validate        %12.0f validations/s\n",
+           persec(validations, start));
+
+    WvX509Cache cache;
+    start = wvtime();
+    for (int i = 0; i < lookups; i++)
+        cache.validate(user, ca, &bigcrl);
+    printf("cached validate %12.0f validations/s (%lu hits)\n",
+           persec(lookups, start), cache.hits);
+
+    return 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * Worldvisions Tunnel Vision Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * AES-CTR, AES-GCM and ChaCha20-Poly1305 cipher abstractions.
+ */
+#include "wvcipher.h"
+#include <openssl/evp.h>
+
+/***** WvEVPCipherEncoder *****/
+
+WvEVPCipherEncoder::WvEVPCipherEncoder(const evp_cipher_st *_cipher,
+    Mode _mode, bool _aead, const void *_key, size_t _keysize,
+    const void *_iv) :
+    cipher(_cipher), mode(_mode), aead(_aead), keysize(_keysize)
+{
+    ctx = EVP_CIPHER_CTX_new();
+    ivsize = cipher ? EVP_CIPHER_iv_length(cipher) : 0;
+    key = new unsigned char[keysize];
+    memcpy(key, _key, keysize);
+    iv = new unsigned char[ivsize];
+    if (_iv)
+        memcpy(iv, _iv, ivsize);
+    else
+        memset(iv, 0, ivsize);
+
+    if (cipher && (size_t)EVP_CIPHER_key_length(cipher) != keysize)
+        cipher = NULL;
+    _reset();
+}
+
+
+WvEVPCipherEncoder::~WvEVPCipherEncoder()
+{
+    EVP_CIPHER_CTX_free(ctx);
+    deletev key;
+    deletev iv;
+}
+
+
+void WvEVPCipherEncoder::setkey(const void *_key)
+{
+    memcpy(key, _key, keysize);
+    reset();
+}
+
+
+void WvEVPCipherEncoder::setiv(const void *_iv)
+{
+    memcpy(iv, _iv, ivsize);
+    reset();
+}
+
+
+void WvEVPCipherEncoder::setaad(const void *_aad, size_t aadlen)
+{
+    aad.zap();
+    aad.put(_aad, aadlen);
+    reset();
+}
+
+
+bool WvEVPCipherEncoder::init()
+{
+    tail.zap();
+    int outl;
+    if (!EVP_CipherInit_ex(ctx, cipher, NULL, key, iv, mode == Encrypt)
+        || (aad.used() && !EVP_CipherUpdate(ctx, NULL, &outl,
+                              aad.peek(0, aad.used()), aad.used())))
+    {
+        seterror("can't initialize cipher");
+        return false;
+    }
+    return true;
+}
+
+
+bool WvEVPCipherEncoder::crypt(unsigned char *out, const unsigned char *in,
+    size_t len)
+{
+    // EVP counts in ints; in and out may be the same
+    while (len > 0)
+    {
+        int chunk = len > (1 << 30) ? (1 << 30) : len, outl;
+        if (!EVP_CipherUpdate(ctx, out, &outl, in, chunk))
+        {
+            seterror("cipher failed");
+            return false;
+        }
+        out += chunk;
+        in += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+
+bool WvEVPCipherEncoder::crypt(WvBuf &inbuf, WvBuf &outbuf, size_t len)
+{
+    while (len > 0)
+    {
+        size_t chunk = inbuf.optgettable();
+        if (chunk > len)
+            chunk = len;
+        const unsigned char *data = inbuf.get(chunk);
+        if (!crypt(outbuf.alloc(chunk), data, chunk))
+            return false;
+        len -= chunk;
+    }
+    return true;
+}
+
+
+bool WvEVPCipherEncoder::cryptinplace(WvBuf &buf, size_t len)
+{
+    size_t chunk;
+    for (size_t offset = 0; offset < len; offset += chunk)
+    {
+        chunk = buf.optpeekable(offset);
+        if (chunk > len - offset)
+            chunk = len - offset;
+        unsigned char *data = buf.mutablepeek(offset, chunk);
+        if (!crypt(data, data, chunk))
+            return false;
+    }
+    return true;
+}
+
+
+bool WvEVPCipherEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    if (!aead || mode == Encrypt)
+        return crypt(inbuf, outbuf, inbuf.used());
+
+    // hang on to the last TAGSIZE bytes: they might be the tag
+    tail.merge(inbuf);
+    size_t used = tail.used();
+    return crypt(tail, outbuf, used > TAGSIZE ? used - TAGSIZE : 0);
+}
+
+
+bool WvEVPCipherEncoder::_encode_inplace(WvBuf &inbuf, WvBuf &outbuf,
+    bool flush)
+{
+    size_t len = inbuf.used(), keep = 0;
+    if (aead && mode == Decrypt)
+    {
+        size_t total = tail.used() + len;
+        if (total <= TAGSIZE)
+        {
+            tail.merge(inbuf);
+            return true;
+        }
+
+        // whatever we were holding back wasn't the tag after all, so it
+        // goes first; it's small enough to just copy
+        size_t fromtail = tail.used();
+        if (fromtail > total - TAGSIZE)
+            fromtail = total - TAGSIZE;
+        if (!crypt(tail, outbuf, fromtail))
+            return false;
+
+        // hold back a copy of the new last TAGSIZE bytes instead, so the
+        // rest can move along in one piece
+        keep = TAGSIZE - tail.used();
+        tail.put(inbuf.peek(len - keep, keep), keep);
+        len -= keep;
+    }
+
+    if (!cryptinplace(inbuf, len))
+        return false;
+    outbuf.merge(inbuf);
+    outbuf.unalloc(keep);
+    return true;
+}
+
+
+bool WvEVPCipherEncoder::_finish(WvBuf &outbuf)
+{
+    unsigned char tag[TAGSIZE], rest[EVP_MAX_BLOCK_LENGTH];
+    int outl;
+
+    if (aead && mode == Decrypt)
+    {
+        if (tail.used() != TAGSIZE)
+        {
+            seterror("message is too short to have a tag");
+            return false;
+        }
+        tail.move(tag, TAGSIZE);
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, TAGSIZE, tag);
+    }
+
+    if (!EVP_CipherFinal_ex(ctx, rest, &outl))
+    {
+        seterror(aead ? "message failed authentication" : "cipher failed");
+        return false;
+    }
+    outbuf.put(rest, outl); // nothing, for stream ciphers
+
+    if (aead && mode == Encrypt)
+    {
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, TAGSIZE, tag);
+        outbuf.put(tag, TAGSIZE);
+    }
+    return true;
+}
+
+
+bool WvEVPCipherEncoder::_reset()
+{
+    if (!cipher)
+    {
+        seterror("unsupported cipher or key size (%s bytes)", keysize);
+        return false;
+    }
+    return init();
+}
+
+
+/***** WvAESCTREncoder *****/
+
+static const EVP_CIPHER *aes_ctr(size_t keysize)
+{
+    switch (keysize)
+    {
+    case 16: return EVP_aes_128_ctr();
+    case 24: return EVP_aes_192_ctr();
+    case 32: return EVP_aes_256_ctr();
+    default: return NULL;
+    }
+}
+
+
+WvAESCTREncoder::WvAESCTREncoder(Mode mode, const void *key,
+    size_t keysize, const void *iv) :
+    WvEVPCipherEncoder(aes_ctr(keysize), mode, false, key, keysize, iv)
+{
+}
+
+
+/***** WvAESGCMEncoder *****/
+
+static const EVP_CIPHER *aes_gcm(size_t keysize)
+{
+    switch (keysize)
+    {
+    case 16: return EVP_aes_128_gcm();
+    case 24: return EVP_aes_192_gcm();
+    case 32: return EVP_aes_256_gcm();
+    default: return NULL;
+    }
+}
+
+
+WvAESGCMEncoder::WvAESGCMEncoder(Mode mode, const void *key,
+    size_t keysize, const void *iv) :
+    WvEVPCipherEncoder(aes_gcm(keysize), mode, true, key, keysize, iv)
+{
+}
+
+
+/***** WvChaCha20Poly1305Encoder *****/
+
+static const EVP_CIPHER *chacha20_poly1305()
+{
+#ifndef OPENSSL_NO_CHACHA
+    return EVP_chacha20_poly1305();
+#else
+    return NULL;
+#endif
+}
+
+
+WvChaCha20Poly1305Encoder::WvChaCha20Poly1305Encoder(Mode mode,
+    const void *key, const void *iv) :
+    WvEVPCipherEncoder(chacha20_poly1305(), mode, true, key, 32, iv)
+{
+}
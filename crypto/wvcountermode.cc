@@ -43,14 +43,12 @@ void WvCounterModeEncoder::incrcounter()
 }
 
 
-bool WvCounterModeEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
+bool WvCounterModeEncoder::keystream(WvBuf &outbuf, size_t &avail,
     bool flush)
 {
     bool success = true;
-    size_t avail = inbuf.used();
     size_t offset = outbuf.used();
     
-    // generate a key stream
     size_t len;
     for (len = avail; len >= countersize; len -= countersize)
     {
@@ -70,11 +68,24 @@ bool WvCounterModeEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
             incrcounter();
         }
         else
-            outbuf.unalloc(outbuf.used() - offset - avail);
+            outbuf.unalloc(outbuf.used() - offset - (avail - len));
     }
     avail -= len;
+    return success;
+}
+
+
+bool WvCounterModeEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
+    bool flush)
+{
+    size_t avail = inbuf.used();
+    size_t offset = outbuf.used();
+    
+    // generate a key stream
+    bool success = keystream(outbuf, avail, flush);
     
     // XOR in the data
+    size_t len;
     while (avail > 0)
     {
         len = outbuf.optpeekable(offset);
@@ -99,3 +110,30 @@ bool WvCounterModeEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf,
     }
     return success;
 }
+
+
+bool WvCounterModeEncoder::_encode_inplace(WvBuf &inbuf, WvBuf &outbuf,
+    bool flush)
+{
+    size_t avail = inbuf.used();
+    keybuf.zap();
+    bool success = keystream(keybuf, avail, flush);
+    
+    // XOR the key stream into the data where it sits, then pass it on
+    size_t offset, len;
+    for (offset = 0; offset < avail; offset += len)
+    {
+        len = inbuf.optpeekable(offset);
+        if (len > avail - offset)
+            len = avail - offset;
+        size_t lenopt = keybuf.optgettable();
+        if (len > lenopt)
+            len = lenopt;
+        unsigned char *data = inbuf.mutablepeek(offset, len);
+        const unsigned char *key = keybuf.get(len);
+        for (size_t i = 0; i < len; i++)
+            data[i] ^= key[i];
+    }
+    outbuf.merge(inbuf, avail);
+    return success;
+}
@@ -7,10 +7,12 @@
 
 #include <openssl/x509v3.h>
 #include <openssl/pem.h>
+#include <ctype.h>
 
 #include "wvcrl.h"
 #include "wvx509mgr.h"
 #include "wvbase64.h"
+#include "wvstringtable.h"
 
 static const char * warning_str_get = "Tried to determine %s, but CRL is blank!\n";
 #define CHECK_CRL_EXISTS_GET(x, y)                                      \
@@ -19,6 +21,22 @@ static const char * warning_str_get = "Tried to determine %s, but CRL is blank!\
         return y;                                                       \
     }
 
+// every WvCRL gets a new version() whenever it changes
+static unsigned long last_version = 0;
+
+
+// a serial number the way BN_bn2dec() prints it
+static bool is_plain_decimal(const char *s)
+{
+    if (*s == '-')
+        s++;
+    if (!isdigit(*s) || (*s == '0' && s[1]))
+        return false;
+    while (isdigit(*s))
+        s++;
+    return !*s;
+}
+
 
 static ASN1_INTEGER * serial_to_int(WvStringParm serial)
 {
@@ -40,6 +58,8 @@ WvCRL::WvCRL()
     : debug("X509 CRL", WvLog::Debug5)
 {
     crl = NULL;
+    revoked_index = NULL;
+    changed();
 }
 
 
@@ -48,6 +68,8 @@ WvCRL::WvCRL(const WvX509Mgr &ca)
 {
     crl = X509_CRL_new();
     assert(crl);
+    revoked_index = NULL;
+    changed();
 
     // Use Version 2 CRLs - Of COURSE that means
     // to set it to 1 here... grumble..
@@ -83,6 +105,15 @@ WvCRL::~WvCRL()
     debug("Deleting.\n");
     if (crl)
 	X509_CRL_free(crl);
+    delete revoked_index;
+}
+
+
+void WvCRL::changed()
+{
+    delete revoked_index;
+    revoked_index = NULL;
+    ver = ++last_version;
 }
 
 
@@ -245,6 +276,7 @@ void WvCRL::decode(const DumpMode mode, WvStringParm str)
 	X509_CRL_free(crl);
 	crl = NULL;
     }
+    changed();
 
     if (mode == CRLFileDER)
     {
@@ -300,6 +332,7 @@ void WvCRL::decode(const DumpMode mode, WvBuf &buf)
 	X509_CRL_free(crl);
 	crl = NULL;
     }
+    changed();
 
     if (mode == CRLFileDER || mode == CRLFilePEM)
     {
@@ -355,34 +388,34 @@ bool WvCRL::isrevoked(WvStringParm serial_number) const
 
     if (!!serial_number)
     {
-	ASN1_INTEGER *serial = serial_to_int(serial_number);
-	if (serial)
+	// anything but the plain decimal that WvX509::get_serial() gives us
+	// (say, with leading zeroes) goes through a BIGNUM first, so it looks
+	// exactly like the ones in the index
+	WvString serial = serial_number;
+	BIGNUM *bn = NULL;
+	if (!is_plain_decimal(serial) && BN_dec2bn(&bn, serial))
 	{
-	    X509_REVOKED mayberevoked;
-	    mayberevoked.serialNumber = serial;
-	    if (crl->crl->revoked)
+	    char *dec = BN_bn2dec(bn);
+	    serial = dec;
+	    OPENSSL_free(dec);
+	    BN_free(bn);
+	}
+
+	if (is_plain_decimal(serial))
+	{
+	    if (!revoked_index)
+		build_index();
+
+	    if ((*revoked_index)[serial])
 	    {
-		int idx = sk_X509_REVOKED_find(crl->crl->revoked, 
-					       &mayberevoked);
-		ASN1_INTEGER_free(serial);
-		if (idx >= 0)
-                {
-                    debug("Certificate is revoked.\n");
-		    return true;
-                }
-                else
-                {
-                    debug("Certificate is not revoked.\n");
-		    return false;
-                }
+		debug("Certificate is revoked.\n");
+		return true;
 	    }
 	    else
 	    {
-		ASN1_INTEGER_free(serial);
-		debug("CRL does not have revoked list.\n");
-                return false;
+		debug("Certificate is not revoked.\n");
+		return false;
 	    }
-	    
 	}
 	else
 	    debug(WvLog::Warning, "Can't convert serial number to ASN1 format. "
@@ -395,6 +428,35 @@ bool WvCRL::isrevoked(WvStringParm serial_number) const
           "was).\n");
     return false;
 }
+
+
+void WvCRL::build_index() const
+{
+    // sk_X509_REVOKED_find() is a binary search at best, and has to sort
+    // the whole list first; big CRLs get looked up a lot, so hash them
+    // instead.
+    STACK_OF(X509_REVOKED) *rev = X509_CRL_get_REVOKED(crl);
+    int count = rev ? sk_X509_REVOKED_num(rev) : 0;
+    if (count < 0)
+        count = 0;
+
+    revoked_index = new WvStringTable(count);
+    BIGNUM *bn = NULL;
+    for (int i = 0; i < count; i++)
+    {
+	BIGNUM *n = ASN1_INTEGER_to_BN(
+	    X509_REVOKED_get0_serialNumber(sk_X509_REVOKED_value(rev, i)), bn);
+	if (!n)
+	    continue;
+	bn = n;
+	char *dec = BN_bn2dec(bn);
+	revoked_index->add(new WvString(dec), true);
+	OPENSSL_free(dec);
+    }
+    BN_free(bn);
+
+    debug("Indexed %s revoked certificates.\n", count);
+}
     
 
 WvCRL::Valid WvCRL::validate(const WvX509 &cacert) const
@@ -455,6 +517,7 @@ void WvCRL::addcert(const WvX509 &cert)
 	X509_CRL_add0_revoked(crl, revoked);
 	ASN1_GENERALIZEDTIME_free(now);
 	ASN1_INTEGER_free(serial);
+	changed();
     }
     else
     {
@@ -0,0 +1,290 @@
+/*
+ * Worldvisions Tunnel Vision Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Works out the digests of lots of files or buffers at once.  See
+ * wvdigestbatch.h.
+ */
+#include "wvdigestbatch.h"
+#include "wvhex.h"
+#include "wvautoconf.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+// how much of a file each thread reads at once
+#define READ_SIZE (1024*1024)
+
+
+WvDigestBatch::WvDigestBatch(const DigestMaker &_maker, int _threads)
+    : digestmaker(_maker), threads(_threads)
+{
+    segment_size = 0;
+    next_unit = 0;
+    if (threads <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? cpus : 1;
+    }
+}
+
+
+WvDigestBatch::~WvDigestBatch()
+{
+    zap();
+}
+
+
+int WvDigestBatch::add(WvStringParm filename)
+{
+    Input *input = new Input;
+    input->filename = filename;
+    input->data = NULL;
+    input->len = 0;
+    input->done = false;
+    inputs.push_back(input);
+    return inputs.size() - 1;
+}
+
+
+int WvDigestBatch::add(const void *data, size_t len)
+{
+    Input *input = new Input;
+    input->data = (const unsigned char *)data;
+    input->len = len;
+    input->done = false;
+    inputs.push_back(input);
+    return inputs.size() - 1;
+}
+
+
+void WvDigestBatch::zap()
+{
+    for (size_t i = 0; i < inputs.size(); i++)
+        delete inputs[i];
+    inputs.clear();
+}
+
+
+bool WvDigestBatch::run()
+{
+    bool success = true;
+
+    // cut the new inputs up into units of work
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        Input *input = inputs[i];
+        if (input->done)
+            continue;
+        input->done = true;
+
+        if (!!input->filename)
+        {
+            struct stat st;
+            if (stat(input->filename, &st) < 0)
+            {
+                input->err = strerror(errno);
+                success = false;
+                continue;
+            }
+            input->len = st.st_size;
+        }
+
+        size_t seglen = input->len;
+        if (segment_size && input->len > segment_size)
+            seglen = segment_size;
+        size_t offset = 0;
+        do
+        {
+            Unit *unit = new Unit;
+            unit->input = input;
+            unit->offset = offset;
+            unit->len = input->len - offset < seglen
+                ? input->len - offset : seglen;
+            // a file digested in one piece is read to the end, whatever
+            // stat() said
+            unit->whole = (seglen == input->len);
+            unit->failure = NULL;
+            unit->err = 0;
+            unit->encoder = digestmaker();
+            units.push_back(unit);
+            offset += seglen;
+        } while (offset < input->len);
+    }
+
+    // everybody grabs the next unit until there aren't any; this thread
+    // works too
+    next_unit = 0;
+    size_t nthreads = threads;
+    if (nthreads > units.size())
+        nthreads = units.size();
+#ifdef HAVE_PTHREAD_H
+    std::vector<pthread_t> tids;
+    for (size_t i = 1; i < nthreads; i++)
+    {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker, this) == 0)
+            tids.push_back(tid);
+    }
+#endif
+    work();
+#ifdef HAVE_PTHREAD_H
+    for (size_t i = 0; i < tids.size(); i++)
+        pthread_join(tids[i], NULL);
+#endif
+
+    // collect the results: segments of the same input are all together
+    for (size_t i = 0; i < units.size(); )
+    {
+        Input *input = units[i]->input;
+        size_t end;
+        for (end = i; end < units.size() && units[end]->input == input; end++)
+        {
+            Unit *unit = units[end];
+            if (!input->err && (unit->failure || unit->err))
+                input->err = unit->failure ? unit->failure
+                    : strerror(unit->err);
+        }
+
+        if (!!input->err)
+            success = false;
+        else if (end - i == 1)
+            input->digest.merge(units[i]->digest);
+        else
+        {
+            WvDigest *digest = digestmaker();
+            WvDynBuf nothing;
+            for (size_t seg = i; seg < end; seg++)
+                digest->encode(units[seg]->digest, nothing);
+            if (!digest->finish(input->digest))
+            {
+                input->err = digest->geterror();
+                success = false;
+            }
+            delete digest;
+        }
+        i = end;
+    }
+
+    for (size_t i = 0; i < units.size(); i++)
+    {
+        delete units[i]->encoder;
+        delete units[i];
+    }
+    units.clear();
+    return success;
+}
+
+
+void *WvDigestBatch::worker(void *userdata)
+{
+    ((WvDigestBatch *)userdata)->work();
+    return NULL;
+}
+
+
+// NOTE: this runs in several threads at once, so it must not touch
+// anything but its own unit.  That includes making, copying or deleting
+// WvStrings, whose reference counts aren't thread-safe, and so anything
+// that has one, like the encoders.
+void WvDigestBatch::work()
+{
+    unsigned char *readbuf = NULL;
+    for (;;)
+    {
+        size_t i = __sync_fetch_and_add(&next_unit, 1);
+        if (i >= units.size())
+            break;
+        Unit &unit = *units[i];
+        if (!readbuf && !!unit.input->filename)
+            readbuf = new unsigned char[READ_SIZE];
+        digest_unit(unit, readbuf);
+    }
+    deletev readbuf;
+}
+
+
+void WvDigestBatch::digest_unit(Unit &unit, unsigned char *readbuf)
+{
+    WvDigest *digest = unit.encoder;
+    WvDynBuf nothing;
+
+    if (!unit.input->filename)
+    {
+        WvConstInPlaceBuf buf(unit.input->data + unit.offset, unit.len);
+        digest->encode(buf, nothing);
+    }
+    else
+    {
+        int fd = open(unit.input->filename.cstr(), O_RDONLY);
+        if (fd < 0)
+            unit.err = errno;
+#ifdef POSIX_FADV_SEQUENTIAL
+        else
+            posix_fadvise(fd, unit.offset, unit.len, POSIX_FADV_SEQUENTIAL);
+#endif
+
+        off_t pos = unit.offset;
+        size_t left = unit.len;
+        while (fd >= 0 && (unit.whole || left))
+        {
+            size_t want = READ_SIZE;
+            if (!unit.whole && want > left)
+                want = left;
+            ssize_t got = pread(fd, readbuf, want, pos);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                unit.err = errno;
+            else if (got == 0 && !unit.whole)
+                unit.failure = "file got shorter while reading it";
+            if (got <= 0)
+                break;
+
+            WvConstInPlaceBuf buf(readbuf, got);
+            digest->encode(buf, nothing);
+            pos += got;
+            if (!unit.whole)
+                left -= got;
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+
+    if (!unit.err && !unit.failure && !digest->finish(unit.digest))
+        unit.failure = "digest failed";
+}
+
+
+bool WvDigestBatch::isok(int i) const
+{
+    return inputs[i]->done && !inputs[i]->err;
+}
+
+
+WvString WvDigestBatch::geterror(int i) const
+{
+    if (!inputs[i]->done)
+        return "not digested yet";
+    return inputs[i]->err;
+}
+
+
+void WvDigestBatch::getdigest(int i, WvBuf &out) const
+{
+    WvDynBuf &digest = inputs[i]->digest;
+    out.put(digest.peek(0, digest.used()), digest.used());
+}
+
+
+WvString WvDigestBatch::hexdigest(int i) const
+{
+    WvDynBuf digest;
+    getdigest(i, digest);
+    return WvHexEncoder().strflushbuf(digest, true);
+}
@@ -4,6 +4,7 @@
  */
 #define OPENSSL_NO_KRB5
 #include "wvsslstream.h"
+#include "wvaddr.h"
 #include "wvx509mgr.h"
 #include "wvcrypto.h"
 #include "wvlistener.h"
@@ -153,7 +154,7 @@ static IWvListener *sslcertlistener(WvStringParm s, IObject *obj)
 static WvMoniker<IWvListener> lreg("ssl", listener);
 static WvMoniker<IWvListener> lsslcertreg("sslcert", sslcertlistener);
 
-#define MAX_BOUNCE_AMOUNT (16384) // 1 SSLv3/TLSv1 record
+#define MAX_RECORD_SIZE (16384 + 2048) // 1 TLS record, with overhead
 
 static int ssl_stream_count = 0;
 
@@ -164,60 +165,113 @@ static int wv_verify_cb(int preverify_ok, X509_STORE_CTX *ctx)
    return 1;
 }
 
-WvSSLGlobalValidateCallback WvSSLStream::global_vcb = 0;
+/*
+ * Setting up an SSL_CTX is expensive, and the server's session cache lives
+ * in it, so all the streams with the same role and certificate share one.
+ * Contexts that nobody is using are kept around (up to a point) for the
+ * next connection, since that's exactly when we need them.
+ *
+ * We identify certificates by their contents rather than by WvX509Mgr
+ * pointer, because the same cert is often loaded into several WvX509Mgr
+ * objects, and a pointer can be reused for a different one.  The context
+ * holds its own references to the certificate and key, so it doesn't need
+ * the WvX509Mgr once it's set up.
+ */
+#define MAX_IDLE_CONTEXTS 8
+#define MAX_CLIENT_SESSIONS 64
 
-WvSSLStream::WvSSLStream(IWvStream *_slave, WvX509Mgr *_x509,
-    WvSSLValidateCallback _vcb, bool _is_server) :
-    WvStreamClone(_slave),
-    debug(WvString("WvSSLStream %s", ++ssl_stream_count), WvLog::Debug5),
-    write_bouncebuf(MAX_BOUNCE_AMOUNT), write_eat(0),
-    read_bouncebuf(MAX_BOUNCE_AMOUNT), read_pending(false)
+struct WvSSLSession
 {
-    x509 = _x509;
-    if (x509)
-	x509->addRef(); // openssl may keep a pointer to this object
+    WvString key;
+    SSL_SESSION *sess;
     
-    vcb = _vcb;
-    if (!vcb && global_vcb)
-	vcb = wv::bind(global_vcb, _1, this);;
+    WvSSLSession(WvStringParm _key, SSL_SESSION *_sess)
+	: key(_key), sess(_sess) { }
+    ~WvSSLSession()
+        { SSL_SESSION_free(sess); }
+};
+DeclareWvList(WvSSLSession);
 
-    is_server = _is_server;
-    ctx = NULL;
-    ssl = NULL;
-    //meth = NULL;
-    sslconnected = ssl_stop_read = ssl_stop_write = false;
+
+struct WvSSLContext
+{
+    WvString id; // role and certificate
+    SSL_CTX *ctx;
+    int refs;
     
-    wvssl_init();
+    /** Client only: the last session with each peer, newest first */
+    WvSSLSessionList sessions;
     
-    if (x509 && !x509->isok())
+    WvSSLContext(WvStringParm _id, SSL_CTX *_ctx)
+	: id(_id), ctx(_ctx), refs(0)
+        { wvssl_init(); }
+    ~WvSSLContext()
     {
-	seterr("Certificate + key pair invalid.");
-	return;
+	sessions.zap(); // before the context they came from
+	SSL_CTX_free(ctx);
+	wvssl_free();
     }
+    
+    SSL_SESSION *find_session(WvStringParm key);
+    static int new_session(SSL *ssl, SSL_SESSION *sess);
+};
+DeclareWvList(WvSSLContext);
 
-    if (is_server && !x509)
+// all the contexts, most recently used first.  Never freed, so that it's
+// still around if a stream is closed during exit.
+static WvSSLContextList *contexts = NULL;
+
+
+SSL_SESSION *WvSSLContext::find_session(WvStringParm key)
+{
+    WvSSLSessionList::Iter i(sessions);
+    for (i.rewind(); i.next(); )
+	if (i->key == key)
+	    return i->sess;
+    return NULL;
+}
+
+
+// OpenSSL calls this when a client gets a session it could resume later:
+// at the end of the handshake or, in TLS 1.3, when the server sends a
+// ticket afterwards.
+int WvSSLContext::new_session(SSL *ssl, SSL_SESSION *sess)
+{
+    WvSSLStream *s = (WvSSLStream *)SSL_get_app_data(ssl);
+    if (!s || !s->shared || !s->session_key)
+	return 0;
+    
+    WvSSLSessionList &sessions = s->shared->sessions;
+    WvSSLSessionList::Iter i(sessions);
+    for (i.rewind(); i.next(); )
     {
-	seterr("Certificate not available: server mode not possible!");
-	return;
+	if (i->key == s->session_key)
+	{
+	    i.xunlink();
+	    break;
+	}
     }
+    if (sessions.count() >= MAX_CLIENT_SESSIONS)
+	sessions.unlink(sessions.last());
+    sessions.prepend(new WvSSLSession(s->session_key, sess), true);
+    return 1; // we keep the reference
+}
+
 
+// Creates and configures a new SSL_CTX, or returns NULL and sets 'err'.
+static SSL_CTX *new_ctx(WvX509Mgr *x509, bool is_server, WvString &err)
+{
+    SSL_CTX *ctx;
     if (is_server)
     {
-    	debug("Configured algorithms and methods for server mode.\n");
-
 	ctx = SSL_CTX_new(SSLv23_server_method());
     	if (!ctx)
     	{
             ERR_print_errors_fp(stderr);
-            debug("Can't get SSL context! Error: %s\n", 
-                  ERR_reason_error_string(ERR_get_error()));
-	    seterr("Can't get SSL context!");
-	    return;
+	    err = "Can't get SSL context!";
+	    return NULL;
     	}
 	
-	// Allow SSL Writes to only write part of a request...
-	SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE);
-
 	// Tell SSL to use 128 bit or better ciphers - this appears to
 	// be necessary for some reason... *sigh*
 	SSL_CTX_set_cipher_list(ctx, "HIGH");
@@ -228,31 +282,142 @@ WvSSLStream::WvSSLStream(IWvStream *_slave, WvX509Mgr *_x509,
 
 	if (!x509->bind_ssl(ctx))
 	{
-	    seterr("Unable to bind Certificate to SSL Context!");
-	    return;
+	    SSL_CTX_free(ctx);
+	    err = "Unable to bind Certificate to SSL Context!";
+	    return NULL;
 	}
 	
         SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER|SSL_VERIFY_CLIENT_ONCE, 
                                wv_verify_cb);
 	
-	debug("Server mode ready.\n");
+	// Remember sessions (and hand out tickets) so that clients can
+	// resume them.  OpenSSL won't resume a session for a server that
+	// asks for client certs unless it has an id context.
+	static const unsigned char sid_ctx[] = "WvSSLStream";
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx) - 1);
     }
     else
     {
-    	debug("Configured algorithms and methods for client mode.\n");
-    
     	ctx = SSL_CTX_new(SSLv23_client_method());
     	if (!ctx)
     	{
-	    seterr("Can't get SSL context!");
-	    return;
+	    err = "Can't get SSL context!";
+	    return NULL;
     	}
         if (x509 && !x509->bind_ssl(ctx))
         {
-            seterr("Unable to bind Certificate to SSL Context!");
-            return;
+	    SSL_CTX_free(ctx);
+            err = "Unable to bind Certificate to SSL Context!";
+            return NULL;
         }
+	
+	// we keep the sessions ourselves, by peer rather than by session id
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT
+				       | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, WvSSLContext::new_session);
+    }
+    return ctx;
+}
+
+
+// Returns a shared context for the given role and certificate, creating it
+// if necessary, or returns NULL and sets 'err'.
+static WvSSLContext *get_context(WvX509Mgr *x509, bool is_server,
+				 WvString &err)
+{
+    WvString id("%s\n%s", is_server ? "server" : "client",
+		x509 ? x509->encode(WvX509::CertPEM) : WvString(""));
+    if (!contexts)
+	contexts = new WvSSLContextList;
+    
+    WvSSLContextList::Iter i(*contexts);
+    for (i.rewind(); i.next(); )
+    {
+	if (i->id == id)
+	{
+	    WvSSLContext *c = i.ptr();
+	    i.xunlink(false);
+	    contexts->prepend(c, true);
+	    c->refs++;
+	    return c;
+	}
+    }
+    
+    SSL_CTX *ctx = new_ctx(x509, is_server, err);
+    if (!ctx)
+	return NULL;
+    WvSSLContext *c = new WvSSLContext(id, ctx);
+    c->refs++;
+    contexts->prepend(c, true);
+    return c;
+}
+
+
+static void release_context(WvSSLContext *c)
+{
+    if (--c->refs > 0)
+	return;
+    
+    // throw out the least recently used idle contexts, if there are too many
+    int idle = 0;
+    WvSSLContextList::Iter i(*contexts);
+    for (i.rewind(); i.next(); )
+    {
+	if (!i->refs && ++idle > MAX_IDLE_CONTEXTS)
+	    i.xunlink();
+    }
+}
+
+
+WvSSLGlobalValidateCallback WvSSLStream::global_vcb = 0;
+bool WvSSLStream::resume_sessions = true;
+
+WvSSLStream::WvSSLStream(IWvStream *_slave, WvX509Mgr *_x509,
+    WvSSLValidateCallback _vcb, bool _is_server) :
+    WvStreamClone(_slave),
+    debug(WvString("WvSSLStream %s", ++ssl_stream_count), WvLog::Debug5),
+    read_pending(false)
+{
+    x509 = _x509;
+    if (x509)
+	x509->addRef(); // openssl may keep a pointer to this object
+    
+    vcb = _vcb;
+    if (!vcb && global_vcb)
+	vcb = wv::bind(global_vcb, _1, this);;
+
+    is_server = _is_server;
+    ctx = NULL;
+    ssl = NULL;
+    shared = NULL;
+    //meth = NULL;
+    sslconnected = ssl_stop_read = ssl_stop_write = ssl_started = false;
+    
+    wvssl_init();
+    
+    if (x509 && !x509->isok())
+    {
+	seterr("Certificate + key pair invalid.");
+	return;
     }
+
+    if (is_server && !x509)
+    {
+	seterr("Certificate not available: server mode not possible!");
+	return;
+    }
+
+    WvString err;
+    shared = get_context(x509, is_server, err);
+    if (!shared)
+    {
+	debug("Can't set up SSL context: %s\n", err);
+	seterr(err);
+	return;
+    }
+    ctx = shared->ctx;
+    debug("%s mode ready.\n", is_server ? "Server" : "Client");
     
     //SSL_CTX_set_read_ahead(ctx, 1);
 
@@ -263,6 +428,21 @@ WvSSLStream::WvSSLStream(IWvStream *_slave, WvX509Mgr *_x509,
     	seterr("Can't create SSL object!");
 	return;
     }
+    SSL_set_app_data(ssl, this);
+    
+    // We move the ciphertext to and from the cloned stream ourselves, so
+    // it can be any kind of stream, and so a big write() turns into
+    // as many records as it needs but only one write() on the cloned
+    // stream.  An empty read BIO means "try again later", not EOF.
+    BIO *rbio = BIO_new(BIO_s_mem()), *wbio = BIO_new(BIO_s_mem());
+    BIO_set_mem_eof_return(rbio, -1);
+    SSL_set_bio(ssl, rbio, wbio);
+    SSL_set_mode(ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER
+		 | SSL_MODE_RELEASE_BUFFERS);
+    if (is_server)
+	SSL_set_accept_state(ssl);
+    else
+	SSL_set_connect_state(ssl);
 
     // If we set this, it seems we always verify the client... security hole,
     // no?  Well, if we don't set it, the server doesn't even ask the client
@@ -307,118 +487,121 @@ void WvSSLStream::printerr(WvStringParm func)
 }
 
  
+void WvSSLStream::fill_rbio()
+{
+    BIO *rbio = SSL_get_rbio(ssl);
+    if (cloned && cloned->isok())
+    {
+	// If this read finds EOF, the cloned stream would close us right
+	// away, before we could decrypt what it already gave us.  We'll
+	// notice ourselves instead.
+	IWvStreamCallback closecb = cloned->setclosecallback(0);
+	
+	unsigned char buf[MAX_RECORD_SIZE];
+	size_t len;
+	do
+	{
+	    len = cloned->read(buf, sizeof(buf));
+	    if (len)
+		BIO_write(rbio, buf, len);
+	} while (len == sizeof(buf));
+	
+	if (cloned->isok())
+	    cloned->setclosecallback(closecb);
+    }
+    
+    // once the other end is gone, SSL should see EOF rather than waiting
+    if (!cloned || !cloned->isok())
+	BIO_set_mem_eof_return(rbio, 0);
+}
+
+
+void WvSSLStream::flush_wbio()
+{
+    BIO *wbio = SSL_get_wbio(ssl);
+    char *data;
+    long len = BIO_get_mem_data(wbio, &data);
+    if (len > 0 && cloned && cloned->isok())
+    {
+	// The cloned stream buffers whatever it can't send right away.  If
+	// the write fails, don't let it close us in the middle of whatever
+	// we were doing; the error will show up in our isok().
+	IWvStreamCallback closecb = cloned->setclosecallback(0);
+	cloned->write(data, len);
+	if (cloned->isok())
+	    cloned->setclosecallback(closecb);
+    }
+    (void)BIO_reset(wbio);
+}
+
+ 
 size_t WvSSLStream::uread(void *buf, size_t len)
 {
     if (!sslconnected)
         return 0;
     if (len == 0) return 0;
 
-    // if SSL buffers stuff on its own, select() may not wake us up
-    // the next time around unless we're sure there is nothing left
-    read_pending = true;
+    fill_rbio();
     
     size_t total = 0;
-    for (;;)
+    int result = 0;
+    while (total < len)
     {
-        // handle SSL_read quirk
-        if (read_bouncebuf.used() != 0)
-        {
-            // copy out cached data
-            size_t amount = len < read_bouncebuf.used() ?
-                len : read_bouncebuf.used();
-            read_bouncebuf.move(buf, amount);
-
-            // locate next chunk in buffer
-            len -= amount;
-            total += amount;
-            if (len == 0)
-	    {
-		read_pending = false;
-                break;
-	    }
-            buf = (unsigned char *)buf + amount;
-	    
-	    // FIXME: this shouldn't be necessary, but it resolves weird
-	    // problems when the other end disconnects in the middle of
-	    // SSL negotiation, but only on emakela's machine.  I don't
-	    // know why.  -- apenwarr (2004/02/10)
-	    break;
-        }
-
-        // attempt to read
-        read_bouncebuf.zap(); // force use of same position in buffer
-        size_t avail = read_bouncebuf.free();
-        unsigned char *data = read_bouncebuf.alloc(avail);
-        
 	ERR_clear_error();
-        int result = SSL_read(ssl, data, avail);
-	// debug("<< SSL_read result %s for %s bytes (wanted %s)\n",
-	//      result, avail, len);
-        if (result <= 0)
-        {
-	    error_t err = errno;
-            read_bouncebuf.unalloc(avail);
-            int sslerrcode = SSL_get_error(ssl, result);
-	    switch (sslerrcode)
-            {
-                case SSL_ERROR_WANT_READ:
-		    debug("<< SSL_read() needs to wait for writable.\n");
-                    break; // wait for later
-                case SSL_ERROR_WANT_WRITE:
-		    debug("<< SSL_read() needs to wait for readable.\n");
-                    break; // wait for later
-                    
-                case SSL_ERROR_NONE:
-                    break; // no error, but can't make progress
-                    
-	        case SSL_ERROR_ZERO_RETURN:
-		    debug("<< EOF: zero return\n");
+        result = SSL_read(ssl, (unsigned char *)buf + total, len - total);
+	if (result <= 0)
+	    break;
+	total += result;
+    }
+    flush_wbio();
+    
+    // If we stopped because the caller's buffer was full, SSL may well
+    // have more for us, and select() won't know about it.  Same if the
+    // other end is gone, since we still have to report the EOF.
+    read_pending = (total == len)
+	|| (total && (!cloned || !cloned->isok()));
+    
+    if (result <= 0)
+    {
+	int sslerrcode = SSL_get_error(ssl, result);
+	switch (sslerrcode)
+	{
+	    case SSL_ERROR_WANT_READ:
+	    case SSL_ERROR_WANT_WRITE:
+	    case SSL_ERROR_NONE:
+		break; // wait for more data from the other end
+		
+	    case SSL_ERROR_ZERO_RETURN:
+		debug("<< EOF: zero return\n");
+		
+		// don't do this if we're returning nonzero!
+		// (SSL has no way to do a one-way shutdown, so if SSL
+		// detects a read problem, it's also a write problem.)
+		if (!total) { noread(); nowrite(); }
+		break;
 		
-		    // don't do this if we're returning nonzero!
-		    // (SSL has no way to do a one-way shutdown, so if SSL
-		    // detects a read problem, it's also a write problem.)
+	    case SSL_ERROR_SYSCALL:
+	    case SSL_ERROR_SSL:
+		if (!cloned || !cloned->isok())
+		{
+		    // the other end went away without saying goodbye
+		    debug("<< EOF: underlying stream closed "
+			  "(%s/%s) total=%s\n", stop_read, stop_write, total);
+		    ERR_clear_error();
 		    if (!total) { noread(); nowrite(); }
-                    break;
-
-		case SSL_ERROR_SYSCALL:
-		    if (!err)
-		    {
-			if (result == 0)
-			{
-			    debug("<< EOF: syscall error "
-				  "(%s/%s, %s/%s) total=%s\n",
-				  stop_read, stop_write,
-				  isok(), cloned && cloned->isok(), total);
-			    
-			    // don't do this if we're returning nonzero!
-			    // (SSL has no way to do a one-way shutdown, so
-			    // if SSL detects a read problem, it's also a
-			    // write problem.)
-			    if (!total) { noread(); nowrite(); }
-			}
-		    }
-		    else
-		    {
-			debug("<< SSL_read() err=%s (%s)\n",
-			    err, strerror(err));
-			seterr_both(err, WvString("SSL read: %s",
-			    strerror(err)));
-		    }
-		    break;
-                    
-                default:
-                    printerr("SSL_read");
-                    seterr("SSL read error #%s", sslerrcode);
-                    break;
-            }
-            read_pending = false;
-            break; // wait for next iteration
-        }
-	// debug("<< read result was %s\n", result);
-	
-	if (result < 0)
-	    result = 0;
-        read_bouncebuf.unalloc(avail - result);
+		}
+		else
+		{
+		    printerr("SSL_read");
+		    seterr("SSL read error #%s", sslerrcode);
+		}
+		break;
+		
+	    default:
+		printerr("SSL_read");
+		seterr("SSL read error #%s", sslerrcode);
+		break;
+	}
     }
 
     // debug("<< read %s bytes (%s, %s)\n",
@@ -431,123 +614,53 @@ size_t WvSSLStream::uwrite(const void *buf, size_t len)
 {
     if (!sslconnected)
     {
-	debug(">> writing, but not connected yet (%s); enqueue.\n", getwfd());
+	debug(">> writing, but not connected yet; enqueue.\n");
         unconnected_buf.put(buf, len);
 	return len;
     }
 
     if (len == 0) return 0;
 
-//    debug(">> I want to write %s bytes.\n", len);
-
-    size_t total = 0;
+    // The write BIO never fills up, so this encrypts everything at once
+    // (unless the other end is renegotiating), and the cloned stream gets
+    // all the records in a single write().
+    ERR_clear_error();
+    int result = SSL_write(ssl, buf, len);
+    flush_wbio();
+    if (result > 0)
+	return result;
     
-    // eat any data that was precached and already written
-    if (write_eat >= len)
-    {
-        write_eat -= len;
-        total = len;
-        len = 0;
-    }
-    else
-    {
-        buf = (const unsigned char *)buf + write_eat;
-        total = write_eat;
-        len -= write_eat;
-        write_eat = 0;
-    }
-
-    // FIXME: WOW!!! Ummm... hope this never spins...
-    // 
-    for (;;) 
+    int sslerrcode = SSL_get_error(ssl, result);
+    switch (sslerrcode)
     {
-        // handle SSL_write quirk
-        if (write_bouncebuf.used() == 0)
-        {
-            if (len == 0) break;
-
-            // copy new data into the bounce buffer only if empty
-            // if it were not empty, then SSL_write probably returned
-            // SSL_ERROR_WANT_WRITE on the previous call and we
-            // must invoke it with precisely the same arguments
-            size_t amount = len < write_bouncebuf.free() ?
-                len : write_bouncebuf.free();
-            write_bouncebuf.put(buf, amount);
-            // note: we don't adjust the total yet...
-        } // otherwise we use what we cached last time in bounce buffer
-        
-        // attempt to write
-        size_t used = write_bouncebuf.used();
-        const unsigned char *data = write_bouncebuf.get(used);
-
-        ERR_clear_error();
-        int result = SSL_write(ssl, data, used);
-	// debug("<< SSL_write result %s for %s bytes\n",
-	//      result, used);
-        if (result <= 0)
-        {
-            int sslerrcode = SSL_get_error(ssl, result);
-            write_bouncebuf.unget(used);
-            switch (sslerrcode)
-            {
-                case SSL_ERROR_WANT_READ:
-                    debug(">> SSL_write() needs to wait for readable.\n");
-                    break; // wait for later
-                case SSL_ERROR_WANT_WRITE:
-                    // debug(">> SSL_write() needs to wait for writable.\n");
-                    break; // wait for later
-                    
-	        case SSL_ERROR_SYSCALL:
-		    debug(">> ERROR: SSL_write() failed on socket error.\n");
-		    seterr(WvString("SSL write error: %s", strerror(errno)));
-		    break;
+	case SSL_ERROR_WANT_READ:
+	case SSL_ERROR_WANT_WRITE:
+	case SSL_ERROR_NONE:
+	    break; // WvStream keeps it in outbuf and tries again later
 	    
-	        // This case can cause truncated web pages... give more info
-	        case SSL_ERROR_SSL:
-		    debug(">> ERROR: SSL_write() failed on internal error.\n");
-		    seterr(WvString("SSL write error: %s", 
-				    ERR_error_string(ERR_get_error(), NULL)));
-		    break;
-		
-	        case SSL_ERROR_NONE:
-                    break; // no error, but can't make progress
-                    
-                case SSL_ERROR_ZERO_RETURN:
-		    debug(">> SSL_write zero return: EOF\n");
-                    close(); // EOF
-                    break;
-                    
-                default:
-                    printerr("SSL_write");
-                    seterr(WvString("SSL write error #%s", sslerrcode));
-                    break;
-            }
-            break; // wait for next iteration
-        }
-	else
-	    assert((size_t)result == used);
-        write_bouncebuf.zap(); // force use of same position in buffer
-        
-        // locate next chunk to be written
-        // note: we assume that initial contents of buf and of the
-        //       bouncebuf match since if we got SSL_ERROR_WANT_WRITE
-        //       we did not claim to actually have written the chunk
-        //       that we cached so we will have gotten it again here
-        if (size_t(result) >= len)
-        {
-            // if we cached more previously than we were given, claim
-            // we wrote what we got and remember to eat the rest later
-            write_eat = result - len;
-            total += len;
-            break;
-        }
-        total += size_t(result);
-        len -= size_t(result);
-        buf = (const unsigned char *)buf + size_t(result);
+	case SSL_ERROR_SYSCALL:
+	    debug(">> ERROR: SSL_write() failed on socket error.\n");
+	    seterr(WvString("SSL write error: %s", strerror(errno)));
+	    break;
+	    
+	// This case can cause truncated web pages... give more info
+	case SSL_ERROR_SSL:
+	    debug(">> ERROR: SSL_write() failed on internal error.\n");
+	    seterr(WvString("SSL write error: %s", 
+			    ERR_error_string(ERR_get_error(), NULL)));
+	    break;
+	    
+	case SSL_ERROR_ZERO_RETURN:
+	    debug(">> SSL_write zero return: EOF\n");
+	    close(); // EOF
+	    break;
+	    
+	default:
+	    printerr("SSL_write");
+	    seterr(WvString("SSL write error #%s", sslerrcode));
+	    break;
     }
-    
-    //debug(">> wrote %s bytes\n", total);
-    return total;
+    return 0;
 }
 
 void WvSSLStream::close()
@@ -559,6 +672,7 @@ void WvSSLStream::close()
     {
         ERR_clear_error();
 	SSL_shutdown(ssl);
+	flush_wbio(); // send the close_notify
 	SSL_free(ssl);
 	ssl = NULL;
 	sslconnected = false;
@@ -566,14 +680,21 @@ void WvSSLStream::close()
     
     WvStreamClone::close();
     
-    if (ctx)
+    if (shared)
     {
-	SSL_CTX_free(ctx);
+	release_context(shared);
+	shared = NULL;
 	ctx = NULL;
     }
 }
 
 
+bool WvSSLStream::resumed() const
+{
+    return ssl && SSL_session_reused(ssl);
+}
+
+
 bool WvSSLStream::isok() const
 {
     return ssl && WvStreamClone::isok();
@@ -618,9 +739,8 @@ void WvSSLStream::pre_select(SelectInfo &si)
 	si.inherit_request = true; // ignore force_select() until connected
     }
     
-    // the SSL library might be keeping its own internal buffers
-    // or we might have left buffered data behind deliberately
-    if (si.wants.readable && (read_pending || read_bouncebuf.used()))
+    // the SSL library might have more for us than we had room for
+    if ((si.wants.readable || readcb) && read_pending)
     {
 	// debug("pre_select: try reading again immediately.\n");
 	si.msec_timeout = 0;
@@ -663,43 +783,45 @@ bool WvSSLStream::post_select(SelectInfo &si)
 	
 	connect_wants.writable = false;
 	
-	// for ssl streams to work, we have to be cloning a stream that
-	// actually uses a single, valid fd.
-        WvFDStream *fdstream = static_cast<WvFDStream*>(cloned);
-        int fd = fdstream->getfd();
-        assert(fd >= 0);
-        ERR_clear_error();
-	SSL_set_fd(ssl, fd);
-//	debug("SSL connected on fd %s.\n", fd);
-	
-	int err;
-    
-	if (is_server)
+	if (!ssl_started)
 	{
-	    // If we are a server, get ready to accept an incoming SSL
-	    // connection
-	    err = SSL_accept(ssl);
+	    ssl_started = true;
+	    if (!is_server && resume_sessions)
+	    {
+		const WvAddr *peer = cloned->src();
+		if (!session_key && peer)
+		    session_key = (WvString)*peer;
+		SSL_SESSION *sess = session_key
+		    ? shared->find_session(session_key) : NULL;
+		if (sess)
+		{
+		    debug("Trying to resume session with %s.\n", session_key);
+		    SSL_set_session(ssl, sess);
+		}
+	    }
 	}
-	else
-	    err = SSL_connect(ssl);
+	fill_rbio();
+        ERR_clear_error();
+	int err = SSL_do_handshake(ssl);
+	flush_wbio();
 	
-	if (err < 0)
+	if (err <= 0)
 	{
-	    if (errno == EAGAIN)
+	    if (SSL_get_error(ssl, err) == SSL_ERROR_WANT_READ
+		    && cloned->isok())
 		debug("Still waiting for SSL negotiation.\n");
-	    else if (!errno)
-            {
-                printerr(is_server ? "SSL_accept" : "SSL_connect");
-		seterr(WvString("SSL negotiation failed (%s)!", err));
-            }
 	    else
             {
                 printerr(is_server ? "SSL_accept" : "SSL_connect");
-		seterr(errno);
+		seterr(WvString("SSL negotiation failed (%s)!", err));
             }
 	}
 	else  // We're connected, so let's do some checks ;)
 	{
+	    // the other end may have sent data right after the handshake,
+	    // and we've already taken it from the cloned stream.
+	    read_pending = true;
+	    
 	    debug("SSL connection using cipher %s.\n", SSL_get_cipher(ssl));
 
 	    WvX509 *peercert = new WvX509(SSL_get_peer_certificate(ssl));
@@ -734,8 +856,7 @@ bool WvSSLStream::post_select(SelectInfo &si)
 	return false;
     }
 
-    if ((si.wants.readable || readcb)
-	&& (read_pending || read_bouncebuf.used()))
+    if ((si.wants.readable || readcb) && read_pending)
 	result = true;
 
     return result;
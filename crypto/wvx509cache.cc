@@ -0,0 +1,121 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2007 Net Integration Technologies, Inc. and others.
+ *
+ * Remembers which certificates were recently found to be signed by which
+ * CA.  See wvx509cache.h.
+ */
+#include "wvx509cache.h"
+#include "wvcrl.h"
+#include <openssl/x509v3.h>
+
+
+// Appends the certificate's SHA-1 fingerprint, in hex, to 'key'.  Once
+// OpenSSL has looked at a certificate's extensions, it remembers its SHA-1
+// digest, so this is a lot cheaper than WvX509::get_fingerprint(), which
+// would otherwise be most of the cost of a hit.
+static bool append_fingerprint(X509 *cert, char *&key)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int len;
+
+    X509_check_purpose(cert, -1, 0);
+    if (!X509_digest(cert, EVP_sha1(), md, &len))
+        return false;
+    for (unsigned int i = 0; i < len; i++)
+    {
+        *key++ = hex[md[i] >> 4];
+        *key++ = hex[md[i] & 15];
+    }
+    *key = 0;
+    return true;
+}
+
+
+WvX509Cache::WvX509Cache(int _max_entries)
+    : hits(0), misses(0), evictions(0),
+      max_entries(_max_entries > 0 ? _max_entries : 1),
+      entries(max_entries / 2 + 1)
+{
+    clock = new Entry *[max_entries];
+    used = hand = 0;
+}
+
+
+WvX509Cache::~WvX509Cache()
+{
+    zap();
+    deletev clock;
+}
+
+
+void WvX509Cache::zap()
+{
+    entries.zap();
+    used = hand = 0;
+}
+
+
+WvX509Cache::Entry *WvX509Cache::add(WvStringParm key)
+{
+    int slot;
+    if (used < max_entries)
+        slot = used++;
+    else
+    {
+        // second chance for anything used since the hand last went by
+        while (clock[hand]->referenced)
+        {
+            clock[hand]->referenced = false;
+            hand = (hand + 1) % max_entries;
+        }
+        entries.remove(clock[hand]);
+        evictions++;
+        slot = hand;
+        hand = (hand + 1) % max_entries;
+    }
+
+    Entry *e = new Entry;
+    e->key = key;
+    e->referenced = false;
+    e->slot = slot;
+    clock[slot] = e;
+    entries.add(e, true);
+    return e;
+}
+
+
+bool WvX509Cache::validate(const WvX509 &cert, WvX509 &cacert,
+                           const WvCRL *crl)
+{
+    // the dates (and a blank certificate)
+    if (!cert.validate())
+        return false;
+
+    char keybuf[EVP_MAX_MD_SIZE * 4 + 2], *k = keybuf;
+    if (!cacert.cert || !append_fingerprint(cert.cert, k))
+        return false;
+    *k++ = ' ';
+    if (!append_fingerprint(cacert.cert, k))
+        return false;
+
+    WvString key(keybuf);
+    unsigned long crlversion = crl ? crl->version() : 0;
+    Entry *e = entries[key];
+    if (e && e->crl == crl && e->crlversion == crlversion)
+    {
+        hits++;
+        e->referenced = true;
+        return e->valid;
+    }
+
+    misses++;
+    if (!e)
+        e = add(key);
+    e->valid = cert.signedbyca(cacert) && cert.issuedbyca(cacert)
+        && !(crl && crl->isrevoked(cert));
+    e->crl = crl;
+    e->crlversion = crlversion;
+    return e->valid;
+}
@@ -23,21 +23,40 @@ WvXOREncoder::~WvXOREncoder()
 }
 
 
+void WvXOREncoder::apply(unsigned char *out, const unsigned char *in,
+			 size_t len)
+{
+    while (len-- > 0)
+    {
+        *out++ = *in++ ^ key[keyoff++];
+        if (keyoff == keylen)
+            keyoff = 0;
+    }
+}
+
+
 bool WvXOREncoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
 {
     size_t len;
     while ((len = inbuf.optgettable()) != 0)
     {
         const unsigned char *data = inbuf.get(len);
-        unsigned char *out = outbuf.alloc(len);
-
-        // FIXME: this loop is SLOW! (believe it or not)
-        while (len-- > 0)
-        {
-            *out++ = (*data++) ^ key[keyoff++];
-            keyoff %= keylen;
-        }
+        apply(outbuf.alloc(len), data, len);
+    }
+    return true;
+}
+
+
+bool WvXOREncoder::_encode_inplace(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    size_t used = inbuf.used(), len;
+    for (size_t offset = 0; offset < used; offset += len)
+    {
+        len = inbuf.optpeekable(offset);
+        unsigned char *data = inbuf.mutablepeek(offset, len);
+        apply(data, data, len);
     }
+    outbuf.merge(inbuf);
     return true;
 }
 
@@ -42,6 +42,7 @@ public:
     virtual bool refresh();
     virtual void commit();
     virtual void set(const UniConfKey &key, WvStringParm value);
+    virtual void setv(const UniConfPairList &pairs);
     virtual WvString get(const UniConfKey &key);
 };
 
@@ -85,6 +85,11 @@ public:
         if (update_after_set)
 	    update(key, value);
     }
+    virtual void setv(const UniConfPairList &pairs)
+    {
+        // every key needs its own set callback
+        setv_naive(pairs);
+    }
 };
 
 
@@ -43,6 +43,23 @@ class UniClientGen : public UniConfGen
 
     int version; /*!< version number of the protocol */
 
+    /**
+     * A subtree request sent by prefetch().  The daemon answers requests
+     * in order, so its results arrive before those of anything we send
+     * afterwards.
+     */
+    struct Prefetch
+    {
+        UniConfKey key;
+        bool recursive;
+        UniListIter *results;
+        bool done, success;
+
+        ~Prefetch();
+    };
+    WvList<Prefetch> prefetches; /*!< in the order they were sent */
+    Prefetch *awaited; /*!< the prefetch do_select() is waiting for */
+
 public:
     /**
      * Creates a generator which can communicate with a daemon using
@@ -69,10 +86,22 @@ public:
     virtual Iter *iterator(const UniConfKey &key);
     virtual Iter *recursiveiterator(const UniConfKey &key);
 
+    /**
+     * Asks the daemon for the subtree without waiting for the answer,
+     * which the next iterator() (or recursiveiterator(), if 'recursive')
+     * on the same key returns.  Asking several generators this way before
+     * iterating over any of them lets their answers arrive in parallel.
+     */
+    virtual void prefetch(const UniConfKey &key, bool recursive);
+
 protected:
     virtual Iter *do_iterator(const UniConfKey &key, bool recursive);
     void conncallback();
     bool do_select();
+
+private:
+    Prefetch *find_prefetch(const UniConfKey &key, bool recursive);
+    bool finish_prefetch(bool success);
 };
 
 
@@ -208,6 +208,14 @@ public:
     void xsetint(WvStringParm key, int value) const
         { (*this)[key].setmeint(value); }
 
+    /**
+     * Stores several values at once, as if by calling setme() on each
+     * subkey of this key in turn.  This is much faster than individual
+     * setme() calls for generators that implement setv() natively, and
+     * the resulting notifications are delivered together at the end.
+     */
+    void setv(const UniConfPairList &pairs) const;
+
 
     /***** Key Handling API *****/
 
@@ -34,6 +34,7 @@ public:
 
 protected:
     UniConf root;
+    UniConfPairList setv_pairs; /*!< pairs received in an unfinished SETV */
 
     virtual void do_invalid(WvStringParm c);
     virtual void do_malformed(UniClientConn::Command);
@@ -41,6 +42,7 @@ protected:
     virtual void do_reply(WvStringParm reply);
     virtual void do_get(const UniConfKey &key);
     virtual void do_set(const UniConfKey &key, WvStringParm value);
+    virtual void do_setv(WvStringParm key, WvStringParm value);
     virtual void do_remove(const UniConfKey &key);
     virtual void do_subtree(const UniConfKey &key, bool recursive);
     virtual void do_haschildren(const UniConfKey &key);
@@ -343,6 +343,20 @@ protected:
     // A naive implementation of setv() that uses only set().
     void setv_naive(const UniConfPairList &pairs);
 
+public:
+    /**
+     * Fills 'sorted' (which does not take ownership) with the pairs from
+     * 'pairs' in key order, so that a generator's setv() can walk each
+     * shared key prefix only once.  Pairs with the same key keep their
+     * relative order.
+     *
+     * Reordering is not safe if a key is deleted after one of its
+     * subkeys was set in the same list; in that case 'sorted' keeps the
+     * original order and this returns false.
+     */
+    static bool sort_pairs(const UniConfPairList &pairs,
+			   UniConfPairList &sorted);
+
 public:
     /**
      * An iterator that's always empty.
@@ -0,0 +1,148 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * Immutable, reference-counted copies of a UniConf tree that can be read
+ * from other threads without locking.
+ */
+#ifndef __UNICONFSNAPSHOT_H
+#define __UNICONFSNAPSHOT_H
+
+#include "uniconfkey.h"
+
+class UniConfValueTree;
+
+/**
+ * A read-only version of a UniConf tree, as published by a
+ * UniConfSnapshotWriter.  Once published, a version never changes; later
+ * changes are published as new versions that share every unchanged subtree
+ * with the old ones.  A version is freed when the last UniConfSnapshot
+ * referring to it goes away.
+ *
+ * Unlike everything else in UniConf, a UniConfSnapshot may be created,
+ * copied, read, and destroyed on any thread, without any locking.  To make
+ * that possible, the read functions deliberately take and return plain
+ * C strings rather than UniConfKey and WvString, whose reference counts
+ * are not thread-safe.  A returned string stays valid for as long as the
+ * snapshot it came from.
+ *
+ * Keys are written as usual ("a/b/c"); as with UniConfKey, repeated
+ * slashes are ignored and segments are compared case-insensitively.
+ */
+class UniConfSnapshot
+{
+public:
+    struct Node;
+    struct Version;
+
+    /** Creates an empty snapshot, in which no key exists. */
+    UniConfSnapshot();
+    UniConfSnapshot(const UniConfSnapshot &other);
+    ~UniConfSnapshot();
+    UniConfSnapshot &operator= (const UniConfSnapshot &other);
+
+    /** Returns the value of 'key', or NULL if it does not exist. */
+    const char *get(const char *key) const;
+
+    /** Returns true if 'key' exists. */
+    bool exists(const char *key) const
+        { return get(key) != NULL; }
+
+    /** Returns true if 'key' exists and has children. */
+    bool haschildren(const char *key) const;
+
+    /**
+     * Returns how many versions, from all writers, haven't been freed
+     * yet.  Only really useful for tests and for hunting leaks.
+     */
+    static int versions();
+
+    class Iter;
+    friend class Iter;
+
+private:
+    Version *version;
+
+    explicit UniConfSnapshot(Version *_version);
+    const Node *find(const char *key) const;
+
+    friend class UniConfSnapshotWriter;
+};
+
+
+/**
+ * Iterates over the immediate children of a key in a UniConfSnapshot, in
+ * sorted order.  The iterator holds its own reference to the snapshot.
+ */
+class UniConfSnapshot::Iter
+{
+public:
+    Iter(const UniConfSnapshot &_snap, const char *key);
+
+    void rewind();
+    bool next();
+
+    /** The name of the current child (only its last segment). */
+    const char *key() const;
+    const char *value() const;
+
+private:
+    UniConfSnapshot snap;
+    const Node *parent;
+    int i;
+};
+
+
+/**
+ * Maintains the working copy of a UniConf tree and publishes it as
+ * UniConfSnapshot versions.  Only one thread (the one that owns the
+ * generator feeding it) may call set(), remove(), rebuild(), and
+ * publish(); any thread may call current().
+ *
+ * Changes are path-copied: set() and remove() copy the nodes from the
+ * root down to the changed key the first time they are touched after a
+ * publish(), and change the copies in place until the next publish(), so
+ * a batch of changes to nearby keys only copies each node once.
+ */
+class UniConfSnapshotWriter
+{
+public:
+    UniConfSnapshotWriter();
+    ~UniConfSnapshotWriter();
+
+    /** Sets 'key' to the non-null 'value', creating its parents. */
+    void set(const UniConfKey &key, WvStringParm value);
+
+    /** Removes 'key' and all of its children. */
+    void remove(const UniConfKey &key);
+
+    /** Replaces the whole working copy with a copy of 'root'. */
+    void rebuild(const UniConfValueTree *root);
+
+    /**
+     * Makes the working copy the current version, if it changed since the
+     * last publish().  Old versions are released once no thread can be
+     * in the middle of picking them up.
+     */
+    void publish();
+
+    /** Returns the most recently published version. */
+    UniConfSnapshot current() const;
+
+private:
+    UniConfSnapshot::Node *working;
+    UniConfSnapshot::Version *retired;
+    unsigned int batch;
+    bool changed;
+
+    // shared with readers, so only accessed atomically
+    mutable UniConfSnapshot::Version * volatile published;
+    mutable volatile int acquiring;
+
+    UniConfSnapshot::Node *copy(UniConfSnapshot::Node *node);
+    UniConfSnapshot::Node *writable(UniConfSnapshot::Node *&slot);
+    UniConfSnapshot::Version *swap(UniConfSnapshot::Version *version);
+    void reclaim();
+};
+
+#endif // __UNICONFSNAPSHOT_H
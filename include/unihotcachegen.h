@@ -0,0 +1,85 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * A UniConf generator that caches a bounded number of recently used keys.
+ */
+#ifndef __UNIHOTCACHEGEN_H
+#define __UNIHOTCACHEGEN_H
+
+#include "unifiltergen.h"
+#include "wvhashtable.h"
+
+/**
+ * A bounded cache of the keys you actually use.
+ *
+ * UniCacheGen keeps a copy of the entire inner tree, and UniFastRegetGen
+ * keeps every key you have ever looked at.  UniHotCacheGen keeps at most
+ * 'max_entries' keys, and when it needs room, throws out one that hasn't
+ * been used recently (using the CLOCK approximation of LRU, which makes a
+ * hit cost no more than a hash lookup).
+ *
+ * Keys that don't exist are cached too, so repeated lookups of missing
+ * keys (for example, UniDefGen trying each of its defaults) don't go to
+ * the inner generator either.
+ *
+ * Cached entries are kept up to date by the inner generator's
+ * notifications, the same way as in UniFastRegetGen: if the inner
+ * generator only sends those from its select loop (eg. UniClientGen), a
+ * value may be stale until the loop has run.  Deleting a key forgets
+ * everything cached under it, and creating one forgets any cached "doesn't
+ * exist" for its parents.  A key whose parent is cached as not existing
+ * is known not to exist without asking.
+ */
+class UniHotCacheGen : public UniFilterGen
+{
+public:
+    UniHotCacheGen(IUniConfGen *_inner, int _max_entries = 1000);
+    virtual ~UniHotCacheGen();
+
+    unsigned long hits;      /*!< get()s answered from the cache */
+    unsigned long misses;    /*!< get()s that went to the inner generator */
+    unsigned long evictions; /*!< entries thrown out to make room */
+
+    /** Returns the number of keys currently cached. */
+    int count() const
+        { return used; }
+
+    /** Forgets everything in the cache. */
+    void zap();
+
+    /***** Overridden members *****/
+    virtual WvString get(const UniConfKey &key);
+    virtual bool exists(const UniConfKey &key);
+    virtual bool haschildren(const UniConfKey &key);
+    virtual void set(const UniConfKey &key, WvStringParm value);
+    virtual void setv(const UniConfPairList &pairs);
+
+protected:
+    virtual void gencallback(const UniConfKey &key, WvStringParm value);
+
+private:
+    struct Entry
+    {
+	UniConfKey key;
+	WvString value;   // null if the key doesn't exist
+	bool referenced;  // used since the clock hand last passed
+	int slot;         // index in 'clock'
+    };
+    DeclareWvDict(Entry, UniConfKey, key);
+
+    EntryDict entries;
+    Entry **clock;
+    int max_entries, used, hand;
+
+    Entry *find(const UniConfKey &key) const
+        { return entries[key]; }
+    void add(const UniConfKey &key, WvStringParm value);
+    void forget(Entry *e);
+    void forget_under(const UniConfKey &key);
+    void forget_parents(const UniConfKey &key);
+    void invalidate(const UniConfKey &key, WvStringParm value);
+};
+
+
+#endif // __UNIHOTCACHEGEN_H
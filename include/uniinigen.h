@@ -49,6 +49,7 @@ public:
     virtual void commit();
     virtual bool refresh();
     virtual void set(const UniConfKey &key, WvStringParm value);
+    virtual void setv(const UniConfPairList &pairs);
 
 private:
 #ifndef _WIN32
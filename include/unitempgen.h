@@ -8,6 +8,7 @@
 #define __UNITEMPGEN_H
 
 #include "uniconfgen.h"
+#include "uniconfsnapshot.h"
 #include "uniconftree.h"
 #include "wvstringcache.h"
 
@@ -20,6 +21,7 @@
 class UniTempGen : public UniConfGen
 {
     WvStringCache scache;
+    UniConfSnapshotWriter *snapshots;
 
 public:
     UniConfValueTree *root; /*!< the root of the tree */
@@ -28,6 +30,23 @@ public:
     UniTempGen();
     virtual ~UniTempGen();
 
+    /**
+     * Switches to read-mostly mode: from now on, every set() or setv()
+     * that changes the tree also publishes an immutable copy of it, which
+     * snapshot() hands out.  The copies share everything that didn't
+     * change, so each change costs a copy of the nodes on its path.
+     * 
+     * Call this before any other thread might call snapshot().
+     */
+    void enable_snapshots();
+
+    /**
+     * Returns the most recently published copy of the tree, or an empty
+     * one if enable_snapshots() was never called.  Unlike everything else
+     * here, this is safe to call from any thread, without locking.
+     */
+    UniConfSnapshot snapshot() const;
+
     /***** Overridden members *****/
 
     virtual WvString get(const UniConfKey &key);
@@ -41,6 +60,23 @@ public:
 
 protected:
     void notify_deleted(const UniConfValueTree *node, void *);
+
+    /**
+     * Sets 'key' to the non-null 'value', given the existing 'node' for
+     * its first 'seg' segments (NULL with seg == 0 if there is no root),
+     * creating any missing nodes below it.  Returns the node for 'key'.
+     */
+    UniConfValueTree *setnode(UniConfValueTree *node, int seg,
+			      const UniConfKey &key, WvStringParm value);
+
+    /** Deletes 'node' (if not NULL) and its children, with notifications. */
+    void removenode(UniConfValueTree *node);
+
+    /**
+     * Publishes a new snapshot of the whole tree, if snapshots are enabled.
+     * Subclasses that replace 'root' directly must call this afterwards.
+     */
+    void resnapshot();
 };
 
 
@@ -92,6 +92,16 @@ public:
      */
     ~UniTransactionGen();
 
+    /**
+     * The number of changes commit() collects before handing them to the
+     * underlying generator in a setv().  A big transaction is committed as
+     * several batches, so it never needs a second complete copy of itself
+     * in memory.  (A batch can be bigger when it has to delete many of a
+     * key's children, since those are found by iterating over the
+     * underlying generator, which mustn't change in the meantime.)
+     */
+    int commit_batch;
+
 
     /***** Overridden methods *****/
     
@@ -107,18 +117,36 @@ public:
 protected:
     UniConfChangeTree *root;
     IUniConfGen *base;
+    int queued; /*!< the number of changes waiting to be flushed */
 
     /**
-     * A recursive helper function for commit().
+     * A recursive helper function for commit().  Appends the set()s
+     * needed to apply 'node' to the underlying generator to 'changes',
+     * handing them over in setv() batches as they pile up.
      */
     void apply_changes(UniConfChangeTree *node,
-		       const UniConfKey &section);
+		       const UniConfKey &section,
+		       UniConfPairList &changes);
 
     /**
      * A recursive helper function for apply_changes().
      */
     void apply_values(UniConfValueTree *newcontents,
-		      const UniConfKey &section);
+		      const UniConfKey &section,
+		      UniConfPairList &changes);
+
+    /**
+     * Adds a change for commit() to hand to the underlying generator.
+     */
+    void queue_change(UniConfPairList &changes, const UniConfKey &key,
+		      WvStringParm value);
+
+    /**
+     * Hands the queued 'changes' to the underlying generator if there are
+     * at least 'min' of them.  Must not be called while iterating over
+     * the underlying generator.
+     */
+    void flush_changes(UniConfPairList &changes, int min);
 
     /**
      * A recursive helper function for refresh().
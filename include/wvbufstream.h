@@ -45,6 +45,13 @@ public:
     virtual void pre_select(SelectInfo &si);
     virtual bool post_select(SelectInfo &si);
     
+    /**
+     * Like write(), but moves the first 'count' bytes of 'buf' into our
+     * inbuf without copying them, where it can.  They're taken out of 'buf'
+     * (and thrown away) even if we're closed.
+     */
+    size_t merge(WvBuf &buf, size_t count);
+    
     void seteof() { eof = true; }
 };
 
@@ -0,0 +1,174 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Tunnel Vision Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * AES-CTR, AES-GCM and ChaCha20-Poly1305 cipher abstractions.
+ */
+#ifndef __WVCIPHER_H
+#define __WVCIPHER_H
+
+#include "wvcrypto.h"
+
+struct evp_cipher_st;
+struct evp_cipher_ctx_st;
+
+/**
+ * @internal
+ * Base class for all ciphers constructed using the OpenSSL EVP API.
+ * OpenSSL picks the fastest implementation it has for the CPU it's
+ * running on (eg. AES-NI) all by itself.
+ *
+ * All of these are stream ciphers, so each byte of input turns into
+ * exactly one byte of output; they work in place (see
+ * WvEncoder::encode_inplace()), and flushing makes no difference.
+ *
+ * The AEAD ciphers (isaead() == true) also authenticate the data:
+ *
+ *  - On finish(), an encryptor writes out a TAGSIZE-byte tag.
+ *  - A decryptor always holds back the last TAGSIZE bytes of its
+ *     input, since they might be the tag.  On finish(), it checks
+ *     them, and if they don't match, finish() fails and isok()
+ *     becomes false.  Everything it decrypted before that is
+ *     untrustworthy until finish() succeeds!
+ *
+ * reset() starts over with the same key and IV, which is only safe
+ * for a decryptor: encrypting two messages with the same IV gives
+ * the game away.  Call setiv() with a fresh one instead.
+ */
+class WvEVPCipherEncoder : public WvCryptoEncoder
+{
+public:
+    enum Mode {
+        Encrypt, /*!< Encrypts (and for AEAD, tags) the data */
+        Decrypt  /*!< Decrypts (and for AEAD, checks) the data */
+    };
+
+    /** The size of an AEAD tag in bytes. */
+    static const size_t TAGSIZE = 16;
+
+    virtual ~WvEVPCipherEncoder();
+
+    /** Returns the key size in bytes. */
+    size_t getkeysize() const
+        { return keysize; }
+
+    /** Returns the IV size in bytes. */
+    size_t getivsize() const
+        { return ivsize; }
+
+    /** Returns true if the cipher authenticates the data as well. */
+    bool isaead() const
+        { return aead; }
+
+    /**
+     * Sets a new key, of getkeysize() bytes, and starts over.
+     * "key" is the new key
+     */
+    virtual void setkey(const void *key);
+    using WvCryptoEncoder::setkey;
+
+    /**
+     * Sets a new IV, of getivsize() bytes, and starts over.
+     * "iv" is the new IV
+     */
+    virtual void setiv(const void *iv);
+
+    /**
+     * Sets the additional data that an AEAD cipher authenticates (but
+     * doesn't encrypt) along with each message, and starts over.
+     * "aad" is the data
+     * "aadlen" is its length in bytes
+     */
+    void setaad(const void *aad, size_t aadlen);
+
+protected:
+    WvEVPCipherEncoder(const evp_cipher_st *_cipher, Mode _mode,
+        bool _aead, const void *_key, size_t _keysize, const void *_iv);
+    virtual bool _encode(WvBuf &inbuf, WvBuf &outbuf, bool flush);
+    virtual bool _isinplace() const
+        { return true; }
+    virtual bool _encode_inplace(WvBuf &inbuf, WvBuf &outbuf, bool flush);
+    virtual bool _finish(WvBuf &outbuf); // outputs or checks the tag
+    virtual bool _reset(); // supported: same key and IV, see above
+
+private:
+    const evp_cipher_st *cipher;
+    evp_cipher_ctx_st *ctx;
+    Mode mode;
+    bool aead;
+    unsigned char *key, *iv;
+    size_t keysize, ivsize;
+    WvDynBuf aad;
+    WvDynBuf tail; // what might be the tag, when decrypting AEAD
+
+    bool init();
+    bool crypt(unsigned char *out, const unsigned char *in, size_t len);
+    bool crypt(WvBuf &inbuf, WvBuf &outbuf, size_t len);
+    bool cryptinplace(WvBuf &buf, size_t len);
+};
+
+
+/**
+ * AES in counter mode.
+ * Takes a 16, 24 or 32 byte key, and a 16 byte IV that is the initial
+ * counter block.
+ */
+class WvAESCTREncoder : public WvEVPCipherEncoder
+{
+public:
+    /**
+     * Creates an AES-CTR encoder.
+     *
+     * "mode" is whether to encrypt or decrypt (the same thing, in CTR)
+     * "key" is the key
+     * "keysize" is the key size in bytes
+     * "iv" is the IV, or NULL for all zeroes
+     */
+    WvAESCTREncoder(Mode mode, const void *key, size_t keysize,
+		    const void *iv = NULL);
+    virtual ~WvAESCTREncoder() { }
+};
+
+
+/**
+ * AES in Galois/Counter Mode, an AEAD cipher.
+ * Takes a 16, 24 or 32 byte key and a 12 byte IV.
+ */
+class WvAESGCMEncoder : public WvEVPCipherEncoder
+{
+public:
+    /**
+     * Creates an AES-GCM encoder.
+     *
+     * "mode" is whether to encrypt or decrypt
+     * "key" is the key
+     * "keysize" is the key size in bytes
+     * "iv" is the IV, or NULL for all zeroes
+     */
+    WvAESGCMEncoder(Mode mode, const void *key, size_t keysize,
+		    const void *iv = NULL);
+    virtual ~WvAESGCMEncoder() { }
+};
+
+
+/**
+ * ChaCha20-Poly1305 (RFC 8439), an AEAD cipher that's fast even without
+ * AES instructions.
+ * Takes a 32 byte key and a 12 byte IV.
+ */
+class WvChaCha20Poly1305Encoder : public WvEVPCipherEncoder
+{
+public:
+    /**
+     * Creates a ChaCha20-Poly1305 encoder.
+     *
+     * "mode" is whether to encrypt or decrypt
+     * "key" is the 32 byte key
+     * "iv" is the IV, or NULL for all zeroes
+     */
+    WvChaCha20Poly1305Encoder(Mode mode, const void *key,
+			      const void *iv = NULL);
+    virtual ~WvChaCha20Poly1305Encoder() { }
+};
+
+#endif // __WVCIPHER_H
@@ -48,12 +48,23 @@ public:
     
 private:
     WvConstInPlaceBuf counterbuf;
+    WvDynBuf keybuf; // key stream for _encode_inplace()
+
+    /**
+     * Appends the key stream for the next "avail" bytes of data to
+     * outbuf, or as much of it as there are whole blocks for, unless
+     * flushing.  Sets "avail" to the number of bytes generated.
+     */
+    bool keystream(WvBuf &outbuf, size_t &avail, bool flush);
 
 protected:
     unsigned char *counter; // auto-incrementing counter
     size_t countersize; // counter size in bytes
     
     virtual bool _encode(WvBuf &inbuf, WvBuf &outbuf, bool flush);
+    virtual bool _isinplace() const
+        { return true; }
+    virtual bool _encode_inplace(WvBuf &inbuf, WvBuf &outbuf, bool flush);
 };
 
 #endif // __WVCOUNTERMODE_H
@@ -20,6 +20,7 @@ struct asn1_string_st;
 typedef struct asn1_string_st ASN1_INTEGER;
 
 class WvX509Mgr;
+class WvStringTable;
 
 /**
  * CRL Class to handle certificate revocation lists and their related
@@ -129,6 +130,8 @@ public:
 
     /**
      * Is the certificate in cert revoked?
+     * The first call builds an index of the revoked serial numbers, so
+     * after that it doesn't matter how big the CRL is.
      */
     bool isrevoked(const WvX509 &cert) const;
     bool isrevoked(WvStringParm serial_number) const;
@@ -144,10 +147,24 @@ public:
      * of memory for large CRLs.
      */
     int numcerts() const;
+
+    /**
+     * Returns a number that changes whenever the list of revoked
+     * certificates might have changed (by decode() or addcert()).  No two
+     * WvCRL objects ever have the same one, so it's safe to remember it
+     * along with an answer from isrevoked() and check it again later.
+     */
+    unsigned long version() const
+        { return ver; }
     
 private:    
     mutable WvLog debug;
     X509_CRL *crl;
+    mutable WvStringTable *revoked_index;
+    unsigned long ver;
+
+    void changed();
+    void build_index() const;
 };
 
 #endif // __WVCRL_H
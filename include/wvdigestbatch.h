@@ -0,0 +1,129 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Tunnel Vision Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Works out the digests of lots of files or buffers at once.
+ */
+#ifndef __WVDIGESTBATCH_H
+#define __WVDIGESTBATCH_H
+
+#include "wvdigest.h"
+#include "wvtr1.h"
+#include <vector>
+
+/**
+ * Works out the digests of a batch of independent inputs (files, or
+ * blocks of memory) at the same time, spread across a few threads.
+ *
+ * Each input gets its own brand new digest encoder from the DigestMaker,
+ * so any kind of WvDigest will do:
+ *
+ *     WvDigestBatch batch(WvDigestBatch::maker<WvSHA1Digest>);
+ *     batch.add("/etc/passwd");
+ *     batch.add("/etc/group");
+ *     batch.run();
+ *     printf("%s\n", batch.hexdigest(0).cstr());
+ *
+ * If segment_size is set, inputs bigger than that are cut into segments
+ * which are digested in parallel too, and the final digest is the digest
+ * (of the same kind) of all of the segments' digests, one after the other.
+ * That makes a single huge file go faster, but of course the answer is
+ * different from digesting the whole thing in one go, so only use it if
+ * the other end does the same.
+ *
+ * The DigestMaker is only ever called from the thread that calls run(),
+ * which makes all of the encoders before starting the worker threads.
+ */
+class WvDigestBatch
+{
+public:
+    typedef wv::function<WvDigest*()> DigestMaker;
+
+    /** A DigestMaker for any WvDigest with a default constructor. */
+    template <class T>
+    static WvDigest *maker()
+        { return new T; }
+
+    /**
+     * Inputs bigger than this many bytes are digested in segments (see
+     * above).  0, the default, means never.
+     */
+    size_t segment_size;
+
+    /**
+     * Creates an empty batch.
+     *
+     * "threads" is how many threads to use at most, or 0 for one per CPU
+     */
+    WvDigestBatch(const DigestMaker &_maker, int _threads = 0);
+    ~WvDigestBatch();
+
+    /** Adds a file to the batch, and returns its index. */
+    int add(WvStringParm filename);
+
+    /**
+     * Adds a block of memory to the batch, and returns its index.
+     * The memory isn't copied, so it has to stay put until run() returns.
+     */
+    int add(const void *data, size_t len);
+
+    /** Returns how many inputs are in the batch. */
+    int count() const
+        { return inputs.size(); }
+
+    /**
+     * Digests everything that was added since the last run().
+     * Returns: true if all of them worked
+     */
+    bool run();
+
+    /** Returns true if input number "i" was digested successfully. */
+    bool isok(int i) const;
+
+    /** Returns the reason input number "i" failed, if it did. */
+    WvString geterror(int i) const;
+
+    /** Appends the digest of input number "i" to "out". */
+    void getdigest(int i, WvBuf &out) const;
+
+    /** Returns the digest of input number "i" in hex. */
+    WvString hexdigest(int i) const;
+
+    /** Forgets all of the inputs and their results. */
+    void zap();
+
+private:
+    struct Input
+    {
+        WvString filename;
+        const unsigned char *data;
+        size_t len;
+        bool done;
+        WvString err;
+        WvDynBuf digest;
+    };
+
+    // one thread's worth of work: all or part of an input
+    struct Unit
+    {
+        Input *input;
+        size_t offset, len;
+        bool whole; // read the file to the end, whatever len says
+        int err; // errno
+        const char *failure; // if it wasn't an errno
+        WvDigest *encoder; // made and deleted outside the worker threads
+        WvDynBuf digest;
+    };
+
+    DigestMaker digestmaker;
+    int threads;
+    std::vector<Input*> inputs;
+    std::vector<Unit*> units;
+    volatile size_t next_unit;
+
+    static void *worker(void *userdata);
+    void work();
+    void digest_unit(Unit &unit, unsigned char *readbuf);
+};
+
+#endif // __WVDIGESTBATCH_H
@@ -164,6 +164,35 @@ public:
         bool finish = false)
         { return encode(inbuf, outbuf, true, finish); }
 
+    /**
+     * Returns true if the encoder can encode_inplace(): every byte of
+     * input turns into exactly one byte of output, which can be written
+     * right over top of it.
+     * 
+     * Returns: true if the encoder works in place
+     * @see _isinplace for the actual implementation
+     */
+    bool isinplace() const
+        { return _isinplace(); }
+
+    /**
+     * Like encode(), but if isinplace() == true, encodes the data right
+     * where it sits in the input buffer and then merge()s it into the
+     * output buffer, so nothing is copied unless merge() has to.  Any
+     * input the encoder can't handle yet stays at the front of the input
+     * buffer, as with encode().  Just calls encode() if the encoder
+     * can't work in place.
+     * 
+     * The input buffer must be writable; don't pass a WvConstInPlaceBuf.
+     * 
+     * "inbuf" is the input buffer
+     * "outbuf" is the output buffer
+     * "flush" is if true, flushes the encoder
+     * Returns: true on success
+     * @see _encode_inplace for the actual implementation
+     */
+    bool encode_inplace(WvBuf &inbuf, WvBuf &outbuf, bool flush = false);
+
     /**
      * Tells the encoder that NO MORE DATA will ever be encoded.
      * 
@@ -177,6 +206,10 @@ public:
      * It is safe to call this function multiple times.
      * The implementation will simply return isok() and do nothing else.
      * 
+     * If it returns false but isok() is still true, there wasn't enough
+     * room in outbuf to finish: the encoder isn't finished yet, and you
+     * can call finish() again once you've made some.
+     * 
      * "outbuf" is the output buffer
      * Returns: true on success
      * @see _finish for the actual implementation
@@ -458,6 +491,36 @@ protected:
      */
     virtual bool _encode(WvBuf &inbuf, WvBuf &outbuf, bool flush) = 0;
 
+    /**
+     * Template method implementation of isinplace().
+     * 
+     * Encoders that return true should also override _encode_inplace().
+     * 
+     * Returns: true if the encoder can encode in place
+     * @see encode_inplace
+     */
+    virtual bool _isinplace() const
+        { return false; }
+
+    /**
+     * Template method implementation of encode_inplace().
+     * 
+     * Only called if _isinplace() == true, and not in any of the cases
+     * where _encode() wouldn't be.  Should change the data in "inbuf"
+     * with mutablepeek(), then merge() as much of it as was encoded into
+     * "outbuf".
+     * 
+     * The default just calls _encode().
+     * 
+     * "inbuf" is the input buffer
+     * "outbuf" is the output buffer
+     * "flush" is if true, flushes the encoder
+     * Returns: true on success
+     * @see encode_inplace
+     */
+    virtual bool _encode_inplace(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+        { return _encode(inbuf, outbuf, flush); }
+
     /**
      * Template method implementation of finish().
      * 
@@ -467,7 +530,9 @@ protected:
      *  - finished == true
      * 
      * 
-     * The encoder is marked finished AFTER this function exits.
+     * The encoder is marked finished AFTER this function exits, unless
+     * it returns false without setting an error, which means it needs
+     * more room in outbuf and should be called again.
      * 
      * Many implementations do not need to override this.
      * 
@@ -534,6 +599,8 @@ public:
     
 protected:
     virtual bool _encode(WvBuf &in, WvBuf &out, bool flush);
+    virtual bool _isinplace() const
+        { return true; } // trivially: merge() is all we do anyway
     virtual bool _reset(); // supported: resets the count to zero
 };
 
@@ -545,6 +612,10 @@ protected:
  * Supports reset() if all the encoders it contains also support
  * reset().
  * 
+ * Encoders that can work in place (see WvEncoder::isinplace()) do so
+ * on the chain's own intermediate buffers, so a run of them just hands
+ * the same data down the chain without copying it.
+ * 
  */
 class WvEncoderChain : public WvEncoder
 {
@@ -673,6 +744,18 @@ protected:
      * Returns true iff all encoders return true.
      */
     virtual bool _encode(WvBuf &in, WvBuf &out, bool flush);
+
+    /**
+     * Returns true if all of the encoders in the chain work in place.
+     */
+    virtual bool _isinplace() const;
+
+    /**
+     * Passes the data through the entire chain of encoders, starting
+     * with the first one working right on top of "in".
+     * Returns true iff all encoders return true.
+     */
+    virtual bool _encode_inplace(WvBuf &in, WvBuf &out, bool flush);
     
     /**
      * Finishes the chain of encoders.
@@ -698,9 +781,13 @@ protected:
     virtual bool _reset();
     
 private:
-    /** Used by _encode() and _finish() */
+    /**
+     * Used by _encode() and _finish().  Encoders only work in place on
+     * "in" itself if "inplace" is true; the chain's own buffers are
+     * always fair game.
+     */
     bool do_encode(WvBuf &in, WvBuf &out, ChainElem *start_after,
-		   bool flush, bool finish);
+		   bool flush, bool finish, bool inplace = false);
 };
 
 #endif // __WVENCODER_H
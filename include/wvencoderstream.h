@@ -40,7 +40,9 @@ class WvEncoderStream : public WvStreamClone
     WvDynBuf readinbuf;
     WvDynBuf readoutbuf;
     WvDynBuf writeinbuf;
-    //WvDynBuf writeoutbuf;
+    WvDynBuf writeoutbuf;
+    WvDynBuf readtmpbuf;
+    bool batched; // writeinbuf has a partial write_batch in it
 
 public:
     /** Encoder chain through which input data is passed. */
@@ -72,6 +74,32 @@ public:
      */
     size_t min_readsize;
 
+    /**
+     * If nonzero, write() doesn't run the write chain every time.  Small
+     * writes pile up until there are at least this many bytes, until
+     * flush() or flush_write(), or until the end of the current trip
+     * through select(), and then all go through the chain together.
+     * That means one gzip flush (say) per batch instead of one per
+     * write(), which compresses a lot better and is a lot faster when
+     * there are many small writes.
+     * 
+     * While anything is waiting, select() doesn't wait for anything else,
+     * so it's never held up for long.  Defaults to 0, meaning each
+     * write() goes through the chain right away.
+     */
+    size_t write_batch;
+    
+    /**
+     * Whether to flush the read chain every time something is read from
+     * the underlying stream.  That's the default, because otherwise
+     * there's no good way to know when it's needed; but most decoders
+     * (like WvGzipEncoder's Inflate mode) give out everything they can
+     * whether they're flushed or not, and skipping it saves them work.
+     * If false, the read chain is only flushed by flush_read(),
+     * finish_read(), and at EOF.
+     */
+    bool read_flush;
+
     /**
      * Creates an encoder stream.
      *
@@ -145,6 +173,7 @@ public:
 
     virtual size_t uread(void *buf, size_t size);
     virtual size_t uwrite(const void *buf, size_t size);
+    virtual bool should_flush();
     
 protected:
     void pre_select(SelectInfo &si);
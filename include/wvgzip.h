@@ -40,14 +40,67 @@ public:
         Inflate  /*!< Decompress using inflate */
     };
     
+    enum Format {
+        Zlib, /*!< zlib header and checksum (the default) */
+        Gzip, /*!< gzip header and checksum, as in .gz files */
+        Raw,  /*!< just the deflate data, with no header or checksum */
+        Auto  /*!< Inflate only: Zlib or Gzip, whichever it turns out to be */
+    };
+    
+    /** How deflate looks for matches; the same as zlib's Z_*_STRATEGY. */
+    enum Strategy {
+        DefaultStrategy = 0,
+        Filtered = 1,    /*!< for data that's mostly small, varied values */
+        HuffmanOnly = 2, /*!< no matching, just Huffman coding */
+        Rle = 3,         /*!< only runs of the same byte; fast */
+        Fixed = 4        /*!< no dynamic Huffman trees */
+    };
+    
     /**
      * Creates a Gzip encoder.
      *
      * "mode" is the compression mode
      */
     WvGzipEncoder(Mode mode, size_t _out_limit = 0);
+    
+    /**
+     * Creates a Gzip encoder with more control over how it compresses.
+     * 
+     * "level" is 0 (no compression) to 9 (best, and slowest); the other
+     *     constructor uses 1.  Ignored when decompressing.
+     * "format" is the framing around the compressed data.  Both ends have
+     *     to agree on it, except that Auto can inflate either Zlib or Gzip.
+     * "window_bits" is 8 to 15, the log of the size of the history
+     *     window.  Inflating needs at least as big a window as was used
+     *     to deflate.
+     * "mem_level" is 1 to 9: how much memory deflate uses for its state.
+     *     More is faster and compresses better.
+     */
+    WvGzipEncoder(Mode mode, int level, Format format = Zlib,
+                  Strategy strategy = DefaultStrategy, int window_bits = 15,
+                  int mem_level = 8);
     virtual ~WvGzipEncoder();
 
+    /**
+     * Use a preset dictionary: data that the compressed data is likely to
+     * have a lot in common with, like a list of the keys that show up in
+     * every message.  Both ends have to use the same one.  It's kept
+     * across reset(), so it can prime each message in a stream of them.
+     * Not available with the Gzip format.
+     * 
+     * Must be set before anything is deflated; when inflating, it can be
+     * set any time before it's needed.
+     */
+    bool set_dictionary(const void *dict, size_t len);
+    
+    /**
+     * Change the compression level and strategy for data from now on;
+     * everything given to encode() so far is compressed the old way first.
+     * If a fixed-size output buffer fills up before that's done, encode()
+     * returns false (without an error) until you make some room.
+     */
+    bool set_level(int level, Strategy strategy = DefaultStrategy);
+
     /**
      * Limit the amount of output produced in one call to encode().
      * Defaults to 0, meaning no limit (empty the input buffer).
@@ -81,12 +134,18 @@ protected:
 
 private:
     struct z_stream_s *zstr;
-    WvInPlaceBuf tmpbuf;
     Mode mode;
+    Format format;
+    int level, strategy, window_bits, mem_level;
+    WvDynBuf dictionary;
+    bool new_level;
     size_t output;
 
     void init();
     void close();
+    bool use_dictionary();
+    bool apply_level(WvBuf &outbuf);
+    size_t room(WvBuf &outbuf);
     void prepare(WvBuf *inbuf);
     bool process(WvBuf &outbuf, bool flush, bool finish);
 };
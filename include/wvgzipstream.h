@@ -28,6 +28,24 @@ public:
 	    readchain.append(new WvGzipEncoder(readmode), true);
 	    writechain.append(new WvGzipEncoder(writemode), true);
 	}
+    
+    /**
+     * Compress what's written at the given level, in the given format, and
+     * decompress what's read (which can be in either the Zlib or the Gzip
+     * format if 'format' is Auto).
+     */
+    WvGzipStream(WvStream *_cloned, int level, WvGzipEncoder::Format format,
+		 WvGzipEncoder::Strategy strategy
+		     = WvGzipEncoder::DefaultStrategy)
+        : WvEncoderStream(_cloned)
+	{
+	    readchain.append(new WvGzipEncoder(WvGzipEncoder::Inflate,
+					       0, format), true);
+	    writechain.append(new WvGzipEncoder(WvGzipEncoder::Deflate,
+			level, format == WvGzipEncoder::Auto
+				? WvGzipEncoder::Zlib : format, strategy), true);
+	}
+    
     virtual ~WvGzipStream() { }
 
 public:
@@ -92,7 +92,14 @@ public:
     int status;
     WvHTTPHeaderDict headers;
 
-    WvBufUrlStream() : err(0), status(0), headers(10)
+    // If this is set (before the body arrives), the body is written
+    // straight to this file descriptor, which is still yours, instead of
+    // being read from this stream.  For plain HTTP on Linux, it's moved
+    // from the socket with splice(), so it never comes into userspace at
+    // all; use it for mirroring big files.
+    int body_fd;
+
+    WvBufUrlStream() : err(0), status(0), headers(10), body_fd(-1)
         {}
     virtual ~WvBufUrlStream()
         {}
@@ -166,6 +173,14 @@ public:
     virtual size_t remaining()
         { return 0; }
     
+    /** the number of requests given to us that we haven't finished yet */
+    int load() const
+        { return urls.count() + waiting_urls.count(); }
+    
+    /** true if we'll hang up after the requests we already have */
+    bool retiring() const
+        { return request_count + (int)waiting_urls.count() >= max_requests; }
+    
     virtual void execute() = 0;
     
 public:
@@ -175,6 +190,7 @@ public:
 unsigned WvHash(const WvUrlStream::Target &n);
 
 DeclareWvDict(WvUrlStream, WvUrlStream::Target, target);
+DeclareWvList(WvUrlStream);
 
 
 class WvHttpStream : public WvUrlStream
@@ -184,6 +200,9 @@ public:
     static WvString pipeline_check_filename;
     bool enable_pipelining, expect_keep_alive;
     
+    /** how long (in ms) to keep the connection open with nothing to do */
+    int idle_timeout;
+    
 private:
     int pipeline_test_count;
     bool ssl;
@@ -196,6 +215,7 @@ private:
 	   ChuckInfinity, ChuckChunked, ChuckStream } encoding;
     size_t bytes_remaining;
     bool in_chunk_trailer, last_was_pipeline_test, in_doneurl;
+    int splice_pipe[2];
 
     virtual void doneurl();
     virtual void request_next();
@@ -203,6 +223,9 @@ private:
     WvString request_str(WvUrlRequest *url, bool keep_alive);
     void send_request(WvUrlRequest *url);
     void pipelining_is_broken(int why);
+    size_t pass_body(size_t max);
+    bool splice_body(WvBufUrlStream *outstream, size_t max, size_t &len);
+    void write_body(WvBufUrlStream *outstream, size_t len);
     
 public:
     WvHttpStream(const WvIPPortAddr &_remaddr, WvStringParm _username,
@@ -260,14 +283,30 @@ public:
 };
 
 
+/**
+ * Fetches URLs over as few connections as it can.  By default, that's one
+ * connection per server (and username), with requests pipelined on it when
+ * the server can handle that.  With set_max_conns(), up to that many
+ * connections are opened to each server, and each new request goes to
+ * whichever one has the fewest requests outstanding; that's what you want
+ * for fetching lots of files from servers that can't pipeline, or that are
+ * slow to answer each request.  Once they're all open, new requests queue
+ * up behind the least busy one.
+ *
+ * Connections with nothing to do are kept around for the keepalive time
+ * (see set_keepalive()), so the next request to the same server doesn't
+ * have to connect again.  'requests' and 'reused' count how well that's
+ * working.
+ */
 // FIXME: Rename this to WvUrlPool someday.
 class WvHttpPool : public WvIStreamList
 {
     WvLog log;
     WvResolver dns;
-    WvUrlStreamDict conns;
+    WvUrlStreamList conns;
     WvUrlRequestList urls;
     int num_streams_created;
+    int max_conns, keepalive;
     bool sure;
     
     WvIPPortAddrTable pipeline_incompatible;
@@ -276,6 +315,21 @@ public:
     WvHttpPool();
     virtual ~WvHttpPool();
     
+    /** requests handed to a connection, and how many found an idle one */
+    unsigned long requests, reused;
+    
+    /** the number of connections opened so far */
+    int num_created() const
+        { return num_streams_created; }
+    
+    /** allow up to 'per_target' simultaneous connections to each server */
+    void set_max_conns(int per_target)
+        { max_conns = per_target > 0 ? per_target : 1; }
+    
+    /** keep idle HTTP connections open for 'msec' milliseconds */
+    void set_keepalive(int msec)
+        { keepalive = msec; }
+    
     virtual void pre_select(SelectInfo &si);
     virtual bool post_select(SelectInfo &si);
     virtual void execute();
@@ -291,6 +345,7 @@ public:
 //			      WvStream *s, bool create_dirs = false);
 private:
     void unconnect(WvUrlStream *s);
+    WvUrlStream *find_stream(WvUrlRequest *url);
     
 public:
     bool idle() const 
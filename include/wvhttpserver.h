@@ -0,0 +1,221 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A small event-driven HTTP/1.1 server, for status pages, metrics and
+ * other little web interfaces to programs that are already running a
+ * WvStreams main loop.
+ *
+ * Create a WvHttpServer, give it some routes and something to listen on,
+ * and add it to your list:
+ *
+ *     WvHttpServer http;
+ *     http.route("/status", wv::bind(show_status, _1, _2));
+ *     http.listen("tcp:0.0.0.0:8080");
+ *     WvIStreamList::globallist.append(&http, false, "http server");
+ */
+#ifndef __WVHTTPSERVER_H
+#define __WVHTTPSERVER_H
+
+#include "wvistreamlist.h"
+#include "wvstreamclone.h"
+#include "iwvlistener.h"
+#include "wvlog.h"
+
+class WvHttpConn;
+class WvHttpServer;
+
+
+/**
+ * One request, as parsed by WvHttpConn.  All the strings point into a
+ * buffer that belongs to the connection, so they're only good until the
+ * response is finished; copy anything you need to keep.
+ */
+class WvHttpRequest
+{
+    friend class WvHttpConn;
+
+public:
+    const char *method;   // "GET", "POST", etc.
+    const char *path;     // "/status", without the query string
+    const char *query;    // what came after the '?', or "" if nothing did
+    int version;          // 10 for HTTP/1.0, 11 for HTTP/1.1
+    bool keepalive;       // false if we'll hang up after the response
+
+    /** the request body, which is still sitting in the connection's inbuf */
+    const unsigned char *body;
+    size_t body_len;
+
+    /** the value of the named header (any case), or NULL if it's not there */
+    const char *header(const char *name) const;
+
+    /** the number of headers, and their names and values */
+    int num_headers() const
+        { return nheaders; }
+    const char *header_name(int i) const
+        { return headers[i].name; }
+    const char *header_value(int i) const
+        { return headers[i].value; }
+
+private:
+    enum { MaxHeaders = 64 };
+    struct Header
+    {
+        const char *name, *value;
+    };
+    Header headers[MaxHeaders];
+    int nheaders;
+};
+
+
+/**
+ * A connection to a WvHttpServer.  It parses requests straight out of its
+ * input buffer, including pipelined ones, and hands them one at a time to
+ * the server's routes.  The next request isn't even looked at until the
+ * handler finishes responding to the last one, which it can do right away
+ * with respond(), or later (say, from a callback of its own), or bit by bit
+ * with start_response(), send() and end_response().
+ *
+ * When sending a long response bit by bit, set a producer callback with
+ * set_producer(): it's called again whenever everything sent so far has
+ * been handed to the socket, so we never buffer more than one bit of the
+ * response at a time, no matter how slow the client is.
+ */
+class WvHttpConn : public WvStreamClone
+{
+public:
+    typedef wv::function<void(WvHttpConn &)> Producer;
+
+    WvHttpConn(IWvStream *_cloned, WvHttpServer &_server);
+    virtual ~WvHttpConn();
+
+    /** the request we're currently responding to, if any */
+    const WvHttpRequest *request() const
+        { return busy ? &req : NULL; }
+
+    /** send a complete response */
+    void respond(int status, WvStringParm content_type, WvStringParm body,
+                 WvStringParm headers = WvString::null);
+    void respond(int status, WvStringParm content_type, WvBuf &body,
+                 WvStringParm headers = WvString::null);
+
+    /**
+     * Start a response whose length we don't know yet: it's sent chunked
+     * to HTTP/1.1 clients, and to HTTP/1.0 clients we just hang up at the
+     * end.  'headers' are extra header lines, each ending in "\r\n".
+     */
+    void start_response(int status, WvStringParm content_type,
+                        WvStringParm headers = WvString::null);
+
+    /** send part of the response started with start_response() */
+    void send(const void *data, size_t len);
+    void send(WvStringParm s)
+        { send(s.cstr(), s.len()); }
+    void send(WvBuf &buf);
+
+    /** finish the response started with start_response() */
+    void end_response();
+
+    /**
+     * Call 'producer' whenever we're in the middle of a response and the
+     * last thing we sent has all gone to the socket.  It should send()
+     * some more, or end_response().  Cleared at the end of each response.
+     */
+    void set_producer(Producer _producer)
+        { producer = _producer; }
+
+    /** true if we're still waiting to hand some output to the socket */
+    bool congested() const
+        { return outbuf.used() || out.used(); }
+
+    virtual void pre_select(SelectInfo &si);
+    virtual bool post_select(SelectInfo &si);
+
+protected:
+    virtual void execute();
+
+private:
+    WvHttpServer &server;
+    WvLog log;
+    WvHttpRequest req;
+    char *head;           // our copy of the headers; the body stays in inbuf
+    size_t head_size;
+    size_t scanned, need; // how much of inbuf we know isn't a whole request
+    size_t consumed;      // how much of inbuf the current request takes up
+    bool busy, chunked, head_only, in_execute;
+    Producer producer;
+    WvDynBuf out;         // responses not written yet, to write all at once
+
+    bool parse_request();
+    bool parse_head(size_t len);
+    void fail(int status);
+    void send_head(int status, WvStringParm content_type,
+                   WvStringParm headers, long content_length);
+    void put_chunk_size(size_t len);
+    void done();
+    void flush_out();
+
+public:
+    const char *wstype() const { return "WvHttpConn"; }
+};
+
+
+/**
+ * An HTTP/1.1 server: a list of connections, plus the listeners that
+ * accept them, and the routing table that decides who answers each
+ * request.
+ */
+class WvHttpServer : public WvIStreamList
+{
+public:
+    typedef wv::function<void(WvHttpConn &, const WvHttpRequest &)> Handler;
+
+    WvHttpServer();
+    virtual ~WvHttpServer();
+
+    /**
+     * Start accepting connections on 'moniker', which is anything
+     * IWvListener::create() understands: "tcp:0.0.0.0:80",
+     * "unix:/var/run/foo", "sslcert:tcp:0.0.0.0:443", and so on.  Returns
+     * the listener, which we own; check its isok() to see if it worked.
+     */
+    IWvListener *listen(WvStringParm moniker);
+
+    /**
+     * Send requests for 'path' to 'handler'.  A path ending in '/' also
+     * matches everything underneath it; when more than one route matches,
+     * the longest one wins.  Requests that match nothing get a 404.
+     */
+    void route(WvStringParm path, Handler handler);
+
+    /** Called by WvHttpConn to find and call the handler for 'req'. */
+    void dispatch(WvHttpConn &conn, const WvHttpRequest &req);
+
+    size_t max_header_size;  // bigger request headers get a 431
+    size_t max_body_size;    // bigger request bodies get a 413
+    int idle_timeout;        // ms before hanging up on an idle client
+
+    unsigned long connections, requests;
+
+private:
+    class Route
+    {
+    public:
+        WvString path;
+        Handler handler;
+
+        Route(WvStringParm _path, Handler _handler)
+            : path(_path), handler(_handler) { }
+    };
+    DeclareWvList(Route);
+    RouteList routes;
+    WvLog log;
+
+    void accept_conn(IWvStream *s);
+
+public:
+    const char *wstype() const { return "WvHttpServer"; }
+};
+
+
+#endif // __WVHTTPSERVER_H
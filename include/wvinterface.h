@@ -23,6 +23,8 @@ struct rtentry;
  */
 class WvInterface
 {
+    friend class WvInterfaceDict;
+    
     WvAddr *my_hwaddr;
     WvIPNet *my_ipaddr;
     
@@ -157,6 +159,10 @@ public:
     
     //operator WvInterfaceDictBase ()
     //    { return slist; }
+    
+private:
+    /** fill the list using rtnetlink; returns false if we can't */
+    bool update_netlink();
 };
 
 #endif // __WVINTERFACE_H
@@ -9,6 +9,11 @@
  * They need you to have created the appropriate firewall tables already,
  * however, and call them from the right places in the Input and/or Forward
  * firewalls.
+ *
+ * Rule changes are sent to the kernel with "iptables-restore --noflush",
+ * so a whole set of them goes in at once instead of running iptables once
+ * per rule.  Use begin() and commit() around a bunch of changes to send
+ * them all in one transaction.
  */
 #ifndef __WVIPFIREWALL_H
 #define __WVIPFIREWALL_H
@@ -16,6 +21,7 @@
 #include "wvinterface.h"
 #include "wvstringlist.h"
 #include "wvaddr.h"
+#include "wvtr1.h"
 
 
 DeclareWvList(WvIPPortAddr);
@@ -89,10 +95,23 @@ class WvIPFirewall : public IWvIPFirewall
 	    { dstport = _dstport; }
     };
 
+    /** One "-A" or "-D" line, waiting to be sent to iptables-restore */
+    class Change
+    {
+    public:
+	WvString table, rule;
+	bool add;
+	
+	Change(const char *_table, bool _add, WvStringParm _rule)
+	    : table(_table), rule(_rule)
+	    { add = _add; }
+    };
+
     DeclareWvList(FFwd);
     DeclareWvList(Redir);
     DeclareWvList(RedirAll);
     DeclareWvList(RedirPortRange);
+    DeclareWvList(Change);
 
     FFwdList ffwds;
     RedirList redirs;
@@ -102,27 +121,51 @@ class WvIPFirewall : public IWvIPFirewall
     WvIPPortAddrList addrs;
     WvStringList protos;
     
-    WvString port_command(const char *cmd, const char *proto,
-			  const WvIPPortAddr &addr);
-    WvString redir_command(const char *cmd,
-			   const WvIPPortAddr &src, int dstport);
-    WvString redir_port_range_command(const char *cmd,
+    ChangeList changes;
+    int holding;
+    
+    void port_command(bool add, const char *proto, const WvIPPortAddr &addr);
+    void redir_command(bool add, const WvIPPortAddr &src, int dstport);
+    void redir_port_range_command(bool add,
     	const WvIPPortAddr &src_min, const WvIPPortAddr &src_max, int dstport);
-    WvString redir_all_command(const char *cmd, int dstport);
-    WvString proto_command(const char *cmd, const char *proto);
-    WvString forward_command(const char *cmd, const char *proto,
-			     const WvIPPortAddr &src,
-			     const WvIPPortAddr &dst, bool snat);
+    void redir_all_command(bool add, int dstport);
+    void proto_command(bool add, const char *proto);
+    void forward_command(bool add, const char *proto,
+			 const WvIPPortAddr &src,
+			 const WvIPPortAddr &dst, bool snat);
+    void change(const char *table, bool add, WvStringParm rule);
+    void apply();
     WvLog log;
-    const char *shutup() const
-        { return ignore_errors ? " >/dev/null 2>/dev/null " : ""; }
     
 public:
+    /**
+     * Something that feeds a ruleset to "iptables-restore --noflush" (or
+     * pretends to), returning true if it was accepted.
+     */
+    typedef wv::function<bool(WvStringParm rules)> Runner;
+    
     WvIPFirewall();
     virtual ~WvIPFirewall();
     
     static bool enable, ignore_errors;
     
+    /**
+     * Where to send rule changes; iptables_restore() by default.  Replace
+     * it to see what would be done without being root.
+     */
+    Runner runner;
+    
+    /** Run iptables-restore --noflush with 'rules' as its input. */
+    static bool iptables_restore(WvStringParm rules);
+    
+    /**
+     * Keep rule changes to ourselves until the matching commit(), and then
+     * send them all at once.  Rules that were added and then deleted in
+     * between never get sent at all.  These calls can be nested.
+     */
+    void begin();
+    void commit();
+    
     virtual void zap();
     virtual void add_port(const WvIPPortAddr &addr);
     virtual void add_redir(const WvIPPortAddr &src, int dstport);
@@ -11,7 +11,24 @@
 #include "iwvlistener.h"
 #include "wvstreamclone.h"  // FIXME needed *only* for CompatCallback
 #include "wvattrs.h"
+#include "wvaddr.h"
+#include "wvistreamlist.h"
 
+/**
+ * A base class for listeners.  When an onaccept() callback is set, each
+ * time the listener becomes readable, callback() calls accept() repeatedly
+ * (up to set_accept_batch() times, or until it returns NULL) and hands the
+ * new connections to the callback, so a burst of connections doesn't
+ * overflow the kernel's listen queue while we go around the select loop
+ * once for each of them.  That means accept() must return NULL, not
+ * block, when there are no more connections waiting.
+ *
+ * set_max_connections() limits how many of the connections given to the
+ * callback may be open at once.  Connections beyond the limit wait in a
+ * queue of their own until one closes, and once that is full too, are
+ * refused (accepted and immediately closed) so that clients find out
+ * right away instead of timing out.
+ */
 class WvListener : public IWvListener
 {
     IMPLEMENT_IOBJECT(WvListener);
@@ -21,6 +38,10 @@ public:
     IWvListenerCallback acceptor;
     IWvListenerWrapper wrapper;
     
+    unsigned long accepted; /*!< connections given to the onaccept() callback */
+    unsigned long refused;  /*!< connections closed for lack of room */
+    unsigned long queued;   /*!< connections that had to wait for a slot */
+    
     WvListener(IWvStream *_cloned);
     virtual ~WvListener();
     
@@ -30,6 +51,32 @@ public:
     IWvStream *wrap(IWvStream *s);
     void runonce(time_t msec_delay);
     
+    /**
+     * Set the most connections callback() will accept() each time it runs.
+     * The default is 16; 1 gives the old one-connection-per-select
+     * behaviour.
+     */
+    void set_accept_batch(int _accept_batch);
+    
+    /**
+     * Allow at most 'max_active' connections given to the onaccept()
+     * callback to be open at once (0, the default, means no limit), and
+     * up to 'max_waiting' more to wait for one of them to close.
+     * 
+     * To know when a connection goes away, the listener keeps a reference
+     * to each one until it is closed or everyone else has released it, so
+     * with a limit set, you must release() accepted streams rather than
+     * deleting them.
+     */
+    void set_max_connections(int _max_active, int _max_waiting = 0);
+    
+    /** The number of accepted connections still open, if limited. */
+    int num_active();
+    
+    /** The number of connections waiting for a slot. */
+    int num_waiting() const
+        { return waiting.count(); }
+    
     //
     // IWvStream default implementation.
     //
@@ -50,10 +97,8 @@ public:
     virtual const WvAddr *src() const
         { return cloned ? cloned->src() : NULL; }
     
-    virtual void pre_select(SelectInfo &si)
-        { if (cloned) cloned->pre_select(si); }
-    virtual bool post_select(SelectInfo &si)
-        { return cloned ? cloned->post_select(si) : false; }
+    virtual void pre_select(SelectInfo &si);
+    virtual bool post_select(SelectInfo &si);
     
     virtual size_t read(void *buf, size_t count)
         { return 0; }
@@ -98,6 +143,21 @@ public:
     virtual void outbuf_limit(size_t size)
         { }
     virtual WvString getattr(WvStringParm name) const;
+    
+protected:
+    /**
+     * Accept a socket from our listening fd, already non-blocking and
+     * close-on-exec where the system can do that in the same call.
+     * Returns the new fd, or -1 with errno set, like accept().
+     */
+    int accept_fd(struct sockaddr *sa, socklen_t *len);
+    
+private:
+    int accept_batch, max_active, max_waiting;
+    WvIStreamListBase active, waiting;
+    
+    bool have_slot();
+    void admit(IWvStream *s);
 };
 
 /**
@@ -0,0 +1,77 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * LZ4 encoder/decoder based on liblz4's frame format.
+ */
+#ifndef __WVLZ4_H
+#define __WVLZ4_H
+
+#include "wvencoder.h"
+
+struct LZ4F_cctx_s;
+struct LZ4F_dctx_s;
+
+/**
+ * An encoder implementing LZ4 compression and decompression, in the LZ4
+ * frame format (the same as the lz4 command line tool).  It compresses a
+ * lot less than WvGzipEncoder, but many times faster, so it's the one to
+ * use when there's more bandwidth than CPU.
+ * 
+ * When compressing:
+ * 
+ *  - On flush(), whatever's been buffered is compressed and written out,
+ *     so everything up to this point can be fully decompressed.
+ *     
+ *  - On finish(), the frame is ended with an end mark and a checksum of
+ *     everything in it.
+ * 
+ * When decompressing:
+ * 
+ *  - The encoder will transition to isfinished() == true on its own
+ *     at the end of the frame.  After this point, no additional data can
+ *     be decompressed.
+ * 
+ * If WvStreams was compiled without liblz4, the encoder is never isok().
+ */
+class WvLz4Encoder : public WvEncoder
+{
+public:
+    enum Mode {
+        Compress,  /*!< Compress */
+        Decompress /*!< Decompress */
+    };
+    
+    /**
+     * Creates an LZ4 encoder.
+     *
+     * "mode" is the compression mode.
+     * "level" is 0 for the normal, fast compression; 3 to 12 for slower,
+     *     better ("high compression") modes; and negative for even faster
+     *     and worse.  Ignored when decompressing.
+     */
+    WvLz4Encoder(Mode mode, int level = 0);
+    virtual ~WvLz4Encoder();
+
+protected:
+    virtual bool _encode(WvBuf &inbuf, WvBuf &outbuf, bool flush);
+    virtual bool _finish(WvBuf &outbuf);
+    virtual bool _reset();
+
+private:
+    struct LZ4F_cctx_s *cctx;
+    struct LZ4F_dctx_s *dctx;
+    Mode mode;
+    int level;
+    bool started;
+
+    void init();
+    void close();
+    bool begin(WvBuf &outbuf);
+    bool compress(WvBuf &inbuf, WvBuf &outbuf, bool flush);
+    bool decompress(WvBuf &inbuf, WvBuf &outbuf);
+    bool check(size_t retval);
+};
+
+
+#endif // __WVLZ4_H
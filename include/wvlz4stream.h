@@ -0,0 +1,38 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * An LZ4 stream.
+ */
+#ifndef __WVLZ4STREAM_H
+#define __WVLZ4STREAM_H
+
+#include "wvlz4.h"
+#include "wvencoderstream.h"
+
+/**
+ * A stream implementing LZ4 compression and decompression.
+ * 
+ * Written data is compressed using WvLz4Encoder::Compress at the given
+ * level, and read data is decompressed using WvLz4Encoder::Decompress.
+ * 
+ * @see WvLz4Encoder
+ */
+class WvLz4Stream : public WvEncoderStream
+{
+public:
+    WvLz4Stream(WvStream *_cloned, int level = 0)
+        : WvEncoderStream(_cloned)
+	{
+	    readchain.append(new WvLz4Encoder(WvLz4Encoder::Decompress), true);
+	    writechain.append(new WvLz4Encoder(WvLz4Encoder::Compress, level),
+			      true);
+	}
+    virtual ~WvLz4Stream() { }
+
+public:
+    const char *wstype() const { return "WvLz4Stream"; }   
+};
+
+
+#endif /* __WVLZ4STREAM_H */
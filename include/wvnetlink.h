@@ -0,0 +1,126 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2005 Net Integration Technologies, Inc.
+ *
+ * A stream for talking to the Linux kernel's rtnetlink interface, to read
+ * the network interfaces, addresses and routes all at once, and to hear
+ * about changes to them.
+ */
+#ifndef __WVNETLINK_H
+#define __WVNETLINK_H
+
+#include "wvfdstream.h"
+#include "wvaddr.h"
+#include "wvhashtable.h"
+#include "wviproute.h"
+
+struct nlmsghdr;
+
+/** A network interface, as the kernel describes it. */
+struct WvNetlinkLink
+{
+    int index;
+    WvString name;
+    int flags;       // IFF_UP and friends
+    int mtu;
+    WvAddr *hwaddr;  // as from WvInterface::hwaddr()
+
+    WvNetlinkLink() : index(0), flags(0), mtu(0), hwaddr(NULL) { }
+    ~WvNetlinkLink() { delete hwaddr; }
+};
+DeclareWvDict(WvNetlinkLink, int, index);
+
+
+/** An IPv4 address on a network interface. */
+struct WvNetlinkAddr
+{
+    int index;       // of the interface
+    WvString label;  // the interface name, or its alias (eg. "eth0:1")
+    WvIPNet addr;
+    bool secondary;  // not the first address in its subnet on the interface
+};
+DeclareWvList(WvNetlinkAddr);
+
+
+/**
+ * WvNetlink talks to the kernel with rtnetlink, which is how "ip" gets its
+ * information: each of get_links(), get_addrs() and get_routes() fetches
+ * the whole table with one request, instead of reading files in /proc and
+ * asking for each attribute with its own ioctl().
+ *
+ * If you pass 'listen', the stream also receives the kernel's notifications
+ * whenever an interface, IPv4 address or IPv4 route is added, changed or
+ * removed, and calls the corresponding callback when you run it (say, in a
+ * WvIStreamList).  So you can read a table once and keep it up to date,
+ * rather than reading it again every so often in case it changed.  If the
+ * kernel drops notifications because we didn't read them fast enough,
+ * resync_callback is called, and you should read the tables again.
+ *
+ * Only IPv4 addresses and routes are supported, like the rest of
+ * WvInterface and WvIPRoute.
+ */
+class WvNetlink : public WvFdStream
+{
+public:
+    typedef wv::function<void(const WvNetlinkLink &, bool added)> LinkCallback;
+    typedef wv::function<void(const WvNetlinkAddr &, bool added)> AddrCallback;
+    typedef wv::function<void(const WvIPRoute &, bool added)> RouteCallback;
+    typedef wv::function<void()> ResyncCallback;
+
+    WvNetlink(bool listen = false);
+    virtual ~WvNetlink();
+
+    /**
+     * Fill 'links' with all the network interfaces.  Returns false (and
+     * sets the error) if the kernel wouldn't tell us.
+     */
+    bool get_links(WvNetlinkLinkDict &links);
+
+    /** Fill 'addrs' with all the IPv4 addresses on all the interfaces. */
+    bool get_addrs(WvNetlinkAddrList &addrs);
+
+    /**
+     * Fill 'routes' with the IPv4 routes from all routing tables except the
+     * "local" one, just like WvIPRouteList::get_kernel().
+     */
+    bool get_routes(WvIPRouteList &routes);
+
+    /**
+     * Called for each change notification.  "added" is true for new and
+     * changed entries, and false for deleted ones.
+     */
+    LinkCallback link_callback;
+    AddrCallback addr_callback;
+    RouteCallback route_callback;
+    ResyncCallback resync_callback;
+
+protected:
+    virtual void execute();
+
+private:
+    int dump_fd;
+    unsigned int seq;
+    WvNetlinkLinkDict names; // for turning interface indexes into names
+    bool have_names;
+    WvString tables;         // contents of /etc/iproute2/rt_tables
+
+    int dumpfd();
+    bool dump(int type, int family);
+    bool recv_dump(WvNetlinkLinkDict *links, WvNetlinkAddrList *addrs,
+		   WvIPRouteList *routes);
+    int parse_msgs(unsigned char *buf, size_t len,
+		   WvNetlinkLinkDict *links, WvNetlinkAddrList *addrs,
+		   WvIPRouteList *routes, bool notify);
+    void learn_names();
+    WvString ifname(int index);
+    WvString tablename(unsigned int table);
+
+    WvNetlinkLink *parse_link(struct nlmsghdr *h);
+    WvNetlinkAddr *parse_addr(struct nlmsghdr *h);
+    WvIPRoute *parse_route(struct nlmsghdr *h);
+
+public:
+    const char *wstype() const { return "WvNetlink"; }
+};
+
+#endif // __WVNETLINK_H
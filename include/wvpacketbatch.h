@@ -0,0 +1,132 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A set of preallocated datagram buffers, for sending and receiving many
+ * packets per system call.
+ */
+#ifndef __WVPACKETBATCH_H
+#define __WVPACKETBATCH_H
+
+#include "wvaddr.h"
+
+/**
+ * A fixed number of preallocated packet buffers, each with room for the
+ * packet's address, that can be filled from (or sent to) a datagram socket
+ * with a single recvmmsg() (or sendmmsg()) call.  On systems without those,
+ * it falls back to one recvmsg() or sendmsg() per packet, which is still no
+ * worse than WvUDPStream::read().
+ *
+ * Nothing is allocated per packet: received data and addresses are left
+ * in the batch's own buffers, and data(), len() and sockaddr() just point
+ * into them, so they are only valid until the batch is used again.
+ *
+ * You normally use this through WvUDPStream::recv_batch() and friends
+ * (or WvTunDev's) rather than calling recv() and send() yourself.
+ */
+class WvPacketBatch
+{
+public:
+    /**
+     * Make room for up to _max_packets packets of up to _max_size bytes
+     * each.  Longer received packets are truncated (see truncated()).
+     */
+    WvPacketBatch(int _max_packets = 64, size_t _max_size = 2048);
+    ~WvPacketBatch();
+
+    /** The number of packets currently in the batch. */
+    int count() const
+        { return used; }
+
+    int max_packets() const
+        { return nslots; }
+    size_t max_size() const
+        { return slotsize; }
+
+    /** Empty the batch. */
+    void zap()
+        { used = 0; }
+
+    /** The payload of packet 'i'. */
+    const unsigned char *data(int i) const;
+    size_t len(int i) const;
+
+    /** True if packet 'i' was longer than max_size() when it arrived. */
+    bool truncated(int i) const;
+
+    /**
+     * The address packet 'i' came from (or will be sent to).  NULL for
+     * packets added without a destination, and for datagrams whose sender
+     * didn't bind an address (as with most Unix datagram sockets).
+     */
+    const struct sockaddr *sockaddr(int i) const;
+    socklen_t sockaddr_len(int i) const;
+
+    /**
+     * Copy a packet into the batch, to be sent to 'dest' (or to wherever
+     * send() is told to send packets with no address of their own).
+     * Returns false if the batch is full or the packet is too big.
+     */
+    bool add(const void *buf, size_t count, const WvAddr *dest = NULL);
+
+    /**
+     * Like add(), but instead of copying the packet in, return a pointer
+     * to 'count' bytes in the batch for you to fill in yourself.  Returns
+     * NULL if there's no room.
+     */
+    unsigned char *alloc(size_t count, const WvAddr *dest = NULL);
+
+    /**
+     * Replace the contents of the batch with as many packets as are
+     * waiting on 'fd', up to max_packets().  Returns the number received,
+     * which is 0 if none were waiting, or -1 (with errno set) on error.
+     */
+    int recv(int fd);
+
+    /**
+     * Send the packets in the batch to 'fd', those without an address of
+     * their own to 'dest', if given.  Sent packets are removed from the
+     * front of the batch, so if the socket fills up, what couldn't be sent
+     * is still there to try again later.  Packets that can never be sent
+     * (too big, say, or to nowhere) are thrown away instead, and counted
+     * in dropped(), so they don't hold up the rest.  Returns the number
+     * sent, or -1 (with errno set) if nothing was sent because of an
+     * error.
+     */
+    int send(int fd, const WvAddr *dest = NULL);
+
+    /**
+     * Like recv() and send(), but for file descriptors that aren't sockets
+     * and return one packet per read() (eg. a tun device).  This still
+     * takes a system call per packet, but drains as many packets as are
+     * waiting at once, straight into (or out of) the batch's buffers.
+     */
+    int read(int fd);
+    int write(int fd);
+
+    /**
+     * The number of packets send() and write() have thrown away because
+     * sending them failed for some reason other than being out of room.
+     */
+    int dropped() const
+        { return ndropped; }
+
+private:
+    struct Msg;
+    struct Slot;
+
+    int nslots, used, ndropped;
+    size_t slotsize;
+    unsigned char *bufs;
+    Slot *slots;
+    Msg *msgs;
+
+    void setup(int i, bool receiving);
+    int sent(int count, int nsent, int err);
+
+    // not copyable
+    WvPacketBatch(const WvPacketBatch &);
+    WvPacketBatch &operator= (const WvPacketBatch &);
+};
+
+#endif // __WVPACKETBATCH_H
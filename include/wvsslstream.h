@@ -23,6 +23,7 @@ typedef struct ssl_method_st SSL_METHOD;
 class WvX509;
 class WvX509Mgr;
 class WvSSLStream;
+struct WvSSLContext;
 
 typedef wv::function<bool(WvX509*)> WvSSLValidateCallback;
 typedef wv::function<bool(WvX509*, WvSSLStream *)> WvSSLGlobalValidateCallback;
@@ -46,6 +47,15 @@ public:
      * with it.
      */
     static WvSSLGlobalValidateCallback global_vcb;
+
+    /**
+     * If true (the default), client streams offer the server the session
+     * they last negotiated with the same peer, so reconnecting can skip
+     * the expensive part of the handshake.  Mostly useful for turning it
+     * off to see what it saves.
+     */
+    static bool resume_sessions;
+
     /**  
      * Start an SSL connection on the stream _slave.  The x509 structure
      * is optional for a client, and mandatory for a server.  You need to
@@ -65,15 +75,29 @@ public:
     virtual void noread();
     virtual void nowrite();
     
+    /**
+     * Sets the key under which a client stream remembers its session for
+     * resuming later.  By default, it's the address of the stream we're
+     * cloning, if it has one.  Must be called before the handshake starts.
+     */
+    void set_session_key(WvStringParm key)
+        { session_key = key; }
+    
+    /** Returns true if the handshake resumed an earlier session. */
+    bool resumed() const;
+    
 protected:
     WvX509Mgr *x509;
     
-    /** SSL Context - used to create SSL Object */
+    /**
+     * SSL Context - used to create SSL Object.  Streams with the same
+     * role and certificate share one; see WvSSLContext.
+     */
     SSL_CTX *ctx;
     
     /**
-     * Main SSL Object - after SSL_set_fd() we make all calls through the
-     * connection through here
+     * Main SSL Object - we make all calls through the connection through
+     * here, and move the ciphertext to and from the cloned stream
      */
     SSL *ssl;
     
@@ -88,6 +112,15 @@ private:
     bool sslconnected;
     SelectRequest connect_wants;
 
+    /** The shared context that 'ctx' came from */
+    WvSSLContext *shared;
+    
+    /** Where we remember our session (client only) */
+    WvString session_key;
+    
+    /** True once we've started the handshake */
+    bool ssl_started;
+
     /** Set the connected flag and flush the unconnected_buf */
     void setconnected(bool conn);
     
@@ -104,18 +137,10 @@ private:
     WvLog debug;
 
     /**
-     * SSL_write() may return an SSL_ERROR_WANT_WRITE code which
-     * indicates that the function should be called again with
-     * precisely the same arguments as the last time.  To ensure that
-     * this can happen, we must unfortunately copy data into a bounce
-     * buffer and remeber the fact.  We use a WvBuf here to allow
-     * an arbitrary amount of data to be set aside.
+     * True if SSL may have data for us that select() can't see, because
+     * we've already taken it from the cloned stream (eg. the last uread()
+     * filled its whole buffer).
      */
-    WvInPlaceBuf write_bouncebuf;
-    size_t write_eat;
-
-    /** Similar nastiness happens with SSL_read() */
-    WvInPlaceBuf read_bouncebuf;
     bool read_pending;
 
     /** Need to buffer writes until sslconnected */
@@ -123,6 +148,14 @@ private:
 
     /** Prints out the entire SSL error queue */
     void printerr(WvStringParm func);
+    
+    /** Gives SSL all the ciphertext the cloned stream has for us */
+    void fill_rbio();
+    
+    /** Sends all the ciphertext SSL has produced to the cloned stream */
+    void flush_wbio();
+
+    friend struct WvSSLContext;
 
 public:
     const char *wstype() const { return "WvSSLStream"; }
@@ -24,6 +24,7 @@
 
 #include <stdarg.h>
 #include <signal.h>
+#include <spawn.h>
 #include <time.h>
 
 class WvSubProc
@@ -49,8 +50,13 @@ public:
 private:
     void init();
     int _startv(const char cmd[], const char * const *argv);
+    pid_t spawn(const char cmd[], const char * const *argv);
+    void watch_exit(bool have_sigchld);
+    void unwatch_exit();
 
     int memlimit;
+    int pidfd;          // readable when our child exits, or -1
+    bool sigchld_watch; // using the shared SIGCHLD signalfd instead
     
 public:
     void prepare(const char cmd[], ...);
@@ -66,6 +72,32 @@ public:
     
     virtual int fork(int *waitfd);
 
+    /**
+     * start() and friends normally use posix_spawn() instead of fork()
+     * and exec(), which is much faster from a big process, since the
+     * kernel doesn't have to copy its page tables just to throw them away
+     * again.  Set this to false to always fork().
+     */
+    static bool use_spawn;
+
+protected:
+    /**
+     * Returns true if it's okay for start() to use posix_spawn() instead
+     * of fork().  Subclasses that override fork() to do things in the
+     * child can't be spawned, so this only says yes for a plain
+     * WvSubProc.  If your subclass hasn't overridden fork(), or can do
+     * the same thing in spawn_actions(), override this to return true.
+     */
+    virtual bool can_spawn() const;
+    
+    /**
+     * Adds anything that needs doing to the child's file descriptors to
+     * 'actions' before posix_spawn().  The default does nothing.
+     */
+    virtual void spawn_actions(posix_spawn_file_actions_t &actions)
+        { }
+
+public:
     // stop (kill -TERM or -KILL as necessary) the subprocess and
     // all its children.
     virtual void stop(time_t msec_delay, bool kill_children = true);
@@ -77,7 +109,7 @@ public:
     pid_t pidfile_pid();
 
     /// Sets a limit on the number of megabytes of memory the subprocess will
-    // use
+    // use.  posix_spawn() can't do that, so this means fork() instead.
     void setMemLimit(int megs) { memlimit = megs; }
     
     // send a signal to the subprocess and all its children.
@@ -86,6 +118,35 @@ public:
     // send a signal only to the main subprocess.
     void kill_primary(int sig);
     
+    /**
+     * Returns a file descriptor that becomes readable when the main
+     * subprocess exits, so you can select() on it instead of polling
+     * wait(0).  That's a pidfd if the kernel has them.  Otherwise it's a
+     * signalfd for SIGCHLD shared by every WvSubProc, which means *some*
+     * child exited; call sigchld_events() to read it.  Returns -1 if
+     * there's nothing to wait for that way (for example, the main process
+     * is gone but its children aren't), in which case you're stuck with
+     * polling.
+     *
+     * Don't read from it or close it.
+     */
+    int exitfd() const;
+    
+    /**
+     * Reads everything waiting on the shared SIGCHLD signalfd, if there is
+     * one, and returns a count that goes up whenever there was something.
+     * If it has changed since you last looked, any child might have exited.
+     */
+    static unsigned long sigchld_events();
+    
+    /**
+     * Set this to false to use the SIGCHLD signalfd even if the kernel
+     * has pidfds.  That keeps SIGCHLD blocked in this process while any
+     * WvSubProc started that way is running, so only do it if you don't
+     * otherwise care about SIGCHLD.  Mainly for testing.
+     */
+    static bool use_pidfd;
+    
     // suspend the process temporarily, or resume it.
     virtual void suspend()
         { kill(SIGSTOP); }
@@ -111,7 +111,7 @@ public:
     /// True if there are no unfinished (ie. running *or* waiting) processes.
     bool isempty() const;
     
-private:
+protected:
     struct Ent
     {
 	Ent(void *_cookie, WvSubProc *_proc)
@@ -132,9 +132,11 @@ private:
     };
     DeclareWvList(Ent);
     
-    unsigned maxrunning;
     EntList runq, waitq;
 
+private:
+    unsigned maxrunning;
+
     bool cookie_running();
 };
 
@@ -10,7 +10,14 @@
 
 /**
  * A variant of WvSubProcQueue that can be added to a WvStreamList so that
- * WvSubProcQueue::go() gets called automatically at a reasonable interval.
+ * WvSubProcQueue::go() gets called automatically whenever a process is
+ * added, or one of the running ones exits.
+ *
+ * It finds out about the exits by selecting on each process's
+ * WvSubProc::exitfd(), so it doesn't wake up at all while everything's
+ * still running, and all of the processes that exited are cleaned up at
+ * once.  The only thing it still polls for (every 100ms) is the children
+ * of a process that has itself already exited.
  */
 class WvSubProcQueueStream : public WvStream, public WvSubProcQueue
 {
@@ -18,10 +25,16 @@ public:
     WvSubProcQueueStream(int _maxrunning);
     virtual ~WvSubProcQueueStream();
     
+    virtual void pre_select(SelectInfo &si);
+    virtual bool post_select(SelectInfo &si);
     virtual void execute();
     
 private:
     WvLog log;
+    unsigned last_remaining;
+    unsigned long last_sigchld;
+
+    bool changed();
     
 public:
     const char *wstype() const { return "WvSubProcQueueStream"; }
@@ -114,6 +114,8 @@ private:
     
     void init(const char * const *argv);
     virtual int fork(int *waitfd);
+    virtual bool can_spawn() const;
+    virtual void spawn_actions(posix_spawn_file_actions_t &actions);
 };
 
 
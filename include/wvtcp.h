@@ -55,6 +55,9 @@ protected:
     /** Resolve the remote address, if it was fed in non-IP form */
     void check_resolver();
     
+    /** The socket options (but not fd flags) set by nice_tcpopts() */
+    void nice_sockopts();
+    
 public:
    /**
     * WvTCPConn tries to make all outgoing connections asynchronously (in
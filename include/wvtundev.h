@@ -10,6 +10,7 @@
 #include "wvfile.h"
 #include "wvinterface.h"
 #include "wvaddr.h"
+#include "wvpacketbatch.h"
 
 /**
  * WvTunDev provides a convenient way of using Linux tunnel devices.
@@ -17,22 +18,78 @@
  * If you don't have the /dev/net/tun device, try doing:
  * mknod /dev/net/tun c 10 200.
  * 
+ * Each read() or write() on a tun device is one packet.  To move packets
+ * without copying them through the stream's buffers, and to drain all the
+ * waiting packets at once whenever the device is readable, use
+ * recv_batch() and send_batch() instead.
+ * 
+ * With the MultiQueue flag, open_queue() gives you more WvTunDevs on the
+ * same interface; the kernel spreads outgoing packets across them by flow,
+ * so each can be serviced by its own thread.
  */
 class WvTunDev : public WvFile
 {
 public:
+    enum {
+	/**
+	 * Each packet read or written starts with a struct virtio_net_hdr
+	 * (vnet_hdr_len bytes) describing its checksum and segmentation
+	 * offload state.  Needed for set_offload().
+	 */
+	VNetHdr = 0x1,
+	
+	/** Allow more queues to be opened with open_queue(). */
+	MultiQueue = 0x2,
+    };
+    
+    /** Size of the header that precedes each packet with VNetHdr. */
+    static const int vnet_hdr_len = 10;
+    
     /**
      * Creates a tunnel device and its associated interface.
      *
      * "addr" is the initial ip address for the interface
      * "mtu" is the max transfer unit, default 1400
+     * "flags" is zero or more of the flags above
      */
-    WvTunDev(const WvIPNet &addr, int mtu = 1400);
+    WvTunDev(const WvIPNet &addr, int mtu = 1400, int _flags = 0);
 
     /** Contains the name of the interface associated with the device. */
     WvString ifcname;
+    
+    /**
+     * Open another queue on this (MultiQueue) interface.  Returns a new
+     * WvTunDev, which you should check isok() on, and delete when done.
+     */
+    WvTunDev *open_queue();
+    
+    /**
+     * Tell the kernel which offloads (TUN_F_CSUM, TUN_F_TSO4, etc. from
+     * <linux/if_tun.h>) we can handle, so it can give us unchecksummed and
+     * unsegmented packets up to 64k long.  Only works with VNetHdr, and
+     * a WvPacketBatch to receive them had better have room.  Returns
+     * false if the kernel refused.
+     */
+    bool set_offload(unsigned int offloads);
+    
+    /**
+     * Replace the contents of 'batch' with as many waiting packets as it
+     * can hold, and return how many that was.  Doesn't wait.
+     */
+    int recv_batch(WvPacketBatch &batch);
+    
+    /**
+     * Send the packets in 'batch', removing them from the batch as they go.
+     * Returns the number sent; anything left over can be retried when the
+     * device is writable.
+     */
+    int send_batch(WvPacketBatch &batch);
 
 private:
+    int flags;
+    
+    WvTunDev(const WvTunDev *first);
+    bool attach(WvStringParm name);
     void init(const WvIPNet &addr, int mtu);
     
 public:
@@ -8,6 +8,9 @@
 
 #include "wvfdstream.h"
 #include "wvaddr.h"
+#ifndef _WIN32
+#include "wvpacketbatch.h"
+#endif
 
 /**
  * WvUDPStream can send and receive packets on a connectionless UDP socket.
@@ -27,12 +30,24 @@
  * including getline(), but because input packets may get lost it is of
  * limited usefulness.  Buffering will cause particular confusion if the
  * socket is not connect()ed.
+
+ * 
+ * If you're handling lots of packets, recv_batch() and send_batch() move
+ * many of them per system call, without going through the stream's
+ * buffers at all.  (Don't mix them with read() unless you don't mind the
+ * order of packets getting confused.)  Several WvUDPStreams created with
+ * 'reuseport' set can bind to the same port, and the kernel will spread
+ * incoming packets across them.
  */
 class WvUDPStream : public WvFDStream
 {
 public:
-    /** connect a new socket */
-    WvUDPStream(const WvIPPortAddr &_local, const WvIPPortAddr &_rem);
+    /**
+     * connect a new socket.  If 'reuseport' is true, set SO_REUSEPORT
+     * before binding, so other sockets that do the same can share _local.
+     */
+    WvUDPStream(const WvIPPortAddr &_local, const WvIPPortAddr &_rem,
+		bool reuseport = false);
     virtual ~WvUDPStream();
     
     const WvAddr *local() const;
@@ -47,6 +62,23 @@ public:
         { remaddr = _remaddr; }
     
     void enable_broadcasts();
+    
+#ifndef _WIN32
+    /**
+     * Replace the contents of 'batch' with as many waiting packets as it
+     * can hold, and return how many that was.  Like read(), this doesn't
+     * wait, and sets src() to the sender of the last packet.
+     */
+    int recv_batch(WvPacketBatch &batch);
+    
+    /**
+     * Send the packets in 'batch' (those without an address of their own
+     * to src()), removing them from the batch as they go.  Returns the
+     * number sent; anything left over didn't fit in the socket's buffer
+     * and can be retried when the stream is writable.
+     */
+    int send_batch(WvPacketBatch &batch);
+#endif
 
 protected:
     WvIPPortAddr localaddr, remaddr;
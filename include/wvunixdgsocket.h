@@ -6,6 +6,7 @@
 #include "wvlinklist.h"
 #include "wvfdstream.h"
 #include "wvaddr.h"
+#include "wvpacketbatch.h"
 
 class WvUnixDGListener;
 class WvUnixDGConn;
@@ -32,6 +33,19 @@ public:
     virtual size_t uwrite(const void *buf, size_t count);
     virtual void pre_select(SelectInfo &si);
     virtual bool post_select(SelectInfo &si);
+    
+    /**
+     * Replace the contents of 'batch' with as many waiting datagrams as it
+     * can hold, and return how many that was.  Doesn't wait.
+     */
+    int recv_batch(WvPacketBatch &batch);
+    
+    /**
+     * Send all the datagrams in 'batch', emptying it.  As with write(),
+     * anything the socket won't take right now is buffered and sent
+     * (in order) later.  Returns the number of datagrams.
+     */
+    int send_batch(WvPacketBatch &batch);
    
 protected:
      WvString socketfile;
@@ -360,6 +360,7 @@ private:
     friend class WvX509Mgr;
     friend class WvOCSPReq;
     friend class WvOCSPResp;
+    friend class WvX509Cache;
 
     /** X.509v3 Certificate - this is why this class exists */
     X509     *cert;
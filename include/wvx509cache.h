@@ -0,0 +1,80 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2007 Net Integration Technologies, Inc. and others.
+ *
+ * Remembers which certificates were recently found to be signed by which
+ * CA, so checking them again doesn't redo the signature verification.
+ */
+#ifndef __WVX509CACHE_H
+#define __WVX509CACHE_H
+
+#include "wvx509.h"
+#include "wvhashtable.h"
+
+class WvCRL;
+
+/**
+ * A bounded cache of certificate validation results.
+ *
+ * WvX509::validate() checks the CA's signature on the certificate every
+ * time, which is by far the slowest part, and a server that sees the same
+ * few client certificates over and over again does it over and over again
+ * too.  WvX509Cache::validate() gives the same answer, but remembers the
+ * expensive parts (the signature, the issuer, and whether the certificate
+ * is revoked) by the fingerprints of the certificate and the CA, for at
+ * most 'max_entries' pairs.  Like UniHotCacheGen, it throws out pairs
+ * that haven't been used recently when it needs room.
+ *
+ * The validity dates are cheap, and change with the time rather than the
+ * certificate, so they're checked every time.  If a CRL is given, the
+ * answer is only reused while it's the same CRL and it hasn't changed
+ * since (see WvCRL::version()), so updating the CRL is enough to make
+ * newly revoked certificates fail.
+ *
+ * To validate a chain, validate each certificate against the next one up;
+ * every link of a chain you've seen before is then a hit.
+ */
+class WvX509Cache
+{
+public:
+    WvX509Cache(int _max_entries = 1000);
+    ~WvX509Cache();
+
+    unsigned long hits;      /*!< validate()s answered from the cache */
+    unsigned long misses;    /*!< validate()s that checked the signature */
+    unsigned long evictions; /*!< entries thrown out to make room */
+
+    /**
+     * Returns true if 'cert' is currently valid, was signed and issued by
+     * 'cacert', and (if 'crl' isn't NULL) isn't revoked in 'crl'.
+     */
+    bool validate(const WvX509 &cert, WvX509 &cacert,
+                  const WvCRL *crl = NULL);
+
+    /** Returns the number of certificate/CA pairs currently cached. */
+    int count() const
+        { return used; }
+
+    /** Forgets everything in the cache. */
+    void zap();
+
+private:
+    struct Entry
+    {
+        WvString key;      // certificate and CA fingerprints
+        bool valid;        // signed and issued by the CA, and not revoked
+        const WvCRL *crl;  // the CRL checked, if any
+        unsigned long crlversion;
+        bool referenced;   // used since the clock hand last passed
+        int slot;          // index in 'clock'
+    };
+    DeclareWvDict(Entry, WvString, key);
+
+    int max_entries, used, hand; // max_entries comes first: it sizes entries
+    EntryDict entries;
+    Entry **clock;
+
+    Entry *add(WvStringParm key);
+};
+
+#endif // __WVX509CACHE_H
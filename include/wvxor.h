@@ -28,11 +28,16 @@ public:
     
 protected:
     bool _encode(WvBuf &in, WvBuf &out, bool flush);
+    virtual bool _isinplace() const
+        { return true; }
+    virtual bool _encode_inplace(WvBuf &in, WvBuf &out, bool flush);
 
 private:
     unsigned char *key;
     size_t keylen;
-    int keyoff;
+    size_t keyoff;
+
+    void apply(unsigned char *out, const unsigned char *in, size_t len);
 };
 
 
@@ -0,0 +1,72 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Zstandard encoder/decoder based on libzstd.
+ */
+#ifndef __WVZSTD_H
+#define __WVZSTD_H
+
+#include "wvencoder.h"
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
+/**
+ * An encoder implementing Zstandard compression and decompression, in
+ * the standard frame format (the same as the zstd command line tool).  At
+ * its default level it compresses about as well as WvGzipEncoder's best,
+ * and several times faster.
+ * 
+ * When compressing:
+ * 
+ *  - On flush(), the current block is ended and written out, so
+ *     everything up to this point can be fully decompressed.
+ *     
+ *  - On finish(), the frame is ended with a checksum of everything in it.
+ * 
+ * When decompressing:
+ * 
+ *  - The encoder will transition to isfinished() == true on its own
+ *     at the end of the frame.  After this point, no additional data can
+ *     be decompressed.
+ * 
+ * If WvStreams was compiled without libzstd, the encoder is never isok().
+ */
+class WvZstdEncoder : public WvEncoder
+{
+public:
+    enum Mode {
+        Compress,  /*!< Compress */
+        Decompress /*!< Decompress */
+    };
+    
+    /**
+     * Creates a Zstandard encoder.
+     *
+     * "mode" is the compression mode.
+     * "level" is 1 (fastest) to 19 (best); 20 to 22 are even better but
+     *     use a lot of memory at both ends, and negative levels are faster
+     *     and worse than 1.  Ignored when decompressing.
+     */
+    WvZstdEncoder(Mode mode, int level = 3);
+    virtual ~WvZstdEncoder();
+
+protected:
+    virtual bool _encode(WvBuf &inbuf, WvBuf &outbuf, bool flush);
+    virtual bool _finish(WvBuf &outbuf);
+    virtual bool _reset();
+
+private:
+    struct ZSTD_CCtx_s *cctx;
+    struct ZSTD_DCtx_s *dctx;
+    Mode mode;
+    int level;
+
+    bool compress(WvBuf &inbuf, WvBuf &outbuf, int directive);
+    bool decompress(WvBuf &inbuf, WvBuf &outbuf);
+    bool check(size_t retval);
+};
+
+
+#endif // __WVZSTD_H
@@ -0,0 +1,38 @@
+/* -*- Mode: C++ -*-
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A Zstandard stream.
+ */
+#ifndef __WVZSTDSTREAM_H
+#define __WVZSTDSTREAM_H
+
+#include "wvzstd.h"
+#include "wvencoderstream.h"
+
+/**
+ * A stream implementing Zstandard compression and decompression.
+ * 
+ * Written data is compressed using WvZstdEncoder::Compress at the given
+ * level, and read data is decompressed using WvZstdEncoder::Decompress.
+ * 
+ * @see WvZstdEncoder
+ */
+class WvZstdStream : public WvEncoderStream
+{
+public:
+    WvZstdStream(WvStream *_cloned, int level = 3)
+        : WvEncoderStream(_cloned)
+	{
+	    readchain.append(new WvZstdEncoder(WvZstdEncoder::Decompress), true);
+	    writechain.append(new WvZstdEncoder(WvZstdEncoder::Compress, level),
+			      true);
+	}
+    virtual ~WvZstdStream() { }
+
+public:
+    const char *wstype() const { return "WvZstdStream"; }   
+};
+
+
+#endif /* __WVZSTDSTREAM_H */
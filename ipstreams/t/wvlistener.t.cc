@@ -3,6 +3,9 @@
 #include "wvtcp.h"
 #include "wvtcplistener.h"
 #include "wvistreamlist.h"
+#include "wvunixlistener.h"
+#include "wvunixsocket.h"
+#include <fcntl.h>
 
 class XListener : public WvListener
 {
@@ -54,3 +57,99 @@ WVTEST_MAIN("wvlistener")
     }
 }
 
+
+
+static WvIStreamListBase accepted_list;
+
+static void collector(IWvStream *s)
+{
+    accepted_list.append(s, true, "accepted");
+}
+
+
+WVTEST_MAIN("accept batch")
+{
+    WvTCPListener l(WvIPPortAddr("127.0.0.1", 0));
+    WVPASS(l.isok());
+    l.onaccept(collector);
+    l.set_accept_batch(3);
+    
+    WvIStreamList conns;
+    for (int i = 0; i < 5; i++)
+	conns.append(new WvTCPConn(*l.src()), true, "tcp connection");
+    for (int i = 0; i < 10; i++)
+	conns.runonce(10);
+    
+    // one wakeup takes as many as the batch allows, and no more
+    l.callback();
+    WVPASSEQ(accepted_list.count(), 3);
+    WVPASSEQ(l.accepted, 3);
+    l.callback();
+    WVPASSEQ(accepted_list.count(), 5);
+    WVPASSEQ(l.accepted, 5);
+    l.callback();
+    WVPASSEQ(accepted_list.count(), 5);
+    
+    WvIStreamListBase::Iter i(accepted_list);
+    for (i.rewind(); i.next(); )
+    {
+	WVPASS(i->isok());
+	WvFdStream *fds = (WvFdStream *)i.ptr();
+	WVPASS(fcntl(fds->getfd(), F_GETFL) & O_NONBLOCK);
+	WVPASS(fcntl(fds->getfd(), F_GETFD) & FD_CLOEXEC);
+    }
+    accepted_list.zap();
+}
+
+
+WVTEST_MAIN("max connections")
+{
+    WvString sockname("/tmp/wvlistener.t.%s", getpid());
+    WvUnixListener l(sockname, 0600);
+    WVPASS(l.isok());
+    l.onaccept(collector);
+    l.set_max_connections(2, 1);
+    
+    WvIStreamList conns;
+    for (int i = 0; i < 5; i++)
+	conns.append(new WvUnixConn(sockname), true, "unix connection");
+    
+    l.callback();
+    WVPASSEQ(accepted_list.count(), 2);
+    WVPASSEQ(l.num_active(), 2);
+    WVPASSEQ(l.num_waiting(), 1);
+    WVPASSEQ(l.accepted, 2);
+    WVPASSEQ(l.queued, 1);
+    WVPASSEQ(l.refused, 2);
+    
+    // the refused ones are closed right away
+    int closed = 0;
+    WvIStreamList::Iter c(conns);
+    for (c.rewind(); c.next(); )
+    {
+	char buf[1];
+	c->read(buf, sizeof(buf));
+	if (!c->isok())
+	    closed++;
+    }
+    WVPASSEQ(closed, 2);
+    
+    // nothing has room yet, so the waiting one stays put
+    WvIStreamList::globallist.append(&l, false, "listener");
+    WvIStreamList::globallist.runonce(10);
+    WVPASSEQ(accepted_list.count(), 2);
+    
+    // closing an accepted connection lets the waiting one in
+    WvIStreamListBase::Iter i(accepted_list);
+    i.rewind(); i.next();
+    i.xunlink();
+    WVPASSEQ(l.num_active(), 1);
+    WvIStreamList::globallist.runonce(1000);
+    WVPASSEQ(accepted_list.count(), 2);
+    WVPASSEQ(l.num_waiting(), 0);
+    WVPASSEQ(l.accepted, 3);
+    
+    WvIStreamList::globallist.unlink(&l);
+    accepted_list.zap();
+    WVPASSEQ(l.num_active(), 0);
+}
@@ -0,0 +1,137 @@
+#include "wvtest.h"
+#include "wvudp.h"
+#include "wvbuf.h"
+#include <errno.h>
+
+
+static WvString packet(const WvPacketBatch &batch, int i)
+{
+    WvDynBuf buf;
+    buf.put(batch.data(i), batch.len(i));
+    return buf.getstr();
+}
+
+
+WVTEST_MAIN("udp read and write")
+{
+    WvUDPStream a(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr());
+    WvUDPStream b(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr());
+    WVPASS(a.isok());
+    WVPASS(b.isok());
+    
+    a.setdest(*(WvIPPortAddr *)b.local());
+    a.write("hello", 5);
+    WVPASS(b.select(1000));
+    
+    WvDynBuf buf;
+    WVPASSEQ(b.read(buf, 100), 5);
+    WVPASSEQ(buf.getstr(), "hello");
+    WVPASSEQ(WvString(*b.src()), WvString(*a.local()));
+}
+
+
+WVTEST_MAIN("udp batches")
+{
+    WvUDPStream a(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr());
+    WvUDPStream b(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr());
+    WVPASS(a.isok());
+    WVPASS(b.isok());
+    
+    WvPacketBatch out(8, 64);
+    WVPASSEQ(out.count(), 0);
+    for (int i = 0; i < 10; i++)
+    {
+	WvString s("packet %s", i);
+	WVPASSEQ(out.add(s.cstr(), s.len(), b.local()), i < 8);
+    }
+    WVFAIL(out.add("x", 65, b.local())); // too big, and full anyway
+    WVPASSEQ(out.count(), 8);
+    WVPASSEQ(a.send_batch(out), 8);
+    WVPASSEQ(out.count(), 0);
+    
+    // packets without an address go to src()
+    a.setdest(*(WvIPPortAddr *)b.local());
+    WVPASS(out.add("last", 4));
+    WVPASS(out.add("one that's far too long to fit in a small batch", 47));
+    WVPASSEQ(a.send_batch(out), 2);
+    
+    WVPASS(b.select(1000));
+    WvPacketBatch in(4, 16);
+    int total = 0;
+    WvString got;
+    while (total < 10 && b.select(1000))
+    {
+	int n = b.recv_batch(in);
+	WVPASS(n > 0 && n <= 4);
+	WVPASSEQ(in.count(), n);
+	for (int i = 0; i < n; i++)
+	{
+	    got.append("%s%s", total ? "," : "",
+		       packet(in, i));
+	    WVPASS(in.sockaddr(i));
+	    WVPASSEQ(WvString(WvIPPortAddr((sockaddr_in *)in.sockaddr(i))),
+		     WvString(*a.local()));
+	    WVPASSEQ(in.truncated(i), total == 9);
+	    total++;
+	}
+    }
+    WVPASSEQ(got, "packet 0,packet 1,packet 2,packet 3,packet 4,"
+	     "packet 5,packet 6,packet 7,last,one that's far t");
+    WVPASSEQ(WvString(*b.src()), WvString(*a.local()));
+    
+    // nothing left
+    WVPASSEQ(b.recv_batch(in), 0);
+    WVPASSEQ(in.count(), 0);
+}
+
+
+WVTEST_MAIN("udp batches with a packet that can't be sent")
+{
+    WvUDPStream a(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr());
+    WvUDPStream b(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr());
+    a.setdest(*(WvIPPortAddr *)b.local());
+    
+    // bigger than any UDP packet can be, so it fails with EMSGSIZE, but
+    // the next one still gets through
+    WvPacketBatch out(2, 70000);
+    WVPASS(out.alloc(70000));
+    WVPASS(out.add("small", 5));
+    WVPASSEQ(a.send_batch(out), 1);
+    WVPASSEQ(out.count(), 0);
+    WVPASSEQ(out.dropped(), 1);
+    
+    WvPacketBatch in(4, 16);
+    WVPASS(b.select(1000));
+    WVPASSEQ(b.recv_batch(in), 1);
+    WVPASSEQ(packet(in, 0), "small");
+    
+    // on its own, it's an error, and it's gone
+    WVPASS(out.alloc(70000));
+    WVPASSEQ(out.send(a.getfd(), b.local()), -1);
+    WVPASSEQ(errno, EMSGSIZE);
+    WVPASSEQ(out.count(), 0);
+    WVPASSEQ(out.dropped(), 2);
+}
+
+
+WVTEST_MAIN("udp reuseport")
+{
+    WvUDPStream a(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr(), true);
+    WVPASS(a.isok());
+    WvIPPortAddr port(*(WvIPPortAddr *)a.local());
+    WvUDPStream b(port, WvIPPortAddr(), true);
+    WVPASS(b.isok());
+    WVPASSEQ(WvString(*b.local()), WvString(port));
+    
+    // every packet arrives at one or the other
+    WvUDPStream c(WvIPPortAddr("127.0.0.1", 0), port);
+    WvPacketBatch batch(20, 16);
+    for (int i = 0; i < 20; i++)
+	batch.add("x", 1);
+    WVPASSEQ(c.send_batch(batch), 20);
+    
+    int total = 0;
+    while (total < 20 && (a.select(1000) || b.select(0)))
+	total += a.recv_batch(batch) + b.recv_batch(batch);
+    WVPASSEQ(total, 20);
+}
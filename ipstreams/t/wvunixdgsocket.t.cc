@@ -3,6 +3,14 @@
 #include "wvhex.h"
 
 
+static WvString packet(const WvPacketBatch &batch, int i)
+{
+    WvDynBuf buf;
+    buf.put(batch.data(i), batch.len(i));
+    return buf.getstr();
+}
+
+
 WVTEST_MAIN("embarrassingly simple unixdgsockets test")
 {
     int fd;
@@ -246,3 +254,32 @@ WVTEST_MAIN("fire random binary data through unixdgsocket")
     WVPASS(success);
 }
 
+
+WVTEST_MAIN("unixdgsocket batches")
+{
+    int fd;
+    WvString testfile = "/tmp/wvunixdgtestXXXXXX";
+    if ((fd = mkstemp(testfile.edit())) == (-1))
+        return;
+    close(fd);
+
+    WvUnixDGListener in(testfile);
+    WvUnixDGConn out(testfile);
+
+    WvPacketBatch batch(8, 32);
+    for (int i = 0; i < 8; i++)
+        WVPASS(batch.add(WvString("dgram %s", i), 7));
+    WVPASSEQ(out.send_batch(batch), 8);
+    WVPASSEQ(batch.count(), 0);
+    WVPASSEQ(out.bufsize, 0);
+
+    WVPASS(in.isreadable());
+    WvPacketBatch got(5, 32);
+    WVPASSEQ(in.recv_batch(got), 5);
+    WVPASSEQ(packet(got, 0), "dgram 0");
+    WVPASSEQ(packet(got, 4), "dgram 4");
+    WVFAIL(got.sockaddr(0)); // the client never bound an address
+    WVPASSEQ(in.recv_batch(got), 3);
+    WVPASSEQ(packet(got, 2), "dgram 7");
+    WVPASSEQ(in.recv_batch(got), 0);
+}
@@ -0,0 +1,66 @@
+/*
+ * Compares receiving UDP packets one read() at a time with receiving them
+ * with WvUDPStream::recv_batch().  Both sides run on localhost.
+ */
+#include "wvudp.h"
+#include "wvtimeutils.h"
+#include <string.h>
+
+static const int npackets = 200000, size = 100;
+
+
+// Returns the number of packets received in the time it took.
+static int run(WvUDPStream &from, WvUDPStream &to, bool batched,
+	       time_t &ms)
+{
+    WvPacketBatch out(64, size), in(64, size);
+    char buf[size];
+    memset(buf, 'x', sizeof(buf));
+
+    int sent = 0, got = 0;
+    WvTime start = wvtime();
+    while (sent < npackets)
+    {
+	// stay within the socket buffer so we don't lose too much
+	for (int i = 0; i < 64; i++)
+	    out.add(buf, sizeof(buf));
+	sent += from.send_batch(out);
+	out.zap();
+
+	while (to.select(0))
+	{
+	    if (batched)
+		got += to.recv_batch(in);
+	    else if (to.read(buf, sizeof(buf)))
+		got++;
+	    else
+		break;
+	}
+    }
+    while (to.select(10))
+    {
+	if (batched)
+	    got += to.recv_batch(in);
+	else if (to.read(buf, sizeof(buf)))
+	    got++;
+    }
+    ms = msecdiff(wvtime(), start);
+    return got;
+}
+
+
+int main()
+{
+    WvUDPStream to(WvIPPortAddr("127.0.0.1", 0), WvIPPortAddr());
+    WvUDPStream from(WvIPPortAddr("127.0.0.1", 0),
+		     *(const WvIPPortAddr *)to.local());
+
+    for (int batched = 0; batched < 2; batched++)
+    {
+	time_t ms;
+	int got = run(from, to, batched, ms);
+	wvcon->print("%s: %s of %s packets in %s ms\n",
+		     batched ? "recv_batch" : "read", got, npackets, ms);
+    }
+    return 0;
+}
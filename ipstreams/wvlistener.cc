@@ -9,6 +9,10 @@
 #include "wvistreamlist.h"
 #include "wvaddr.h"
 #include "wvmoniker.h"
+#include <errno.h>
+#ifndef _WIN32
+# include <fcntl.h>
+#endif
 
 UUID_MAP_BEGIN(WvListener)
   UUID_MAP_ENTRY(IObject)
@@ -33,6 +37,9 @@ WvListener::WvListener(IWvStream *_cloned)
 {
     cloned = _cloned;
     wrapper = 0;
+    accepted = refused = queued = 0;
+    accept_batch = 16;
+    max_active = max_waiting = 0;
 }
     
 
@@ -65,13 +72,127 @@ void WvListener::addwrap(IWvListenerWrapper _wrapper)
 }
 
 
+void WvListener::set_accept_batch(int _accept_batch)
+{
+    accept_batch = _accept_batch > 0 ? _accept_batch : 1;
+}
+
+
+void WvListener::set_max_connections(int _max_active, int _max_waiting)
+{
+    max_active = _max_active > 0 ? _max_active : 0;
+    max_waiting = _max_waiting > 0 ? _max_waiting : 0;
+    if (!max_active)
+	active.zap();
+}
+
+
+int WvListener::num_active()
+{
+    // forget about connections that have closed, or that nobody but us
+    // is holding onto any more
+    WvIStreamListBase::Iter i(active);
+    for (i.rewind(); i.next(); )
+    {
+	bool lastref = (i->addRef() == 2);
+	i->release();
+	if (lastref || !i->isok())
+	    i.xunlink();
+    }
+    return active.count();
+}
+
+
+bool WvListener::have_slot()
+{
+    return !max_active || num_active() < max_active;
+}
+
+
+void WvListener::admit(IWvStream *s)
+{
+    accepted++;
+    if (max_active)
+    {
+	s->addRef();
+	active.append(s, true);
+    }
+    acceptor(s);
+}
+
+
 void WvListener::callback()
 {  
-    if (acceptor)
+    if (!acceptor)
+	return;
+    
+    // connections that were waiting for a slot go first
+    while (!waiting.isempty() && have_slot())
+    {
+	WvIStreamListBase::Iter i(waiting);
+	i.rewind(); i.next();
+	IWvStream *s = i.ptr();
+	i.xunlink(false);
+	admit(s);
+    }
+    
+    for (int n = 0; n < accept_batch && acceptor; n++)
     {
 	IWvStream *s = accept();
-	if (s) acceptor(s);
+	if (!s)
+	    break;
+	
+	if (have_slot())
+	    admit(s);
+	else if ((int)waiting.count() < max_waiting)
+	{
+	    queued++;
+	    waiting.append(s, true);
+	}
+	else
+	{
+	    refused++;
+	    WVRELEASE(s);
+	}
+    }
+}
+
+
+void WvListener::pre_select(SelectInfo &si)
+{
+    if (cloned)
+	cloned->pre_select(si);
+    if (!waiting.isempty() && acceptor && have_slot())
+	si.msec_timeout = 0;
+}
+
+
+bool WvListener::post_select(SelectInfo &si)
+{
+    bool ready = cloned ? cloned->post_select(si) : false;
+    return ready || (!waiting.isempty() && acceptor && have_slot());
+}
+
+
+int WvListener::accept_fd(struct sockaddr *sa, socklen_t *len)
+{
+#ifdef SOCK_CLOEXEC
+    int fd = ::accept4(getfd(), sa, len, SOCK_NONBLOCK|SOCK_CLOEXEC);
+    if (fd < 0 && errno == ENOSYS)
+    {
+	// glibc knows about accept4(), but the kernel is too old
+	fd = ::accept(getfd(), sa, len);
+	if (fd >= 0)
+	{
+	    fcntl(fd, F_SETFD, FD_CLOEXEC);
+	    fcntl(fd, F_SETFL, O_RDWR|O_NONBLOCK);
+	}
     }
+    return fd;
+#else
+    // the caller will have to set the flags itself
+    return ::accept(getfd(), sa, len);
+#endif
 }
 
 
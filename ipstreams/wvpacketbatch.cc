@@ -0,0 +1,336 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A set of preallocated datagram buffers, for sending and receiving many
+ * packets per system call.  See wvpacketbatch.h.
+ */
+#include "wvpacketbatch.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// recvmmsg() and sendmmsg() came along with MSG_WAITFORONE
+#ifdef MSG_WAITFORONE
+# define HAVE_MMSG 1
+struct WvPacketBatch::Msg : public mmsghdr
+{
+};
+#else
+# define HAVE_MMSG 0
+struct WvPacketBatch::Msg
+{
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+#endif
+
+
+struct WvPacketBatch::Slot
+{
+    unsigned char *buf;
+    size_t len;
+    bool truncated;
+    struct iovec iov;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+};
+
+
+static bool would_block(int err)
+{
+    return err == EAGAIN || err == EWOULDBLOCK || err == EINTR;
+}
+
+
+// Sending a packet that fails for any other reason (EMSGSIZE, EINVAL,
+// ECONNREFUSED, ...) will just fail again, so there's no point keeping it.
+static bool send_later(int err)
+{
+    return would_block(err) || err == ENOBUFS;
+}
+
+
+template<class T>
+static void reverse(T *slots, int n)
+{
+    for (int i = 0, j = n - 1; i < j; i++, j--)
+    {
+	T tmp = slots[i];
+	slots[i] = slots[j];
+	slots[j] = tmp;
+    }
+}
+
+
+WvPacketBatch::WvPacketBatch(int _max_packets, size_t _max_size)
+{
+    nslots = _max_packets > 0 ? _max_packets : 1;
+    slotsize = _max_size > 0 ? _max_size : 1;
+    used = 0;
+    ndropped = 0;
+
+    bufs = new unsigned char[nslots * slotsize];
+    slots = new Slot[nslots];
+    msgs = new Msg[nslots];
+    memset(msgs, 0, nslots * sizeof(*msgs));
+    for (int i = 0; i < nslots; i++)
+    {
+	slots[i].buf = bufs + i * slotsize;
+	slots[i].len = 0;
+	slots[i].truncated = false;
+	slots[i].addrlen = 0;
+    }
+}
+
+
+WvPacketBatch::~WvPacketBatch()
+{
+    delete[] msgs;
+    delete[] slots;
+    delete[] bufs;
+}
+
+
+const unsigned char *WvPacketBatch::data(int i) const
+{
+    return slots[i].buf;
+}
+
+
+size_t WvPacketBatch::len(int i) const
+{
+    return slots[i].len;
+}
+
+
+bool WvPacketBatch::truncated(int i) const
+{
+    return slots[i].truncated;
+}
+
+
+const struct sockaddr *WvPacketBatch::sockaddr(int i) const
+{
+    // an unbound sender gives us nothing but the address family
+    if (slots[i].addrlen <= sizeof(sa_family_t))
+	return NULL;
+    return (const struct sockaddr *)&slots[i].addr;
+}
+
+
+socklen_t WvPacketBatch::sockaddr_len(int i) const
+{
+    return sockaddr(i) ? slots[i].addrlen : 0;
+}
+
+
+unsigned char *WvPacketBatch::alloc(size_t count, const WvAddr *dest)
+{
+    if (used >= nslots || count > slotsize)
+	return NULL;
+
+    Slot &slot = slots[used];
+    slot.addrlen = 0;
+    if (dest)
+    {
+	struct sockaddr *sa = dest->sockaddr();
+	size_t salen = dest->sockaddr_len();
+	if (salen > sizeof(slot.addr))
+	{
+	    delete sa;
+	    return NULL;
+	}
+	memcpy(&slot.addr, sa, salen);
+	slot.addrlen = salen;
+	delete sa;
+    }
+    slot.len = count;
+    slot.truncated = false;
+    used++;
+    return slot.buf;
+}
+
+
+bool WvPacketBatch::add(const void *buf, size_t count, const WvAddr *dest)
+{
+    unsigned char *p = alloc(count, dest);
+    if (p)
+	memcpy(p, buf, count);
+    return p != NULL;
+}
+
+
+void WvPacketBatch::setup(int i, bool receiving)
+{
+    Slot &slot = slots[i];
+    struct msghdr &hdr = msgs[i].msg_hdr;
+
+    slot.iov.iov_base = slot.buf;
+    slot.iov.iov_len = receiving ? slotsize : slot.len;
+    hdr.msg_iov = &slot.iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = NULL;
+    hdr.msg_controllen = 0;
+    hdr.msg_flags = 0;
+    if (receiving || slot.addrlen)
+    {
+	hdr.msg_name = &slot.addr;
+	hdr.msg_namelen = receiving ? sizeof(slot.addr) : slot.addrlen;
+    }
+    else
+    {
+	hdr.msg_name = NULL;
+	hdr.msg_namelen = 0;
+    }
+    msgs[i].msg_len = 0;
+}
+
+
+int WvPacketBatch::recv(int fd)
+{
+    used = 0;
+    for (int i = 0; i < nslots; i++)
+	setup(i, true);
+
+    int n;
+#if HAVE_MMSG
+    n = recvmmsg(fd, msgs, nslots, MSG_DONTWAIT, NULL);
+    if (n < 0)
+	return would_block(errno) ? 0 : -1;
+#else
+    for (n = 0; n < nslots; n++)
+    {
+	ssize_t got = recvmsg(fd, &msgs[n].msg_hdr, MSG_DONTWAIT);
+	if (got < 0)
+	{
+	    if (!n && !would_block(errno))
+		return -1;
+	    break;
+	}
+	msgs[n].msg_len = got;
+    }
+#endif
+
+    for (int i = 0; i < n; i++)
+    {
+	slots[i].len = msgs[i].msg_len;
+	slots[i].truncated = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+	slots[i].addrlen = msgs[i].msg_hdr.msg_namelen;
+    }
+    used = n;
+    return n;
+}
+
+
+int WvPacketBatch::send(int fd, const WvAddr *dest)
+{
+    if (!used)
+	return 0;
+
+    struct sockaddr *destsa = dest ? dest->sockaddr() : NULL;
+    socklen_t destlen = dest ? dest->sockaddr_len() : 0;
+    for (int i = 0; i < used; i++)
+    {
+	setup(i, false);
+	if (!slots[i].addrlen && destsa)
+	{
+	    msgs[i].msg_hdr.msg_name = destsa;
+	    msgs[i].msg_hdr.msg_namelen = destlen;
+	}
+    }
+
+    int count = 0, nsent = 0, err = 0;
+    while (count < used)
+    {
+#if HAVE_MMSG
+	int n = sendmmsg(fd, msgs + count, used - count, MSG_DONTWAIT);
+#else
+	int n = sendmsg(fd, &msgs[count].msg_hdr, MSG_DONTWAIT) < 0 ? -1 : 1;
+#endif
+	if (n < 0)
+	{
+	    if (send_later(errno))
+		break;
+	    
+	    // packet 'count' is the one that failed; skip it and go on
+	    err = errno;
+	    count++;
+	    continue;
+	}
+	count += n;
+	nsent += n;
+    }
+    delete destsa;
+    return sent(count, nsent, err);
+}
+
+
+int WvPacketBatch::read(int fd)
+{
+    used = 0;
+    while (used < nslots)
+    {
+	Slot &slot = slots[used];
+	ssize_t got = ::read(fd, slot.buf, slotsize);
+	if (got <= 0)
+	{
+	    if (got < 0 && !used && !would_block(errno))
+		return -1;
+	    break;
+	}
+	slot.len = got;
+	slot.truncated = false; // we can't tell
+	slot.addrlen = 0;
+	used++;
+    }
+    return used;
+}
+
+
+int WvPacketBatch::write(int fd)
+{
+    int count = 0, nsent = 0, err = 0;
+    while (count < used)
+    {
+	if (::write(fd, slots[count].buf, slots[count].len) < 0)
+	{
+	    if (send_later(errno))
+		break;
+	    err = errno;
+	}
+	else
+	    nsent++;
+	count++;
+    }
+    return sent(count, nsent, err);
+}
+
+
+// Drop the first 'count' packets, of which 'nsent' were sent and the rest
+// failed for good (the last one with 'err'), and return what send() or
+// write() should.
+int WvPacketBatch::sent(int count, int nsent, int err)
+{
+    ndropped += count - nsent;
+
+    // move what's left to the front, by swapping slots rather than copying
+    // any data
+    if (count && count < used)
+    {
+	reverse(slots, count);
+	reverse(slots + count, used - count);
+	reverse(slots, used);
+    }
+    used -= count;
+
+    if (!nsent && err)
+    {
+	errno = err;
+	return -1;
+    }
+    return nsent;
+}
@@ -113,7 +113,12 @@ WvTCPConn::WvTCPConn(int _fd, const WvIPPortAddr &_remaddr)
     resolved = true;
     connected = true;
     incoming = true;
+#ifdef SOCK_CLOEXEC
+    // WvTCPListener::accept() already made it non-blocking and close-on-exec
+    nice_sockopts();
+#else
     nice_tcpopts();
+#endif
 }
 
 
@@ -165,7 +170,12 @@ void WvTCPConn::nice_tcpopts()
 {
     set_close_on_exec(true);
     set_nonblock(true);
-    
+    nice_sockopts();
+}
+
+
+void WvTCPConn::nice_sockopts()
+{
     int value = 1;
     setsockopt(getfd(), SOL_SOCKET, SO_KEEPALIVE, &value, sizeof(value));
     low_delay();
@@ -415,7 +425,7 @@ WvTCPListener::WvTCPListener(const WvIPPortAddr &_listenport)
     if (getfd() < 0
 	|| setsockopt(getfd(), SOL_SOCKET, SO_REUSEADDR, &x, sizeof(x))
 	|| bind(getfd(), sa, listenport.sockaddr_len())
-	|| listen(getfd(), 5))
+	|| listen(getfd(), SOMAXCONN))
     {
 	seterr(errno);
 	return;
@@ -448,7 +458,7 @@ IWvStream *WvTCPListener::accept()
     
     if (!isok()) return NULL;
 
-    int newfd = ::accept(getfd(), (struct sockaddr *)&sin, &len);
+    int newfd = accept_fd((struct sockaddr *)&sin, &len);
     if (newfd >= 0)
 	return wrap(new WvTCPConn(newfd, WvIPPortAddr(&sin)));
     else if (errno == EAGAIN || errno == EINTR)
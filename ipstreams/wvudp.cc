@@ -24,7 +24,7 @@
 #endif
 
 WvUDPStream::WvUDPStream(const WvIPPortAddr &_local,
-    const WvIPPortAddr &_rem) :
+    const WvIPPortAddr &_rem, bool reuseport) :
     localaddr(), remaddr(_rem)
 {
     int x = 1;
@@ -36,6 +36,20 @@ WvUDPStream::WvUDPStream(const WvIPPortAddr &_local,
 	return;
     }
     
+    if (reuseport)
+    {
+#ifdef SO_REUSEPORT
+	if (setsockopt(getfd(), SOL_SOCKET, SO_REUSEPORT, &x, sizeof(x)) < 0)
+	{
+	    seterr(errno);
+	    return;
+	}
+#else
+	seterr(ENOPROTOOPT);
+	return;
+#endif
+    }
+    
     set_close_on_exec(true);
     set_nonblock(true);
 
@@ -138,3 +152,39 @@ void WvUDPStream::enable_broadcasts()
     
     setsockopt(getfd(), SOL_SOCKET, SO_BROADCAST, &value, sizeof(value));
 }
+
+
+#ifndef _WIN32
+int WvUDPStream::recv_batch(WvPacketBatch &batch)
+{
+    if (!isok())
+    {
+	batch.zap();
+	return 0;
+    }
+    
+    int n = batch.recv(getfd());
+    if (n > 0)
+    {
+	const struct sockaddr *from = batch.sockaddr(n - 1);
+	if (from && from->sa_family == AF_INET)
+	    remaddr = WvIPPortAddr((sockaddr_in *)from);
+    }
+    
+    // errors in UDP are ignored
+    return n < 0 ? 0 : n;
+}
+
+
+int WvUDPStream::send_batch(WvPacketBatch &batch)
+{
+    if (!isok()) return 0;
+    
+    int out = batch.send(getfd(), remaddr.is_zero() ? NULL : &remaddr);
+    if (out < 0 && errno == EACCES) // permission denied
+	seterr(EACCES);
+    
+    // other errors in UDP are ignored, as in uwrite()
+    return out < 0 ? 0 : out;
+}
+#endif
@@ -88,6 +88,38 @@ size_t WvUnixDGSocket::uwrite(const void *buf, size_t count)
     return count;
 }
 
+int WvUnixDGSocket::recv_batch(WvPacketBatch &batch)
+{
+    if (!isok())
+    {
+        batch.zap();
+        return 0;
+    }
+
+    int n = batch.recv(getfd());
+    if (n < 0)
+    {
+        seterr(errno);
+        return 0;
+    }
+    return n;
+}
+
+int WvUnixDGSocket::send_batch(WvPacketBatch &batch)
+{
+    int count = batch.count();
+
+    // anything already buffered has to go first
+    if (isok() && bufs.isempty())
+        batch.send(getfd());
+
+    for (int i = 0; i < batch.count(); i++)
+        uwrite(batch.data(i), batch.len(i));
+    batch.zap();
+
+    return count;
+}
+
 void WvUnixDGSocket::pre_select(SelectInfo &si)
 {
     SelectRequest oldwant = si.wants;
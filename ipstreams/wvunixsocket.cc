@@ -97,8 +97,11 @@ WvUnixConn::WvUnixConn(int _fd, const WvUnixAddr &_addr)
     : WvFDStream(_fd), addr(_addr)
 {
     // all is well and we're connected.
+#ifndef SOCK_CLOEXEC
+    // (otherwise WvUnixListener::accept() already set these)
     set_nonblock(true);
     set_close_on_exec(true);
+#endif
 }
 
 
@@ -218,7 +221,7 @@ IWvStream *WvUnixListener::accept()
     
     if (!isok()) return NULL;
     
-    int newfd = ::accept(getfd(), (struct sockaddr *)&saun, &len);
+    int newfd = accept_fd((struct sockaddr *)&saun, &len);
     if (newfd >= 0)
 	return wrap(new WvUnixConn(newfd, addr));
     else if (errno == EAGAIN || errno == EINTR)
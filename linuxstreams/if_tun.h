@@ -75,12 +75,33 @@ struct tun_struct {
 #define TUNSETIFF     _IOW('T', 202, int) 
 #define TUNSETPERSIST _IOW('T', 203, int) 
 #define TUNSETOWNER   _IOW('T', 204, int)
+#ifndef TUNSETOFFLOAD
+#define TUNSETOFFLOAD  _IOW('T', 208, unsigned int)
+#endif
+#ifndef TUNSETVNETHDRSZ
+#define TUNSETVNETHDRSZ _IOW('T', 216, int)
+#endif
 
 /* TUNSETIFF ifr flags */
 #define IFF_TUN		0x0001
 #define IFF_TAP		0x0002
 #define IFF_NO_PI	0x1000
 #define IFF_ONE_QUEUE	0x2000
+#ifndef IFF_VNET_HDR
+#define IFF_VNET_HDR	0x4000
+#endif
+#ifndef IFF_MULTI_QUEUE
+#define IFF_MULTI_QUEUE	0x0100
+#endif
+
+/* Features for TUNSETOFFLOAD */
+#ifndef TUN_F_CSUM
+#define TUN_F_CSUM	0x01	/* You can hand me unchecksummed packets. */
+#define TUN_F_TSO4	0x02	/* I can handle TSO for IPv4 packets */
+#define TUN_F_TSO6	0x04	/* I can handle TSO for IPv6 packets */
+#define TUN_F_TSO_ECN	0x08	/* I can handle TSO with ECN bits. */
+#define TUN_F_UFO	0x10	/* I can handle UFO packets */
+#endif
 
 struct tun_pi {
 	unsigned short flags;
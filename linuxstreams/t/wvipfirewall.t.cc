@@ -0,0 +1,96 @@
+#include "wvtest.h"
+#include "wvipfirewall.h"
+
+
+static bool record(WvStringList &runs, bool ok, WvStringParm rules)
+{
+    runs.append(rules);
+    return ok;
+}
+
+
+WVTEST_MAIN("firewall batches")
+{
+    WvIPFirewall::enable = true;
+    WvStringList runs;
+    {
+	WvIPFirewall fw;
+	fw.runner = wv::bind(record, wv::ref(runs), true, _1);
+
+	// each change on its own is one transaction
+	fw.add_port(WvIPPortAddr("0.0.0.0", 22));
+	WVPASSEQ(runs.count(), 1);
+	WVPASSEQ(*runs.first(),
+		 "*filter\n"
+		 "-A Services -j ACCEPT -p tcp --dport 22\n"
+		 "-A Services -j ACCEPT -p udp --dport 22\n"
+		 "COMMIT\n");
+	runs.zap();
+
+	// a batch is one transaction, grouped by table, and what cancels out
+	// isn't sent at all
+	fw.begin();
+	for (int port = 8000; port < 8300; port++)
+	    fw.add_redir(WvIPPortAddr("0.0.0.0", port), 3128);
+	fw.add_proto("gre");
+	fw.add_redir(WvIPPortAddr("10.0.0.1", 80), 3129);
+	fw.del_redir(WvIPPortAddr("10.0.0.1", 80), 3129);
+	fw.commit();
+	WVPASSEQ(runs.count(), 1);
+	WvString s(*runs.first());
+	WVPASS(!strncmp(s, "*filter\n-A Services -p gre -j ACCEPT\nCOMMIT\n"
+			"*nat\n-A TProxy -p tcp --dport 8000 -j REDIRECT "
+			"--to-ports 3128\n", 100));
+	WVFAIL(strstr(s, "3129"));
+	WVPASS(strstr(s, "--dport 8299 "));
+	runs.zap();
+
+	// nothing happens until the outermost commit()
+	fw.begin();
+	fw.begin();
+	fw.add_proto("esp");
+	fw.commit();
+	WVPASSEQ(runs.count(), 0);
+	fw.commit();
+	WVPASSEQ(runs.count(), 1);
+	runs.zap();
+    }
+
+    // zap() takes everything out at once
+    WVPASSEQ(runs.count(), 1);
+    WvString s(*runs.first());
+    WVPASS(strstr(s, "-D Services -j ACCEPT -p tcp --dport 22\n"));
+    WVPASS(strstr(s, "-D TProxy -p tcp --dport 8150 "));
+    WVPASS(strstr(s, "-D Services -p esp -j ACCEPT\n"));
+    WVFAIL(strstr(s, "-A "));
+    WVFAIL(strstr(s, "3129"));
+
+    WvIPFirewall::enable = false;
+}
+
+
+WVTEST_MAIN("firewall failures")
+{
+    WvIPFirewall::enable = true;
+    WvStringList runs;
+    {
+	WvIPFirewall fw;
+	fw.runner = wv::bind(record, wv::ref(runs), false, _1);
+
+	// if the transaction fails, we try each rule by itself
+	fw.begin();
+	fw.add_proto("gre");
+	fw.add_redir_all(3128);
+	fw.commit();
+	WVPASSEQ(runs.count(), 3);
+	WVPASSEQ(*runs.last(),
+		 "*nat\n-A TProxy -p tcp -j REDIRECT --to-ports 3128\n"
+		 "COMMIT\n");
+	runs.zap();
+
+	// nothing is sent while we're disabled
+	WvIPFirewall::enable = false;
+	fw.zap();
+	WVPASSEQ(runs.count(), 0);
+    }
+}
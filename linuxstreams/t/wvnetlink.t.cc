@@ -0,0 +1,111 @@
+#include "wvtest.h"
+#include "wvnetlink.h"
+#include "wvinterface.h"
+#include "wvtundev.h"
+#include "wvstringlist.h"
+#include <net/if.h>
+
+
+WVTEST_MAIN("netlink tables")
+{
+    WvNetlink nl;
+    if (!nl.isok())
+    {
+	printf("No rtnetlink (%s), skipping.\n", nl.errstr().cstr());
+	return;
+    }
+
+    WvNetlinkLinkDict links(15);
+    WVPASS(nl.get_links(links));
+    WvNetlinkLink *lo = NULL;
+    WvNetlinkLinkDict::Iter link(links);
+    for (link.rewind(); link.next(); )
+	if (link->name == "lo")
+	    lo = link.ptr();
+    WVPASS(lo);
+    if (!lo)
+	return;
+    WVPASS(lo->flags & IFF_LOOPBACK);
+    WVPASS(lo->hwaddr);
+
+    WvNetlinkAddrList addrs;
+    WVPASS(nl.get_addrs(addrs));
+    bool found = false;
+    WvNetlinkAddrList::Iter addr(addrs);
+    for (addr.rewind(); addr.next(); )
+    {
+	if (addr->index == lo->index
+	    && WvIPAddr(addr->addr) == WvIPAddr("127.0.0.1"))
+	{
+	    found = true;
+	    WVPASSEQ(addr->label, "lo");
+	    WVPASSEQ(addr->addr.bits(), 8);
+	}
+    }
+    WVPASS(found);
+
+    // WvInterfaceDict should agree, without asking for each address
+    WvInterfaceDict ifcs;
+    WvInterface *ifc = ifcs["lo"];
+    WVPASS(ifc);
+    if (ifc)
+    {
+	WVPASS(WvIPAddr(ifc->ipaddr()) == WvIPAddr("127.0.0.1"));
+	WVPASSEQ(ifc->ipaddr().bits(), 8);
+    }
+
+    // the routes are whatever they are, but they should all have a real
+    // interface, and WvIPRouteList should agree
+    WvIPRouteList routes;
+    WVPASS(nl.get_routes(routes));
+    WvIPRouteList::Iter r(routes);
+    for (r.rewind(); r.next(); )
+	WVPASS(ifcs[r->ifc]);
+
+    WvIPRouteList kernel;
+    kernel.get_kernel();
+    WVPASSEQ(kernel.count(), routes.count());
+}
+
+
+static void linkchange(WvStringList &added, WvStringList &removed,
+		       const WvNetlinkLink &link, bool add)
+{
+    (add ? added : removed).append(link.name);
+}
+
+
+WVTEST_MAIN("netlink notifications")
+{
+    WvNetlink nl(true);
+    WVPASS(nl.isok());
+
+    WvStringList added, removed;
+    nl.link_callback = wv::bind(linkchange, wv::ref(added), wv::ref(removed),
+				_1, _2);
+
+    WvString name;
+    {
+	WvTunDev tun(WvIPNet("10.78.0.1", 24));
+	if (!tun.isok())
+	{
+	    printf("Can't create a tun device (%s), skipping.\n",
+		   tun.errstr().cstr());
+	    return;
+	}
+	name = tun.ifcname;
+
+	while (!added.count() && nl.select(1000))
+	    nl.callback();
+	WVPASS(added.count());
+	if (added.count())
+	    WVPASSEQ(*added.first(), name);
+    }
+
+    // closing the tun device removes the interface
+    while (!removed.count() && nl.select(1000))
+	nl.callback();
+    WVPASS(removed.count());
+    if (removed.count())
+	WVPASSEQ(*removed.last(), name);
+}
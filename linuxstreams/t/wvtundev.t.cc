@@ -0,0 +1,71 @@
+#include "wvtest.h"
+#include "wvtundev.h"
+#include "wvudp.h"
+#include <string.h>
+
+
+WVTEST_MAIN("tundev batches")
+{
+    WvTunDev tun(WvIPNet("10.77.0.1", 24), 1400,
+		 WvTunDev::VNetHdr | WvTunDev::MultiQueue);
+    if (!tun.isok())
+    {
+	// probably not root
+	printf("Can't create a tun device (%s), skipping.\n",
+	       tun.errstr().cstr());
+	return;
+    }
+    
+    WvTunDev *queue = tun.open_queue();
+    WVPASS(queue->isok());
+    WVPASSEQ(queue->ifcname, tun.ifcname);
+    
+    WvUDPStream udp(WvIPPortAddr("10.77.0.1", 0),
+		    WvIPPortAddr("10.77.0.2", 9));
+    WVPASS(udp.isok());
+    for (int i = 0; i < 5; i++)
+	udp.write(WvString("ping %s", i));
+    
+    // the packets may be spread across both queues
+    WvPacketBatch batch(16, 2048);
+    int total = 0;
+    unsigned char reply[100];
+    size_t replylen = 0;
+    while (total < 5 && (tun.select(1000) || queue->select(0)))
+    {
+	WvTunDev *q = tun.select(0) ? &tun : queue;
+	int n = q->recv_batch(batch);
+	for (int i = 0; i < n; i++)
+	{
+	    const unsigned char *ip = batch.data(i) + WvTunDev::vnet_hdr_len;
+	    if (ip[0] != 0x45 || ip[9] != 17) // some IPv6 noise, maybe
+		continue;
+	    WVPASSEQ(batch.len(i), WvTunDev::vnet_hdr_len + 20 + 8 + 6);
+	    replylen = batch.len(i);
+	    memcpy(reply, batch.data(i), replylen);
+	    total++;
+	}
+    }
+    WVPASSEQ(total, 5);
+    
+    // bounce the last one back by swapping the addresses and ports, which
+    // leaves the checksums right
+    unsigned char *ip = reply + WvTunDev::vnet_hdr_len, tmp[4];
+    memcpy(tmp, ip + 12, 4);
+    memcpy(ip + 12, ip + 16, 4);
+    memcpy(ip + 16, tmp, 4);
+    memcpy(tmp, ip + 20, 2);
+    memcpy(ip + 20, ip + 22, 2);
+    memcpy(ip + 22, tmp, 2);
+    batch.zap();
+    WVPASS(batch.add(reply, replylen));
+    WVPASSEQ(tun.send_batch(batch), 1);
+    WVPASSEQ(batch.count(), 0);
+    
+    WVPASS(udp.select(1000));
+    WvDynBuf buf;
+    udp.read(buf, 100);
+    WVPASSEQ(buf.getstr(), "ping 4");
+    
+    delete queue;
+}
@@ -11,6 +11,7 @@
 
 #include "wvsubproc.h"
 #include "wvfile.h"
+#include "wvnetlink.h"
 
 #include <sys/ioctl.h>
 #include <sys/socket.h>
@@ -620,6 +621,68 @@ WvInterfaceDict::~WvInterfaceDict()
 }
 
 
+// auto-fill the list of interfaces from rtnetlink, which tells us about
+// every interface and alias, up or down, along with their hardware and IP
+// addresses, in two requests.  That saves an ioctl() or two per interface
+// later on, when someone asks for the addresses.
+//
+bool WvInterfaceDict::update_netlink()
+{
+    WvNetlink nl;
+    WvNetlinkLinkDict links(15);
+    WvNetlinkAddrList addrs;
+    
+    if (!nl.get_links(links) || !nl.get_addrs(addrs))
+	return false;
+    
+    WvNetlinkLinkDict::Iter link(links);
+    for (link.rewind(); link.next(); )
+    {
+	WvInterface *ifc = (*this)[link->name];
+	
+	if (!ifc)
+	{
+	    ifc = new WvInterface(link->name);
+	    slist.add(ifc, true);
+	}
+	else
+	    ifc->rescan();
+	ifc->valid = true;
+	
+	// hand over the address; 'links' is about to go away anyway
+	ifc->my_hwaddr = link->hwaddr;
+	link->hwaddr = NULL;
+	ifc->my_ipaddr = new WvIPNet();
+	log(WvLog::Debug3, "Found %-16s  [%s]\n", ifc->name, ifc->hwaddr());
+    }
+    
+    // the kernel lists each interface's primary addresses first, which are
+    // the ones SIOCGIFADDR would have given us.  Aliases (eg. "eth0:1") are
+    // interfaces of their own, named by their address labels.
+    WvNetlinkAddrList::Iter addr(addrs);
+    for (addr.rewind(); addr.next(); )
+    {
+	WvInterface *ifc = (*this)[addr->label];
+	
+	if (!ifc)
+	{
+	    ifc = new WvInterface(addr->label);
+	    slist.add(ifc, true);
+	}
+	else if (!ifc->valid)
+	    ifc->rescan();
+	else if (ifc->my_ipaddr && !ifc->my_ipaddr->is_default())
+	    continue; // already have its first address
+	ifc->valid = true;
+	
+	delete ifc->my_ipaddr;
+	ifc->my_ipaddr = new WvIPNet(addr->addr);
+    }
+    
+    return true;
+}
+
+
 // auto-fill the list of interfaces using the list from /proc/net/dev.
 //
 // I wish there was a better way to do this, but the SIOCGIFCONF ioctl
@@ -640,6 +703,8 @@ void WvInterfaceDict::update()
     for (i.rewind(); i.next(); )
 	i().valid = false;
     
+    if (update_netlink())
+	return;
 
     // get list of all non-aliased interfaces from /proc/net/dev
     
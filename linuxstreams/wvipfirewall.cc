@@ -7,6 +7,8 @@
  */
 #include "wvipfirewall.h"
 #include "wvinterface.h"
+#include "wvpipe.h"
+#include <fcntl.h>
 #include <unistd.h>
 
 
@@ -17,6 +19,8 @@ WvIPFirewall::WvIPFirewall() : log("Firewall", WvLog::Debug2)
 {
     // don't change any firewall rules here!  Remember that there may be
     // more than one instance of the firewall object.
+    holding = 0;
+    runner = iptables_restore;
 }
 
 
@@ -26,40 +30,161 @@ WvIPFirewall::~WvIPFirewall()
 }
 
 
-WvString WvIPFirewall::port_command(const char *cmd, const char *proto,
-				    const WvIPPortAddr &addr)
+bool WvIPFirewall::iptables_restore(WvStringParm rules)
+{
+    const char *argv[] = { "iptables-restore", "--noflush", NULL };
+    int null = ignore_errors ? open("/dev/null", O_WRONLY) : -1;
+    WvPipe p(argv[0], argv, true, false, false, 0,
+	     null >= 0 ? null : 1, null >= 0 ? null : 2);
+    if (null >= 0)
+	close(null);
+    
+    p.write(rules);
+    p.flush(-1);
+    p.nowrite();
+    return p.finish() == 0 && !p.child_killed();
+}
+
+
+void WvIPFirewall::begin()
+{
+    holding++;
+}
+
+
+void WvIPFirewall::commit()
+{
+    if (holding > 0 && !--holding)
+	apply();
+}
+
+
+// remember a change to make to the given table, and make it right away
+// unless we're in the middle of a begin()/commit()
+void WvIPFirewall::change(const char *table, bool add, WvStringParm rule)
+{
+    // tidy up the spacing, so equal rules compare equal
+    WvStringList words;
+    words.split(rule);
+    changes.append(new Change(table, add, words.join(" ")), true);
+    
+    if (!holding)
+	apply();
+}
+
+
+// A rule that was added and deleted again before we got around to telling
+// the kernel about it.
+struct WvIPFirewallNet
+{
+    WvString key;
+    int count;
+    
+    WvIPFirewallNet(WvStringParm _key) : key(_key)
+        { count = 0; }
+};
+DeclareWvDict(WvIPFirewallNet, WvString, key);
+
+
+void WvIPFirewall::apply()
+{
+    if (!enable)
+    {
+	changes.zap();
+	return;
+    }
+    
+    // add up the net effect of all the changes to each rule...
+    WvIPFirewallNetDict net(changes.count() + 1);
+    ChangeList::Iter i(changes);
+    for (i.rewind(); i.next(); )
+    {
+	WvString key("%s %s", i->table, i->rule);
+	WvIPFirewallNet *n = net[key];
+	if (!n)
+	{
+	    n = new WvIPFirewallNet(key);
+	    net.add(n, true);
+	}
+	n->count += i->add ? 1 : -1;
+    }
+    
+    // ...and drop the changes that cancel out
+    for (i.rewind(); i.next(); )
+    {
+	WvIPFirewallNet *n = net[WvString("%s %s", i->table, i->rule)];
+	if (i->add && n->count > 0)
+	    n->count--;
+	else if (!i->add && n->count < 0)
+	    n->count++;
+	else
+	    i.xunlink();
+    }
+    
+    if (!changes.count())
+	return;
+    
+    // iptables-restore wants the changes grouped by table
+    static const char *tables[] = { "filter", "nat", "mangle", NULL };
+    WvString rules("");
+    for (const char **table = tables; *table; table++)
+    {
+	WvString lines("");
+	for (i.rewind(); i.next(); )
+	{
+	    if (i->table == *table)
+		lines.append("%s %s\n", i->add ? "-A" : "-D", i->rule);
+	}
+	if (!!lines)
+	    rules.append("*%s\n%sCOMMIT\n", *table, lines);
+    }
+    
+    log("Applying %s rule changes:\n%s", changes.count(), rules);
+    if (!runner(rules) && changes.count() > 1)
+    {
+	// One bad rule (say, deleting one somebody else already deleted)
+	// spoils the whole transaction.  Do the rest of them one at a time,
+	// like we used to.
+	log("iptables-restore failed; retrying one rule at a time.\n");
+	for (i.rewind(); i.next(); )
+	    runner(WvString("*%s\n%s %s\nCOMMIT\n",
+			    i->table, i->add ? "-A" : "-D", i->rule));
+    }
+    changes.zap();
+}
+
+
+void WvIPFirewall::port_command(bool add, const char *proto,
+				const WvIPPortAddr &addr)
 {
     WvIPAddr ad(addr), none;
     
-    return WvString("iptables %s Services -j ACCEPT -p %s "
-		    "%s --dport %s "
-		    "%s",
-		    cmd, proto,
+    change("filter", add,
+	   WvString("Services -j ACCEPT -p %s "
+		    "%s --dport %s",
+		    proto,
 		    ad == none ? WvString("") : WvString("-d %s", ad),
-		    addr.port,
-		    shutup());
+		    addr.port));
 }
 
 
-WvString WvIPFirewall::redir_command(const char *cmd, const WvIPPortAddr &src,
-				     int dstport)
+void WvIPFirewall::redir_command(bool add, const WvIPPortAddr &src,
+				 int dstport)
 {
     WvIPAddr ad(src), none;
     
-    return WvString("iptables -t nat %s TProxy "
+    change("nat", add,
+	   WvString("TProxy "
 		    "-p tcp %s --dport %s "
-		    "-j REDIRECT --to-ports %s "
-		    "%s",
-		    cmd,
+		    "-j REDIRECT --to-ports %s",
 		    ad == none ? WvString("") : WvString("-d %s", ad),
-		    src.port, dstport,
-		    shutup());
+		    src.port, dstport));
 }
 
-WvString WvIPFirewall::forward_command(const char *cmd, 
-				       const char *proto,
-				       const WvIPPortAddr &src,
-				       const WvIPPortAddr &dst, bool snat)
+void WvIPFirewall::forward_command(bool add, 
+				   const char *proto,
+				   const WvIPPortAddr &src,
+				   const WvIPPortAddr &dst, bool snat)
 {
     WvIPAddr srcaddr(src), dstaddr(dst), zero;
     WvString haveiface(""), haveoface("");
@@ -69,22 +194,22 @@ WvString WvIPFirewall::forward_command(const char *cmd,
 	haveiface.append((WvString)srcaddr);
     }
     
-    WvString retval;
-
     if ((dst == WvIPAddr("127.0.0.1")) || (dst == zero))
     {
-        retval.append("iptables -t nat %s FASTFORWARD -p %s --dport %s %s "
-                  "-j REDIRECT --to-port %s %s \n",
-                   cmd, proto, src.port, haveiface, dst.port, shutup());
+        change("nat", add,
+	       WvString("FASTFORWARD -p %s --dport %s %s "
+			"-j REDIRECT --to-port %s",
+			proto, src.port, haveiface, dst.port));
     }
     else
     {
 	haveoface.append("-d ");
 	haveoface.append((WvString)dstaddr);
     
-        retval.append("iptables -t nat %s FASTFORWARD -p %s --dport %s %s "
-                  "-j DNAT --to-destination %s "
-                  "%s \n", cmd, proto, src.port, haveiface,  dst, shutup());
+        change("nat", add,
+	       WvString("FASTFORWARD -p %s --dport %s %s "
+			"-j DNAT --to-destination %s",
+			proto, src.port, haveiface, dst));
     }
 
     // FA57 is leet-speak for FAST, which is short for FASTFORWARD --adewhurst
@@ -95,68 +220,58 @@ WvString WvIPFirewall::forward_command(const char *cmd,
     // 
     // If we mark the packet with FA58, that means it gets masqueraded before
     // leaving, which may be useful to work around some network configuratios.
-    retval.append("iptables -t mangle %s FASTFORWARD -p %s --dport %s "
-	          "-j MARK --set-mark %s %s %s\n", cmd, proto, src.port,
-		  snat ? "0xFA58" : "0xFA57", haveiface, shutup());
+    change("mangle", add,
+	   WvString("FASTFORWARD -p %s --dport %s "
+		    "-j MARK --set-mark %s %s", proto, src.port,
+		    snat ? "0xFA58" : "0xFA57", haveiface));
 
     // Don't open the port completely; just open it for the forwarded packets
-    retval.append("iptables %s FFASTFORWARD -j ACCEPT -p %s "
-		  "--dport %s -m mark --mark %s %s %s\n", cmd, proto, dst.port,
-		  snat ? "0xFA58" : "0xFA57", haveoface, shutup());
-    
-    return retval;
+    change("filter", add,
+	   WvString("FFASTFORWARD -j ACCEPT -p %s "
+		    "--dport %s -m mark --mark %s %s", proto, dst.port,
+		    snat ? "0xFA58" : "0xFA57", haveoface));
 }
 
-WvString WvIPFirewall::redir_port_range_command(const char *cmd,
+void WvIPFirewall::redir_port_range_command(bool add,
     	const WvIPPortAddr &src_min, const WvIPPortAddr &src_max, int dstport)
 {
     WvIPAddr ad(src_min), none;
     
-    return WvString("iptables -t nat %s TProxy "
+    change("nat", add,
+	   WvString("TProxy "
 		    "-p tcp %s --dport %s:%s "
-		    "-j REDIRECT --to-ports %s "
-		    "%s",
-		    cmd,
+		    "-j REDIRECT --to-ports %s",
 		    ad == none ? WvString("") : WvString("-d %s", ad),
 		    src_min.port == 0? WvString(""): WvString(src_min.port),
 		    src_max.port == 0? WvString(""): WvString(src_max.port),
-		    dstport,
-		    shutup());
+		    dstport));
 }
 
-WvString WvIPFirewall::redir_all_command(const char *cmd, int dstport)
+void WvIPFirewall::redir_all_command(bool add, int dstport)
 {
-    return WvString("iptables -t nat %s TProxy "
+    change("nat", add,
+	   WvString("TProxy "
 		    "-p tcp "
-		    "-j REDIRECT --to-ports %s "
-		    "%s",
-		    cmd,
-		    dstport,
-		    shutup());
+		    "-j REDIRECT --to-ports %s",
+		    dstport));
 }
 
-WvString WvIPFirewall::proto_command(const char *cmd, const char *proto)
+void WvIPFirewall::proto_command(bool add, const char *proto)
 {
-    return WvString("iptables %s Services -p %s -j ACCEPT "
-		    "%s",
-		    cmd, proto, shutup());
+    change("filter", add, WvString("Services -p %s -j ACCEPT", proto));
 }
 
 
 void WvIPFirewall::add_port(const WvIPPortAddr &addr)
 {
     addrs.append(new WvIPPortAddr(addr), true);
-    WvString s(port_command("-A", "tcp", addr)),
-    	    s2(port_command("-A", "udp", addr));
-    if (enable)
-    {
-	system(s);
-	system(s2);
-    }
+    begin();
+    port_command(true, "tcp", addr);
+    port_command(true, "udp", addr);
+    commit();
 }
 
 
-// note!  This does not remove the address from the list, only the kernel!
 void WvIPFirewall::del_port(const WvIPPortAddr &addr)
 {
     WvIPPortAddrList::Iter i(addrs);
@@ -164,13 +279,11 @@ void WvIPFirewall::del_port(const WvIPPortAddr &addr)
     {
 	if (*i == addr)
 	{
-	    WvString s(port_command("-D", "tcp", addr)),
-		    s2(port_command("-D", "udp", addr));
-	    if (enable)
-	    {
-		system(s);
-		system(s2);
-	    }
+	    begin();
+	    port_command(false, "tcp", addr);
+	    port_command(false, "udp", addr);
+	    commit();
+	    i.xunlink();
 	    return;
 	}
     }
@@ -180,16 +293,12 @@ void WvIPFirewall::add_forward(const WvIPPortAddr &src,
 			       const WvIPPortAddr &dst, bool snat)
 {
     ffwds.append(new FFwd(src, dst, snat), true);
-    WvString s(forward_command("-A", "tcp", src, dst, snat)),
-    	    s2(forward_command("-A", "udp", src, dst, snat));
-
-    log("Add Forwards (%s):\n%s\n%s\n", enable, s, s2);
+    log("Add Forward (%s): %s -> %s\n", enable, src, dst);
     
-    if (enable)
-    {
-	system(s);
-	system(s2);
-    }
+    begin();
+    forward_command(true, "tcp", src, dst, snat);
+    forward_command(true, "udp", src, dst, snat);
+    commit();
 }
 
 void WvIPFirewall::del_forward(const WvIPPortAddr &src,
@@ -200,16 +309,13 @@ void WvIPFirewall::del_forward(const WvIPPortAddr &src,
     {
         if (i->src == src && i->dst == dst && i->snat == snat) 
         {
-            WvString s(forward_command("-D", "tcp", src, dst, snat)),
-	            s2(forward_command("-D", "udp", src, dst, snat));
-
-            log("Delete Forward (%s):\n%s\n%s\n", enable, s, s2);
+            log("Delete Forward (%s): %s -> %s\n", enable, src, dst);
     
-            if (enable) 
-            {
-	        system(s);
-                system(s2);
-            }
+            begin();
+            forward_command(false, "tcp", src, dst, snat);
+            forward_command(false, "udp", src, dst, snat);
+            commit();
+            i.xunlink();
         }
     }
 }
@@ -217,8 +323,7 @@ void WvIPFirewall::del_forward(const WvIPPortAddr &src,
 void WvIPFirewall::add_redir(const WvIPPortAddr &src, int dstport)
 {
     redirs.append(new Redir(src, dstport), true);
-    WvString s(redir_command("-A", src, dstport));
-    if (enable) system(s);
+    redir_command(true, src, dstport);
 }
 
 
@@ -229,8 +334,8 @@ void WvIPFirewall::del_redir(const WvIPPortAddr &src, int dstport)
     {
 	if (i->src == src && i->dstport == dstport)
 	{
-	    WvString s(redir_command("-D", src, dstport));
-	    if (enable) system(s);
+	    redir_command(false, src, dstport);
+	    i.xunlink();
 	    return;
 	}
     }
@@ -239,8 +344,7 @@ void WvIPFirewall::del_redir(const WvIPPortAddr &src, int dstport)
 void WvIPFirewall::add_redir_all(int dstport)
 {
     redir_alls.append(new RedirAll(dstport), true);
-    WvString s(redir_all_command("-A", dstport));
-    if (enable) system(s);
+    redir_all_command(true, dstport);
 }
 
 
@@ -251,8 +355,8 @@ void WvIPFirewall::del_redir_all(int dstport)
     {
 	if (i->dstport == dstport)
 	{
-	    WvString s(redir_all_command("-D", dstport));
-	    if (enable) system(s);
+	    redir_all_command(false, dstport);
+	    i.xunlink();
 	    return;
 	}
     }
@@ -262,8 +366,7 @@ void WvIPFirewall::add_redir_port_range(const WvIPPortAddr &src_min,
     	const WvIPPortAddr &src_max, int dstport)
 {
     redir_port_ranges.append(new RedirPortRange(src_min, src_max, dstport), true);
-    WvString s(redir_port_range_command("-A", src_min, src_max, dstport));
-    if (enable) system(s);
+    redir_port_range_command(true, src_min, src_max, dstport);
 }
 
 
@@ -276,8 +379,8 @@ void WvIPFirewall::del_redir_port_range(const WvIPPortAddr &src_min,
 	if (i->src_min == src_min && i->src_max == src_max
 	    	&& i->dstport == dstport)
 	{
-	    WvString s(redir_port_range_command("-D", src_min, src_max, dstport));
-	    if (enable) system(s);
+	    redir_port_range_command(false, src_min, src_max, dstport);
+	    i.xunlink();
 	    return;
 	}
     }
@@ -287,8 +390,7 @@ void WvIPFirewall::del_redir_port_range(const WvIPPortAddr &src_min,
 void WvIPFirewall::add_proto(WvStringParm proto)
 {
     protos.append(new WvString(proto), true);
-    WvString s(proto_command("-A", proto));
-    if (enable) system(s);
+    proto_command(true, proto);
 }
 
 
@@ -299,57 +401,46 @@ void WvIPFirewall::del_proto(WvStringParm proto)
     {
 	if (*i == proto)
 	{
-	    WvString s(proto_command("-D", proto));
-	    if (enable) system(s);
+	    proto_command(false, proto);
+	    i.xunlink();
 	    return;
 	}
     }
 }
 
 
-// clear out our portion of the firewall
+// clear out our portion of the firewall, all in one go
 void WvIPFirewall::zap()
 {
-    WvIPPortAddrList::Iter i(addrs);
-    for (i.rewind(); i.next(); )
-    {
-	del_port(*i);
-	i.xunlink();
-    }
-
-    FFwdList::Iter ifwd(ffwds);
-    for (ifwd.rewind(); ifwd.next();)
-    {
-        del_forward(ifwd->src, ifwd->dst, ifwd->snat);
-        ifwd.xunlink();
-    }
+    begin();
     
-    RedirList::Iter i2(redirs);
-    for (i2.rewind(); i2.next(); )
-    {
-	del_redir(i2->src, i2->dstport);
-	i2.xunlink();
-    }
+    // each del_*() removes the entry from its list, so we copy it first
+    while (addrs.count())
+	del_port(WvIPPortAddr(*addrs.first()));
     
-    RedirAllList::Iter i2_5(redir_alls);
-    for (i2_5.rewind(); i2_5.next(); )
+    while (ffwds.count())
     {
-	del_redir_all(i2_5->dstport);
-	i2_5.xunlink();
+	FFwd f(*ffwds.first());
+	del_forward(f.src, f.dst, f.snat);
     }
     
-    RedirPortRangeList::Iter port_range(redir_port_ranges);
-    for (port_range.rewind(); port_range.next(); )
+    while (redirs.count())
     {
-	del_redir_port_range(port_range->src_min, port_range->src_max,
-	    	port_range->dstport);
-	port_range.xunlink();
+	Redir r(*redirs.first());
+	del_redir(r.src, r.dstport);
     }
     
-    WvStringList::Iter i3(protos);
-    for (i3.rewind(); i3.next(); )
+    while (redir_alls.count())
+	del_redir_all(redir_alls.first()->dstport);
+    
+    while (redir_port_ranges.count())
     {
-        del_proto(*i3);
-        i3.xunlink();
+	RedirPortRange r(*redir_port_ranges.first());
+	del_redir_port_range(r.src_min, r.src_max, r.dstport);
     }
+    
+    while (protos.count())
+	del_proto(WvString(*protos.first()));
+    
+    commit();
 }
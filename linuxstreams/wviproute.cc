@@ -10,6 +10,7 @@
 #include "wvinterface.h"
 #include "wvfile.h"
 #include "wvstringlist.h"
+#include "wvnetlink.h"
 
 #include <net/route.h>
 #include <ctype.h>
@@ -66,6 +67,15 @@ void WvIPRouteList::get_kernel()
     WvStringList words;
     WvStringList::Iter word(words);
     
+    // rtnetlink gives us every table in one go, without needing the ip
+    // command; fall back to the old way for kernels that don't have it.
+    {
+	WvNetlink nl;
+	if (nl.get_routes(*this))
+	    return;
+	zap();
+    }
+    
     // read each route information line from /proc/net/route; even though
     // "ip route list table all" returns all the same information plus more,
     // there's no guarantee that the ip command is available on all systems.
@@ -0,0 +1,462 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2005 Net Integration Technologies, Inc.
+ *
+ * A stream for talking to the Linux kernel's rtnetlink interface.  See
+ * wvnetlink.h.
+ */
+#include "wvnetlink.h"
+#include "wvfile.h"
+#include "wvstringlist.h"
+
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+// big enough for any single message the kernel will send us
+#define NL_BUFSIZE 65536
+
+
+static int nl_socket(unsigned int groups)
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    if (fd < 0)
+	return -1;
+
+    struct sockaddr_nl sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = groups;
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+    {
+	int err = errno;
+	::close(fd);
+	errno = err;
+	return -1;
+    }
+    return fd;
+}
+
+
+// Fills 'tb' (indexed by attribute type, up to 'max') from the attributes
+// following a message's fixed header.
+static void parse_attrs(struct rtattr **tb, int max,
+			struct rtattr *rta, int len)
+{
+    memset(tb, 0, sizeof(*tb) * (max + 1));
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+	if (rta->rta_type <= max)
+	    tb[rta->rta_type] = rta;
+}
+
+
+static WvIPAddr rta_ipaddr(struct rtattr *rta)
+{
+    if (!rta || RTA_PAYLOAD(rta) < 4)
+	return WvIPAddr();
+    return WvIPAddr((const unsigned char *)RTA_DATA(rta));
+}
+
+
+static unsigned int rta_u32(struct rtattr *rta)
+{
+    return rta ? *(unsigned int *)RTA_DATA(rta) : 0;
+}
+
+
+WvNetlink::WvNetlink(bool listen)
+    : names(15)
+{
+    dump_fd = -1;
+    seq = 0;
+    have_names = false;
+
+    setfd(nl_socket(listen ? (RTMGRP_LINK | RTMGRP_IPV4_IFADDR
+			      | RTMGRP_IPV4_ROUTE) : 0));
+    if (getfd() < 0)
+    {
+	seterr(errno);
+	return;
+    }
+    set_close_on_exec(true);
+    set_nonblock(true);
+}
+
+
+WvNetlink::~WvNetlink()
+{
+    close();
+    if (dump_fd >= 0)
+	::close(dump_fd);
+}
+
+
+bool WvNetlink::dump(int type, int family)
+{
+    struct
+    {
+	struct nlmsghdr h;
+	struct rtgenmsg g;
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    req.h.nlmsg_len = NLMSG_LENGTH(sizeof(req.g));
+    req.h.nlmsg_type = type;
+    req.h.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.h.nlmsg_seq = ++seq;
+    req.g.rtgen_family = family;
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    return sendto(dumpfd(), &req, req.h.nlmsg_len, 0,
+		  (struct sockaddr *)&kernel, sizeof(kernel)) >= 0;
+}
+
+
+int WvNetlink::dumpfd()
+{
+    // Dumps get their own socket, so that their replies don't get mixed
+    // up with change notifications on ours.  It blocks, because the kernel
+    // always answers right away.
+    if (dump_fd < 0)
+	dump_fd = nl_socket(0);
+    return dump_fd;
+}
+
+
+bool WvNetlink::recv_dump(WvNetlinkLinkDict *links, WvNetlinkAddrList *addrs,
+			  WvIPRouteList *routes)
+{
+    unsigned char *buf = new unsigned char[NL_BUFSIZE];
+    int result;
+
+    do
+    {
+	ssize_t len = recv(dumpfd(), buf, NL_BUFSIZE, 0);
+	if (len < 0)
+	{
+	    if (errno == EINTR)
+		continue;
+	    result = -1;
+	    break;
+	}
+	result = parse_msgs(buf, len, links, addrs, routes, false);
+    } while (result == 0);
+
+    delete[] buf;
+    if (result < 0)
+	seterr(errno);
+    return result > 0;
+}
+
+
+// Returns 1 if we saw the end of a dump, -1 (with errno set) if the kernel
+// said there was an error, or 0 otherwise.
+int WvNetlink::parse_msgs(unsigned char *buf, size_t _len,
+			  WvNetlinkLinkDict *links, WvNetlinkAddrList *addrs,
+			  WvIPRouteList *routes, bool notify)
+{
+    int len = _len;
+    for (struct nlmsghdr *h = (struct nlmsghdr *)buf;
+	 NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+    {
+	if (!notify && h->nlmsg_seq != seq)
+	    continue; // left over from an earlier, failed dump
+
+	switch (h->nlmsg_type)
+	{
+	case NLMSG_DONE:
+	    return 1;
+
+	case NLMSG_ERROR:
+	    {
+		struct nlmsgerr *e = (struct nlmsgerr *)NLMSG_DATA(h);
+		if (!e->error)
+		    break;
+		errno = -e->error;
+		return -1;
+	    }
+
+	case RTM_NEWLINK:
+	case RTM_DELLINK:
+	    {
+		WvNetlinkLink *link = parse_link(h);
+		if (!link)
+		    break;
+		bool added = (h->nlmsg_type == RTM_NEWLINK);
+
+		// keep our index-to-name map up to date
+		if (names[link->index])
+		    names.remove(names[link->index]);
+		if (added)
+		{
+		    WvNetlinkLink *n = new WvNetlinkLink;
+		    n->index = link->index;
+		    n->name = link->name;
+		    names.add(n, true);
+		}
+
+		if (notify && link_callback)
+		    link_callback(*link, added);
+		if (links)
+		    links->add(link, true);
+		else
+		    delete link;
+		break;
+	    }
+
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+	    {
+		WvNetlinkAddr *addr = parse_addr(h);
+		if (!addr)
+		    break;
+		if (notify && addr_callback)
+		    addr_callback(*addr, h->nlmsg_type == RTM_NEWADDR);
+		if (addrs)
+		    addrs->append(addr, true);
+		else
+		    delete addr;
+		break;
+	    }
+
+	case RTM_NEWROUTE:
+	case RTM_DELROUTE:
+	    {
+		WvIPRoute *route = parse_route(h);
+		if (!route)
+		    break;
+		if (notify && route_callback)
+		    route_callback(*route, h->nlmsg_type == RTM_NEWROUTE);
+		if (routes)
+		    routes->append(route, true);
+		else
+		    delete route;
+		break;
+	    }
+	}
+    }
+    return 0;
+}
+
+
+void WvNetlink::learn_names()
+{
+    // get_links() fills in 'names' as a side effect
+    WvNetlinkLinkDict links(15);
+    get_links(links);
+}
+
+
+// Only looks in the cache: doing a dump from here could land in the middle
+// of another one.  Call learn_names() before starting anything that needs
+// this.
+WvString WvNetlink::ifname(int index)
+{
+    WvNetlinkLink *link = names[index];
+    return link ? link->name : WvString(index);
+}
+
+
+WvString WvNetlink::tablename(unsigned int table)
+{
+    // WvIPRoute has always called both of these "default"
+    if (table == RT_TABLE_MAIN || table == RT_TABLE_DEFAULT)
+	return "default";
+
+    if (!tables)
+    {
+	WvFile f("/etc/iproute2/rt_tables", O_RDONLY);
+	WvDynBuf buf;
+	while (f.isok())
+	    f.read(buf, 4096);
+	tables = buf.getstr();
+	if (!tables)
+	    tables = "\n";
+    }
+
+    WvStringList lines;
+    lines.split(tables, "\n");
+    WvStringList::Iter line(lines);
+    for (line.rewind(); line.next(); )
+    {
+	WvStringList words;
+	words.split(*line, " \t");
+	if (words.count() >= 2 && words.first()->num() == (int)table
+	    && words.first()->cstr()[0] != '#')
+	    return *words.last();
+    }
+    return WvString(table);
+}
+
+
+WvNetlinkLink *WvNetlink::parse_link(struct nlmsghdr *h)
+{
+    struct ifinfomsg *ifi = (struct ifinfomsg *)NLMSG_DATA(h);
+    struct rtattr *tb[IFLA_MAX + 1];
+    parse_attrs(tb, IFLA_MAX, IFLA_RTA(ifi), IFLA_PAYLOAD(h));
+    if (!tb[IFLA_IFNAME])
+	return NULL;
+
+    WvNetlinkLink *link = new WvNetlinkLink;
+    link->index = ifi->ifi_index;
+    link->name = (const char *)RTA_DATA(tb[IFLA_IFNAME]);
+    link->flags = ifi->ifi_flags;
+    link->mtu = rta_u32(tb[IFLA_MTU]);
+
+    // the same thing SIOCGIFHWADDR would have given us
+    struct sockaddr sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_family = ifi->ifi_type;
+    if (tb[IFLA_ADDRESS])
+    {
+	size_t len = RTA_PAYLOAD(tb[IFLA_ADDRESS]);
+	if (len > sizeof(sa.sa_data))
+	    len = sizeof(sa.sa_data);
+	memcpy(sa.sa_data, RTA_DATA(tb[IFLA_ADDRESS]), len);
+    }
+    link->hwaddr = WvAddr::gen(&sa);
+    return link;
+}
+
+
+WvNetlinkAddr *WvNetlink::parse_addr(struct nlmsghdr *h)
+{
+    struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(h);
+    if (ifa->ifa_family != AF_INET)
+	return NULL;
+
+    struct rtattr *tb[IFA_MAX + 1];
+    parse_attrs(tb, IFA_MAX, IFA_RTA(ifa), IFA_PAYLOAD(h));
+
+    // IFA_LOCAL is our end of a point-to-point link; otherwise only
+    // IFA_ADDRESS is given, and it's ours.
+    struct rtattr *local = tb[IFA_LOCAL] ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+    if (!local)
+	return NULL;
+
+    WvNetlinkAddr *addr = new WvNetlinkAddr;
+    addr->index = ifa->ifa_index;
+    addr->label = tb[IFA_LABEL] ? WvString((const char *)RTA_DATA(tb[IFA_LABEL]))
+				 : ifname(ifa->ifa_index);
+    addr->addr = WvIPNet(rta_ipaddr(local), ifa->ifa_prefixlen);
+    addr->secondary = (ifa->ifa_flags & IFA_F_SECONDARY) != 0;
+    return addr;
+}
+
+
+WvIPRoute *WvNetlink::parse_route(struct nlmsghdr *h)
+{
+    struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(h);
+    if (rtm->rtm_family != AF_INET || rtm->rtm_type != RTN_UNICAST)
+	return NULL; // skip broadcast, local, unreachable, etc.
+
+    struct rtattr *tb[RTA_MAX + 1];
+    parse_attrs(tb, RTA_MAX, RTM_RTA(rtm), RTM_PAYLOAD(h));
+
+    unsigned int table = tb[RTA_TABLE] ? rta_u32(tb[RTA_TABLE])
+				       : rtm->rtm_table;
+    if (table == RT_TABLE_LOCAL)
+	return NULL; // too complex, as always
+
+    int oif = rta_u32(tb[RTA_OIF]);
+    WvIPAddr gate = rta_ipaddr(tb[RTA_GATEWAY]);
+    if (!oif && tb[RTA_MULTIPATH])
+    {
+	// like /proc/net/route, we only report the first hop
+	struct rtnexthop *nh = (struct rtnexthop *)RTA_DATA(tb[RTA_MULTIPATH]);
+	if (RTA_PAYLOAD(tb[RTA_MULTIPATH]) >= sizeof(*nh))
+	{
+	    struct rtattr *nhtb[RTA_MAX + 1];
+	    oif = nh->rtnh_ifindex;
+	    parse_attrs(nhtb, RTA_MAX, RTNH_DATA(nh),
+			nh->rtnh_len - sizeof(*nh));
+	    gate = rta_ipaddr(nhtb[RTA_GATEWAY]);
+	}
+    }
+    if (!oif)
+	return NULL;
+
+    WvIPRoute *r = new WvIPRoute(ifname(oif),
+				 WvIPNet(rta_ipaddr(tb[RTA_DST]),
+					 rtm->rtm_dst_len),
+				 gate, rta_u32(tb[RTA_PRIORITY]),
+				 tablename(table));
+    if (tb[RTA_PREFSRC])
+	r->src = rta_ipaddr(tb[RTA_PREFSRC]);
+    return r;
+}
+
+
+bool WvNetlink::get_links(WvNetlinkLinkDict &links)
+{
+    if (!dump(RTM_GETLINK, AF_UNSPEC) || !recv_dump(&links, NULL, NULL))
+    {
+	seterr(errno);
+	return false;
+    }
+    have_names = true;
+    return true;
+}
+
+
+bool WvNetlink::get_addrs(WvNetlinkAddrList &addrs)
+{
+    // addresses without a label get their interface's name instead
+    if (!have_names)
+	learn_names();
+    if (!dump(RTM_GETADDR, AF_INET) || !recv_dump(NULL, &addrs, NULL))
+    {
+	seterr(errno);
+	return false;
+    }
+    return true;
+}
+
+
+bool WvNetlink::get_routes(WvIPRouteList &routes)
+{
+    if (!have_names)
+	learn_names();
+    if (!dump(RTM_GETROUTE, AF_INET) || !recv_dump(NULL, NULL, &routes))
+    {
+	seterr(errno);
+	return false;
+    }
+    return true;
+}
+
+
+void WvNetlink::execute()
+{
+    WvFdStream::execute();
+    if (!have_names)
+	learn_names();
+
+    unsigned char *buf = new unsigned char[NL_BUFSIZE];
+    for (;;)
+    {
+	ssize_t len = recv(getfd(), buf, NL_BUFSIZE, 0);
+	if (len < 0)
+	{
+	    int err = errno; // resync_callback() might change it
+	    
+	    // we missed some changes, so all we can do is start over
+	    if (err == ENOBUFS && resync_callback)
+		resync_callback();
+	    if (err == ENOBUFS || err == EINTR)
+		continue;
+	    break;
+	}
+	if (len == 0)
+	    break;
+	parse_msgs(buf, len, NULL, NULL, NULL, true);
+    }
+    delete[] buf;
+}
@@ -15,12 +15,44 @@
 #include "wvlog.h"
 #include "wvtundev.h"
 
-WvTunDev::WvTunDev(const WvIPNet &addr, int mtu) :
-    WvFile("/dev/net/tun", O_RDWR)
+WvTunDev::WvTunDev(const WvIPNet &addr, int mtu, int _flags) :
+    WvFile("/dev/net/tun", O_RDWR), flags(_flags)
 {
     init(addr, mtu);
 }
 
+
+WvTunDev::WvTunDev(const WvTunDev *first) :
+    WvFile("/dev/net/tun", O_RDWR), flags(first->flags)
+{
+    if (getfd() < 0)
+        seterr(errno);
+    else if (attach(first->ifcname))
+        ifcname = first->ifcname;
+}
+
+
+bool WvTunDev::attach(WvStringParm name)
+{
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_NO_PI | IFF_TUN;
+    if (flags & VNetHdr)
+        ifr.ifr_flags |= IFF_VNET_HDR;
+    if (flags & MultiQueue)
+        ifr.ifr_flags |= IFF_MULTI_QUEUE;
+    strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+
+    if (ioctl(getfd(), TUNSETIFF, (void *) &ifr) < 0)
+    {
+        seterr(errno);
+        return false;
+    }
+    ifcname = ifr.ifr_name;
+    return true;
+}
+
+
 void WvTunDev::init(const WvIPNet &addr, int mtu)
 {
     WvLog log("New tundev", WvLog::Debug2);
@@ -31,24 +63,64 @@ void WvTunDev::init(const WvIPNet &addr, int mtu)
         return;
     }
 
-    struct ifreq ifr;
-    memset(&ifr, 0, sizeof(ifr));
-    ifr.ifr_flags = IFF_NO_PI | IFF_TUN;
-
-    if (ioctl(getfd(), TUNSETIFF, (void *) &ifr) < 0 ||
-        ioctl(getfd(), TUNSETNOCSUM, 1) < 0)
+    if (!attach("") || ioctl(getfd(), TUNSETNOCSUM, 1) < 0)
     {
-        log("Could not initialize the interface: %s\n", strerror(errno));
-        seterr(errno);
+        if (isok())
+            seterr(errno);
+        log("Could not initialize the interface: %s\n", errstr());
         return;
     }
     
-    WvInterface iface(ifr.ifr_name);
+    WvInterface iface(ifcname);
     iface.setipaddr(addr);
     iface.setmtu(mtu);
     iface.up(true);
-    ifcname = ifr.ifr_name;
     log.app = ifcname;
 
     log(WvLog::Debug2, "Now up (%s).\n", addr);
-}    
+}
+
+
+WvTunDev *WvTunDev::open_queue()
+{
+    return new WvTunDev(this);
+}
+
+
+bool WvTunDev::set_offload(unsigned int offloads)
+{
+    return isok() && ioctl(getfd(), TUNSETOFFLOAD, offloads) == 0;
+}
+
+
+int WvTunDev::recv_batch(WvPacketBatch &batch)
+{
+    if (!isok())
+    {
+        batch.zap();
+        return 0;
+    }
+
+    int n = batch.read(getfd());
+    if (n < 0)
+    {
+        seterr(errno);
+        return 0;
+    }
+    return n;
+}
+
+
+int WvTunDev::send_batch(WvPacketBatch &batch)
+{
+    if (!isok())
+        return 0;
+
+    int n = batch.write(getfd());
+    if (n < 0)
+    {
+        seterr(errno);
+        return 0;
+    }
+    return n;
+}
@@ -576,3 +576,120 @@ WVTEST_MAIN("add filters midstream")
     wvcon->print("Error code: '%s'\n", s.errstr());
 }
 #endif
+
+
+#include "wvtimeutils.h"
+
+// passes everything through when flushed, like a compressor would, and
+// counts how often that is
+class FlushCountEncoder : public WvEncoder
+{
+public:
+    int calls, flushes;
+    
+    FlushCountEncoder() { calls = flushes = 0; }
+
+protected:
+    virtual bool _encode(WvBuf &in, WvBuf &out, bool flush)
+    {
+	calls++;
+	if (!flush)
+	    return true;
+	if (in.used())
+	    flushes++;
+	out.merge(in);
+	return true;
+    }
+};
+
+
+static size_t readall(WvStream &s)
+{
+    char buf[4096];
+    size_t total = 0, len;
+    while ((len = s.read(buf, sizeof(buf))) > 0)
+	total += len;
+    return total;
+}
+
+
+WVTEST_MAIN("encoderstream write batching")
+{
+    char chunk[64];
+    memset(chunk, 'x', sizeof(chunk));
+    
+    WvBufStream *buf = new WvBufStream;
+    WvEncoderStream s((buf->addRef(), buf));
+    FlushCountEncoder *counter = new FlushCountEncoder;
+    s.writechain.append(counter, true);
+    
+    // without batching, every write goes through, and is flushed
+    for (int i = 0; i < 10; i++)
+	s.write(chunk, sizeof(chunk));
+    WVPASSEQ(readall(*buf), 640);
+    WVPASSEQ(counter->flushes, 10);
+    
+    // with it, nothing happens until the batch fills up...
+    s.write_batch = 1000;
+    counter->calls = counter->flushes = 0;
+    for (int i = 0; i < 15; i++)
+	s.write(chunk, sizeof(chunk));
+    WVPASSEQ(counter->calls, 0);
+    WVPASSEQ(readall(*buf), 0);
+    s.write(chunk, sizeof(chunk));
+    WVPASSEQ(readall(*buf), 1024);
+    WVPASSEQ(counter->flushes, 1);
+    
+    // ...or flush() is called...
+    s.write(chunk, sizeof(chunk));
+    WVPASSEQ(readall(*buf), 0);
+    s.flush(0);
+    WVPASSEQ(readall(*buf), 64);
+    WVPASSEQ(counter->flushes, 2);
+    
+    // ...or we go through select(), which doesn't wait
+    s.write(chunk, sizeof(chunk));
+    s.write(chunk, sizeof(chunk));
+    WvTime start = wvtime();
+    s.runonce(10000);
+    WVPASS(msecdiff(wvtime(), start) < 1000);
+    WVPASSEQ(readall(*buf), 128);
+    WVPASSEQ(counter->flushes, 3);
+    
+    // and nothing is lost at the end
+    s.write(chunk, sizeof(chunk));
+    s.close();
+    WVPASSEQ(readall(*buf), 64);
+    WVRELEASE(buf);
+}
+
+
+WVTEST_MAIN("encoderstream batched gzip")
+{
+    // lots of little gzip flushes cost a lot more than a few big ones
+    size_t sizes[2];
+    for (int batch = 0; batch < 2; batch++)
+    {
+	WvBufStream *buf = new WvBufStream;
+	WvEncoderStream s((buf->addRef(), buf));
+	s.writechain.append(new WvGzipEncoder(WvGzipEncoder::Deflate), true);
+	s.write_batch = batch ? 16384 : 0;
+	for (int i = 0; i < 1000; i++)
+	    s.print("line %s of some text\n", i);
+	s.flush(0);
+	WvDynBuf zipped;
+	while (buf->read(zipped, 65536))
+	    ;
+	sizes[batch] = zipped.used();
+	WVRELEASE(buf);
+	
+	WvBufStream *buf2 = new WvBufStream;
+	buf2->write(zipped, zipped.used());
+	WvEncoderStream r(buf2);
+	r.readchain.append(new WvGzipEncoder(WvGzipEncoder::Inflate), true);
+	r.read_flush = false;
+	for (int i = 0; i < 1000; i++)
+	    WVPASSEQ(r.getline(), WvString("line %s of some text", i));
+    }
+    WVPASS(sizes[1] < sizes[0] / 3);
+}
@@ -41,3 +41,44 @@ WVTEST_MAIN("wvsubprocqueuestream")
     WVPASS(i < 50);
     WVPASSEQ(q.remaining(), 0);
 }
+
+
+static int run_queue(WvIStreamList &l, WvSubProcQueueStream &q, int max)
+{
+    int i;
+    for (i = 0; i < max && !q.isempty(); i++)
+	l.runonce(-1);
+    printf("Done looping with i=%d.\n", i);
+    return i;
+}
+
+
+WVTEST_MAIN("wvsubprocqueuestream wakeups")
+{
+    WvIStreamList l;
+    WvSubProcQueueStream q(2);
+    l.append(&q, false, "subproc queue");
+    
+    const char *argv[] = { "sleep", "1", NULL };
+    
+    // nothing to do but wait for both to exit, so we shouldn't wake up
+    // more than once to start them and once or twice for the exits
+    q.add(NULL, argv[0], argv);
+    q.add(NULL, argv[0], argv);
+    WVPASS(run_queue(l, q, 10) <= 4);
+    WVPASSEQ(q.remaining(), 0);
+    
+    // and the same without pidfds
+    WvSubProc::use_pidfd = false;
+    q.add(NULL, argv[0], argv);
+    q.add(NULL, argv[0], argv);
+    WVPASS(run_queue(l, q, 10) <= 4);
+    WVPASSEQ(q.remaining(), 0);
+    
+    const char *argv1[] = { "true", NULL };
+    for (int i = 0; i < 20; i++)
+	q.add(NULL, argv1[0], argv1);
+    WVPASS(run_queue(l, q, 100) < 100);
+    WVPASSEQ(q.remaining(), 0);
+    WvSubProc::use_pidfd = true;
+}
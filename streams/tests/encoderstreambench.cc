@@ -0,0 +1,122 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast lots of small writes go through a WvEncoderStream,
+ * with and without write_batch, and how fast a WvEncoderStream reads a
+ * gzipped stream in small pieces, with and without read_flush.
+ *
+ * usage: encoderstreambench [writes] [write size] [writes per tick]
+ */
+#include "wvencoderstream.h"
+#include "wvbufstream.h"
+#include "wvgzip.h"
+#include "wvbase64.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static size_t drain(WvStream &s)
+{
+    char buf[65536];
+    size_t total = 0, len;
+    while ((len = s.read(buf, sizeof(buf))) > 0)
+	total += len;
+    return total;
+}
+
+
+static void bench_write(const char *name, WvEncoder *enc, size_t batch,
+			int writes, size_t size, int per_tick)
+{
+    WvBufStream *sink = new WvBufStream;
+    WvEncoderStream s((sink->addRef(), sink));
+    if (enc)
+	s.writechain.append(enc, true);
+    s.write_batch = batch;
+    
+    char *chunk = new char[size];
+    for (size_t i = 0; i < size; i++)
+	chunk[i] = 'a' + i % 7 + (i / 7) % 5;
+    
+    size_t total = 0;
+    WvTime start = wvtime();
+    for (int i = 0; i < writes; i++)
+    {
+	s.write(chunk, size);
+	if (i % per_tick == per_tick - 1)
+	{
+	    s.runonce(0);
+	    total += drain(*sink);
+	}
+    }
+    s.flush(0);
+    total += drain(*sink);
+    time_t ms = msecdiff(wvtime(), start);
+    
+    printf("%-8s batch %-6d %8.0f writes/s %7.1f MB/s -> %9d bytes\n",
+	   name, (int)batch, ms ? writes * 1000.0 / ms : 0.0,
+	   ms ? (double)writes * size / 1048576 * 1000 / ms : 0.0,
+	   (int)total);
+    delete[] chunk;
+    WVRELEASE(sink);
+}
+
+
+static void bench_read(bool read_flush, size_t megs, size_t readsize)
+{
+    // something compressed to read back
+    WvGzipEncoder zip(WvGzipEncoder::Deflate);
+    WvDynBuf text, zipped;
+    size_t size = megs * 1024 * 1024;
+    while (text.used() < size)
+	text.putstr(WvString("line %s of the text\n", text.used()));
+    size = text.used();
+    zip.flush(text, zipped, true);
+    
+    WvBufStream *source = new WvBufStream;
+    source->write(zipped, zipped.used());
+    source->seteof();
+    WvEncoderStream s(source);
+    s.readchain.append(new WvGzipEncoder(WvGzipEncoder::Inflate), true);
+    s.read_flush = read_flush;
+    s.min_readsize = 4096;
+    
+    char *buf = new char[readsize];
+    size_t total = 0, len;
+    WvTime start = wvtime();
+    while (s.isok() || s.isreadable())
+    {
+	len = s.read(buf, readsize);
+	if (!len && !s.isok())
+	    break;
+	total += len;
+    }
+    time_t ms = msecdiff(wvtime(), start);
+    printf("gzip read, read_flush %d: %7.1f MB/s (%s)\n", read_flush,
+	   ms ? total / 1048576.0 * 1000 / ms : 0.0,
+	   total == size ? "ok" : "WRONG SIZE");
+    delete[] buf;
+}
+
+
+int main(int argc, char **argv)
+{
+    int writes = argc > 1 ? atoi(argv[1]) : 200000;
+    size_t size = argc > 2 ? atoi(argv[2]) : 64;
+    int per_tick = argc > 3 ? atoi(argv[3]) : 100;
+    
+    for (int batch = 0; batch <= 16384; batch += 16384)
+    {
+	bench_write("none", NULL, batch, writes, size, per_tick);
+	bench_write("gzip", new WvGzipEncoder(WvGzipEncoder::Deflate),
+		    batch, writes, size, per_tick);
+	bench_write("base64", new WvBase64Encoder, batch, writes, size,
+		    per_tick);
+    }
+    
+    bench_read(true, 32, 256);
+    bench_read(false, 32, 256);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Runs a lot of short-lived processes through a WvSubProcQueueStream, a
+ * few hundred at a time, and shows how long it took, how many times the
+ * stream list woke up, and how much CPU time we spent: with pidfds, with
+ * the SIGCHLD signalfd, and polling the queue every 100ms the way
+ * WvSubProcQueueStream used to.
+ *
+ * usage: subprocqueuebench [processes] [at once] [seconds each]
+ */
+#include "wvsubprocqueuestream.h"
+#include "wvistreamlist.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+
+static time_t cpu_msec()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec * 1000 + ru.ru_utime.tv_usec / 1000
+	+ ru.ru_stime.tv_sec * 1000 + ru.ru_stime.tv_usec / 1000;
+}
+
+
+static void report(const char *name, const WvTime &start, time_t cpu,
+		   int wakeups)
+{
+    printf("%-10s %8ld ms %8d wakeups %8ld ms cpu\n", name,
+	   (long)msecdiff(wvtime(), start), wakeups, (long)(cpu_msec() - cpu));
+}
+
+
+static void fill(WvSubProcQueue &q, int nprocs, const char * const *argv)
+{
+    for (int i = 0; i < nprocs; i++)
+	q.add(NULL, argv[0], argv);
+}
+
+
+int main(int argc, char **argv)
+{
+    int nprocs = argc > 1 ? atoi(argv[1]) : 1000;
+    int parallel = argc > 2 ? atoi(argv[2]) : 200;
+    const char *secs = argc > 3 ? argv[3] : "0.2";
+    const char *sleep_argv[] = { "sleep", secs, NULL };
+    
+    printf("%d processes of 'sleep %s', %d at a time:\n",
+	   nprocs, secs, parallel);
+    
+    for (int pidfds = 1; pidfds >= 0; pidfds--)
+    {
+	WvSubProc::use_pidfd = pidfds;
+	WvIStreamList l;
+	WvSubProcQueueStream q(parallel);
+	l.append(&q, false, "subproc queue");
+	fill(q, nprocs, sleep_argv);
+	
+	WvTime start = wvtime();
+	time_t cpu = cpu_msec();
+	int wakeups;
+	for (wakeups = 0; !q.isempty(); wakeups++)
+	    l.runonce(-1);
+	report(pidfds ? "pidfd" : "signalfd", start, cpu, wakeups);
+    }
+    WvSubProc::use_pidfd = true;
+    
+    // what WvSubProcQueueStream::execute() used to do
+    WvSubProcQueue q(parallel);
+    fill(q, nprocs, sleep_argv);
+    WvTime start = wvtime();
+    time_t cpu = cpu_msec();
+    int wakeups;
+    for (wakeups = 0; !q.isempty(); wakeups++)
+	if (!q.go())
+	    usleep(100*1000);
+    report("polling", start, cpu, wakeups);
+    
+    return 0;
+}
@@ -45,6 +45,20 @@ size_t WvBufStream::uwrite(const void *buf, size_t size)
 }
 
 
+size_t WvBufStream::merge(WvBuf &buf, size_t count)
+{
+    if (count > buf.used())
+	count = buf.used();
+    if (!isok() || stop_write)
+    {
+	buf.skip(count);
+	return 0;
+    }
+    inbuf.merge(buf, count);
+    return count;
+}
+
+
 bool WvBufStream::isok() const
 {
     return !dead;
@@ -12,6 +12,9 @@ WvEncoderStream::WvEncoderStream(WvStream *_cloned) : WvStreamClone(_cloned)
 {
     is_closing = false;
     min_readsize = 0;
+    write_batch = 0;
+    read_flush = true;
+    batched = false;
 }
 
 
@@ -116,15 +119,18 @@ void WvEncoderStream::pull(size_t size)
     }
     
     // deal with any encoders that have been added recently
-    WvDynBuf tmpbuf;
-    tmpbuf.merge(readoutbuf);
-    readchain.continue_encode(tmpbuf, readoutbuf);
+    if (readoutbuf.used())
+    {
+	readtmpbuf.merge(readoutbuf);
+	readchain.continue_encode(readtmpbuf, readoutbuf);
+    }
     
     // apenwarr 2004/11/06: always flush on read, because otherwise there's
     // no clear way to decide when we need to flush.  Anyway, most "decoders"
     // (the kind of thing you'd put in the readchain) don't care whether you
-    // flush or not.
-    readchain.encode(readinbuf, readoutbuf, true);
+    // flush or not.  (Unless read_flush says they really don't.)
+    // readinbuf is all ours, so encoders can work right on top of it.
+    readchain.encode_inplace(readinbuf, readoutbuf, read_flush || finish);
     //readchain.encode(readinbuf, readoutbuf, finish /*flush*/);
     if (finish)
     {
@@ -147,12 +153,12 @@ void WvEncoderStream::pull(size_t size)
 
 bool WvEncoderStream::push(bool flush, bool finish)
 {
-    WvDynBuf writeoutbuf;
+    batched = false;
     
     // encode the output
     if (flush)
         writeinbuf.merge(outbuf);
-    bool success = writechain.encode(writeinbuf, writeoutbuf, flush);
+    bool success = writechain.encode_inplace(writeinbuf, writeoutbuf, flush);
     if (finish)
         if (!writechain.finish(writeoutbuf))
             success = false;
@@ -191,17 +197,34 @@ size_t WvEncoderStream::uread(void *buf, size_t size)
 size_t WvEncoderStream::uwrite(const void *buf, size_t size)
 {
     writeinbuf.put(buf, size);
-    push(false /*flush*/, false /*finish*/);
+    if (!write_batch || writeinbuf.used() >= write_batch)
+	push(false /*flush*/, false /*finish*/);
+    else
+	batched = true;
     return size;
 }
 
 
+bool WvEncoderStream::should_flush()
+{
+    // write() flushes after each call if we let it; hold off until the
+    // batch is full
+    if (batched)
+	return false;
+    return WvStreamClone::should_flush();
+}
+
+
 void WvEncoderStream::pre_select(SelectInfo &si)
 {
     WvStreamClone::pre_select(si);
 
     if (si.wants.readable && readoutbuf.used() != 0)
         si.msec_timeout = 0;     
+    
+    // don't sit on a partial batch
+    if (batched)
+	si.msec_timeout = 0;
 }
 
 
@@ -221,7 +244,11 @@ bool WvEncoderStream::post_select(SelectInfo &si)
     
     // try to push pending encoded output to cloned stream
     // outbuf_delayed_flush condition already handled by uwrite()
-    push(false /*flush*/, false /*finish*/);
+    // A partial batch goes out now, as if write() had flushed it.
+    if (batched)
+	flush_write();
+    else
+	push(false /*flush*/, false /*finish*/);
     
     // consult the underlying stream
     sure |= WvStreamClone::post_select(si);
@@ -0,0 +1,14 @@
+#include "wvlz4stream.h"
+#include "wvmoniker.h"
+#include "wvlinkerhack.h"
+
+WV_LINK(WvLz4Stream);
+
+static IWvStream *creator(WvStringParm s, IObject *_obj)
+{
+    return new WvLz4Stream(new WvStreamClone(wvcreate<IWvStream>(s, _obj)));
+}
+
+static WvMoniker<IWvStream> reg("lz4", creator);
+
+
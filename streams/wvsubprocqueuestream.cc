@@ -10,6 +10,8 @@
 WvSubProcQueueStream::WvSubProcQueueStream(int _maxrunning)
     : WvSubProcQueue(_maxrunning), log("Subproc Queue", WvLog::Debug5)
 {
+    last_remaining = 0;
+    last_sigchld = WvSubProc::sigchld_events();
     alarm(0);
 }
 
@@ -19,19 +21,72 @@ WvSubProcQueueStream::~WvSubProcQueueStream()
 }
 
 
+// true if something was added, or might have exited, since execute()
+bool WvSubProcQueueStream::changed()
+{
+    return remaining() != last_remaining
+	|| WvSubProc::sigchld_events() != last_sigchld;
+}
+
+
+void WvSubProcQueueStream::pre_select(SelectInfo &si)
+{
+    WvStream::pre_select(si);
+    
+    if (changed())
+    {
+	si.msec_timeout = 0;
+	return;
+    }
+    
+    EntList::Iter i(runq);
+    for (i.rewind(); i.next(); )
+    {
+	int fd = i->proc->exitfd();
+	if (fd >= 0)
+	{
+	    FD_SET(fd, &si.read);
+	    if (si.max_fd < fd)
+		si.max_fd = fd;
+	}
+    }
+}
+
+
+bool WvSubProcQueueStream::post_select(SelectInfo &si)
+{
+    bool ready = WvStream::post_select(si);
+    
+    if (changed())
+	return true;
+    
+    EntList::Iter i(runq);
+    for (i.rewind(); i.next(); )
+    {
+	int fd = i->proc->exitfd();
+	if (fd >= 0 && FD_ISSET(fd, &si.read))
+	    return true;
+    }
+    
+    return ready;
+}
+
+
 void WvSubProcQueueStream::execute()
 {
+    last_sigchld = WvSubProc::sigchld_events();
     int started = WvSubProcQueue::go();
     int run = running(), remain = remaining();
+    last_remaining = remain;
     if (started || run || remain)
 	log("Started %s processes (%s running, %s waiting)\n",
 	    started, run, remain - run);
-    if (!remain)
-	alarm(1000); // nothing is even in the queue; come back later.
-    else if (started)
-	alarm(0); // we're busy; go fast if possible
-    else
-	alarm(100); // no processes were ready *this* time; wait longer
+    
+    // anything whose exit we can't select() on has to be polled
+    bool poll = false;
+    EntList::Iter i(runq);
+    for (i.rewind(); i.next(); )
+	if (i->proc->exitfd() < 0)
+	    poll = true;
+    alarm(poll ? 100 : -1);
 }
-
-
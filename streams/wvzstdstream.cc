@@ -0,0 +1,14 @@
+#include "wvzstdstream.h"
+#include "wvmoniker.h"
+#include "wvlinkerhack.h"
+
+WV_LINK(WvZstdStream);
+
+static IWvStream *creator(WvStringParm s, IObject *_obj)
+{
+    return new WvZstdStream(new WvStreamClone(wvcreate<IWvStream>(s, _obj)));
+}
+
+static WvMoniker<IWvStream> reg("zstd", creator);
+
+
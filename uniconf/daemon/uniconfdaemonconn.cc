@@ -89,6 +89,10 @@ void UniConfDaemonConn::execute()
 		do_set(arg1, arg2);
 	    break;
 	    
+	case UniClientConn::REQ_SETV:
+	    do_setv(arg1, arg2);
+	    break;
+	    
 	case UniClientConn::REQ_REMOVE:
 	    if (arg1.isnull())
 		do_malformed(command);
@@ -176,6 +180,20 @@ void UniConfDaemonConn::do_set(const UniConfKey &key, WvStringParm value)
 }
 
 
+void UniConfDaemonConn::do_setv(WvStringParm key, WvStringParm value)
+{
+    // Like VAL, SETV sends one pair per line until an empty SETV ends the
+    // batch.  A missing value deletes the key.
+    if (key.isnull())
+    {
+	root.setv(setv_pairs);
+	setv_pairs.zap();
+    }
+    else
+	setv_pairs.append(new UniConfPair(key, value), true);
+}
+
+
 void UniConfDaemonConn::do_remove(const UniConfKey &_key)
 {      
     int notifications_sent = 0;
@@ -329,3 +329,93 @@ WVTEST_MAIN("timeout")
 
     kill(daemon.get_pid(), SIGCONT);
 }
+
+
+WVTEST_MAIN("setv")
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    WvString sockname = wvtmpfilename("uniclientgen.t-sock");
+    unlink(sockname);
+
+    UniConfTestDaemon daemon(sockname, "temp:");
+
+    UniConfRoot uniconf;
+    UniClientGen *client_gen = create_client_conn("setv", sockname);
+    uniconf.mountgen(client_gen);
+    uniconf["sub/gone"].setme("soon");
+
+    UniConfPairList pairs;
+    for (int i = 0; i < 100; i++)
+	pairs.append(new UniConfPair(WvString("key%s", i), i), true);
+    pairs.append(new UniConfPair("gone", WvString::null), true);
+    pairs.append(new UniConfPair("empty", ""), true);
+    uniconf["sub"].setv(pairs);
+
+    WVPASSEQ(uniconf["sub/key0"].getme(), "0");
+    WVPASSEQ(uniconf["sub/key99"].getme(), "99");
+    WVPASSEQ(uniconf["sub/empty"].getme(), "");
+    WVFAIL(uniconf["sub/gone"].exists());
+}
+
+
+WVTEST_MAIN("prefetch")
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    WvString sockname = wvtmpfilename("uniclientgen.t-sock");
+    unlink(sockname);
+
+    UniConfTestDaemon daemon(sockname, "temp:");
+
+    UniClientGen *gen = create_client_conn("prefetch", sockname);
+    gen->set("a/b", "ab");
+    gen->set("a/b/c", "abc");
+    gen->set("x/y", "xy");
+    
+    // several requests in flight at once, answered in order
+    gen->prefetch("a", true);
+    gen->prefetch("x", false);
+    WVPASSEQ(gen->get("x/y"), "xy");
+    
+    int count = 0;
+    UniConfGen::Iter *i = gen->iterator("x");
+    if (WVPASS(i))
+    {
+	for (i->rewind(); i->next(); count++)
+	    WVPASSEQ(i->value(), "xy");
+	delete i;
+    }
+    WVPASSEQ(count, 1);
+    
+    count = 0;
+    i = gen->recursiveiterator("a");
+    if (WVPASS(i))
+    {
+	for (i->rewind(); i->next(); count++)
+	    ;
+	delete i;
+    }
+    WVPASSEQ(count, 2);
+    
+    // a prefetch that fails
+    gen->prefetch("nonexistent", true);
+    WVFAIL(gen->recursiveiterator("nonexistent"));
+    
+    // prefetched results that go out of date are thrown away
+    gen->prefetch("a", true);
+    WVPASSEQ(gen->get("a/b"), "ab");
+    gen->set("a/b/d", "abd");
+    WVPASSEQ(gen->get("a/b/d"), "abd");
+    count = 0;
+    i = gen->recursiveiterator("a");
+    if (WVPASS(i))
+    {
+	for (i->rewind(); i->next(); count++)
+	    ;
+	delete i;
+    }
+    WVPASSEQ(count, 3);
+    
+    WVRELEASE(gen);
+}
@@ -0,0 +1,102 @@
+#include "unihotcachegen.h"
+#include "unislowgen.h"
+#include "unitempgen.h"
+#include "uniconfroot.h"
+#include "wvtest.h"
+#include "uniconfgen-sanitytest.h"
+
+
+WVTEST_MAIN("UniHotCacheGen Sanity Test")
+{
+    UniHotCacheGen *gen = new UniHotCacheGen(new UniTempGen);
+    UniConfGenSanityTester::sanity_test(gen, "hotcache:temp:");
+    WVRELEASE(gen);
+}
+
+
+WVTEST_MAIN("hotcache")
+{
+    UniTempGen *t = new UniTempGen;
+    UniSlowGen *slow = new UniSlowGen(t);
+    UniHotCacheGen *cache = new UniHotCacheGen(slow);
+    UniConfRoot uni(cache, true);
+    
+    t->set("x/y/z", 5);
+    slow->reset_slow();
+    cache->hits = cache->misses = 0;
+    
+    // first get is slow, regets are free
+    WVPASSEQ(uni.xgetint("x/y/z"), 5);
+    WVPASSEQ(uni.xgetint("x/y/z"), 5);
+    WVPASSEQ(slow->how_slow(), 1); slow->reset_slow();
+    WVPASSEQ(cache->misses, 1);
+    WVPASSEQ(cache->hits, 1);
+    
+    // notifications are processed
+    t->set("x/y/z", 9);
+    WVPASSEQ(uni.xgetint("x/y/z"), 9);
+    WVPASSEQ(slow->how_slow(), 0); slow->reset_slow();
+    
+    // missing keys are cached too, and so are their children
+    WvString nil;
+    WVPASSEQ(uni.xget("a/b"), nil);
+    WVPASSEQ(uni.xget("a/b"), nil);
+    WVPASSEQ(uni.xget("a/b/c"), nil);
+    WVFAIL(uni["a/b"].haschildren());
+    WVPASSEQ(slow->how_slow(), 1); slow->reset_slow();
+    
+    // creating a child makes its parents exist
+    t->set("a/b/c/d", "abcd");
+    WVPASSEQ(uni.xget("a/b"), "");
+    WVPASSEQ(uni.xget("a/b/c/d"), "abcd");
+    
+    // deleting a parent deletes its children
+    t->set("a", nil);
+    WVPASSEQ(uni.xget("a/b/c/d"), nil);
+    
+    // sets through the cache are seen immediately
+    uni.xset("x/y/z", 11);
+    WVPASSEQ(uni.xgetint("x/y/z"), 11);
+    UniConfPairList pairs;
+    pairs.append(new UniConfPair("x/y/z", "12"), true);
+    pairs.append(new UniConfPair("a/b", "ab"), true);
+    cache->setv(pairs);
+    WVPASSEQ(uni.xgetint("x/y/z"), 12);
+    WVPASSEQ(uni.xget("a/b"), "ab");
+    WVPASSEQ(uni.xget("a"), "");
+}
+
+
+WVTEST_MAIN("hotcache eviction")
+{
+    UniTempGen *t = new UniTempGen;
+    UniSlowGen *slow = new UniSlowGen(t);
+    UniHotCacheGen *cache = new UniHotCacheGen(slow, 4);
+    UniConfRoot uni(cache, true);
+    
+    for (int i = 0; i < 10; i++)
+	t->set(WvString("k/%s", i), i);
+    cache->zap();
+    cache->hits = cache->misses = 0;
+    
+    // a hot key survives a scan over the others
+    WVPASSEQ(uni.xgetint("k/0"), 0);
+    for (int i = 1; i < 10; i++)
+    {
+	WVPASSEQ(uni.xgetint(WvString("k/%s", i)), i);
+	WVPASSEQ(uni.xgetint("k/0"), 0);
+    }
+    WVPASSEQ(cache->count(), 4);
+    WVPASSEQ(cache->evictions, 6);
+    WVPASSEQ(cache->misses, 10);
+    
+    slow->reset_slow();
+    WVPASSEQ(uni.xgetint("k/0"), 0);
+    WVPASSEQ(uni.xgetint("k/9"), 9);
+    WVPASSEQ(slow->how_slow(), 0);
+    
+    cache->zap();
+    WVPASSEQ(cache->count(), 0);
+    WVPASSEQ(uni.xgetint("k/0"), 0);
+    WVPASSEQ(slow->how_slow(), 1);
+}
@@ -163,16 +163,40 @@ WVTEST_MAIN("multiple generators - iterators")
     }
     delete i; 
 
-#if 0 // FIXME: unimountgen deals badly with nested mounts
+    // frump, and the two mountpoints with their trees
     i = g.recursiveiterator("/");
     if (WVPASS(i))
     {
         int num_values = 0;
+        WvString keys;
         for (i->rewind(); i->next(); )
+        {
+            if (i->key() == "foo" || i->key() == "bar" || i->key() == "frump")
+                WVPASSEQ(i->value(), "bung");
+            else
+                WVPASS(i->value() == "foo" || i->value() == "bar");
+            keys.append("%s ", i->key());
             num_values++;
-        WVPASSEQ(num_values, 10);
+        }
+        WVPASSEQ(num_values, 12);
+        WVPASSEQ(keys, "bar bar/bum bar/bum/gum bar/bum/scum "
+                 "bar/bum/scum/flum bar/dum foo foo/bam foo/bim foo/bum "
+                 "foo/bum/bum frump ");
     }
-#endif
+    delete i;
+    
+    // a newer generator hides everything under it
+    IUniConfGen *t4 = g.mount("/bar/bum", "temp:", true);
+    t4->set("new", "new");
+    i = g.recursiveiterator("/bar");
+    if (WVPASS(i))
+    {
+        WvString keys;
+        for (i->rewind(); i->next(); )
+            keys.append("%s ", i->key());
+        WVPASSEQ(keys, "bum bum/new dum ");
+    }
+    delete i;
 }
 
 WVTEST_MAIN("multiple generators - iterating with gaps")
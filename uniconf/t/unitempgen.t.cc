@@ -2,6 +2,11 @@
 #include "uniconfroot.h"
 #include "unitempgen.h"
 #include "uniconfgen-sanitytest.h"
+#include "wvautoconf.h"
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
 
 
 WVTEST_MAIN("UniTempGen Sanity Test")
@@ -13,3 +18,269 @@ WVTEST_MAIN("UniTempGen Sanity Test")
 
 // FIXME: could test lots more stuff here, or rather in the Sanity Tester...
 
+
+
+static int setv_deltas;
+static void setv_callback(const UniConfKey &, WvStringParm)
+{
+    ++setv_deltas;
+}
+
+
+WVTEST_MAIN("setv")
+{
+    UniTempGen gen;
+    gen.set("a/old", "1");
+    gen.set("z", "2");
+    
+    setv_deltas = 0;
+    gen.add_callback(&setv_deltas, setv_callback);
+    
+    UniConfPairList pairs;
+    pairs.append(new UniConfPair("b/y", "by"), true);
+    pairs.append(new UniConfPair("a/x/1", "ax1"), true);
+    pairs.append(new UniConfPair("b/x", "bx"), true);
+    pairs.append(new UniConfPair("a/old", WvString::null), true);
+    pairs.append(new UniConfPair("a/x/2", "ax2"), true);
+    pairs.append(new UniConfPair("B/X", "BX"), true);
+    pairs.append(new UniConfPair("z", WvString::null), true);
+    pairs.append(new UniConfPair("c/", "ignored"), true);
+    
+    gen.hold_delta();
+    gen.setv(pairs);
+    WVPASSEQ(setv_deltas, 0);
+    gen.unhold_delta();
+    WVPASSEQ(setv_deltas, 9);
+    
+    WVPASSEQ(gen.get("a/x/1"), "ax1");
+    WVPASSEQ(gen.get("a/x/2"), "ax2");
+    WVPASSEQ(gen.get("a/x"), "");
+    WVPASSEQ(gen.get("b/x"), "BX");
+    WVPASSEQ(gen.get("b/y"), "by");
+    WVFAIL(gen.exists("a/old"));
+    WVFAIL(gen.exists("z"));
+    WVFAIL(gen.exists("c"));
+    
+    gen.del_callback(&setv_deltas);
+}
+
+
+WVTEST_MAIN("setv with deletions after sets")
+{
+    // the deletion of 'a' comes after the set of 'a/b/c', so sorting them
+    // would be wrong
+    UniConfPairList pairs;
+    pairs.append(new UniConfPair("a/b/c", "abc"), true);
+    pairs.append(new UniConfPair("a", WvString::null), true);
+    pairs.append(new UniConfPair("a/d", "ad"), true);
+    pairs.append(new UniConfPair("e/f", "ef"), true);
+    pairs.append(new UniConfPair("e/", WvString::null), true);
+    
+    UniConfPairList sorted;
+    WVFAIL(UniTempGen::sort_pairs(pairs, sorted));
+    WVPASSEQ(sorted.count(), pairs.count());
+    
+    UniTempGen gen, naive;
+    gen.setv(pairs);
+    UniConfPairList::Iter pair(pairs);
+    for (pair.rewind(); pair.next(); )
+	naive.set(pair->key(), pair->value());
+    
+    WVFAIL(gen.exists("a/b"));
+    WVPASSEQ(gen.get("a/d"), "ad");
+    WVFAIL(gen.exists("e"));
+    WVPASSEQ(gen.get(""), naive.get(""));
+    WVPASSEQ(gen.haschildren(""), naive.haschildren(""));
+    WVPASSEQ(gen.get("a"), naive.get("a"));
+}
+
+
+WVTEST_MAIN("snapshots")
+{
+    UniTempGen gen;
+    gen.set("a/b", "ab");
+    
+    UniConfSnapshot empty = gen.snapshot();
+    WVFAIL(empty.exists(""));
+    
+    gen.enable_snapshots();
+    UniConfSnapshot s1 = gen.snapshot();
+    WVPASSEQ(s1.get("a/b"), "ab");
+    WVPASSEQ(s1.get("/A//B"), "ab");
+    WVPASSEQ(s1.get("a"), "");
+    WVFAIL(s1.exists("a/c"));
+    
+    // changes don't affect snapshots that are already out there
+    gen.set("a/b", "ab2");
+    gen.set("a/c/d", "acd");
+    gen.set("x", "x");
+    UniConfSnapshot s2 = gen.snapshot();
+    WVPASSEQ(s1.get("a/b"), "ab");
+    WVFAIL(s1.exists("a/c"));
+    WVFAIL(s1.exists("x"));
+    WVPASSEQ(s2.get("a/b"), "ab2");
+    WVPASSEQ(s2.get("a/c/d"), "acd");
+    WVPASS(s2.haschildren("a/c"));
+    
+    UniConfPairList pairs;
+    pairs.append(new UniConfPair("a/c", WvString::null), true);
+    pairs.append(new UniConfPair("a/e", "ae"), true);
+    pairs.append(new UniConfPair("X", "X"), true);
+    gen.setv(pairs);
+    UniConfSnapshot s3 = gen.snapshot();
+    WVPASSEQ(s2.get("a/c/d"), "acd");
+    WVFAIL(s3.exists("a/c"));
+    WVPASSEQ(s3.get("x"), "X");
+    
+    // unchanged values are shared, not copied
+    WVPASS(s2.get("a/b") == s3.get("a/b"));
+    WVFAIL(s1.get("a/b") == s3.get("a/b"));
+    
+    WvString children;
+    UniConfSnapshot::Iter i(s3, "a");
+    for (i.rewind(); i.next(); )
+	children.append("%s=%s ", i.key(), i.value());
+    WVPASSEQ(children, "b=ab2 e=ae ");
+    
+    gen.set("", WvString::null);
+    WVFAIL(gen.snapshot().exists(""));
+    WVPASSEQ(s3.get("a/e"), "ae");
+}
+
+
+WVTEST_MAIN("snapshots outlive the generator")
+{
+    UniTempGen *gen = new UniTempGen;
+    gen->enable_snapshots();
+    gen->set("a", "1");
+    UniConfSnapshot s = gen->snapshot();
+    WVRELEASE(gen);
+    WVPASSEQ(s.get("a"), "1");
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+#define SNAPSHOT_KEYS 10
+
+// sets "gen" and all of "k/*" to 'n', all in one version
+static void set_generation(UniTempGen &gen, int n)
+{
+    UniConfPairList pairs;
+    pairs.append(new UniConfPair("gen", WvString(n)), true);
+    for (int i = 0; i < SNAPSHOT_KEYS; i++)
+	pairs.append(new UniConfPair(WvString("k/%s", i), WvString(n)), true);
+    gen.setv(pairs);
+}
+
+
+// returns the generation of 's', or -1 if it's not all the same one
+static int check_generation(const UniConfSnapshot &s)
+{
+    const char *g = s.get("gen");
+    if (!g)
+	return -1;
+    int n = atoi(g), count = 0;
+    UniConfSnapshot::Iter i(s, "k");
+    for (i.rewind(); i.next(); count++)
+	if (atoi(i.value()) != n)
+	    return -1;
+    return count == SNAPSHOT_KEYS ? n : -1;
+}
+
+
+struct SnapshotReader
+{
+    pthread_t tid;
+    const UniTempGen *gen;
+    volatile int *stop;
+    volatile int reads;
+    int bad, backwards;
+};
+
+
+// Runs in its own thread, so it mustn't use wvtest, or any WvStrings.
+static void *snapshot_reader(void *userdata)
+{
+    SnapshotReader &r = *(SnapshotReader *)userdata;
+    UniConfSnapshot first = r.gen->snapshot();
+    int firstgen = check_generation(first), last = firstgen;
+    if (firstgen < 0)
+	r.bad++;
+
+    while (!__sync_add_and_fetch(r.stop, 0))
+    {
+	UniConfSnapshot s = r.gen->snapshot();
+	int n = check_generation(s);
+	if (n < 0)
+	    r.bad++;
+	else if (n < last)
+	    r.backwards++;
+	else
+	    last = n;
+	__sync_add_and_fetch(&r.reads, 1);
+    }
+
+    // the one we've been holding all along hasn't changed underneath us
+    if (check_generation(first) != firstgen)
+	r.bad++;
+    return NULL;
+}
+
+
+WVTEST_MAIN("snapshots with several reader threads")
+{
+    const int nreaders = 4;
+    int base = UniConfSnapshot::versions();
+    {
+	UniTempGen gen;
+	gen.enable_snapshots();
+	set_generation(gen, 0);
+	UniConfSnapshot held = gen.snapshot();
+
+	volatile int stop = 0;
+	SnapshotReader readers[nreaders];
+	for (int i = 0; i < nreaders; i++)
+	{
+	    readers[i].gen = &gen;
+	    readers[i].stop = &stop;
+	    readers[i].reads = readers[i].bad = readers[i].backwards = 0;
+	    WVPASSEQ(pthread_create(&readers[i].tid, NULL, snapshot_reader,
+				    &readers[i]), 0);
+	}
+
+	// keep going until everybody has had a good look
+	int n = 0, least = 0;
+	while (n < 100000 && (n < 2000 || least < 100))
+	{
+	    set_generation(gen, ++n);
+	    least = readers[0].reads;
+	    for (int i = 1; i < nreaders; i++)
+		if (readers[i].reads < least)
+		    least = readers[i].reads;
+	}
+
+	__sync_add_and_fetch(&stop, 1);
+	for (int i = 0; i < nreaders; i++)
+	{
+	    pthread_join(readers[i].tid, NULL);
+	    WVPASS(readers[i].reads > 0);
+	    WVPASSEQ(readers[i].bad, 0);
+	    WVPASSEQ(readers[i].backwards, 0);
+	}
+
+	// nobody else has one, but ours is still there
+	WVPASSEQ(check_generation(held), 0);
+	WVPASSEQ(check_generation(gen.snapshot()), n);
+
+	// the readers are done, so everything but the current version and
+	// ours goes away with the next change
+	set_generation(gen, ++n);
+	WVPASSEQ(UniConfSnapshot::versions(), base + 2);
+	held = UniConfSnapshot();
+	WVPASSEQ(UniConfSnapshot::versions(), base + 1);
+    }
+    WVPASSEQ(UniConfSnapshot::versions(), base);
+}
+
+#endif // HAVE_PTHREAD_H
@@ -681,6 +681,58 @@ WVTEST_MAIN("nested transaction commit/replace")
 }
 
 
+class SetvCountGen : public UniTempGen
+{
+public:
+    int setvs, largest;
+    
+    SetvCountGen() : setvs(0), largest(0) { }
+    
+    virtual void setv(const UniConfPairList &pairs)
+    {
+	setvs++;
+	if ((int)pairs.count() > largest)
+	    largest = pairs.count();
+	UniTempGen::setv(pairs);
+    }
+};
+
+
+WVTEST_MAIN("commit in batches")
+{
+    SetvCountGen *base = new SetvCountGen;
+    UniTransactionGen *gen = new UniTransactionGen(base);
+    UniConfRoot root(gen, true);
+    
+    for (int i = 0; i < 100; i++)
+	base->set(WvString("old/%s/x", i), i);
+    base->set("keep", "1");
+    
+    // replace a subtree with one that only partly overlaps it
+    gen->commit_batch = 7;
+    root["old"].remove();
+    for (int i = 50; i < 150; i++)
+	root["old"][i].xset("x", i * 2);
+    root["new"].xset("a", "b");
+    root["keep"].remove();
+    gen->commit();
+    
+    // the 50 deletions under "old" have to go in one batch, since they
+    // come from iterating over it
+    WVPASS(base->setvs > 1);
+    WVPASS(base->largest <= 7 + 50);
+    WVFAIL(base->exists("old/49"));
+    WVFAIL(base->exists("keep"));
+    WVPASSEQ(base->get("old/50/x"), "100");
+    WVPASSEQ(base->get("old/149/x"), "298");
+    WVPASSEQ(base->get("new/a"), "b");
+    int count = 0;
+    UniConf::Iter i(root["old"]);
+    for (i.rewind(); i.next(); )
+	count++;
+    WVPASSEQ(count, 100);
+}
+
 #if 1 // BUGZID: 13167
 static int callback_count;
 
@@ -0,0 +1,63 @@
+/*
+ * Compares get() performance through a UniClientGen with and without a
+ * UniHotCacheGen in front of it.  Start a uniconfd first, eg.
+ *
+ *    uniconfd -f -l tcp:4111 /=temp:
+ *
+ * ...then run this with the moniker to connect to.
+ */
+#include "uniconfroot.h"
+#include "unihotcachegen.h"
+#include "wvstream.h"
+#include "wvtimeutils.h"
+
+static const int nkeys = 1000, nhot = 50, nlookups = 20000;
+
+
+// Mostly looks up a few hot keys, with a scattering of others and of keys
+// that don't exist, which is roughly what UniDefGen clients do.
+static time_t run(const UniConf &cfg)
+{
+    WvTime start = wvtime();
+    for (int i = 0; i < nlookups; i++)
+    {
+	int k = (i * 7919) % nkeys;
+	if (i % 4 == 0)
+	    cfg[WvString("missing/%s", k)].getme();
+	else if (i % 4 == 1)
+	    cfg[WvString("keys/%s", k)].getme();
+	else
+	    cfg[WvString("keys/%s", k % nhot)].getme();
+    }
+    return msecdiff(wvtime(), start);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *mon = (argc > 1) ? argv[1] : "tcp:localhost:4111";
+    wvcon->print("Using uniconf moniker '%s'\n", mon);
+
+    UniConfRoot plain(mon);
+    if (!plain.whichmount() || !plain.whichmount()->isok())
+    {
+	wvcon->print("Can't connect!\n");
+	return 1;
+    }
+    for (int i = 0; i < nkeys; i++)
+	plain[WvString("keys/%s", i)].setme(i);
+    plain.commit();
+
+    time_t ms = run(plain);
+    wvcon->print("uncached: %s gets in %s ms\n", nlookups, ms);
+
+    UniHotCacheGen *cache = new UniHotCacheGen(
+		wvcreate<IUniConfGen>(mon), nkeys / 4);
+    UniConfRoot cached(cache, true);
+    ms = run(cached);
+    wvcon->print("cached:   %s gets in %s ms "
+		 "(%s hits, %s misses, %s evictions)\n",
+		 nlookups, ms, cache->hits, cache->misses, cache->evictions);
+
+    return 0;
+}
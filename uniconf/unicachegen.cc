@@ -98,6 +98,11 @@ void UniCacheGen::set(const UniConfKey &key, WvStringParm value)
     inner->set(key, value);
 }
 
+void UniCacheGen::setv(const UniConfPairList &pairs)
+{
+    inner->setv(pairs);
+}
+
 WvString UniCacheGen::get(const UniConfKey &key)
 {
     //inner->get(key);
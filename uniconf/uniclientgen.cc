@@ -112,6 +112,7 @@ UniClientGen::UniClientGen(IWvStream *stream, WvStringParm dst)
 {
     cmdinprogress = cmdsuccess = false;
     result_list = NULL;
+    awaited = NULL;
 
     conn = new UniClientConn(stream, dst);
     conn->setcallback(wv::bind(&UniClientGen::conncallback, this));
@@ -204,14 +205,20 @@ void UniClientGen::setv(const UniConfPairList &pairs)
     if (version >= 19)
     {
 	// Much like how VAL works, SETV continues sending key-value pairs
-	// until it sends a terminating SETV, which has no arguments.
+	// until it sends a terminating SETV, which has no arguments.  A key
+	// without a value is deleted.
 	for (i.rewind(); i.next(); )
 	{
-	    conn->writecmd(UniClientConn::REQ_SETV,
-			   spacecat(wvtcl_escape(i->key()),
-				    wvtcl_escape(i->value()), ' '));
+	    if (i->value().isnull())
+		conn->writecmd(UniClientConn::REQ_SETV,
+			       wvtcl_escape(i->key()));
+	    else
+		conn->writecmd(UniClientConn::REQ_SETV,
+			       spacecat(wvtcl_escape(i->key()),
+					wvtcl_escape(i->value()), ' '));
 	}
 	conn->writecmd(UniClientConn::REQ_SETV);
+	flush_buffers();
     }
     else
     {
@@ -239,9 +246,96 @@ bool UniClientGen::haschildren(const UniConfKey &key)
 }
 
 
+UniClientGen::Prefetch::~Prefetch()
+{
+    delete results;
+}
+
+
+UniClientGen::Prefetch *UniClientGen::find_prefetch(const UniConfKey &key,
+						    bool recursive)
+{
+    WvList<Prefetch>::Iter i(prefetches);
+    for (i.rewind(); i.next(); )
+	if (i->recursive == recursive && i->key == key)
+	    return i.ptr();
+    return NULL;
+}
+
+
+// Called when a REPLY_OK or REPLY_FAIL arrives; returns true if it was
+// the end of a prefetch rather than of the current command.
+bool UniClientGen::finish_prefetch(bool success)
+{
+    WvList<Prefetch>::Iter i(prefetches);
+    for (i.rewind(); i.next(); )
+    {
+	if (!i->done)
+	{
+	    i->done = true;
+	    i->success = success;
+	    if (i.ptr() == awaited)
+	    {
+		cmdsuccess = success;
+		cmdinprogress = false;
+	    }
+	    return true;
+	}
+    }
+    return false;
+}
+
+
+void UniClientGen::prefetch(const UniConfKey &key, bool recursive)
+{
+    if (find_prefetch(key, recursive))
+	return;
+    
+    // don't let results that nobody asked for pile up forever
+    if (prefetches.count() >= 16)
+    {
+	WvList<Prefetch>::Iter i(prefetches);
+	for (i.rewind(); i.next() && !i->done; )
+	    ;
+	if (i.cur() == NULL)
+	    return; // all still busy; a later iterator will just have to wait
+	i.xunlink();
+    }
+    
+    Prefetch *p = new Prefetch;
+    p->key = key;
+    p->recursive = recursive;
+    p->results = new UniListIter(this);
+    p->done = p->success = false;
+    prefetches.append(p, true);
+    conn->writecmd(UniClientConn::REQ_SUBTREE,
+		   WvString("%s %s", wvtcl_escape(key), WvString(recursive)));
+}
+
+
 UniClientGen::Iter *UniClientGen::do_iterator(const UniConfKey &key,
 					      bool recursive)
 {
+    Prefetch *p = find_prefetch(key, recursive);
+    if (p)
+    {
+	if (!p->done)
+	{
+	    awaited = p;
+	    do_select();
+	    awaited = NULL;
+	}
+	
+	ListIter *it = NULL;
+	if (p->done && p->success)
+	{
+	    it = p->results;
+	    p->results = NULL;
+	}
+	prefetches.unlink(p);
+	return it;
+    }
+    
     assert(!result_list);
     result_list = new UniListIter(this);
     conn->writecmd(UniClientConn::REQ_SUBTREE,
@@ -285,11 +379,15 @@ void UniClientGen::conncallback()
             break;
 
         case UniClientConn::REPLY_OK:
+            if (finish_prefetch(true))
+                break;
             cmdsuccess = true;
             cmdinprogress = false;
             break;
 
         case UniClientConn::REPLY_FAIL:
+            if (finish_prefetch(false))
+                break;
             result_key = WvString::null;
             cmdsuccess = false;
             cmdinprogress = false;
@@ -334,7 +432,14 @@ void UniClientGen::conncallback()
 
                 if (!key.isnull() && !value.isnull())
                 {
-                    if (result_list)
+                    // results for prefetches arrive before the current
+                    // command's
+                    WvList<Prefetch>::Iter i(prefetches);
+                    for (i.rewind(); i.next() && i->done; )
+                        ;
+                    if (i.cur())
+                        i->results->add(key, value);
+                    else if (result_list)
 			result_list->add(key, value);
                 }
                 break;
@@ -369,6 +474,14 @@ void UniClientGen::conncallback()
             {
                 WvString key(wvtcl_getword(conn->payloadbuf, nasty_space));
                 WvString value(wvtcl_getword(conn->payloadbuf, nasty_space));
+                
+                // prefetched results that this changes are out of date
+                UniConfKey changed(key);
+                WvList<Prefetch>::Iter i(prefetches);
+                for (i.rewind(); i.next(); )
+                    if (i->done && (i->key.suborsame(changed)
+                                    || changed.suborsame(i->key)))
+                        i.xunlink();
                 delta(key, value);
             }   
 
@@ -92,6 +92,23 @@ void UniConf::setmeint(int value) const
 }
 
 
+void UniConf::setv(const UniConfPairList &pairs) const
+{
+    if (xfullkey.isempty())
+    {
+	xroot->mounts.setv(pairs);
+	return;
+    }
+    
+    UniConfPairList fullpairs;
+    UniConfPairList::Iter pair(pairs);
+    for (pair.rewind(); pair.next(); )
+	fullpairs.append(new UniConfPair(UniConfKey(xfullkey, pair->key()),
+					 pair->value()), true);
+    xroot->mounts.setv(fullpairs);
+}
+
+
 void UniConf::move(const UniConf &dst) const
 {
     dst.remove();
@@ -6,6 +6,8 @@
  */
 #include "uniconfgen.h"
 #include "strutils.h"
+#include <algorithm>
+#include <vector>
 
 // FIXME: interfaces (IUniConfGen) shouldn't have implementations!
 IUniConfGen::~IUniConfGen()
@@ -98,6 +100,73 @@ void UniConfGen::setv_naive(const UniConfPairList &pairs)
 }
 
 
+struct _UniConfPairRef
+{
+    UniConfPair *pair;
+    int index; // position in the original list
+};
+
+
+static bool pairref_less(const _UniConfPairRef &a, const _UniConfPairRef &b)
+{
+    return a.pair->key().compareto(b.pair->key()) < 0;
+}
+
+
+bool UniConfGen::sort_pairs(const UniConfPairList &pairs,
+			    UniConfPairList &sorted)
+{
+    std::vector<_UniConfPairRef> refs;
+    refs.reserve(pairs.count());
+    
+    UniConfPairList::Iter pair(pairs);
+    for (pair.rewind(); pair.next(); )
+    {
+	_UniConfPairRef ref = { pair.ptr(), (int)refs.size() };
+	refs.push_back(ref);
+    }
+    
+    std::stable_sort(refs.begin(), refs.end(), pairref_less);
+    
+    // Subkeys sort right after their parent, so any key deleted by an
+    // entry still on the stack is below that entry.  If such a key was
+    // set *before* the deletion, applying the sorted list would bring it
+    // back to life.
+    std::vector<_UniConfPairRef> deletions;
+    bool safe = true;
+    for (size_t i = 0; safe && i < refs.size(); i++)
+    {
+	const UniConfKey &key = refs[i].pair->key();
+	while (!deletions.empty()
+	       && !deletions.back().pair->key().suborsame(key))
+	    deletions.pop_back();
+	
+	for (size_t j = 0; j < deletions.size(); j++)
+	{
+	    if (deletions[j].index > refs[i].index)
+	    {
+		safe = false;
+		break;
+	    }
+	}
+	
+	if (refs[i].pair->value().isnull())
+	    deletions.push_back(refs[i]);
+    }
+    
+    if (!safe)
+    {
+	for (pair.rewind(); pair.next(); )
+	    sorted.append(pair.ptr(), false);
+	return false;
+    }
+    
+    for (size_t i = 0; i < refs.size(); i++)
+	sorted.append(refs[i].pair, false);
+    return true;
+}
+
+
 bool UniConfGen::haschildren(const UniConfKey &key)
 {
     bool children = false;
@@ -0,0 +1,486 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * Immutable, reference-counted copies of a UniConf tree that can be read
+ * from other threads without locking.  See uniconfsnapshot.h.
+ */
+#include "uniconfsnapshot.h"
+#include "uniconftree.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * Nodes and versions are shared between threads, so their reference
+ * counts are only ever changed atomically.  Everything else in a node is
+ * only changed by the writer, and only while the node belongs to the
+ * current batch, ie. before any version that could contain it is
+ * published.
+ */
+struct UniConfSnapshot::Node
+{
+    volatile int refs;
+    unsigned int batch;
+    char *key, *value;
+    int nchildren, maxchildren;
+    Node **children; // sorted by strcasecmp() on their keys
+};
+
+
+struct UniConfSnapshot::Version
+{
+    volatile int refs;
+    Node *root;
+    Version *next; // on the writer's retired list
+};
+
+
+// the number of versions that haven't been freed yet
+static volatile int live_versions = 0;
+
+
+static UniConfSnapshot::Node *newnode(const char *key, const char *value,
+				      unsigned int batch)
+{
+    UniConfSnapshot::Node *node = new UniConfSnapshot::Node;
+    node->refs = 1;
+    node->batch = batch;
+    node->key = strdup(key);
+    node->value = strdup(value);
+    node->nchildren = node->maxchildren = 0;
+    node->children = NULL;
+    return node;
+}
+
+
+static void release(UniConfSnapshot::Node *node)
+{
+    if (!node || __sync_sub_and_fetch(&node->refs, 1) > 0)
+	return;
+    for (int i = 0; i < node->nchildren; i++)
+	release(node->children[i]);
+    delete[] node->children;
+    free(node->key);
+    free(node->value);
+    delete node;
+}
+
+
+static void release(UniConfSnapshot::Version *version)
+{
+    if (!version || __sync_sub_and_fetch(&version->refs, 1) > 0)
+	return;
+    release(version->root);
+    delete version;
+    __sync_sub_and_fetch(&live_versions, 1);
+}
+
+
+// Compares the 'len' characters at 'seg' to the nul-terminated 'key'.
+static int segcmp(const char *seg, size_t len, const char *key)
+{
+    int cmp = strncasecmp(seg, key, len);
+    if (!cmp && key[len])
+	return -1;
+    return cmp;
+}
+
+
+// Returns the index of the child called 'seg', or where it would be
+// inserted if there is no such child.
+static int findchild(const UniConfSnapshot::Node *node,
+		     const char *seg, size_t len, bool &found)
+{
+    int lo = 0, hi = node->nchildren;
+    while (lo < hi)
+    {
+	int mid = (lo + hi) / 2;
+	int cmp = segcmp(seg, len, node->children[mid]->key);
+	if (cmp == 0)
+	{
+	    found = true;
+	    return mid;
+	}
+	if (cmp < 0)
+	    hi = mid;
+	else
+	    lo = mid + 1;
+    }
+    found = false;
+    return lo;
+}
+
+
+static void insertchild(UniConfSnapshot::Node *node, int i,
+			UniConfSnapshot::Node *child)
+{
+    if (node->nchildren == node->maxchildren)
+    {
+	node->maxchildren = node->maxchildren ? node->maxchildren * 2 : 4;
+	UniConfSnapshot::Node **children
+	    = new UniConfSnapshot::Node *[node->maxchildren];
+	if (node->nchildren)
+	    memcpy(children, node->children,
+		   node->nchildren * sizeof(*children));
+	delete[] node->children;
+	node->children = children;
+    }
+    memmove(&node->children[i + 1], &node->children[i],
+	    (node->nchildren - i) * sizeof(*node->children));
+    node->children[i] = child;
+    node->nchildren++;
+}
+
+
+static int childcmp(const void *a, const void *b)
+{
+    return strcasecmp((*(UniConfSnapshot::Node * const *)a)->key,
+		      (*(UniConfSnapshot::Node * const *)b)->key);
+}
+
+
+static UniConfSnapshot::Node *build(const UniConfValueTree *tree,
+				    unsigned int batch)
+{
+    UniConfSnapshot::Node *node = newnode(tree->key().printable().cstr(),
+					  tree->value().cstr(), batch);
+    if (tree->haschildren())
+    {
+	UniConfValueTree::Iter i(*const_cast<UniConfValueTree *>(tree));
+	for (i.rewind(); i.next(); )
+	    node->maxchildren++;
+	node->children = new UniConfSnapshot::Node *[node->maxchildren];
+	for (i.rewind(); i.next(); )
+	    node->children[node->nchildren++] = build(i.ptr(), batch);
+	qsort(node->children, node->nchildren, sizeof(*node->children),
+	      childcmp);
+    }
+    return node;
+}
+
+
+/***** UniConfSnapshot *****/
+
+UniConfSnapshot::UniConfSnapshot()
+    : version(NULL)
+{
+}
+
+
+UniConfSnapshot::UniConfSnapshot(Version *_version)
+    : version(_version)
+{
+}
+
+
+UniConfSnapshot::UniConfSnapshot(const UniConfSnapshot &other)
+    : version(other.version)
+{
+    if (version)
+	__sync_add_and_fetch(&version->refs, 1);
+}
+
+
+UniConfSnapshot::~UniConfSnapshot()
+{
+    release(version);
+}
+
+
+UniConfSnapshot &UniConfSnapshot::operator= (const UniConfSnapshot &other)
+{
+    if (other.version)
+	__sync_add_and_fetch(&other.version->refs, 1);
+    release(version);
+    version = other.version;
+    return *this;
+}
+
+
+const UniConfSnapshot::Node *UniConfSnapshot::find(const char *key) const
+{
+    const Node *node = version ? version->root : NULL;
+    const char *seg = key;
+    while (node)
+    {
+	while (*seg == '/')
+	    seg++;
+	if (!*seg)
+	    break;
+	size_t len = strcspn(seg, "/");
+	bool found;
+	int i = findchild(node, seg, len, found);
+	node = found ? node->children[i] : NULL;
+	seg += len;
+    }
+    return node;
+}
+
+
+const char *UniConfSnapshot::get(const char *key) const
+{
+    const Node *node = find(key);
+    return node ? node->value : NULL;
+}
+
+
+bool UniConfSnapshot::haschildren(const char *key) const
+{
+    const Node *node = find(key);
+    return node && node->nchildren > 0;
+}
+
+
+int UniConfSnapshot::versions()
+{
+    return __sync_add_and_fetch(&live_versions, 0);
+}
+
+
+UniConfSnapshot::Iter::Iter(const UniConfSnapshot &_snap, const char *key)
+    : snap(_snap)
+{
+    parent = snap.find(key);
+    i = -1;
+}
+
+
+void UniConfSnapshot::Iter::rewind()
+{
+    i = -1;
+}
+
+
+bool UniConfSnapshot::Iter::next()
+{
+    return parent && ++i < parent->nchildren;
+}
+
+
+const char *UniConfSnapshot::Iter::key() const
+{
+    return parent->children[i]->key;
+}
+
+
+const char *UniConfSnapshot::Iter::value() const
+{
+    return parent->children[i]->value;
+}
+
+
+/***** UniConfSnapshotWriter *****/
+
+UniConfSnapshotWriter::UniConfSnapshotWriter()
+    : working(NULL), retired(NULL), batch(1), changed(false),
+      published(NULL), acquiring(0)
+{
+}
+
+
+UniConfSnapshotWriter::~UniConfSnapshotWriter()
+{
+    UniConfSnapshot::Version *last = swap(NULL);
+    if (last)
+    {
+	last->next = retired;
+	retired = last;
+    }
+
+    // Readers that are still holding a version will free it themselves
+    // when they're done; we only have to wait for the ones that are in
+    // the middle of picking one up.
+    while (__sync_add_and_fetch(&acquiring, 0))
+	;
+    reclaim();
+    release(working);
+}
+
+
+UniConfSnapshot::Node *UniConfSnapshotWriter::copy(UniConfSnapshot::Node *node)
+{
+    UniConfSnapshot::Node *c = newnode(node->key, node->value, batch);
+    if (node->nchildren)
+    {
+	c->children = new UniConfSnapshot::Node *[node->nchildren];
+	c->maxchildren = c->nchildren = node->nchildren;
+	for (int i = 0; i < node->nchildren; i++)
+	{
+	    c->children[i] = node->children[i];
+	    __sync_add_and_fetch(&c->children[i]->refs, 1);
+	}
+    }
+    return c;
+}
+
+
+UniConfSnapshot::Node *UniConfSnapshotWriter::writable(
+					UniConfSnapshot::Node *&slot)
+{
+    if (slot->batch != batch)
+    {
+	// published, or possibly about to be: change a copy instead.
+	UniConfSnapshot::Node *c = copy(slot);
+	release(slot);
+	slot = c;
+    }
+    return slot;
+}
+
+
+void UniConfSnapshotWriter::set(const UniConfKey &key, WvStringParm value)
+{
+    int nsegs = key.numsegments();
+    UniConfSnapshot::Node *node;
+
+    changed = true;
+    if (!working)
+	node = working = newnode("", nsegs ? "" : value.cstr(), batch);
+    else
+	node = writable(working);
+
+    for (int seg = 0; seg < nsegs; seg++)
+    {
+	WvString name(key.segment(seg).printable());
+	bool found;
+	int i = findchild(node, name, name.len(), found);
+	if (found)
+	    node = writable(node->children[i]);
+	else
+	{
+	    UniConfSnapshot::Node *child = newnode(name,
+				seg + 1 < nsegs ? "" : value.cstr(), batch);
+	    insertchild(node, i, child);
+	    node = child;
+	}
+    }
+
+    if (strcmp(node->value, value) != 0)
+    {
+	free(node->value);
+	node->value = strdup(value);
+    }
+}
+
+
+void UniConfSnapshotWriter::remove(const UniConfKey &key)
+{
+    int nsegs = key.numsegments();
+    if (!working)
+	return;
+    if (!nsegs)
+    {
+	release(working);
+	working = NULL;
+	changed = true;
+	return;
+    }
+
+    // Make sure it's there before copying anything.
+    WvString name;
+    UniConfSnapshot::Node *node = working;
+    int i = 0;
+    for (int seg = 0; seg < nsegs; seg++)
+    {
+	name = key.segment(seg).printable();
+	bool found;
+	i = findchild(node, name, name.len(), found);
+	if (!found)
+	    return;
+	if (seg + 1 < nsegs)
+	    node = node->children[i];
+    }
+
+    changed = true;
+    node = writable(working);
+    for (int seg = 0; seg + 1 < nsegs; seg++)
+    {
+	WvString parent(key.segment(seg).printable());
+	bool found;
+	node = writable(node->children[findchild(node, parent, parent.len(),
+						 found)]);
+    }
+
+    release(node->children[i]);
+    node->nchildren--;
+    memmove(&node->children[i], &node->children[i + 1],
+	    (node->nchildren - i) * sizeof(*node->children));
+}
+
+
+void UniConfSnapshotWriter::rebuild(const UniConfValueTree *root)
+{
+    release(working);
+    working = root ? build(root, batch) : NULL;
+    changed = true;
+}
+
+
+void UniConfSnapshotWriter::publish()
+{
+    if (!changed)
+	return;
+    changed = false;
+
+    UniConfSnapshot::Version *version = new UniConfSnapshot::Version;
+    __sync_add_and_fetch(&live_versions, 1);
+    version->refs = 1;
+    version->root = working;
+    version->next = NULL;
+    if (working)
+	__sync_add_and_fetch(&working->refs, 1);
+
+    // everything in 'working' is now shared, so future changes must copy
+    batch++;
+
+    UniConfSnapshot::Version *old = swap(version);
+
+    if (old)
+    {
+	old->next = retired;
+	retired = old;
+    }
+    reclaim();
+}
+
+
+UniConfSnapshot::Version *UniConfSnapshotWriter::swap(
+					UniConfSnapshot::Version *version)
+{
+    // a full barrier, so readers see the new version completely built
+    UniConfSnapshot::Version *old;
+    do
+	old = __sync_fetch_and_add(&published, 0);
+    while (!__sync_bool_compare_and_swap(&published, old, version));
+    return old;
+}
+
+
+void UniConfSnapshotWriter::reclaim()
+{
+    // A reader that got the old pointer but hasn't yet added its
+    // reference would be left with a dangling pointer if we dropped ours
+    // now.  Once nobody is acquiring, every reader either already has its
+    // reference or will see the new version.
+    if (__sync_add_and_fetch(&acquiring, 0))
+	return;
+
+    while (retired)
+    {
+	UniConfSnapshot::Version *version = retired;
+	retired = version->next;
+	release(version);
+    }
+}
+
+
+UniConfSnapshot UniConfSnapshotWriter::current() const
+{
+    __sync_add_and_fetch(&acquiring, 1);
+    UniConfSnapshot::Version *version = __sync_fetch_and_add(&published, 0);
+    if (version)
+	__sync_add_and_fetch(&version->refs, 1);
+    __sync_sub_and_fetch(&acquiring, 1);
+    return UniConfSnapshot(version);
+}
@@ -0,0 +1,208 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 2002-2005 Net Integration Technologies, Inc.
+ *
+ * A UniConf generator that caches a bounded number of recently used keys.
+ */
+#include "unihotcachegen.h"
+#include "wvmoniker.h"
+#include "wvlinkerhack.h"
+
+WV_LINK(UniHotCacheGen);
+
+
+// if 'obj' is non-NULL and is a UniConfGen, wrap that; otherwise wrap the
+// given moniker.
+static IUniConfGen *creator(WvStringParm s, IObject *_obj)
+{
+    return new UniHotCacheGen(wvcreate<IUniConfGen>(s, _obj));
+}
+
+static WvMoniker<IUniConfGen> reg("hotcache", creator);
+
+
+/***** UniHotCacheGen *****/
+
+UniHotCacheGen::UniHotCacheGen(IUniConfGen *_inner, int _max_entries)
+    : UniFilterGen(_inner), hits(0), misses(0), evictions(0),
+      entries(_max_entries / 2 + 1)
+{
+    max_entries = _max_entries > 0 ? _max_entries : 1;
+    clock = new Entry *[max_entries];
+    used = hand = 0;
+}
+
+
+UniHotCacheGen::~UniHotCacheGen()
+{
+    zap();
+    deletev clock;
+}
+
+
+void UniHotCacheGen::zap()
+{
+    entries.zap();
+    used = hand = 0;
+}
+
+
+void UniHotCacheGen::add(const UniConfKey &key, WvStringParm value)
+{
+    int slot;
+    if (used < max_entries)
+	slot = used++;
+    else
+    {
+	// Go around the clock until we find an entry that hasn't been used
+	// since the last time we passed it.  Entries that have been get a
+	// second chance.
+	while (clock[hand]->referenced)
+	{
+	    clock[hand]->referenced = false;
+	    hand = (hand + 1) % max_entries;
+	}
+	entries.remove(clock[hand]);
+	evictions++;
+	slot = hand;
+	hand = (hand + 1) % max_entries;
+    }
+
+    Entry *e = new Entry;
+    e->key = key;
+    e->value = value;
+    e->referenced = false;
+    e->slot = slot;
+    clock[slot] = e;
+    entries.add(e, true);
+}
+
+
+void UniHotCacheGen::forget(Entry *e)
+{
+    // keep the clock packed by moving the last entry into the hole
+    Entry *last = clock[--used];
+    clock[e->slot] = last;
+    last->slot = e->slot;
+    if (hand >= used)
+	hand = 0;
+    entries.remove(e);
+}
+
+
+void UniHotCacheGen::forget_under(const UniConfKey &key)
+{
+    // backwards, so that forget() only moves entries we've already seen
+    for (int i = used - 1; i >= 0; i--)
+	if (key.suborsame(clock[i]->key))
+	    forget(clock[i]);
+}
+
+
+void UniHotCacheGen::forget_parents(const UniConfKey &key)
+{
+    // the key exists, so all of its parents do too
+    for (int n = key.numsegments() - 1; n >= 0; n--)
+    {
+	Entry *e = find(key.first(n));
+	if (e && e->value.isnull())
+	    forget(e);
+    }
+}
+
+
+void UniHotCacheGen::gencallback(const UniConfKey &key, WvStringParm value)
+{
+    if (value.isnull())
+	forget_under(key);
+    else
+    {
+	Entry *e = find(key);
+	if (e)
+	    e->value = value;
+	forget_parents(key);
+    }
+    UniFilterGen::gencallback(key, value);
+}
+
+
+WvString UniHotCacheGen::get(const UniConfKey &key)
+{
+    // Keys with trailing slashes can't have values set on them
+    if (key.hastrailingslash())
+        return WvString::null;
+
+    Entry *e = find(key);
+    if (!e && !key.isempty())
+    {
+	// if the parent is known not to exist, neither does the child
+	Entry *parent = find(key.removelast());
+	if (parent && parent->value.isnull())
+	    e = parent;
+    }
+    if (e)
+    {
+	hits++;
+	e->referenced = true;
+	return e->value;
+    }
+
+    misses++;
+    WvString value = UniFilterGen::get(key);
+
+    // the inner generator may have sent notifications while we waited
+    e = find(key);
+    if (e)
+	e->value = value;
+    else
+	add(key, value);
+    return value;
+}
+
+
+bool UniHotCacheGen::exists(const UniConfKey &key)
+{
+    return !get(key).isnull();
+}
+
+
+bool UniHotCacheGen::haschildren(const UniConfKey &key)
+{
+    // if we already know the node is null, we can short circuit this one
+    Entry *e = find(key);
+    if (e && e->value.isnull())
+	return false;
+    return UniFilterGen::haschildren(key);
+}
+
+
+void UniHotCacheGen::invalidate(const UniConfKey &key, WvStringParm value)
+{
+    // We don't know what the inner generator really did with a change
+    // until it tells us, so just make sure the next get() asks.
+    if (value.isnull())
+	forget_under(key);
+    else
+    {
+	Entry *e = find(key);
+	if (e)
+	    forget(e);
+	forget_parents(key);
+    }
+}
+
+
+void UniHotCacheGen::set(const UniConfKey &key, WvStringParm value)
+{
+    UniFilterGen::set(key, value);
+    invalidate(key, value);
+}
+
+
+void UniHotCacheGen::setv(const UniConfPairList &pairs)
+{
+    UniFilterGen::setv(pairs);
+    UniConfPairList::Iter pair(pairs);
+    for (pair.rewind(); pair.next(); )
+	invalidate(pair->key(), pair->value());
+}
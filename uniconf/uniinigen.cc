@@ -47,6 +47,16 @@ void UniIniGen::set(const UniConfKey &key, WvStringParm value)
 }
 
 
+void UniIniGen::setv(const UniConfPairList &pairs)
+{
+    UniTempGen::setv(pairs);
+
+    // Re-create the root, since this generator can't handle it not existing.
+    if (!root)
+        UniTempGen::set(UniConfKey::EMPTY, WvString::empty);
+}
+
+
 UniIniGen::~UniIniGen()
 {
 }
@@ -196,6 +206,7 @@ bool UniIniGen::refresh()
     root = newtree;
     newgen->root = NULL;
     dirty = false;
+    resnapshot();
     oldtree->compare(newtree, wv::bind(&UniIniGen::refreshcomparator, this,
 				       _1, _2));
     
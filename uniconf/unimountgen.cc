@@ -10,7 +10,9 @@
 #include "wvstrutils.h"
 #include "unilistiter.h"
 #include "wvstringtable.h"
+#include <algorithm>
 #include <assert.h>
+#include <vector>
 
 /***** UniMountGen *****/
 
@@ -91,9 +93,13 @@ void UniMountGen::setv(const UniConfPairList &pairs)
 	}
     }
 
+    // collect the notifications from all the mounts into one batch
+    hold_delta();
     UniGenMountPairsDict::Iter i(mountpairs);
     for (i.rewind(); i.next(); )
-	i->mount->gen->setv(i->pairs);
+	if (!i->pairs.isempty())
+	    i->mount->gen->setv(i->pairs);
+    unhold_delta();
 }
 
 
@@ -345,16 +351,98 @@ IUniConfGen::Iter *UniMountGen::iterator(const UniConfKey &key)
 }
 
 
-// FIXME: this function will be rather slow if you try to iterate over multiple
-// generators and the latency level is high (as is the case with e.g.: the tcp generator). 
-// the fast path will only kick in if you iterate over a single generator.
+struct UniMountGenEntry
+{
+    UniConfKey key;
+    WvString value;
+    
+    UniMountGenEntry(const UniConfKey &_key, WvStringParm _value)
+	: key(_key), value(_value) { }
+    
+    bool operator< (const UniMountGenEntry &other) const
+        { return key.compareto(other.key) < 0; }
+};
+
+
 IUniConfGen::Iter *UniMountGen::recursiveiterator(const UniConfKey &key)
 {
     UniGenMount *found = findmountunder(key);
     if (found)
         return found->gen->recursiveiterator(trimkey(found->key, key));
-    else
-	return UniConfGen::recursiveiterator(key);
+
+    // The subtree is split between several generators.  Rather than
+    // walking it one key at a time (which is terribly slow when some of
+    // them are far away, like tcp:), ask each of them for its whole part
+    // at once, and merge the answers.
+    WvList<UniGenMount> parts;
+    MountList::Iter i(mounts);
+    for (i.rewind(); i.next(); )
+    {
+	if (i->key.suborsame(key))
+	{
+	    // mounted above us: it hides everything mounted before it
+	    parts.append(i.ptr(), false);
+	    break;
+	}
+	else if (key.suborsame(i->key) && findmount(i->key) == i.ptr())
+	    parts.append(i.ptr(), false);
+    }
+    
+    // Send all the requests before waiting for any of the answers.
+    WvList<UniGenMount>::Iter part(parts);
+    for (part.rewind(); part.next(); )
+    {
+	if (part->key.suborsame(key))
+	    part->gen->prefetch(trimkey(part->key, key), true);
+	else
+	    part->gen->prefetch(UniConfKey::EMPTY, true);
+    }
+    
+    std::vector<UniMountGenEntry> entries;
+    for (part.rewind(); part.next(); )
+    {
+	UniConfKey prefix;
+	IUniConfGen::Iter *it;
+	if (part->key.suborsame(key))
+	    it = part->gen->recursiveiterator(trimkey(part->key, key));
+	else
+	{
+	    prefix = part->key.removefirst(key.numsegments());
+	    it = part->gen->recursiveiterator(UniConfKey::EMPTY);
+	    
+	    // the mountpoint, and any keys leading up to it that aren't
+	    // in any generator, exist too.
+	    entries.push_back(UniMountGenEntry(prefix,
+					   part->gen->get(UniConfKey::EMPTY)));
+	    for (int n = key.numsegments() + 1;
+		 n < part->key.numsegments(); n++)
+	    {
+		UniConfKey between(part->key.first(n));
+		if (!findmount(between))
+		    entries.push_back(UniMountGenEntry(
+			between.removefirst(key.numsegments()), get(between)));
+	    }
+	}
+	if (!it)
+	    continue;
+	
+	// only keep the keys this generator is really responsible for
+	for (it->rewind(); it->next(); )
+	{
+	    UniConfKey subkey(prefix, it->key());
+	    if (findmount(UniConfKey(key, subkey)) == part.ptr())
+		entries.push_back(UniMountGenEntry(subkey, it->value()));
+	}
+	delete it;
+    }
+    
+    // UniConfKey sorts parents right before their children
+    std::sort(entries.begin(), entries.end());
+    ListIter *it = new ListIter(this);
+    for (unsigned int n = 0; n < entries.size(); n++)
+	if (!n || entries[n].key != entries[n - 1].key)
+	    it->add(entries[n].key, entries[n].value);
+    return it;
 }
 
 
@@ -116,6 +116,17 @@ void UniSecureGen::set(const UniConfKey &key, WvStringParm value)
 }
 
 
+void UniSecureGen::setv(const UniConfPairList &pairs)
+{
+    UniConfPairList allowed;
+    UniConfPairList::Iter pair(pairs);
+    for (pair.rewind(); pair.next(); )
+        if (findperm(pair->key(), UniPermGen::WRITE))
+            allowed.append(pair.ptr(), false);
+    UniFilterGen::setv(allowed);
+}
+
+
 bool UniSecureGen::haschildren(const UniConfKey &key)
 {
     if (findperm(key, UniPermGen::EXEC))
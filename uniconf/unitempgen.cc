@@ -24,17 +24,44 @@ static WvMoniker<IUniConfGen> reg("temp", creator);
 /***** UniTempGen *****/
 
 UniTempGen::UniTempGen()
-    : root(NULL)
+    : snapshots(NULL), root(NULL)
 {
 }
 
 
 UniTempGen::~UniTempGen()
 {
+    delete snapshots;
     delete root;
 }
 
 
+void UniTempGen::enable_snapshots()
+{
+    if (!snapshots)
+    {
+	snapshots = new UniConfSnapshotWriter;
+	resnapshot();
+    }
+}
+
+
+UniConfSnapshot UniTempGen::snapshot() const
+{
+    return snapshots ? snapshots->current() : UniConfSnapshot();
+}
+
+
+void UniTempGen::resnapshot()
+{
+    if (snapshots)
+    {
+	snapshots->rebuild(root);
+	snapshots->publish();
+    }
+}
+
+
 WvString UniTempGen::get(const UniConfKey &key)
 {
     if (root)
@@ -60,96 +87,157 @@ void UniTempGen::set(const UniConfKey &_key, WvStringParm _value)
     
     hold_delta();
     UniConfKey key = _key;
-    // FIXME: Use key.hastrailingslash(), it's shorter and easier and faster
-    bool trailing_slash = false;
-    if (!key.isempty())
+    if (key.hastrailingslash())
     {
-	// Look for an empty section at the end.
-	UniConfKey last = key;
-	key = last.pop(last.numsegments() - 1);
-	if (last.isempty())
-	    trailing_slash = true;
-	else
-	    key = _key;
+	// "foo/" can be deleted, but it can't be given a value
+	key = key.removelast();
+	if (value.isnull())
+	    removenode(root ? root->find(key) : NULL);
     }
+    else if (value.isnull())
+	removenode(root ? root->find(key) : NULL);
+    else
+	setnode(root, 0, key, value);
+    
+    // publish before anyone hears about the change
+    if (snapshots)
+	snapshots->publish();
+    unhold_delta();
+}
 
-    if (value.isnull())
-    {
-        // remove a subtree
-        if (root)
-        {
-            UniConfValueTree *node = root->find(key);
-            if (node)
-            {
-                hold_delta();
-                // Issue notifications for every key that gets deleted.
-                node->visit(wv::bind(&UniTempGen::notify_deleted, this,
-				     _1, _2),
-			    NULL, false, true);
-                delete node;
-                if (node == root)
-                    root = NULL;
-                dirty = true;
-                unhold_delta();
-            }
-        }
-    }
-    else if (!trailing_slash)
+
+void UniTempGen::setv(const UniConfPairList &pairs)
+{
+    UniConfPairList sorted;
+    sort_pairs(pairs, sorted);
+    
+    // 'node' is the most recently visited node, and 'nodekey' its key.
+    // Each key only needs to be walked from the deepest segment it has in
+    // common with the previous one, which for sorted input is most of it.
+    UniConfValueTree *node = NULL;
+    UniConfKey nodekey;
+    int depth = 0;
+    
+    hold_delta();
+    UniConfPairList::Iter pair(sorted);
+    for (pair.rewind(); pair.next(); )
     {
-        UniConfValueTree *node = root;
-        UniConfValueTree *prev = NULL;
-        UniConfKey prevkey;
+	WvString value(scache.get(pair->value()));
+	UniConfKey key(pair->key());
+	if (key.hastrailingslash())
+	{
+	    if (!value.isnull())
+		continue;
+	    key = key.removelast();
+	}
+	
+	int common = 0;
+	if (node)
+	{
+	    int max = key.numsegments() < depth ? key.numsegments() : depth;
+	    while (common < max
+		   && key.segment(common) == nodekey.segment(common))
+		common++;
+	    for (; depth > common; depth--)
+		node = node->parent();
+	}
+	else
+	    node = root;
 	
-        UniConfKey::Iter it(key);
-        it.rewind();
-        for (;;)
-        {
-            bool more = it.next(); // not the last node in the key?
-	    
-            if (!node)
-            {
-		// we'll have to create the sub-node, since we couldn't
-		// find the most recent part of the key.
-                node = new UniConfValueTree(prev, prevkey,
-					    more ? WvString::empty : value);
-                dirty = true;
-                if (!prev) // we just created the root
-                    root = node;
-		if (more)
-		    delta(node->fullkey(), WvString::empty); // AUTO-VIVIFIED
-		else
-		{
-		    delta(node->fullkey(), value); // ADDED
-		    break; // done!
-		}
-            }
-            else if (!more)
-            {
-		// don't have to create the most recent sub-node, but there
-		// are no more sub-nodes; that means we're changing the value
-		// of an existing node.
-                if (value != node->value())
-                {
-                    node->setvalue(value);
-                    dirty = true;
-                    delta(node->fullkey(), value); // CHANGED
-                }
-                break;
-            }
-            prevkey = *it;
-            prev = node;
-            node = prev->findchild(prevkey);
-        }
-	assert(node);
+	if (value.isnull())
+	{
+	    UniConfValueTree *victim = node
+		? node->find(key.removefirst(common)) : NULL;
+	    if (victim)
+	    {
+		// the parent survives and is still on our path
+		node = victim->parent();
+		nodekey = key.removelast();
+		depth = node ? key.numsegments() - 1 : 0;
+		removenode(victim);
+	    }
+	}
+	else
+	{
+	    node = setnode(node, common, key, value);
+	    nodekey = key;
+	    depth = key.numsegments();
+	}
     }
     
+    if (snapshots)
+	snapshots->publish();
     unhold_delta();
 }
 
 
-void UniTempGen::setv(const UniConfPairList &pairs)
+void UniTempGen::removenode(UniConfValueTree *node)
+{
+    if (!node)
+	return;
+    
+    hold_delta();
+    // Issue notifications for every key that gets deleted.
+    node->visit(wv::bind(&UniTempGen::notify_deleted, this, _1, _2),
+		NULL, false, true);
+    if (snapshots)
+	snapshots->remove(node->fullkey());
+    if (node == root)
+	root = NULL;
+    delete node;
+    dirty = true;
+    unhold_delta();
+}
+
+
+UniConfValueTree *UniTempGen::setnode(UniConfValueTree *node, int seg,
+				      const UniConfKey &key,
+				      WvStringParm value)
 {
-    setv_naive(pairs);
+    int nsegs = key.numsegments();
+    bool created = false;
+    
+    if (!node)
+    {
+	// we have to create the root first
+	assert(seg == 0);
+	node = root = new UniConfValueTree(NULL, UniConfKey::EMPTY,
+				    nsegs ? WvString::empty : value);
+	created = true;
+	dirty = true;
+	delta(UniConfKey::EMPTY, node->value()); // AUTO-VIVIFIED or ADDED
+    }
+    
+    for (; seg < nsegs; seg++)
+    {
+	UniConfKey segment(key.segment(seg));
+	UniConfValueTree *child = node->findchild(segment);
+	created = !child;
+	if (created)
+	{
+	    // we'll have to create the sub-node, since we couldn't
+	    // find the most recent part of the key.
+	    child = new UniConfValueTree(node, segment,
+				 seg + 1 < nsegs ? WvString::empty : value);
+	    dirty = true;
+	    delta(child->fullkey(), child->value()); // AUTO-VIVIFIED or ADDED
+	}
+	node = child;
+    }
+    
+    if (!created && value != node->value())
+    {
+	// the node was already there; we're changing its value.
+	node->setvalue(value);
+	dirty = true;
+	delta(node->fullkey(), value); // CHANGED
+    }
+    else if (!created)
+	return node;
+    
+    if (snapshots)
+	snapshots->set(key, value);
+    return node;
 }
 
 
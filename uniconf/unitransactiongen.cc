@@ -200,7 +200,7 @@ private:
 };
 
 UniTransactionGen::UniTransactionGen(IUniConfGen *_base)
-    : root(NULL), base(_base)
+    : commit_batch(1000), root(NULL), base(_base), queued(0)
 {
     base->add_callback(this, wv::bind(&UniTransactionGen::gencallback, this,
 				      _1, _2));
@@ -274,7 +274,9 @@ void UniTransactionGen::commit()
 	// away callbacks at this point, because we may get notified of
 	// changes caused by our changes.
 	hold_delta();
-	apply_changes(root, UniConfKey());
+	UniConfPairList changes;
+	apply_changes(root, UniConfKey(), changes);
+	flush_changes(changes, 1);
 
 	// make sure the inner generator also commits
 	base->commit();
@@ -350,10 +352,28 @@ UniConfGen::Iter *UniTransactionGen::iterator(const UniConfKey &key)
     }
 }
 
+void UniTransactionGen::queue_change(UniConfPairList &changes,
+				     const UniConfKey &key, WvStringParm value)
+{
+    changes.append(new UniConfPair(key, value), true);
+    queued++;
+}
+
+void UniTransactionGen::flush_changes(UniConfPairList &changes, int min)
+{
+    if (queued < min)
+	return;
+    base->setv(changes);
+    changes.zap();
+    queued = 0;
+}
+
 void UniTransactionGen::apply_values(UniConfValueTree *newcontents,
-				     const UniConfKey &section)
+				     const UniConfKey &section,
+				     UniConfPairList &changes)
 {
-    base->set(section, newcontents->value());
+    flush_changes(changes, commit_batch);
+    queue_change(changes, section, newcontents->value());
 
     UniConfGen::Iter *j = base->iterator(section);
     if (j)
@@ -364,7 +384,8 @@ void UniTransactionGen::apply_values(UniConfValueTree *newcontents,
 		// Delete all children of the current value in the
 		// underlying generator that do not exist in our
 		// replacement tree.
-		base->set(UniConfKey(section, j->key()), WvString::null);
+		queue_change(changes, UniConfKey(section, j->key()),
+			     WvString::null);
 	}
 	delete j;
     }
@@ -372,27 +393,29 @@ void UniTransactionGen::apply_values(UniConfValueTree *newcontents,
     // Repeat for each child in the replacement tree.
     UniConfValueTree::Iter i(*newcontents);
     for (i.rewind(); i.next();)
-	apply_values(i.ptr(), UniConfKey(section, i->key()));
+	apply_values(i.ptr(), UniConfKey(section, i->key()), changes);
 }
 
 void UniTransactionGen::apply_changes(UniConfChangeTree *node,
-				      const UniConfKey &section)
+				      const UniConfKey &section,
+				      UniConfPairList &changes)
 {
+    flush_changes(changes, commit_batch);
     if (node->mode == NEWTREE)
     {
 	// If the current change is a NEWTREE change, then replace the
 	// tree in the underlying generator with the stored one.
 	if (node->newtree == NULL)
-	    base->set(section, WvString::null);
+	    queue_change(changes, section, WvString::null);
 	else
-	    apply_values(node->newtree, section);
+	    apply_values(node->newtree, section, changes);
 	// Since such changes have no children, return immediately.
 	return;
     }
     else if (node->mode == NEWVALUE)
     {
 	// Else if the current change is a NEWVALUE change, ...
-	base->set(section, node->newvalue);
+	queue_change(changes, section, node->newvalue);
     }
     else if (node->mode == NEWNODE)
     {
@@ -400,7 +423,7 @@ void UniTransactionGen::apply_changes(UniConfChangeTree *node,
 	if (!base->exists(section))
 	    // ... and the current value in the underlying generator doesn't
 	    // exist, then create it.
-	    base->set(section, WvString::empty);
+	    queue_change(changes, section, WvString::empty);
 	// Note: This *is* necessary. We can't ignore this change and have
 	// the underlying generator handle it, because it's possible that
 	// this NEWNODE was the result of a set() which was later deleted.
@@ -409,7 +432,7 @@ void UniTransactionGen::apply_changes(UniConfChangeTree *node,
     // Repeat for each child in the change tree.
     UniConfChangeTree::Iter i(*node);
     for (i.rewind(); i.next();)
-	apply_changes(i.ptr(), UniConfKey(section, i->key()));
+	apply_changes(i.ptr(), UniConfKey(section, i->key()), changes);
 }
 
 struct my_userdata
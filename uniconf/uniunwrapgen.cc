@@ -96,9 +96,7 @@ void UniUnwrapGen::set(const UniConfKey &key, WvStringParm value)
 
 void UniUnwrapGen::setv(const UniConfPairList &pairs)
 {
-    // Extremely evil.  This pokes directly into UniMountGen, because we
-    // don't want to expose setv to users.
-    xinner.rootobj()->mounts.setv(pairs);
+    xinner.setv(pairs);
 }
 
 
@@ -142,11 +140,12 @@ public:
 
 class UniUnwrapGen::RecursiveIter : public UniConfGen::Iter
 {
+    UniConf top;
     UniConf::RecursiveIter i;
     
 public:
     RecursiveIter(const UniConf &cfg)
-	: i(cfg)
+	: top(cfg), i(cfg)
         { }
     virtual ~RecursiveIter()
         { }
@@ -154,7 +153,7 @@ public:
     /***** Overridden members *****/
     virtual void rewind() { i.rewind(); }
     virtual bool next() { return i.next(); }
-    virtual UniConfKey key() const { return i->key(); }
+    virtual UniConfKey key() const { return i->fullkey(top); }
     virtual WvString value() const { return i->getme(); }
 };
 
@@ -1,10 +1,15 @@
 #include "wvtest.h"
 #include "wvhttppool.h"
+#include "wvhttpserver.h"
 #include "wvtcplistener.h"
+#include "strutils.h"
+#include "wvfileutils.h"
 #include <stdio.h>
 
 #ifndef _WIN32
 #include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 
@@ -261,3 +266,207 @@ WVTEST_MAIN("WvHttpPool pipelining")
     WVPASS(listener->isok());
 }
 
+
+
+// answers every request right away, on however many connections it gets
+static void simple_callback(WvStream &s)
+{
+    char *line;
+    while ((line = s.getline(0)) != NULL)
+    {
+        if (!*trim_string(line))
+            s.print("HTTP/1.1 200 OK\r\n"
+                    "Content-Length: 3\r\n\r\n"
+                    "Ok\n");
+    }
+}
+
+
+static void simple_listener_callback(WvIStreamList *list, IWvStream *_newconn)
+{
+    http_conns++;
+    WvStreamClone *newconn = new WvStreamClone(_newconn);
+    newconn->setcallback(wv::bind(simple_callback, wv::ref(*newconn)));
+    list->append(newconn, true, "incoming http conn");
+}
+
+
+static void fetch(WvIStreamList &l, WvHttpPool &pool, unsigned int port,
+                  int num_requests)
+{
+    WvIStreamList bufs;
+    for (int i = 0; i < num_requests; i++)
+    {
+        WvStream *buf = pool.addurl(WvString("http://localhost:%s/%s.html",
+                                             port, i));
+        buf->autoforward(*wvcon);
+        bufs.append(buf, true, "poolbuf");
+    }
+
+    l.append(&bufs, false, "list of bufs");
+    for (int tries = 0; bufs.count() && tries < 1000; tries++)
+        l.runonce(10);
+    WVPASSEQ(bufs.count(), 0);
+    l.unlink(&bufs);
+}
+
+
+WVTEST_MAIN("WvHttpPool connection limit")
+{
+    WvIStreamList l;
+    WvTCPListener *listener = new WvTCPListener(WvIPPortAddr("127.0.0.1", 0));
+    unsigned int port = ((const WvIPPortAddr *)listener->src())->port;
+    listener->onaccept(wv::bind(simple_listener_callback, &l, _1));
+    l.append(listener, true, "http listener");
+
+    // no pipelining, so each connection has one request at a time
+    WvHttpStream::global_enable_pipelining = false;
+    http_conns = 0;
+    {
+        WvHttpPool pool;
+        pool.set_max_conns(3);
+        l.append(&pool, false, "WvHttpPool");
+
+        // requests are spread over as many connections as we allow, and
+        // the rest queue up behind them...
+        fetch(l, pool, port, 9);
+        WVPASSEQ(pool.num_created(), 3);
+        WVPASSEQ(pool.requests, 9);
+        WVPASSEQ(pool.reused, 0);
+
+        // ...which stay open for next time
+        fetch(l, pool, port, 3);
+        WVPASSEQ(pool.num_created(), 3);
+        WVPASSEQ(pool.requests, 12);
+        WVPASSEQ(pool.reused, 3);
+
+        l.unlink(&pool);
+    }
+    WVPASSEQ(http_conns, 3);
+    WvHttpStream::global_enable_pipelining = true;
+}
+
+
+static const size_t big_size = 3*1024*1024 + 17;
+
+static void fill_big(WvBuf &buf, size_t start, size_t len)
+{
+    unsigned char *p = buf.alloc(len);
+    for (size_t i = 0; i < len; i++)
+        p[i] = (start + i) % 251;
+}
+
+
+static bool check_big(const unsigned char *p, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        if (p[i] != i % 251)
+            return false;
+    return true;
+}
+
+
+static void serve_big(WvHttpConn &conn, const WvHttpRequest &req)
+{
+    WvDynBuf buf;
+    fill_big(buf, 0, big_size);
+    conn.respond(200, "application/octet-stream", buf);
+}
+
+
+static void big_more(size_t &sent, WvHttpConn &conn)
+{
+    WvDynBuf buf;
+    size_t len = big_size - sent < 65536 ? big_size - sent : 65536;
+    fill_big(buf, sent, len);
+    sent += len;
+    conn.send(buf);
+    if (sent == big_size)
+        conn.end_response();
+}
+
+
+static void serve_chunked(size_t &sent, WvHttpConn &conn,
+                          const WvHttpRequest &req)
+{
+    sent = 0;
+    conn.start_response(200, "application/octet-stream");
+    conn.set_producer(wv::bind(big_more, wv::ref(sent), _1));
+}
+
+
+static void fetch_big(WvIStreamList &l, WvHttpPool &pool, WvStringParm url,
+                      WvDynBuf &got, int body_fd = -1)
+{
+    WvBufUrlStream *buf = pool.addurl(url);
+    buf->body_fd = body_fd;
+    l.append(buf, false, "big buf");
+    for (int tries = 0; buf->isok() && tries < 10000; tries++)
+    {
+        l.runonce(10);
+        buf->read(got, 1024*1024);
+    }
+    WVPASSEQ(buf->status, 200);
+    l.unlink(buf);
+    WVRELEASE(buf);
+}
+
+
+WVTEST_MAIN("WvHttpPool large bodies")
+{
+    WvIStreamList l;
+    WvHttpServer server;
+    size_t sent = 0;
+    server.route("/big", serve_big);
+    server.route("/chunked", wv::bind(serve_chunked, wv::ref(sent), _1, _2));
+    IWvListener *listener = server.listen("tcp:127.0.0.1:0");
+    WvString base("http://127.0.0.1:%s",
+                  ((const WvIPPortAddr *)listener->src())->port);
+    l.append(&server, false, "http server");
+
+    WvHttpPool pool;
+    l.append(&pool, false, "WvHttpPool");
+
+    WvDynBuf got;
+    fetch_big(l, pool, WvString("%s/big", base), got);
+    WVPASSEQ(got.used(), big_size);
+    WVPASS(check_big(got.get(got.used()), big_size));
+
+    fetch_big(l, pool, WvString("%s/chunked", base), got);
+    WVPASSEQ(got.used(), big_size);
+    WVPASS(check_big(got.get(got.used()), big_size));
+
+#ifndef _WIN32
+    // straight to a file, without going through the stream at all
+    FILE *f = tmpfile();
+    fetch_big(l, pool, WvString("%s/big", base), got, fileno(f));
+    fetch_big(l, pool, WvString("%s/chunked", base), got, fileno(f));
+    WVPASSEQ(got.used(), 0);
+    WVPASSEQ((size_t)lseek(fileno(f), 0, SEEK_CUR), 2 * big_size);
+    lseek(fileno(f), 0, SEEK_SET);
+    unsigned char *p = got.alloc(2 * big_size);
+    WVPASSEQ(read(fileno(f), p, 2 * big_size), (ssize_t)(2 * big_size));
+    WVPASS(check_big(p, big_size));
+    WVPASS(check_big(p + big_size, big_size));
+    fclose(f);
+    got.zap();
+
+    // splice() won't write to an O_APPEND file, so that has to be done
+    // the slow way, without losing anything
+    WvString appendname = wvtmpfilename("wvtest-httppool-");
+    int fd = open(appendname, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0600);
+    fetch_big(l, pool, WvString("%s/big", base), got, fd);
+    fetch_big(l, pool, WvString("%s/chunked", base), got, fd);
+    WVPASSEQ(got.used(), 0);
+    lseek(fd, 0, SEEK_SET);
+    p = got.alloc(2 * big_size);
+    WVPASSEQ(read(fd, p, 2 * big_size), (ssize_t)(2 * big_size));
+    WVPASS(check_big(p, big_size));
+    WVPASS(check_big(p + big_size, big_size));
+    close(fd);
+    unlink(appendname);
+#endif
+
+    l.unlink(&pool);
+    l.unlink(&server);
+}
@@ -0,0 +1,196 @@
+#include "wvtest.h"
+#include "wvhttpserver.h"
+#include "wvtcp.h"
+#include "wvtimeutils.h"
+#include "strutils.h"
+#include <sys/socket.h>
+
+
+static void hello(WvHttpConn &conn, const WvHttpRequest &req)
+{
+    conn.respond(200, "text/plain", WvString("hello %s\n", req.path));
+}
+
+
+static void echo(WvHttpConn &conn, const WvHttpRequest &req)
+{
+    WvDynBuf buf;
+    buf.put(req.body, req.body_len);
+    conn.respond(200, "application/octet-stream", buf);
+}
+
+
+static void count_more(int &left, WvHttpConn &conn)
+{
+    if (left)
+	conn.send(WvString("%s\n", left--));
+    else
+	conn.end_response();
+}
+
+
+static void countdown(int &left, WvHttpConn &conn, const WvHttpRequest &req)
+{
+    left = atoi(req.query);
+    
+    // keep the kernel from soaking up too much of it
+    int size = 65536;
+    setsockopt(conn.cloned->getwfd(), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    conn.start_response(200, "text/plain");
+    conn.set_producer(wv::bind(count_more, wv::ref(left), _1));
+}
+
+
+static void blocks_more(int &left, WvHttpConn &conn)
+{
+    static char block[16384];
+    if (left--)
+	conn.send(block, sizeof(block));
+    else
+	conn.end_response();
+}
+
+
+static void blocks(int &left, WvHttpConn &conn, const WvHttpRequest &req)
+{
+    left = atoi(req.query);
+    
+    // keep the kernel from soaking up too much of it
+    int size = 65536;
+    setsockopt(conn.cloned->getwfd(), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    conn.start_response(200, "application/octet-stream");
+    conn.set_producer(wv::bind(blocks_more, wv::ref(left), _1));
+}
+
+
+// send 'request' and collect everything that comes back until the server
+// hangs up
+static WvString talk(WvHttpServer &server, IWvListener *listener,
+		     WvStringParm request)
+{
+    WvIStreamList l;
+    l.append(&server, false, "server");
+
+    WvTCPConn client(*(const WvIPPortAddr *)listener->src());
+    client.write(request);
+    l.append(&client, false, "client");
+
+    WvDynBuf got;
+    WvTime start = wvtime();
+    while (client.isok() && msecdiff(wvtime(), start) < 5000)
+    {
+	l.runonce(100);
+	char buf[4096];
+	size_t len = client.read(buf, sizeof(buf));
+	got.put(buf, len);
+    }
+    l.unlink(&client);
+    l.unlink(&server);
+    return got.getstr();
+}
+
+
+WVTEST_MAIN("http server basics")
+{
+    WvHttpServer server;
+    server.route("/hello", hello);
+    server.route("/files/", hello);
+    server.route("/files/echo", echo);
+    IWvListener *listener = server.listen("tcp:127.0.0.1:0");
+    WVPASS(listener->isok());
+
+    // pipelined requests come back in order, in one go
+    WvString r = talk(server, listener,
+		      "GET /hello HTTP/1.1\r\nHost: x\r\n\r\n"
+		      "GET /files/a/b?c HTTP/1.1\r\nHost: x\r\n\r\n"
+		      "GET /nothing HTTP/1.1\r\nHost: x\r\n"
+		      "Connection: close\r\n\r\n");
+    WVPASSEQ(r,
+	     "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+	     "Content-Length: 13\r\n\r\nhello /hello\n"
+	     "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+	     "Content-Length: 17\r\n\r\nhello /files/a/b\n"
+	     "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n"
+	     "Content-Length: 10\r\nConnection: close\r\n\r\nNot Found\n");
+    WVPASSEQ(server.requests, 3);
+
+    // a body, and HTTP/1.0, which hangs up by default
+    r = talk(server, listener, "POST /files/echo HTTP/1.0\r\n"
+	     "Content-Length: 5\r\n\r\nabcde");
+    WVPASSEQ(r, "HTTP/1.0 200 OK\r\nContent-Type: application/octet-stream"
+	     "\r\nContent-Length: 5\r\nConnection: close\r\n\r\nabcde");
+
+    // HEAD gets the headers only
+    r = talk(server, listener,
+	     "HEAD /hello HTTP/1.1\r\nConnection: close\r\n\r\n");
+    WVPASSEQ(r, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+	     "Content-Length: 13\r\nConnection: close\r\n\r\n");
+
+    // nonsense gets a 400, and too much of it gets a 431
+    r = talk(server, listener, "GARBAGE\r\n\r\n");
+    WVPASS(!strncmp(r, "HTTP/1.0 400 Bad Request\r\n", 26));
+    server.max_header_size = 100;
+    WvString junk("x");
+    while (junk.len() < 200)
+	junk.append(junk);
+    r = talk(server, listener,
+	     WvString("GET / HTTP/1.1\r\nX-Junk: %s\r\n\r\n", junk));
+    WVPASS(!strncmp(r, "HTTP/1.0 431 ", 13));
+    WVPASSEQ(server.connections, 5);
+}
+
+
+WVTEST_MAIN("http server streaming")
+{
+    WvHttpServer server;
+    int left = 0;
+    server.route("/count", wv::bind(countdown, wv::ref(left), _1, _2));
+    IWvListener *listener = server.listen("tcp:127.0.0.1:0");
+    WVPASS(listener->isok());
+
+    WvString r = talk(server, listener, "GET /count?3 HTTP/1.1\r\n\r\n"
+		      "GET /count?1 HTTP/1.1\r\nConnection: close\r\n\r\n");
+    WVPASSEQ(r, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+	     "Transfer-Encoding: chunked\r\n\r\n"
+	     "2\r\n3\n\r\n2\r\n2\n\r\n2\r\n1\n\r\n0\r\n\r\n"
+	     "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+	     "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n"
+	     "2\r\n1\n\r\n0\r\n\r\n");
+
+    // without chunks, HTTP/1.0 clients find the end when we hang up
+    r = talk(server, listener,
+	     "GET /count?2 HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+    WVPASSEQ(r, "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n"
+	     "Connection: close\r\n\r\n2\n1\n");
+
+    // a slow reader doesn't make us buffer the whole thing: we only make
+    // more when the socket can take it
+    left = 0;
+    server.route("/blocks", wv::bind(blocks, wv::ref(left), _1, _2));
+    WvIStreamList l;
+    l.append(&server, false, "server");
+    WvTCPConn client(*(const WvIPPortAddr *)listener->src());
+    int size = 65536;
+    setsockopt(client.getfd(), SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    client.write("GET /blocks?256 HTTP/1.1\r\nConnection: close\r\n\r\n");
+    l.append(&client, false, "client");
+    for (int n = 0; n < 500; n++)
+	l.runonce(1);
+    WVPASS(left > 0);
+    WVPASS(left < 256);
+    WVPASS(left > 128); // the kernel can take some, but not that much
+    l.unlink(&client);
+
+    size_t total = 0;
+    char buf[65536];
+    WvTime start = wvtime();
+    while (client.isok() && msecdiff(wvtime(), start) < 20000)
+    {
+	l.runonce(10);
+	while (client.isok() && client.select(0))
+	    total += client.read(buf, sizeof(buf));
+    }
+    WVPASS(total > 256 * 16384);
+    WVPASSEQ(left, -1);
+    l.unlink(&server);
+}
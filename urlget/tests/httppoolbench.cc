@@ -0,0 +1,102 @@
+/*
+ * Fetches a lot of files from a local HTTP server that takes a few ms to
+ * answer each request, with different numbers of connections allowed per
+ * server in WvHttpPool.  Pipelining is off, as it is for many real servers.
+ */
+#include "wvhttppool.h"
+#include "wvtcplistener.h"
+#include "wvtimeutils.h"
+#include "strutils.h"
+
+static const int nfiles = 200, delay = 5;
+
+
+// answers requests one at a time, 'delay' ms after the last one
+class StubConn : public WvStreamClone
+{
+    int pending;
+    bool closing;
+
+public:
+    StubConn(IWvStream *s) : WvStreamClone(s)
+        { pending = 0; closing = false; }
+
+    virtual void execute()
+    {
+        WvStreamClone::execute();
+
+        if (alarm_was_ticking && pending)
+        {
+            print("HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nOk\n");
+            if (--pending)
+                alarm(delay);
+        }
+
+        char *line;
+        while ((line = getline(0)) != NULL)
+        {
+            if (!strcasecmp(line, "Connection: close\r"))
+                closing = true;
+            if (!*trim_string(line) && !pending++)
+                alarm(delay);
+        }
+        if (closing && !pending)
+            close(); // like a real server would
+
+    }
+};
+
+
+static void accept_stub(WvIStreamList *list, IWvStream *conn)
+{
+    list->append(new StubConn(conn), true, "stub conn");
+}
+
+
+static void run(WvIStreamList &l, unsigned int port, int max_conns)
+{
+    WvHttpPool pool;
+    pool.set_max_conns(max_conns);
+    l.append(&pool, false, "pool");
+
+    WvIStreamList bufs;
+    for (int i = 0; i < nfiles; i++)
+        bufs.append(pool.addurl(WvString("http://127.0.0.1:%s/%s", port, i)),
+                    true, "buf");
+    l.append(&bufs, false, "bufs");
+
+    WvTime start = wvtime();
+    char buf[1024];
+    while (bufs.count())
+    {
+        l.runonce();
+        WvIStreamList::Iter i(bufs);
+        for (i.rewind(); i.next(); )
+            i->read(buf, sizeof(buf)); // throw it away
+    }
+
+    wvcon->print("%s conns/server: %s files in %s ms, %s connections, "
+                 "%s of %s requests found one idle\n",
+                 max_conns, nfiles, msecdiff(wvtime(), start),
+                 pool.num_created(), pool.reused, pool.requests);
+
+    l.unlink(&bufs);
+    l.unlink(&pool);
+}
+
+
+int main()
+{
+    WvIStreamList l;
+    WvTCPListener *listener = new WvTCPListener(WvIPPortAddr("127.0.0.1", 0));
+    unsigned int port = ((const WvIPPortAddr *)listener->src())->port;
+    listener->onaccept(wv::bind(accept_stub, &l, _1));
+    l.append(listener, true, "listener");
+
+    WvHttpStream::global_enable_pipelining = false;
+    run(l, port, 1);
+    run(l, port, 2);
+    run(l, port, 4);
+    run(l, port, 8);
+    return 0;
+}
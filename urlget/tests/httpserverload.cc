@@ -0,0 +1,106 @@
+/*
+ * Throws a lot of pipelined requests at a WvHttpServer over loopback, from
+ * a forked child so the client doesn't slow down the server, and reports
+ * how many requests per second it answered.
+ *
+ * usage: httpserverload [connections] [requests per connection] [depth]
+ */
+#include "wvhttpserver.h"
+#include "wvtcp.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const char request[] = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+static const char response[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+    "Content-Length: 6\r\n\r\nhello\n";
+
+
+static void hello(WvHttpConn &conn, const WvHttpRequest &req)
+{
+    conn.respond(200, "text/plain", "hello\n");
+}
+
+
+// one client connection, keeping 'depth' requests in flight at a time
+class LoadConn : public WvTCPConn
+{
+public:
+    int left, inflight, depth;
+    size_t partial;
+
+    LoadConn(const WvIPPortAddr &addr, int count, int _depth)
+	: WvTCPConn(addr)
+    {
+	left = count;
+	inflight = 0;
+	depth = _depth;
+	partial = 0;
+	fill();
+    }
+
+    void fill()
+    {
+	WvDynBuf buf;
+	for (; inflight < depth && left; inflight++, left--)
+	    buf.putstr(request);
+	write(buf, buf.used());
+    }
+
+    virtual void execute()
+    {
+	WvTCPConn::execute();
+
+	char buf[65536];
+	size_t len = read(buf, sizeof(buf));
+	partial += len;
+	inflight -= partial / (sizeof(response) - 1);
+	partial %= sizeof(response) - 1;
+	fill();
+	if (!left && !inflight)
+	    close();
+    }
+};
+
+
+int main(int argc, char **argv)
+{
+    int conns = argc > 1 ? atoi(argv[1]) : 10;
+    int count = argc > 2 ? atoi(argv[2]) : 10000;
+    int depth = argc > 3 ? atoi(argv[3]) : 16;
+
+    WvHttpServer server;
+    server.route("/hello", hello);
+    IWvListener *listener = server.listen("tcp:127.0.0.1:0");
+    if (!listener->isok())
+	return 1;
+    WvIPPortAddr addr(*(const WvIPPortAddr *)listener->src());
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+	while (true)
+	    server.runonce();
+	_exit(0);
+    }
+    server.zap();
+
+    WvIStreamList l;
+    WvTime start = wvtime();
+    for (int i = 0; i < conns; i++)
+	l.append(new LoadConn(addr, count, depth), true, "load conn");
+    while (l.count())
+	l.runonce();
+    time_t ms = msecdiff(wvtime(), start);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+
+    printf("%d connections x %d requests, %d deep: %ld ms, %.0f requests/s\n",
+	   conns, count, depth, (long)ms,
+	   ms ? conns * (double)count * 1000 / ms : 0.0);
+    return 0;
+}
@@ -96,11 +96,13 @@ void WvUrlStream::delurl(WvUrlRequest *url, WvStringParm reason)
 
 
 WvHttpPool::WvHttpPool() 
-    : log("HTTP Pool", WvLog::Debug), conns(10),
-      pipeline_incompatible(50)
+    : log("HTTP Pool", WvLog::Debug), pipeline_incompatible(50)
 {
     log(WvLog::Debug2, "Pool initializing.\n");
     num_streams_created = 0;
+    max_conns = 1;
+    keepalive = 5000;
+    requests = reused = 0;
 }
 
 
@@ -108,6 +110,9 @@ WvHttpPool::~WvHttpPool()
 {
     log(WvLog::Debug2, "Created %s individual session%s during this run.\n",
             num_streams_created, num_streams_created == 1 ? "" : "s");
+    if (requests)
+        log(WvLog::Debug2, "Reused a connection for %s of %s requests.\n",
+            reused, requests);
     if (geterr())
         log("Error was: %s\n", errstr());
 
@@ -125,7 +130,7 @@ void WvHttpPool::pre_select(SelectInfo &si)
 
     WvIStreamList::pre_select(si);
 
-    WvUrlStreamDict::Iter ci(conns);
+    WvUrlStreamList::Iter ci(conns);
     for (ci.rewind(); ci.next(); )
     {
         if (!ci->isok())
@@ -151,7 +156,7 @@ bool WvHttpPool::post_select(SelectInfo &si)
 {
     bool sure = false;
 
-    WvUrlStreamDict::Iter ci(conns);
+    WvUrlStreamList::Iter ci(conns);
     for (ci.rewind(); ci.next(); )
     {
         if (!ci->isok())
@@ -177,10 +182,8 @@ bool WvHttpPool::post_select(SelectInfo &si)
 	    else
 		reason = "URL done";
             // nicely delete the url request
-            WvUrlStream::Target target(i->url.getaddr(), i->url.getuser());
-            WvUrlStream *s = conns[target];
-            if (s)
-                s->delurl(i.ptr(), reason);
+            if (i->instream)
+                i->instream->delurl(i.ptr(), reason);
             i.xunlink();
             continue;
         }
@@ -204,48 +207,95 @@ void WvHttpPool::execute()
 {
     WvIStreamList::execute();
 
+    // any URLs on a dead connection will have to go somewhere else
+    WvUrlStreamList::Iter ci(conns);
+    for (ci.rewind(); ci.next(); )
+    {
+        if (!ci->isok())
+        {
+            unconnect(ci.ptr());
+            ci.rewind();
+        }
+    }
+
     WvUrlRequestList::Iter i(urls);
     for (i.rewind(); i.next(); )
     {
-        WvUrlStream *s;
-
         if (!i->outstream || !i->url.isok() || !i->url.resolve())
             continue; // skip it for now
 
-        WvUrlStream::Target target(i->url.getaddr(), i->url.getuser());
+        if (i->instream)
+            continue; // already on its way
 
-        s = conns[target];
-        if (s && !s->isok())
-        {
-            unconnect(s);
-            s = NULL;
-        }
+        WvUrlStream *s = find_stream(i.ptr());
+        if (!s)
+            continue; // try again later
 
-        if (!i->outstream)
-            continue; // unconnect might have caused this URL to be marked bad
+        s->addurl(i.ptr());
+        i->instream = s;
+    }
+}
 
-        if (!s)
-        {
-            num_streams_created++;
-            if (!strncasecmp(i->url.getproto(), "http", 4))
-                s = new WvHttpStream(target.remaddr, target.username,
-                        i->url.getproto() == "https",
-                        pipeline_incompatible);
-            else if (!strcasecmp(i->url.getproto(), "ftp"))
-                s = new WvFtpStream(target.remaddr, target.username,
-                        i->url.getpassword());
-            conns.add(s, true);
-
-            // add it to the streamlist, so it can do things
-            append(s, false, "http/ftp stream");
-        }
 
-        if (!i->instream)
-        {
-            s->addurl(i.ptr());
-            i->instream = s;
-        }
+// Find the least busy connection for the given URL, unless they're all
+// busy and we're allowed another one, in which case open it.  Once we're at
+// max_conns, the URL queues up behind the least busy one; only if they're
+// all about to hang up does this return NULL, and the URL waits here in the
+// pool until one of them goes away.
+WvUrlStream *WvHttpPool::find_stream(WvUrlRequest *url)
+{
+    WvUrlStream::Target target(url->url.getaddr(), url->url.getuser());
+    WvUrlStream *best = NULL;
+    int count = 0;
+
+    WvUrlStreamList::Iter ci(conns);
+    for (ci.rewind(); ci.next(); )
+    {
+        if (!(ci->target == target))
+            continue;
+
+        // connections that are about to hang up still count against the
+        // limit, but can't take any more requests
+        count++;
+        if (!ci->retiring() && (!best || ci->load() < best->load()))
+            best = ci.ptr();
     }
+
+    if (best && (!best->load() || count >= max_conns))
+    {
+        requests++;
+        if (!best->load())
+            reused++; // an idle connection we kept open
+        return best;
+    }
+    else if (count >= max_conns)
+        return NULL;
+
+    WvUrlStream *s;
+    if (!strncasecmp(url->url.getproto(), "http", 4))
+    {
+        WvHttpStream *h = new WvHttpStream(target.remaddr, target.username,
+                url->url.getproto() == "https", pipeline_incompatible);
+        h->idle_timeout = keepalive;
+        s = h;
+    }
+    else if (!strcasecmp(url->url.getproto(), "ftp"))
+        s = new WvFtpStream(target.remaddr, target.username,
+                url->url.getpassword());
+    else
+    {
+        log("Unsupported protocol in '%s'\n", url->url);
+        url->done();
+        return NULL;
+    }
+
+    requests++;
+    num_streams_created++;
+    conns.append(s, true);
+
+    // add it to the streamlist, so it can do things
+    append(s, false, "http/ftp stream");
+    return s;
 }
 
 
@@ -277,5 +327,5 @@ void WvHttpPool::unconnect(WvUrlStream *s)
     }
 
     unlink(s);
-    conns.remove(s);
+    conns.unlink(s);
 }
@@ -0,0 +1,599 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * A small event-driven HTTP/1.1 server.  See wvhttpserver.h.
+ */
+#include "wvhttpserver.h"
+#include "wvlistener.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// how much to read from the socket at once
+#define READ_SIZE 16384
+
+// how much the socket's own buffer may hold before we stop giving it more
+#define SOCKET_BUFFER 65536
+
+
+static const char *status_text(int status)
+{
+    switch (status)
+    {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    default:  return "Unknown";
+    }
+}
+
+
+// true if the comma-separated list 'list' contains 'token' (in any case)
+static bool has_token(const char *list, const char *token)
+{
+    if (!list)
+	return false;
+
+    size_t len = strlen(token);
+    for (const char *p = list; *p; )
+    {
+	while (*p == ' ' || *p == '\t' || *p == ',')
+	    p++;
+	const char *end = strchr(p, ',');
+	if (!end)
+	    end = p + strlen(p);
+	const char *e = end;
+	while (e > p && (e[-1] == ' ' || e[-1] == '\t'))
+	    e--;
+	if ((size_t)(e - p) == len && !strncasecmp(p, token, len))
+	    return true;
+	p = end;
+    }
+    return false;
+}
+
+
+const char *WvHttpRequest::header(const char *name) const
+{
+    for (int i = 0; i < nheaders; i++)
+	if (!strcasecmp(headers[i].name, name))
+	    return headers[i].value;
+    return NULL;
+}
+
+
+WvHttpConn::WvHttpConn(IWvStream *_cloned, WvHttpServer &_server)
+    : WvStreamClone(_cloned), server(_server), log("HTTP Conn", WvLog::Debug)
+{
+    head = NULL;
+    head_size = 0;
+    scanned = need = consumed = 0;
+    busy = chunked = head_only = in_execute = false;
+    memset(&req, 0, sizeof(req));
+
+    // Let the socket buffer only so much; the rest waits in our outbuf,
+    // which is how we know when a slow client is holding us up.
+    if (cloned)
+	cloned->outbuf_limit(SOCKET_BUFFER);
+    alarm(server.idle_timeout);
+}
+
+
+WvHttpConn::~WvHttpConn()
+{
+    close();
+    delete[] head;
+}
+
+
+void WvHttpConn::pre_select(SelectInfo &si)
+{
+    SelectRequest oldwant = si.wants;
+
+    // don't read any more requests until we've answered this one
+    if (busy)
+    {
+	si.wants.readable = false;
+	if (producer && !congested())
+	    si.msec_timeout = 0;
+    }
+    WvStreamClone::pre_select(si);
+    si.wants = oldwant;
+}
+
+
+bool WvHttpConn::post_select(SelectInfo &si)
+{
+    SelectRequest oldwant = si.wants;
+
+    if (busy)
+	si.wants.readable = false;
+    bool ready = WvStreamClone::post_select(si);
+    si.wants = oldwant;
+
+    // the last bit of our response is gone, so we want the next one
+    return ready || (busy && producer && !congested());
+}
+
+
+void WvHttpConn::execute()
+{
+    WvStreamClone::execute();
+
+    if (busy)
+    {
+	if (producer && !congested())
+	{
+	    in_execute = true;
+	    Producer p(producer); // it might replace itself
+	    p(*this);
+	    in_execute = false;
+	    flush_out();
+	}
+	if (busy)
+	    return;
+    }
+
+    if (alarm_was_ticking)
+    {
+	log(WvLog::Debug2, "Idle timeout.\n");
+	inbuf.zap();
+	nowrite();
+	noread();
+	return;
+    }
+
+    // pull in whatever has arrived
+    queuemin(0);
+    unsigned char *p = inbuf.alloc(READ_SIZE);
+    size_t len = uread(p, READ_SIZE);
+    inbuf.unalloc(READ_SIZE - len);
+
+    // answer as many requests as we can: more than one if they were
+    // pipelined, all into 'out', so they go out in one write()
+    in_execute = true;
+    while (!busy && isok() && !stop_read && parse_request())
+    {
+	busy = true;
+	alarm(-1);
+	server.requests++;
+	server.dispatch(*this, req);
+    }
+    in_execute = false;
+    flush_out();
+
+    // don't wake up again until there's more than a partial request
+    if (!busy)
+	queuemin(inbuf.used() + 1);
+}
+
+
+// Returns true if there's a whole request at the front of inbuf, which is
+// now in 'req'.  The body stays in inbuf, where req.body points, until the
+// response is done().
+bool WvHttpConn::parse_request()
+{
+    // skip the blank lines some clients send between requests
+    while (inbuf.used())
+    {
+	const char c = *(const char *)inbuf.peek(0, 1);
+	if (c != '\r' && c != '\n')
+	    break;
+	inbuf.skip(1);
+	scanned = need = 0;
+    }
+
+    size_t used = inbuf.used();
+    if (!used || used < need)
+	return false;
+
+    // look for the blank line at the end of the headers, picking up where
+    // we left off last time
+    const char *buf = (const char *)inbuf.peek(0, used);
+    size_t end = 0;
+    size_t i = scanned > 2 ? scanned - 2 : 0;
+    while (i < used)
+    {
+	const char *nl = (const char *)memchr(buf + i, '\n', used - i);
+	if (!nl)
+	    break;
+	i = nl - buf + 1;
+	if (i < used && buf[i] == '\n')
+	{
+	    end = i + 1;
+	    break;
+	}
+	if (i + 1 < used && buf[i] == '\r' && buf[i+1] == '\n')
+	{
+	    end = i + 2;
+	    break;
+	}
+    }
+
+    if (!end || end > server.max_header_size)
+    {
+	scanned = used;
+	if (used > server.max_header_size)
+	    fail(431);
+	return false;
+    }
+
+    if (!parse_head(end))
+	return false;
+
+    size_t body_len = 0;
+    const char *cl = req.header("Content-Length");
+    if (req.header("Transfer-Encoding"))
+    {
+	fail(411); // we don't take chunked uploads
+	return false;
+    }
+    else if (cl)
+    {
+	char *e;
+	unsigned long n = strtoul(cl, &e, 10);
+	if (*e || !*cl)
+	{
+	    fail(400);
+	    return false;
+	}
+	else if (n > server.max_body_size)
+	{
+	    fail(413);
+	    return false;
+	}
+	body_len = n;
+    }
+
+    if (used < end + body_len)
+    {
+	need = end + body_len;
+	return false;
+    }
+
+    req.body = body_len ? (const unsigned char *)inbuf.peek(end, body_len)
+			: (const unsigned char *)"";
+    req.body_len = body_len;
+    consumed = end + body_len;
+    scanned = need = 0;
+    return true;
+}
+
+
+// Copy the first 'len' bytes of inbuf (the request line and headers) and
+// chop them up into 'req', in place.
+bool WvHttpConn::parse_head(size_t len)
+{
+    if (head_size < len + 1)
+    {
+	delete[] head;
+	head_size = len + 1;
+	head = new char[head_size];
+    }
+    memcpy(head, inbuf.peek(0, len), len);
+    head[len] = 0;
+
+    memset(&req, 0, sizeof(req));
+    req.query = "";
+
+    // request line: METHOD target HTTP/x.y
+    char *line = head, *next = strchr(line, '\n');
+    *next++ = 0;
+    if (next - line > 1 && next[-2] == '\r')
+	next[-2] = 0;
+
+    req.method = line;
+    char *sp = strchr(line, ' ');
+    char *target = sp ? sp + 1 : NULL;
+    char *sp2 = target ? strchr(target, ' ') : NULL;
+    if (!sp || !sp2 || strchr(sp2 + 1, ' '))
+    {
+	fail(400);
+	return false;
+    }
+    *sp = *sp2 = 0;
+    req.path = target;
+    char *q = strchr(target, '?');
+    if (q)
+    {
+	*q = 0;
+	req.query = q + 1;
+    }
+
+    const char *version = sp2 + 1;
+    if (!strcmp(version, "HTTP/1.1"))
+	req.version = 11;
+    else if (!strcmp(version, "HTTP/1.0"))
+	req.version = 10;
+    else
+    {
+	fail(!strncmp(version, "HTTP/", 5) ? 505 : 400);
+	return false;
+    }
+
+    // headers: "Name: value", one per line, until the blank one
+    for (line = next; *line && *line != '\r' && *line != '\n'; line = next)
+    {
+	next = strchr(line, '\n');
+	*next++ = 0;
+	char *e = next - 1;
+	while (e > line && (e[-1] == '\r' || e[-1] == ' ' || e[-1] == '\t'))
+	    *--e = 0;
+
+	char *colon = strchr(line, ':');
+	if (req.nheaders >= WvHttpRequest::MaxHeaders)
+	{
+	    fail(431);
+	    return false;
+	}
+	else if (!colon || colon == line || *line == ' ' || *line == '\t')
+	{
+	    // no name, or an obsolete continuation line
+	    fail(400);
+	    return false;
+	}
+	*colon++ = 0;
+	while (*colon == ' ' || *colon == '\t')
+	    colon++;
+	req.headers[req.nheaders].name = line;
+	req.headers[req.nheaders].value = colon;
+	req.nheaders++;
+    }
+
+    const char *conn = req.header("Connection");
+    if (req.version >= 11)
+	req.keepalive = !has_token(conn, "close");
+    else
+	req.keepalive = has_token(conn, "keep-alive");
+    return true;
+}
+
+
+// Answer a request we couldn't make sense of, and hang up, since we can't
+// tell where the next one starts.
+void WvHttpConn::fail(int status)
+{
+    log(WvLog::Debug2, "Bad request: %s %s\n", status, status_text(status));
+    memset(&req, 0, sizeof(req));
+    req.query = "";
+    req.version = 10;
+    req.keepalive = false;
+    busy = true;
+    respond(status, "text/plain", WvString("%s\n", status_text(status)));
+}
+
+
+void WvHttpConn::send_head(int status, WvStringParm content_type,
+			   WvStringParm headers, long content_length)
+{
+    head_only = req.method && !strcmp(req.method, "HEAD");
+    out.putstr(WvString("HTTP/1.%s %s %s\r\n",
+			req.version >= 11 ? 1 : 0, status, status_text(status)));
+    if (!!content_type)
+	out.putstr(WvString("Content-Type: %s\r\n", content_type));
+    if (content_length >= 0)
+	out.putstr(WvString("Content-Length: %s\r\n", content_length));
+    else if (chunked)
+	out.putstr("Transfer-Encoding: chunked\r\n");
+    if (!req.keepalive)
+	out.putstr("Connection: close\r\n");
+    else if (req.version < 11)
+	out.putstr("Connection: keep-alive\r\n");
+    if (!!headers)
+	out.putstr(headers);
+    out.putstr("\r\n");
+}
+
+
+void WvHttpConn::respond(int status, WvStringParm content_type,
+			 WvStringParm body, WvStringParm headers)
+{
+    if (!busy)
+	return;
+    send_head(status, content_type, headers, body.len());
+    if (!head_only)
+	out.putstr(body);
+    done();
+}
+
+
+void WvHttpConn::respond(int status, WvStringParm content_type,
+			 WvBuf &body, WvStringParm headers)
+{
+    if (!busy)
+	return;
+    send_head(status, content_type, headers, body.used());
+    if (head_only)
+	body.zap();
+    else
+	out.merge(body);
+    done();
+}
+
+
+void WvHttpConn::start_response(int status, WvStringParm content_type,
+				WvStringParm headers)
+{
+    if (!busy)
+	return;
+
+    // without chunks, the only way to mark the end is to hang up
+    chunked = req.version >= 11;
+    if (!chunked)
+	req.keepalive = false;
+    send_head(status, content_type, headers, -1);
+    flush_out();
+}
+
+
+void WvHttpConn::put_chunk_size(size_t len)
+{
+    char buf[20];
+    int n = snprintf(buf, sizeof(buf), "%lx\r\n", (unsigned long)len);
+    out.put(buf, n);
+}
+
+
+void WvHttpConn::send(const void *data, size_t len)
+{
+    if (!busy || !len || head_only)
+	return;
+    if (chunked)
+	put_chunk_size(len);
+    out.put(data, len);
+    if (chunked)
+	out.putstr("\r\n");
+    flush_out();
+}
+
+
+void WvHttpConn::send(WvBuf &buf)
+{
+    size_t len = buf.used();
+    if (!busy || !len || head_only)
+    {
+	buf.zap();
+	return;
+    }
+    if (chunked)
+	put_chunk_size(len);
+    out.merge(buf);
+    if (chunked)
+	out.putstr("\r\n");
+    flush_out();
+}
+
+
+void WvHttpConn::end_response()
+{
+    if (!busy)
+	return;
+    if (chunked && !head_only)
+	out.putstr("0\r\n\r\n");
+    done();
+}
+
+
+// The current response is finished; get ready for the next request.
+void WvHttpConn::done()
+{
+    busy = chunked = head_only = false;
+    producer = 0;
+    inbuf.skip(consumed);
+    consumed = 0;
+    if (!req.keepalive)
+    {
+	// hang up once it's all sent
+	write(out, out.used());
+	inbuf.zap();
+	nowrite();
+	noread();
+	return;
+    }
+
+    alarm(server.idle_timeout);
+    flush_out();
+
+    // there might be another request waiting in inbuf already
+    queuemin(0);
+}
+
+
+// Write everything in 'out' at once, unless we're in the middle of
+// execute(), which does it at the end.
+void WvHttpConn::flush_out()
+{
+    if (!in_execute && out.used())
+	write(out, out.used());
+}
+
+
+WvHttpServer::WvHttpServer() : log("HTTP Server", WvLog::Debug)
+{
+    max_header_size = 16384;
+    max_body_size = 1024*1024;
+    idle_timeout = 15000;
+    connections = requests = 0;
+}
+
+
+WvHttpServer::~WvHttpServer()
+{
+    zap();
+}
+
+
+IWvListener *WvHttpServer::listen(WvStringParm moniker)
+{
+    IWvListener *l = IWvListener::create(moniker);
+    if (!l->isok())
+	log(WvLog::Error, "Can't listen on %s: %s\n", moniker, l->errstr());
+    else
+	log(WvLog::Info, "Listening on %s.\n", *l->src());
+    l->onaccept(wv::bind(&WvHttpServer::accept_conn, this, _1));
+    append(l, true, "http listener");
+    return l;
+}
+
+
+void WvHttpServer::accept_conn(IWvStream *s)
+{
+    connections++;
+    append(new WvHttpConn(s, *this), true, "http conn");
+}
+
+
+void WvHttpServer::route(WvStringParm path, Handler handler)
+{
+    routes.append(new Route(path, handler), true);
+}
+
+
+void WvHttpServer::dispatch(WvHttpConn &conn, const WvHttpRequest &req)
+{
+    log(WvLog::Debug3, "%s %s\n", req.method, req.path);
+
+    Route *best = NULL;
+    size_t best_len = 0;
+    size_t pathlen = strlen(req.path);
+    RouteList::Iter i(routes);
+    for (i.rewind(); i.next(); )
+    {
+	size_t len = i->path.len();
+	if (len < best_len && best)
+	    continue;
+	if (len == pathlen && !strcmp(i->path, req.path))
+	{
+	    best = i.ptr();
+	    break; // can't do better than an exact match
+	}
+	if (len && i->path[len - 1] == '/' && len <= pathlen
+	    && !strncmp(i->path, req.path, len) && len > best_len)
+	{
+	    best = i.ptr();
+	    best_len = len;
+	}
+    }
+
+    if (best)
+	best->handler(conn, req);
+    else
+	conn.respond(404, "text/plain", "Not Found\n");
+}
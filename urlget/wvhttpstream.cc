@@ -15,6 +15,14 @@
 #ifdef HAVE_EXECINFO_H
 #include <execinfo.h> // FIXME: add a WvCrash feature for explicit dumps
 #endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#include <errno.h>
 
 #ifdef _WIN32
 #define ETIMEDOUT WSAETIMEDOUT
@@ -23,6 +31,7 @@
 #define CONNECT_TIMEOUT 120000
 #define ACTIVITY_TIMEOUT 900000
 #define IDLE_TIMEOUT 5000
+#define BODY_READ 65536
 
 
 WvHttpStream::WvHttpStream(const WvIPPortAddr &_remaddr, WvStringParm _username,
@@ -38,6 +47,8 @@ WvHttpStream::WvHttpStream(const WvIPPortAddr &_remaddr, WvStringParm _username,
     in_chunk_trailer = false;
     pipeline_test_count = 0;
     last_was_pipeline_test = false;
+    idle_timeout = IDLE_TIMEOUT;
+    splice_pipe[0] = splice_pipe[1] = -1;
 
     enable_pipelining = global_enable_pipelining 
         && !pipeline_incompatible[target.remaddr];
@@ -45,7 +56,13 @@ WvHttpStream::WvHttpStream(const WvIPPortAddr &_remaddr, WvStringParm _username,
     ssl = _ssl;
 
     if (ssl)
-        cloned = new WvSSLStream(static_cast<WvFDStream*>(cloned));
+    {
+        // reconnecting to the same server can resume the last session
+        WvSSLStream *sslstream
+            = new WvSSLStream(static_cast<WvFDStream*>(cloned));
+        sslstream->set_session_key((WvString)_remaddr);
+        cloned = sslstream;
+    }
 
     sent_url_request = false;
 
@@ -59,6 +76,11 @@ WvHttpStream::~WvHttpStream()
     if (geterr())
         log(WvLog::Debug4, "Error was: %s\n", errstr());
     close();
+    if (splice_pipe[0] >= 0)
+    {
+	::close(splice_pipe[0]);
+	::close(splice_pipe[1]);
+    }
 }
 
 
@@ -162,6 +184,131 @@ void WvHttpStream::doneurl()
 }
 
 
+// Hand up to 'max' bytes of the current body to its outstream (or its
+// body_fd), reading them straight from the connection if we don't have any
+// already.  Whole buffers are moved, not copied.  Returns the number of
+// bytes handled; check isok() if it's zero.
+size_t WvHttpStream::pass_body(size_t max)
+{
+    WvBufUrlStream *outstream = curl ? curl->outstream : NULL;
+    size_t len;
+
+    if (!inbuf.used())
+    {
+	if (outstream && outstream->body_fd >= 0
+	    && splice_body(outstream, max, len))
+	    return len;
+
+	// read into our own buffer, which we can then give away
+	len = max < BODY_READ ? max : BODY_READ;
+	unsigned char *p = inbuf.alloc(len);
+	inbuf.unalloc(len - uread(p, len));
+	if (!isok())
+	    return 0;
+    }
+
+    len = inbuf.used() < max ? inbuf.used() : max;
+    write_body(outstream, len);
+    return len;
+}
+
+
+#ifdef SPLICE_F_MOVE
+// splice() only writes to a regular file opened without O_APPEND, and if
+// the file is nonblocking it might give up halfway.
+static bool can_splice_to(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    struct stat st;
+    return flags >= 0 && !(flags & (O_APPEND | O_NONBLOCK))
+	&& fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+}
+#endif
+
+
+// Move up to 'max' bytes from the socket to outstream->body_fd through a
+// pipe, so they never come into userspace.  Returns false if that can't
+// be done, and we should read and write them ourselves.
+bool WvHttpStream::splice_body(WvBufUrlStream *outstream, size_t max,
+			       size_t &len)
+{
+    len = 0;
+#ifdef SPLICE_F_MOVE
+    // SSL needs decrypting, and an error means it's not going to work
+    if (ssl || outstream->geterr() || !cloned
+	|| !can_splice_to(outstream->body_fd))
+	return false;
+    if (splice_pipe[0] < 0 && pipe(splice_pipe) < 0)
+	return false;
+
+    ssize_t in = splice(cloned->getrfd(), NULL, splice_pipe[1], NULL,
+			max < BODY_READ ? max : BODY_READ,
+			SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (in < 0 && (errno == EAGAIN || errno == EINTR))
+	return true; // nothing there yet
+    else if (in <= 0)
+	return false; // let uread() find the EOF or error
+
+    len = in;
+    while (in > 0)
+    {
+	ssize_t out = splice(splice_pipe[0], NULL, outstream->body_fd, NULL,
+			     in, SPLICE_F_MOVE);
+	if (out < 0 && errno == EINTR)
+	    continue;
+	else if (out <= 0)
+	{
+	    // the data's already off the socket, so get it back out of the
+	    // pipe and let write_body() deal with it (and with the error,
+	    // if it's a real one)
+	    unsigned char *p = inbuf.alloc(in);
+	    ssize_t got = 0, r;
+	    while (got < in
+		   && ((r = ::read(splice_pipe[0], p + got, in - got)) > 0
+		       || (r < 0 && errno == EINTR)))
+		got += (r > 0 ? r : 0);
+	    inbuf.unalloc(in - got);
+	    write_body(outstream, got);
+	    break;
+	}
+	in -= out;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+// Give the first 'len' bytes of inbuf to outstream, or write them to its
+// body_fd, or throw them away if nobody wants them anymore.
+void WvHttpStream::write_body(WvBufUrlStream *outstream, size_t len)
+{
+    if (!outstream)
+	inbuf.skip(len);
+    else if (outstream->body_fd < 0)
+	outstream->merge(inbuf, len);
+    else
+    {
+	while (len && !outstream->geterr())
+	{
+	    size_t avail = inbuf.optgettable();
+	    if (avail > len)
+		avail = len;
+	    const unsigned char *p = inbuf.get(avail);
+	    int out = ::write(outstream->body_fd, p, avail);
+	    if (out < 0 && errno == EINTR)
+		out = 0;
+	    else if (out <= 0)
+		outstream->seterr(out < 0 ? errno : EIO);
+	    inbuf.unget(avail - (out > 0 ? out : 0));
+	    len -= (out > 0 ? out : 0);
+	}
+	inbuf.skip(len);
+    }
+}
+
+
 static WvString encode64(WvStringParm user, WvStringParm password)
 {
     WvBase64Encoder encoder;
@@ -406,9 +553,9 @@ void WvHttpStream::execute()
 
     if (!curl)
     {
-        // in the header section
-        line = getline();
-        if (line)
+        // in the header section: take all the lines we already have, not
+        // just one per callback
+        while (!curl && isok() && (line = getline()) != NULL)
         {
             line = trim_string(line);
             log(WvLog::Debug4, "#%s Header: '%s'\n", done_count+1, line);
@@ -623,14 +770,12 @@ void WvHttpStream::execute()
         // just read data until the connection closes, and assume all was
         // well.  It sucks, but there's no way to tell if all the data arrived
         // okay... that's why Chunked or ContentLength encoding is better.
-        len = read(buf, sizeof(buf));
+        len = pass_body(BODY_READ);
 	if (!isok())
 	    return;
 
         if (len)
             log(WvLog::Debug5, "Rcv infinity: read %s bytes.\n", len);
-        if (curl && curl->outstream)
-            curl->outstream->write(buf, len);
 
         if (!isok() && curl)
             doneurl();
@@ -640,10 +785,7 @@ void WvHttpStream::execute()
         // in the data section of a chunked or content-length encoding,
         // with 'bytes_remaining' bytes of data left.
 
-        if (bytes_remaining > sizeof(buf))
-            len = read(buf, sizeof(buf));
-        else
-            len = read(buf, bytes_remaining);
+        len = pass_body(bytes_remaining);
 	if (!isok())
 	    return;
 
@@ -651,8 +793,6 @@ void WvHttpStream::execute()
         if (len)
             log(WvLog::Debug5, 
                     "Read %s bytes (%s bytes left).\n", len, bytes_remaining);
-        if (curl && curl->outstream)
-            curl->outstream->write(buf, len);
 
         if (!bytes_remaining && encoding == ContentLength && curl)
             doneurl();
@@ -665,7 +805,7 @@ void WvHttpStream::execute()
     }
 
     if (urls.isempty())
-        alarm(IDLE_TIMEOUT);
+        alarm(idle_timeout);
     else
         alarm(ACTIVITY_TIMEOUT);
 }
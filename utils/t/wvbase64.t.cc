@@ -550,3 +550,85 @@ WVTEST_MAIN("resetting")
     }
 
 }
+
+
+// the obvious way to do it, to check the fast ways against
+static WvString slow_base64(const unsigned char *p, size_t len)
+{
+    static const char alpha[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    WvDynBuf out;
+    for (size_t i = 0; i < len; i += 3)
+    {
+	unsigned int bits = p[i] << 16;
+	if (i + 1 < len)
+	    bits |= p[i+1] << 8;
+	if (i + 2 < len)
+	    bits |= p[i+2];
+	out.putch(alpha[bits >> 18]);
+	out.putch(alpha[(bits >> 12) & 0x3f]);
+	out.putch(i + 1 < len ? alpha[(bits >> 6) & 0x3f] : '=');
+	out.putch(i + 2 < len ? alpha[bits & 0x3f] : '=');
+    }
+    return out.getstr();
+}
+
+
+WVTEST_MAIN("big blocks")
+{
+    srandom(42);
+    unsigned char data[5000];
+    for (size_t i = 0; i < sizeof(data); i++)
+	data[i] = random();
+
+    // every length around the sizes the block encoders work in, and some
+    // bigger ones; streamed in in odd-sized pieces
+    for (size_t len = 0; len < sizeof(data); len += len < 100 ? 1 : 97)
+    {
+	WvString want = slow_base64(data, len);
+	WvBase64Encoder enc;
+	WvDynBuf in, out;
+	for (size_t i = 0; i < len; i += 1000)
+	{
+	    in.put(data + i, len - i < 1000 ? len - i : 1000);
+	    enc.encode(in, out);
+	}
+	enc.finish(out);
+	WvString got = out.getstr();
+	WVPASS(got == want);
+
+	WvBase64Decoder dec;
+	in.putstr(got);
+	dec.flush(in, out);
+	if (out.used() != len || memcmp(out.get(len), data, len))
+	    WVFAIL(len);
+	out.zap();
+    }
+
+    // line breaks and bad characters anywhere in the input
+    WvString enc(slow_base64(data, 3000));
+    for (size_t pos = 0; pos < 200; pos += 3)
+    {
+	WvDynBuf in, out;
+	WvString wrapped;
+	for (size_t i = 0; i < enc.len(); i += 64 + pos % 16)
+	{
+	    in.put(enc.cstr() + i, enc.len() - i < 64 + pos % 16
+		   ? enc.len() - i : 64 + pos % 16);
+	    in.putstr("\r\n");
+	}
+	WvBase64Decoder dec;
+	WVPASS(dec.flush(in, out));
+	WVPASSEQ(out.used(), 3000);
+	WVPASS(!memcmp(out.get(3000), data, 3000));
+
+	WvString bad(enc);
+	bad.edit()[pos * 5] = pos & 1 ? '*' : '\xc1';
+	WvBase64Decoder dec2;
+	in.putstr(bad);
+	WVFAIL(dec2.flush(in, out));
+	WVFAIL(dec2.isok());
+	WVPASSEQ(out.used(), pos * 5 / 4 * 3 + (pos * 5 % 4 ? pos * 5 % 4 - 1 : 0));
+	out.zap();
+    }
+}
@@ -230,3 +230,195 @@ WVTEST_MAIN("severe compression errors")
     if (!gzipinf.isok())
         wvcon->print("GzipEncoder error: %s\n", gzipinf.geterror());
 }
+
+
+// some text that compresses about as well as real text does
+static WvString some_text(int lines)
+{
+    WvString s("");
+    for (int i = 0; i < lines; i++)
+        s.append("line %s: the quick brown fox jumps over %s lazy dogs\n",
+                 i, i * 7919 % 1000);
+    return s;
+}
+
+
+static WvString roundtrip(WvGzipEncoder &zip, WvGzipEncoder &unzip,
+                          WvStringParm s, size_t *zipped_size = NULL)
+{
+    WvDynBuf in, zipped, out;
+    in.putstr(s);
+    zip.flush(in, zipped, true);
+    if (zipped_size)
+        *zipped_size = zipped.used();
+    unzip.flush(zipped, out, true);
+    return out.getstr();
+}
+
+
+WVTEST_MAIN("wvgzip levels and formats")
+{
+    WvString text(some_text(2000));
+    size_t fast_size, best_size, raw_size, gzip_size;
+
+    WvGzipEncoder fast(WvGzipEncoder::Deflate);
+    WvGzipEncoder unfast(WvGzipEncoder::Inflate);
+    WVPASS(roundtrip(fast, unfast, text, &fast_size) == text);
+
+    WvGzipEncoder best(WvGzipEncoder::Deflate, 9);
+    WvGzipEncoder unbest(WvGzipEncoder::Inflate);
+    WVPASS(roundtrip(best, unbest, text, &best_size) == text);
+    WVPASS(best_size < fast_size);
+
+    // raw has no header or checksum at all, and gzip has a bigger one
+    WvGzipEncoder raw(WvGzipEncoder::Deflate, 9, WvGzipEncoder::Raw);
+    WvGzipEncoder unraw(WvGzipEncoder::Inflate, 0, WvGzipEncoder::Raw);
+    WVPASS(roundtrip(raw, unraw, text, &raw_size) == text);
+    WVPASSEQ(raw_size, best_size - 6);
+
+    WvGzipEncoder gzip(WvGzipEncoder::Deflate, 9, WvGzipEncoder::Gzip);
+    WvDynBuf in, zipped, out;
+    in.putstr(text);
+    gzip.flush(in, zipped, true);
+    gzip_size = zipped.used();
+    WVPASSEQ(gzip_size, raw_size + 18);
+    WVPASSEQ(zipped.peek(0, 1)[0], 0x1f);
+    WVPASSEQ(zipped.peek(1, 1)[0], 0x8b);
+
+    // Auto can tell the difference
+    WvGzipEncoder autogz(WvGzipEncoder::Inflate, 0, WvGzipEncoder::Auto);
+    autogz.flush(zipped, out, true);
+    WVPASS(out.getstr() == text);
+    WvGzipEncoder autozlib(WvGzipEncoder::Inflate, 0, WvGzipEncoder::Auto);
+    WvGzipEncoder zlib(WvGzipEncoder::Deflate, 9, WvGzipEncoder::Zlib,
+                       WvGzipEncoder::Filtered, 10, 9);
+    WVPASS(roundtrip(zlib, autozlib, text) == text);
+
+    // changing the level as we go
+    WvGzipEncoder changing(WvGzipEncoder::Deflate, 0);
+    WvGzipEncoder unchanging(WvGzipEncoder::Inflate);
+    in.putstr(text);
+    changing.encode(in, zipped);
+    WVPASS(changing.set_level(9));
+    in.putstr(text);
+    changing.encode(in, zipped);
+    WVPASS(changing.set_level(1, WvGzipEncoder::HuffmanOnly));
+    in.putstr(text);
+    changing.flush(in, zipped, true);
+    WVPASS(zipped.used() > text.len());
+    WVPASS(zipped.used() < text.len() * 2);
+    unchanging.flush(zipped, out, true);
+    WVPASS(out.getstr() == WvString("%s%s%s", text, text, text));
+    WVFAIL(changing.set_level(10));
+
+    // if there's no room to finish off the old level, try again later
+    WvGzipEncoder cramped(WvGzipEncoder::Deflate, 1);
+    WvString noise = some_text(2000);
+    in.putstr(noise);
+    cramped.encode(in, zipped);
+    WVPASS(cramped.set_level(9));
+    unsigned char small[16];
+    WvInPlaceBuf full(small, sizeof(small), sizeof(small));
+    in.putstr(noise);
+    WVFAIL(cramped.encode(in, full));
+    WVPASS(cramped.isok());
+    WVPASSEQ(in.used(), noise.len());
+    WVPASSEQ(full.used(), sizeof(small));
+    cramped.flush(in, zipped, true);
+    WVPASS(cramped.isok());
+    WVPASSEQ(in.used(), 0);
+    unchanging.reset();
+    unchanging.flush(zipped, out, true);
+    WVPASS(out.getstr() == WvString("%s%s", noise, noise));
+
+    // and the same for finishing
+    WvGzipEncoder ending(WvGzipEncoder::Deflate, 9);
+    in.putstr(noise);
+    ending.encode(in, zipped);
+    int tries;
+    for (tries = 0; tries < 100000; tries++)
+    {
+        WvInPlaceBuf out16(small, 0, sizeof(small));
+        bool done = ending.finish(out16);
+        zipped.put(out16.get(out16.used()), out16.used());
+        if (done || !ending.isok() || ending.isfinished())
+            break;
+    }
+    WVPASS(tries > 0);
+    WVPASS(ending.isfinished());
+    unchanging.reset();
+    unchanging.flush(zipped, out, true);
+    WVPASS(out.getstr() == noise);
+}
+
+
+WVTEST_MAIN("wvgzip dictionaries")
+{
+    WvString dict("\"status\": \"version\": \"hostname\": \"uptime\": "
+                  "\"load\": [ ], \"memory\": { \"free\": \"used\": }");
+    WvString msg("{ \"hostname\": \"foo\", \"status\": \"ok\", "
+                 "\"uptime\": 12345, \"memory\": { \"free\": 100 } }");
+    size_t plain_size, dict_size, raw_size;
+
+    WvGzipEncoder plain(WvGzipEncoder::Deflate, 9);
+    WvGzipEncoder unplain(WvGzipEncoder::Inflate);
+    WVPASS(roundtrip(plain, unplain, msg, &plain_size) == msg);
+
+    // zlib inflate asks for the dictionary when it gets to it
+    WvGzipEncoder zip(WvGzipEncoder::Deflate, 9);
+    WvGzipEncoder unzip(WvGzipEncoder::Inflate);
+    WVPASS(zip.set_dictionary(dict.cstr(), dict.len()));
+    WVPASS(unzip.set_dictionary(dict.cstr(), dict.len()));
+    WVPASS(roundtrip(zip, unzip, msg, &dict_size) == msg);
+    WVPASS(dict_size < plain_size * 2 / 3);
+
+    // ...and it's used again after a reset
+    for (int i = 0; i < 3; i++)
+    {
+        WVPASS(zip.reset());
+        WVPASS(unzip.reset());
+        WVPASS(roundtrip(zip, unzip, msg) == msg);
+    }
+
+    // raw inflate doesn't know it needs one, so it has to be set up front
+    WvGzipEncoder rawzip(WvGzipEncoder::Deflate, 9, WvGzipEncoder::Raw);
+    WvGzipEncoder rawunzip(WvGzipEncoder::Inflate, 0, WvGzipEncoder::Raw);
+    WVPASS(rawzip.set_dictionary(dict.cstr(), dict.len()));
+    WVPASS(rawunzip.set_dictionary(dict.cstr(), dict.len()));
+    WVPASS(roundtrip(rawzip, rawunzip, msg, &raw_size) == msg);
+    WVPASSEQ(raw_size, dict_size - 10);
+
+    // without it, zlib inflate gives up
+    WvGzipEncoder zip2(WvGzipEncoder::Deflate, 9);
+    WvGzipEncoder nodict(WvGzipEncoder::Inflate);
+    zip2.set_dictionary(dict.cstr(), dict.len());
+    WVPASS(roundtrip(zip2, nodict, msg) == "");
+    WVFAIL(nodict.isok());
+    WVPASS(strstr(nodict.geterror(), "dictionary"));
+}
+
+
+WVTEST_MAIN("wvgzip into a fixed-size buffer")
+{
+    // there's no temporary buffer any more, so make sure we stop when the
+    // output buffer is full, and carry on when there's room again
+    WvString text(some_text(500));
+    WvDynBuf in, zipped;
+    in.putstr(text);
+    WvGzipEncoder zip(WvGzipEncoder::Deflate, 6);
+    zip.flush(in, zipped, true);
+
+    WvGzipEncoder unzip(WvGzipEncoder::Inflate);
+    WvString got("");
+    unsigned char mem[1000];
+    while (zipped.used() || !unzip.isfinished())
+    {
+        WvInPlaceBuf out(mem, 0, sizeof(mem));
+        WVPASS(unzip.encode(zipped, out, true));
+        if (!out.used())
+            break;
+        WVPASS(out.used() <= sizeof(mem));
+        got.append(out.getstr());
+    }
+    WVPASS(got == text);
+}
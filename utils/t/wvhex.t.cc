@@ -786,3 +786,61 @@ WVTEST_MAIN("resetting")
 
 }
 
+
+
+WVTEST_MAIN("big blocks")
+{
+    srandom(42);
+    unsigned char data[1000];
+    for (size_t i = 0; i < sizeof(data); i++)
+	data[i] = random();
+
+    for (size_t len = 0; len < sizeof(data); len += len < 100 ? 1 : 37)
+    {
+	WvHexEncoder enc(len & 1);
+	WvDynBuf in, out;
+	in.put(data, len);
+	enc.flush(in, out);
+	WVPASSEQ(out.used(), len * 2);
+	const char *got = (const char *)out.peek(0, len * 2);
+	bool same = true;
+	for (size_t i = 0; i < len; i++)
+	{
+	    char want[3];
+	    snprintf(want, sizeof(want), len & 1 ? "%02X" : "%02x", data[i]);
+	    if (got[i*2] != want[0] || got[i*2+1] != want[1])
+		same = false;
+	}
+	WVPASS(same);
+
+	WvHexDecoder dec;
+	dec.flush(out, in);
+	WVPASSEQ(in.used(), len);
+	WVPASS(!memcmp(in.get(len), data, len));
+    }
+
+    // spaces and bad characters anywhere in the input
+    WvString hex(WvHexEncoder().strflushmem(data, sizeof(data)));
+    for (size_t pos = 0; pos < 200; pos += 3)
+    {
+	WvDynBuf in, out;
+	for (size_t i = 0; i < hex.len(); i += 2 * pos + 2)
+	{
+	    in.put(hex.cstr() + i, hex.len() - i < 2 * pos + 2
+		   ? hex.len() - i : 2 * pos + 2);
+	    in.putstr(" \n");
+	}
+	WvHexDecoder dec;
+	WVPASS(dec.flush(in, out));
+	WVPASSEQ(out.used(), sizeof(data));
+	WVPASS(!memcmp(out.get(sizeof(data)), data, sizeof(data)));
+
+	WvString bad(hex);
+	bad.edit()[pos * 7] = pos & 1 ? 'g' : '\xc1';
+	WvHexDecoder dec2;
+	in.putstr(bad);
+	WVFAIL(dec2.flush(in, out));
+	WVFAIL(dec2.isok());
+	WVPASSEQ(out.used(), pos * 7 / 2);
+    }
+}
@@ -0,0 +1,151 @@
+#include "wvtest.h"
+#include "wvlz4.h"
+#include "wvautoconf.h"
+
+#if defined(HAVE_LZ4FRAME_H) && defined(HAVE_LIBLZ4)
+
+static WvString some_text(int lines)
+{
+    WvString s("");
+    for (int i = 0; i < lines; i++)
+        s.append("line %s: the quick brown fox jumps over %s lazy dogs\n",
+                 i, i * 7919 % 1000);
+    return s;
+}
+
+
+WVTEST_MAIN("wvlz4 encode + decode")
+{
+    WvString text(some_text(5000));
+    WvDynBuf in, zipped, out;
+
+    for (int level = -1; level <= 9; level += 5)
+    {
+        WvLz4Encoder zip(WvLz4Encoder::Compress, level);
+        WvLz4Encoder unzip(WvLz4Encoder::Decompress);
+        in.putstr(text);
+        WVPASS(zip.flush(in, zipped, true));
+        WVPASSEQ(in.used(), 0);
+        WVPASS(zipped.used() < text.len() / 3);
+        WVPASS(unzip.flush(zipped, out));
+        WVPASS(unzip.isfinished());
+        WVPASS(out.getstr() == text);
+    }
+
+    // nothing at all is fine too
+    WvLz4Encoder zip(WvLz4Encoder::Compress);
+    WvLz4Encoder unzip(WvLz4Encoder::Decompress);
+    WVPASS(zip.finish(zipped));
+    WVPASS(zipped.used() > 0);
+    WVPASS(unzip.flush(zipped, out));
+    WVPASS(unzip.isfinished());
+    WVPASSEQ(out.used(), 0);
+}
+
+
+WVTEST_MAIN("wvlz4 flush")
+{
+    // everything up to each flush comes out the other end right away
+    WvLz4Encoder zip(WvLz4Encoder::Compress);
+    WvLz4Encoder unzip(WvLz4Encoder::Decompress);
+    WvDynBuf in, zipped, out;
+    for (int i = 0; i < 100; i++)
+    {
+        WvString line("message %s\n", i);
+        in.putstr(line);
+        WVPASS(zip.flush(in, zipped));
+        WVPASS(unzip.flush(zipped, out));
+        WVPASSEQ(out.getstr(), line);
+        WVFAIL(unzip.isfinished());
+    }
+
+    // without a flush, it waits for more
+    in.putstr("x");
+    WVPASS(zip.encode(in, zipped));
+    WVPASSEQ(in.used(), 0);
+    WVPASS(unzip.flush(zipped, out));
+    WVPASSEQ(out.used(), 0);
+    WVPASS(zip.finish(zipped));
+    WVPASS(unzip.flush(zipped, out));
+    WVPASSEQ(out.getstr(), "x");
+    WVPASS(unzip.isfinished());
+
+    // a new frame after a reset
+    WVPASS(zip.reset());
+    WVPASS(unzip.reset());
+    in.putstr("again");
+    WVPASS(zip.flush(in, zipped, true));
+    WVPASS(unzip.flush(zipped, out));
+    WVPASSEQ(out.getstr(), "again");
+    WVPASS(unzip.isfinished());
+}
+
+
+WVTEST_MAIN("wvlz4 errors and small buffers")
+{
+    WvString text(some_text(500));
+    WvLz4Encoder zip(WvLz4Encoder::Compress);
+    WvDynBuf in, zipped;
+    in.putstr(text);
+    zip.flush(in, zipped, true);
+
+    // decompress into a small fixed buffer, a bit at a time
+    WvLz4Encoder unzip(WvLz4Encoder::Decompress);
+    WvDynBuf copy;
+    copy.put(zipped.peek(0, zipped.used()), zipped.used());
+    WvString got("");
+    unsigned char mem[1000];
+    while (!unzip.isfinished())
+    {
+        WvInPlaceBuf out(mem, 0, sizeof(mem));
+        WVPASS(unzip.encode(copy, out));
+        if (!out.used())
+            break;
+        got.append(out.getstr());
+    }
+    WVPASS(got == text);
+
+    // the checksum catches damage
+    WvLz4Encoder broken(WvLz4Encoder::Decompress);
+    WvDynBuf out;
+    unsigned char *p = (unsigned char *)zipped.mutablepeek(100, 1);
+    *p ^= 0x55;
+    WVFAIL(broken.flush(zipped, out));
+    WVFAIL(broken.isok());
+    WVPASS(strstr(broken.geterror(), "LZ4"));
+}
+
+
+WVTEST_MAIN("wvlz4 finish into a small buffer")
+{
+    WvString text(some_text(500));
+    WvLz4Encoder zip(WvLz4Encoder::Compress);
+    WvDynBuf in, zipped;
+    in.putstr(text);
+    zip.encode(in, zipped);
+
+    // not enough room to finish is not an error; try again with more
+    unsigned char mem[16];
+    WvInPlaceBuf small(mem, 0, sizeof(mem));
+    WVFAIL(zip.finish(small));
+    WVPASSEQ(small.used(), 0);
+    WVPASS(zip.isok());
+    WVFAIL(zip.isfinished());
+    WVPASS(zip.finish(zipped));
+    WVPASS(zip.isfinished());
+
+    WvLz4Encoder unzip(WvLz4Encoder::Decompress);
+    WvDynBuf out;
+    WVPASS(unzip.flush(zipped, out));
+    WVPASS(out.getstr() == text);
+}
+
+#else
+
+WVTEST_MAIN("wvlz4 without liblz4")
+{
+    WvLz4Encoder zip(WvLz4Encoder::Compress);
+    WVFAIL(zip.isok());
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include "wvsubproc.h"
+#include "wvtimeutils.h"
+#include "wvtest.h"
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+static bool readable(int fd, int msec)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, msec) > 0;
+}
+
+
+WVTEST_MAIN("exitfd")
+{
+    WvSubProc proc;
+    WVPASSEQ(proc.exitfd(), -1);
+    
+    proc.start("sleep", "sleep", "1", NULL);
+    int fd = proc.exitfd();
+    WVPASS(fd >= 0);
+    WVFAIL(readable(fd, 0));
+    
+    WvTime start = wvtime();
+    WVPASS(readable(fd, 5000));
+    WVPASS(msecdiff(wvtime(), start) < 3000);
+    proc.wait(0);
+    WVFAIL(proc.running);
+    WVPASSEQ(proc.exitfd(), -1);
+    
+    // wait() doesn't wait any longer than it has to
+    proc.start("sleep", "sleep", "0.2", NULL);
+    start = wvtime();
+    proc.wait(5000);
+    WVFAIL(proc.running);
+    WVPASS(msecdiff(wvtime(), start) < 3000);
+}
+
+
+WVTEST_MAIN("exitfd without pidfds")
+{
+    WvSubProc::use_pidfd = false;
+    
+    WvSubProc p1, p2;
+    p1.start("true", "true", NULL);
+    p2.start("sleep", "sleep", "1", NULL);
+    int fd = p1.exitfd();
+    WVPASS(fd >= 0);
+    WVPASSEQ(p2.exitfd(), fd); // it's the shared signalfd
+    
+    unsigned long events = WvSubProc::sigchld_events();
+    while (events == WvSubProc::sigchld_events() && readable(fd, 5000))
+	;
+    WVPASS(WvSubProc::sigchld_events() != events);
+    p1.wait(0);
+    WVFAIL(p1.running);
+    WVPASSEQ(p1.exitfd(), -1);
+    WVPASS(p2.running);
+    p2.wait(-1);
+    WVFAIL(p2.running);
+    
+    // nobody's using the signalfd now, so SIGCHLD is back to normal
+    WvSubProc::use_pidfd = true;
+    sigset_t ss;
+    sigprocmask(SIG_BLOCK, NULL, &ss);
+    WVFAIL(sigismember(&ss, SIGCHLD));
+}
+
+
+// runs "sh -c script" and returns what it printed, with spawn or fork
+static WvString run_sh(WvSubProc &proc, const char *script, bool spawn)
+{
+    int fds[2];
+    if (pipe(fds) < 0)
+	return WvString::null;
+    
+    WvSubProc::use_spawn = spawn;
+    WvString cmd("exec >&%s; %s", fds[1], script);
+    proc.start("sh", "sh", "-c", cmd.cstr(), NULL);
+    WvSubProc::use_spawn = true;
+    close(fds[1]);
+    
+    char buf[1024];
+    size_t used = 0;
+    ssize_t len;
+    while (used < sizeof(buf) - 1
+	   && (len = read(fds[0], buf + used, sizeof(buf) - 1 - used)) > 0)
+	used += len;
+    buf[used] = 0;
+    close(fds[0]);
+    proc.wait(-1);
+    return buf;
+}
+
+
+WVTEST_MAIN("spawn and fork do the same thing")
+{
+    setenv("LD_LIBRARY_PATH", "/old/lib", 1);
+    setenv("WVTEST_UNSET", "here", 1);
+    unsetenv("LD_PRELOAD");
+    
+    for (int spawn = 0; spawn < 2; spawn++)
+    {
+	WvSubProc proc;
+	proc.env.append("LD_LIBRARY_PATH=/new/lib");
+	proc.env.append("LD_PRELOAD=/new/preload.so");
+	proc.env.append("WVTEST_NEW=a=b");
+	proc.env.append("WVTEST_UNSET");
+	WVPASSEQ(run_sh(proc, "echo $LD_LIBRARY_PATH $LD_PRELOAD $WVTEST_NEW"
+			" ${WVTEST_UNSET-unset}", spawn),
+		 "/new/lib:/old/lib /new/preload.so a=b unset\n");
+	
+	// its own process group, whose leader is the process itself
+	WVPASSEQ(run_sh(proc, "set -- $(cat /proc/$$/stat); echo $(($5 - $$))",
+			spawn), "0\n");
+	
+	// programs that aren't there exit with 242
+	proc.start("/nonexistent/program", "program", NULL);
+	WVPASS(proc.running);
+	proc.wait(-1);
+	WVPASS(WIFEXITED(proc.estatus));
+	WVPASSEQ(WEXITSTATUS(proc.estatus), 242);
+    }
+    
+    // we never touched our own environment
+    WVPASSEQ(getenv("LD_LIBRARY_PATH"), "/old/lib");
+    WVPASSEQ(getenv("WVTEST_UNSET"), "here");
+    WVFAIL(getenv("WVTEST_NEW"));
+    unsetenv("LD_LIBRARY_PATH");
+    unsetenv("WVTEST_UNSET");
+}
+
+
+WVTEST_MAIN("spawn searches the new PATH, like fork does")
+{
+    WvString dir("/tmp/wvtest-wvsubproc-%s", getpid());
+    WvString prog("%s/wvtest-exit7", dir);
+    WVPASS(mkdir(dir, 0700) == 0);
+    FILE *f = fopen(prog, "w");
+    WVPASS(f);
+    fputs("#!/bin/sh\nexit 7\n", f);
+    fclose(f);
+    WVPASS(chmod(prog, 0700) == 0);
+    
+    for (int spawn = 0; spawn < 2; spawn++)
+    {
+	WvSubProc::use_spawn = spawn;
+	
+	// only in the child's PATH
+	WvSubProc p1;
+	p1.env.append(WvString("PATH=%s:/bin:/usr/bin", dir));
+	p1.start("wvtest-exit7", "wvtest-exit7", NULL);
+	p1.wait(-1);
+	WVPASS(WIFEXITED(p1.estatus));
+	WVPASSEQ(WEXITSTATUS(p1.estatus), 7);
+	
+	// only in our PATH
+	WvSubProc p2;
+	p2.env.append(WvString("PATH=%s", dir));
+	p2.start("sh", "sh", "-c", "exit 0", NULL);
+	p2.wait(-1);
+	WVPASS(WIFEXITED(p2.estatus));
+	WVPASSEQ(WEXITSTATUS(p2.estatus), 242);
+    }
+    WvSubProc::use_spawn = true;
+    
+    unlink(prog);
+    rmdir(dir);
+}
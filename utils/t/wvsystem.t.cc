@@ -52,3 +52,39 @@ WVTEST_MAIN("wvsystem")
     ::unlink(fn2);
     ::unlink(fn3);
 }
+
+
+WVTEST_MAIN("wvsystem redirections with spawn and fork")
+{
+    WvString fn("test-%s.tmp", getpid()); 
+    WvString fn2("test2-%s.tmp", getpid()); 
+    WvString fn3("test3-%s.tmp", getpid());
+    WvString teststring("test \t string");
+    WvString outstr("%s x\n %s\n", teststring, teststring);
+    
+    for (int spawn = 0; spawn < 2; spawn++)
+    {
+	WvSubProc::use_spawn = spawn;
+	::unlink(fn);
+	::unlink(fn2);
+	::unlink(fn3);
+	
+	WVPASSEQ(WvSystem("echo", teststring, "x\n", teststring)
+		 .outfile(fn).go(), 0);
+	WVPASS(WvSystem("cat", "-", "stupid")
+	       .infile(fn).outfile(fn2).errfile(fn3).go() != 0);
+	WVPASSEQ(WvFile(fn, O_RDONLY).blocking_getline(-1, 0), outstr);
+	WVPASSEQ(WvFile(fn2, O_RDONLY).blocking_getline(-1, 0), outstr);
+	WVPASS(!!WvString(WvFile(fn3, O_RDONLY).blocking_getline(-1)));
+	
+	// stdin from a file that isn't there is just closed
+	::unlink(fn);
+	WVPASS(WvSystem("cat").infile(fn).outfile(fn2).errfile(fn3).go()
+	       != 0);
+	WVPASS(access(fn, F_OK) != 0);
+    }
+    WvSubProc::use_spawn = true;
+    
+    ::unlink(fn2);
+    ::unlink(fn3);
+}
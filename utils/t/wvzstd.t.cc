@@ -0,0 +1,158 @@
+#include "wvtest.h"
+#include "wvzstd.h"
+#include "wvautoconf.h"
+
+#if defined(HAVE_ZSTD_H) && defined(HAVE_LIBZSTD)
+
+static WvString some_text(int lines)
+{
+    WvString s("");
+    for (int i = 0; i < lines; i++)
+        s.append("line %s: the quick brown fox jumps over %s lazy dogs\n",
+                 i, i * 7919 % 1000);
+    return s;
+}
+
+
+WVTEST_MAIN("wvzstd encode + decode")
+{
+    WvString text(some_text(5000));
+    WvDynBuf in, zipped, out;
+
+    for (int level = -1; level <= 19; level += 5)
+    {
+        WvZstdEncoder zip(WvZstdEncoder::Compress, level);
+        WvZstdEncoder unzip(WvZstdEncoder::Decompress);
+        in.putstr(text);
+        WVPASS(zip.flush(in, zipped, true));
+        WVPASSEQ(in.used(), 0);
+        WVPASS(zipped.used() < text.len() / 3);
+        WVPASS(unzip.flush(zipped, out));
+        WVPASS(unzip.isfinished());
+        WVPASS(out.getstr() == text);
+    }
+
+    // nothing at all is fine too
+    WvZstdEncoder zip(WvZstdEncoder::Compress);
+    WvZstdEncoder unzip(WvZstdEncoder::Decompress);
+    WVPASS(zip.finish(zipped));
+    WVPASS(zipped.used() > 0);
+    WVPASS(unzip.flush(zipped, out));
+    WVPASS(unzip.isfinished());
+    WVPASSEQ(out.used(), 0);
+}
+
+
+WVTEST_MAIN("wvzstd flush")
+{
+    // everything up to each flush comes out the other end right away
+    WvZstdEncoder zip(WvZstdEncoder::Compress);
+    WvZstdEncoder unzip(WvZstdEncoder::Decompress);
+    WvDynBuf in, zipped, out;
+    for (int i = 0; i < 100; i++)
+    {
+        WvString line("message %s\n", i);
+        in.putstr(line);
+        WVPASS(zip.flush(in, zipped));
+        WVPASS(unzip.flush(zipped, out));
+        WVPASSEQ(out.getstr(), line);
+        WVFAIL(unzip.isfinished());
+    }
+
+    // without a flush, it waits for more
+    in.putstr("x");
+    WVPASS(zip.encode(in, zipped));
+    WVPASSEQ(in.used(), 0);
+    WVPASS(unzip.flush(zipped, out));
+    WVPASSEQ(out.used(), 0);
+    WVPASS(zip.finish(zipped));
+    WVPASS(unzip.flush(zipped, out));
+    WVPASSEQ(out.getstr(), "x");
+    WVPASS(unzip.isfinished());
+
+    // a new frame after a reset
+    WVPASS(zip.reset());
+    WVPASS(unzip.reset());
+    in.putstr("again");
+    WVPASS(zip.flush(in, zipped, true));
+    WVPASS(unzip.flush(zipped, out));
+    WVPASSEQ(out.getstr(), "again");
+    WVPASS(unzip.isfinished());
+}
+
+
+WVTEST_MAIN("wvzstd errors and small buffers")
+{
+    WvString text(some_text(500));
+    WvZstdEncoder zip(WvZstdEncoder::Compress);
+    WvDynBuf in, zipped;
+    in.putstr(text);
+    zip.flush(in, zipped, true);
+
+    // decompress into a small fixed buffer, a bit at a time
+    WvZstdEncoder unzip(WvZstdEncoder::Decompress);
+    WvDynBuf copy;
+    copy.put(zipped.peek(0, zipped.used()), zipped.used());
+    WvString got("");
+    unsigned char mem[1000];
+    while (!unzip.isfinished())
+    {
+        WvInPlaceBuf out(mem, 0, sizeof(mem));
+        WVPASS(unzip.encode(copy, out));
+        if (!out.used())
+            break;
+        got.append(out.getstr());
+    }
+    WVPASS(got == text);
+
+    // the checksum catches damage
+    WvZstdEncoder broken(WvZstdEncoder::Decompress);
+    WvDynBuf out;
+    unsigned char *p = (unsigned char *)zipped.mutablepeek(100, 1);
+    *p ^= 0x55;
+    WVFAIL(broken.flush(zipped, out));
+    WVFAIL(broken.isok());
+    WVPASS(strstr(broken.geterror(), "Zstandard"));
+}
+
+
+WVTEST_MAIN("wvzstd finish into a small buffer")
+{
+    WvString text(some_text(500));
+    WvZstdEncoder zip(WvZstdEncoder::Compress);
+    WvDynBuf in, zipped;
+    in.putstr(text);
+    zip.encode(in, zipped);
+
+    // the end of the frame comes out a bit at a time, and it's not
+    // finished until all of it has
+    unsigned char mem[16];
+    int tries;
+    for (tries = 0; tries < 100000; tries++)
+    {
+        WvInPlaceBuf out(mem, 0, sizeof(mem));
+        bool done = zip.finish(out);
+        zipped.put(out.get(out.used()), out.used());
+        if (done || !zip.isok() || zip.isfinished())
+            break;
+    }
+    WVPASS(tries > 0);
+    WVPASS(zip.isok());
+    WVPASS(zip.isfinished());
+
+    WvZstdEncoder unzip(WvZstdEncoder::Decompress);
+    WvDynBuf out;
+    WVPASS(unzip.flush(zipped, out));
+    WVPASS(unzip.isfinished());
+    WVPASS(out.getstr() == text);
+}
+
+#else
+
+WVTEST_MAIN("wvzstd without libzstd")
+{
+    WvZstdEncoder zip(WvZstdEncoder::Compress);
+    WVFAIL(zip.isok());
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Compares the gzip, LZ4 and Zstandard encoders on data that looks like
+ * config files and log files (or on files you give it), in MB/s of
+ * uncompressed data, flushing every 64k like a busy stream would.
+ *
+ * usage: compressbench [megabytes] [files...]
+ */
+#include "wvgzip.h"
+#include "wvlz4.h"
+#include "wvzstd.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static time_t bench(WvEncoder &enc, WvDynBuf &in, WvDynBuf &out)
+{
+    WvTime start = wvtime();
+    WvConstInPlaceBuf chunk(NULL, 0);
+    while (in.used())
+    {
+	size_t len = in.optgettable() < 65536 ? in.optgettable() : 65536;
+	chunk.reset(in.get(len), len);
+	enc.flush(chunk, out);
+    }
+    enc.finish(out);
+    return msecdiff(wvtime(), start);
+}
+
+
+static double mbps(size_t size, time_t ms)
+{
+    return ms ? size / 1048576.0 * 1000 / ms : 0.0;
+}
+
+
+static void compare(const char *name, WvEncoder &zip, WvEncoder &unzip,
+		    WvBuf &data)
+{
+    size_t size = data.used();
+    WvDynBuf in, zipped, out;
+    in.put(data.peek(0, size), size);
+    
+    time_t zip_ms = bench(zip, in, zipped);
+    size_t zipped_size = zipped.used();
+    time_t unzip_ms = bench(unzip, zipped, out);
+    
+    if (!zip.isok() || !unzip.isok())
+    {
+	printf("%-10s %s\n", name,
+	       (!zip.isok() ? zip.geterror() : unzip.geterror()).cstr());
+	return;
+    }
+    if (out.used() != size
+	|| memcmp(out.get(size), data.peek(0, size), size))
+	printf("%s didn't come back the same!\n", name);
+    printf("%-10s %7.1f MB/s %7.1f MB/s %6.2f\n", name,
+	   mbps(size, zip_ms), mbps(size, unzip_ms),
+	   (double)size / zipped_size);
+}
+
+
+static void compare_all(const char *what, WvBuf &data)
+{
+    printf("\n%s (%.1f MB)\n", what, data.used() / 1048576.0);
+    printf("encoder      compress  decompress  ratio\n");
+    for (int level = 1; level <= 6; level += 5)
+    {
+	WvGzipEncoder zip(WvGzipEncoder::Deflate, level);
+	WvGzipEncoder unzip(WvGzipEncoder::Inflate);
+	compare(WvString("gzip -%s", level), zip, unzip, data);
+    }
+    for (int level = 0; level <= 9; level += 9)
+    {
+	WvLz4Encoder zip(WvLz4Encoder::Compress, level);
+	WvLz4Encoder unzip(WvLz4Encoder::Decompress);
+	compare(WvString("lz4 -%s", level), zip, unzip, data);
+    }
+    for (int level = 1; level <= 9; level += 2 * level)
+    {
+	WvZstdEncoder zip(WvZstdEncoder::Compress, level);
+	WvZstdEncoder unzip(WvZstdEncoder::Decompress);
+	compare(WvString("zstd -%s", level), zip, unzip, data);
+    }
+}
+
+
+static void fake_config(WvBuf &buf, size_t size)
+{
+    for (int i = 0; buf.used() < size; i++)
+    {
+	WvString s("[net/interfaces/eth%s]\n"
+		   "address = 10.%s.%s.%s\nnetmask = 255.255.255.0\n"
+		   "mtu = %s\nenabled = %s\n\n",
+		   i, random() % 256, random() % 256, random() % 256,
+		   random() % 2 ? 1500 : 9000, random() % 2 ? "yes" : "no");
+	buf.putstr(s);
+    }
+}
+
+
+static void fake_log(WvBuf &buf, size_t size)
+{
+    static const char *sources[] = {
+	"HTTP Server", "WvTCPConn", "UniConfDaemon", "Resolver"
+    };
+    static const char *messages[] = {
+	"GET /status/%s", "Connected to 10.0.%s.1:80",
+	"Client %s disconnected", "Looking up host%s.example.com"
+    };
+    for (int t = 1000000000; buf.used() < size; t += random() % 3)
+    {
+	int which = random() % 4;
+	WvString msg(messages[which], random() % 1000);
+	WvString s("%s %s<Info>: %s\n", t, sources[which], msg);
+	buf.putstr(s);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? atoi(argv[1]) : 32) * 1024 * 1024;
+    
+    if (argc > 2)
+    {
+	for (int i = 2; i < argc; i++)
+	{
+	    FILE *f = fopen(argv[i], "rb");
+	    if (!f)
+	    {
+		perror(argv[i]);
+		return 1;
+	    }
+	    WvDynBuf data;
+	    unsigned char buf[65536];
+	    size_t len;
+	    while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.put(buf, len);
+	    fclose(f);
+	    compare_all(argv[i], data);
+	}
+	return 0;
+    }
+    
+    srandom(1);
+    WvDynBuf config, log;
+    fake_config(config, size);
+    compare_all("config", config);
+    fake_log(log, size);
+    compare_all("log", log);
+    return 0;
+}
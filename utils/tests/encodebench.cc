@@ -0,0 +1,68 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast the base64 and hex encoders and decoders go, in MB/s
+ * of unencoded data.
+ *
+ * usage: encodebench [megabytes]
+ */
+#include "wvbase64.h"
+#include "wvhex.h"
+#include "wvbuf.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static void bench(const char *name, WvEncoder &enc, WvDynBuf &in,
+		  WvDynBuf &out, size_t size)
+{
+    WvTime start = wvtime();
+    enc.flush(in, out);
+    enc.finish(out);
+    time_t ms = msecdiff(wvtime(), start);
+    printf("%-15s %8.1f MB/s\n", name,
+	   ms ? size / 1048576.0 * 1000 / ms : 0.0);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? atoi(argv[1]) : 64) * 1024 * 1024;
+    WvDynBuf data, enc, dec;
+
+    srandom(1);
+    unsigned char *p = data.alloc(size);
+    for (size_t i = 0; i < size; i++)
+	p[i] = random();
+
+    {
+	WvBase64Encoder e;
+	WvDynBuf in;
+	in.put(data.peek(0, size), size);
+	bench("base64 encode", e, in, enc, size);
+    }
+    {
+	WvBase64Decoder d;
+	bench("base64 decode", d, enc, dec, size);
+	if (dec.used() != size
+	    || memcmp(dec.get(size), data.peek(0, size), size))
+	    printf("base64 didn't come back the same!\n");
+	dec.zap();
+    }
+    {
+	WvHexEncoder e;
+	WvDynBuf in;
+	in.put(data.peek(0, size), size);
+	bench("hex encode", e, in, enc, size);
+    }
+    {
+	WvHexDecoder d;
+	bench("hex decode", d, enc, dec, size);
+	if (dec.used() != size
+	    || memcmp(dec.get(size), data.peek(0, size), size))
+	    printf("hex didn't come back the same!\n");
+    }
+    return 0;
+}
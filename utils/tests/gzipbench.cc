@@ -0,0 +1,93 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Measures how fast WvGzipEncoder compresses and decompresses at each
+ * level, in MB/s of uncompressed data, and how small it gets.
+ *
+ * usage: gzipbench [megabytes] [file to compress]
+ */
+#include "wvgzip.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static time_t bench(WvEncoder &enc, WvDynBuf &in, WvDynBuf &out)
+{
+    WvTime start = wvtime();
+    // a bit at a time, like a stream would
+    WvConstInPlaceBuf chunk(NULL, 0);
+    while (in.used())
+    {
+	size_t len = in.optgettable() < 65536 ? in.optgettable() : 65536;
+	chunk.reset(in.get(len), len);
+	enc.flush(chunk, out);
+    }
+    enc.finish(out);
+    return msecdiff(wvtime(), start);
+}
+
+
+static double mbps(size_t size, time_t ms)
+{
+    return ms ? size / 1048576.0 * 1000 / ms : 0.0;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? atoi(argv[1]) : 64) * 1024 * 1024;
+    WvDynBuf data;
+
+    // something that compresses like text, unless we're given some
+    if (argc > 2)
+    {
+	FILE *f = fopen(argv[2], "rb");
+	if (!f)
+	{
+	    perror(argv[2]);
+	    return 1;
+	}
+	unsigned char buf[65536];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+	    data.put(buf, len);
+	fclose(f);
+	size = data.used();
+    }
+    else
+    {
+	srandom(1);
+	while (data.used() < size)
+	{
+	    WvString line("%s %s the quick brown fox %s\n",
+			  random() % 1000, random() % 3 ? "jumps over" : "and",
+			  random() % 100000);
+	    data.put(line.cstr(), line.len());
+	}
+	size = data.used();
+    }
+
+    printf("level   deflate   inflate   ratio\n");
+    for (int level = 0; level <= 9; level++)
+    {
+	WvDynBuf in, zipped, out;
+	in.put(data.peek(0, size), size);
+
+	WvGzipEncoder zip(WvGzipEncoder::Deflate, level);
+	time_t zip_ms = bench(zip, in, zipped);
+	size_t zipped_size = zipped.used();
+
+	WvGzipEncoder unzip(WvGzipEncoder::Inflate);
+	time_t unzip_ms = bench(unzip, zipped, out);
+
+	if (out.used() != size || memcmp(out.get(size), data.peek(0, size),
+					 size))
+	    printf("level %d didn't come back the same!\n", level);
+	printf("%5d %7.1f MB/s %5.0f MB/s %6.2f\n", level,
+	       mbps(size, zip_ms), mbps(size, unzip_ms),
+	       (double)size / zipped_size);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Starts lots of WvSubProcs running "true", one after another, with
+ * posix_spawn() and then with plain fork(), and says how many per second
+ * each one managed.  fork() has to copy the parent's page tables, so the
+ * bigger the parent, the worse it gets; the test is repeated after
+ * dirtying a big chunk of heap to show that.
+ *
+ * usage: spawnbench [count] [megabytes of heap]
+ */
+#include "wvsubproc.h"
+#include "wvtimeutils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// global, so the compiler can't decide nobody looks at it
+char *heap;
+
+
+static double spawns_per_sec(int count, bool spawn)
+{
+    WvSubProc::use_spawn = spawn;
+    WvTime start = wvtime();
+    for (int i = 0; i < count; i++)
+    {
+	WvSubProc proc;
+	proc.start("true", "true", NULL);
+	proc.wait(-1);
+    }
+    time_t ms = msecdiff(wvtime(), start);
+    return ms ? count * 1000.0 / ms : 0.0;
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1000;
+    size_t heapsize = (argc > 2 ? atoi(argv[2]) : 1024) * 1024 * 1024UL;
+
+    printf("%d processes:           spawn       fork\n", count);
+    printf("small parent     %10.1f %10.1f per sec\n",
+	   spawns_per_sec(count, true), spawns_per_sec(count, false));
+
+    heap = new char[heapsize];
+    for (size_t i = 0; i < heapsize; i += 4096)
+	heap[i] = random();
+    printf("%5dM parent     %10.1f %10.1f per sec\n", (int)(heapsize >> 20),
+	   spawns_per_sec(count, true), spawns_per_sec(count, false));
+    deletev heap;
+    return 0;
+}
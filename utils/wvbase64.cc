@@ -14,10 +14,24 @@
  */
 #include "wvbase64.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) \
+        || defined(__clang__))
+# define BASE64_SIMD 1
+# include <immintrin.h>
+#endif
+
+// how much input to handle at once in the block encoders, so the output
+// buffer doesn't have to be enormous
+#define BLOCK_MAX 49152
+
 // maps codes to the Base64 alphabet
 static char alphabet[67] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=\n";
 
+// maps the Base64 alphabet to codes, and everything else to -1
+static signed char decodes[256];
+
 // finds codes in the Base64 alphabet
 static int lookup(char ch)
 {
@@ -40,10 +54,301 @@ static int lookup(char ch)
 }
 
 
+/***** Block encoding *****/
+
+// These work on whole groups (3 bytes in, 4 characters out) in contiguous
+// memory, which is most of the data when there's a lot of it; the state
+// machines in the encoders take care of whatever's left over, and of
+// whitespace and padding.
+
+// Encodes 'groups' groups from 'in' to 'out'.
+static void encode_scalar(const unsigned char *in, size_t groups, char *out)
+{
+    for (; groups; groups--, in += 3, out += 4)
+    {
+        unsigned int bits = (in[0] << 16) | (in[1] << 8) | in[2];
+        out[0] = alphabet[bits >> 18];
+        out[1] = alphabet[(bits >> 12) & 0x3f];
+        out[2] = alphabet[(bits >> 6) & 0x3f];
+        out[3] = alphabet[bits & 0x3f];
+    }
+}
+
+
+// Decodes up to 'groups' groups from 'in' to 'out', stopping at the first
+// group that has anything but alphabet characters in it.  Returns the
+// number of groups decoded.
+static size_t decode_scalar(const unsigned char *in, size_t groups,
+                            unsigned char *out)
+{
+    size_t done;
+    for (done = 0; done < groups; done++, in += 4, out += 3)
+    {
+        int a = decodes[in[0]], b = decodes[in[1]];
+        int c = decodes[in[2]], d = decodes[in[3]];
+        if ((a | b | c | d) < 0)
+            break;
+        unsigned int bits = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = bits >> 16;
+        out[1] = bits >> 8;
+        out[2] = bits;
+    }
+    return done;
+}
+
+
+#ifdef BASE64_SIMD
+
+// The vector versions are the well-known ones by Wojciech Mula: shuffle
+// each 3 bytes into a 32-bit lane, pull out the four 6-bit codes with a
+// couple of multiplies, and turn codes into characters (or back) by adding
+// an offset looked up with pshufb.  That needs SSSE3; SSE2 has no byte
+// shuffle, so without SSSE3 we use the scalar versions.
+
+// splits 12 bytes (in each 128-bit lane) into 16 6-bit codes, one per byte
+#define SPLIT_CODES(X, in) \
+    X##_or_si##in( \
+        X##_mulhi_epu16(X##_and_si##in(v, X##_set1_epi32(0x0fc0fc00)), \
+                        X##_set1_epi32(0x04000040)), \
+        X##_mullo_epi16(X##_and_si##in(v, X##_set1_epi32(0x003f03f0)), \
+                        X##_set1_epi32(0x01000010)))
+
+__attribute__((target("ssse3")))
+static size_t encode_ssse3(const unsigned char *in, size_t groups, char *out)
+{
+    const __m128i shuf = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                      4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t done;
+
+    // each step reads 16 bytes, but only uses 12 of them
+    for (done = 0; done + 6 <= groups; done += 4, in += 12, out += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)in);
+        v = _mm_shuffle_epi8(v, shuf);
+        __m128i codes = SPLIT_CODES(_mm, 128);
+
+        // 0-25 -> 13, 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, 63 -> 12
+        __m128i idx = _mm_subs_epu8(codes, _mm_set1_epi8(51));
+        idx = _mm_or_si128(idx, _mm_and_si128(
+              _mm_cmpgt_epi8(_mm_set1_epi8(26), codes), _mm_set1_epi8(13)));
+        v = _mm_add_epi8(codes, _mm_shuffle_epi8(offsets, idx));
+        _mm_storeu_si128((__m128i *)out, v);
+    }
+    return done;
+}
+
+
+__attribute__((target("avx2")))
+static size_t encode_avx2(const unsigned char *in, size_t groups, char *out)
+{
+    const __m256i shuf = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                         4, 5, 3, 4, 1, 2, 0, 1,
+                                         10, 11, 9, 10, 7, 8, 6, 7,
+                                         4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t done;
+
+    // each step reads 28 bytes, but only uses 24 of them
+    for (done = 0; done + 10 <= groups; done += 8, in += 24, out += 32)
+    {
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                        _mm_loadu_si128((const __m128i *)in)),
+                        _mm_loadu_si128((const __m128i *)(in + 12)), 1);
+        v = _mm256_shuffle_epi8(v, shuf);
+        __m256i codes = SPLIT_CODES(_mm256, 256);
+
+        __m256i idx = _mm256_subs_epu8(codes, _mm256_set1_epi8(51));
+        idx = _mm256_or_si256(idx, _mm256_and_si256(
+              _mm256_cmpgt_epi8(_mm256_set1_epi8(26), codes),
+              _mm256_set1_epi8(13)));
+        v = _mm256_add_epi8(codes, _mm256_shuffle_epi8(offsets, idx));
+        _mm256_storeu_si256((__m256i *)out, v);
+    }
+    return done;
+}
+
+
+// Validates 16 characters (in each lane), and turns them into codes.
+// 'bad' is nonzero if any of them weren't in the alphabet.
+#define DECODE_CODES(X, in) \
+    const __m##in##i hi = X##_and_si##in(X##_srli_epi32(v, 4), \
+                                         X##_set1_epi8(0x0f)); \
+    const __m##in##i lo = X##_and_si##in(v, X##_set1_epi8(0x0f)); \
+    const __m##in##i bad = X##_and_si##in(X##_shuffle_epi8(lut_lo, lo), \
+                                          X##_shuffle_epi8(lut_hi, hi)); \
+    const __m##in##i slash = X##_cmpeq_epi8(v, X##_set1_epi8('/')); \
+    v = X##_add_epi8(v, X##_shuffle_epi8(lut_roll, X##_add_epi8(slash, hi)))
+
+// Packs 16 6-bit codes (in each lane) into 12 bytes, in the low 12 bytes.
+#define PACK_CODES(X) \
+    v = X##_maddubs_epi16(v, X##_set1_epi32(0x01400140)); \
+    v = X##_madd_epi16(v, X##_set1_epi32(0x00011000)); \
+    v = X##_shuffle_epi8(v, pack)
+
+#define LUT16(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p) \
+    a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p
+#define DECODE_LUT_LO LUT16(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, \
+                            0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a)
+#define DECODE_LUT_HI LUT16(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, \
+                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10)
+#define DECODE_LUT_ROLL LUT16(0, 16, 19, 4, -65, -65, -71, -71, \
+                              0, 0, 0, 0, 0, 0, 0, 0)
+#define DECODE_PACK LUT16(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, \
+                          -1, -1, -1, -1)
+
+__attribute__((target("ssse3")))
+static size_t decode_ssse3(const unsigned char *in, size_t groups,
+                           unsigned char *out)
+{
+    const __m128i lut_lo = _mm_setr_epi8(DECODE_LUT_LO);
+    const __m128i lut_hi = _mm_setr_epi8(DECODE_LUT_HI);
+    const __m128i lut_roll = _mm_setr_epi8(DECODE_LUT_ROLL);
+    const __m128i pack = _mm_setr_epi8(DECODE_PACK);
+    size_t done;
+
+    // each step writes 16 bytes, but only 12 of them are real
+    for (done = 0; done + 6 <= groups; done += 4, in += 16, out += 12)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)in);
+        DECODE_CODES(_mm, 128);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128()))
+            != 0xffff)
+            break;
+        PACK_CODES(_mm);
+        _mm_storeu_si128((__m128i *)out, v);
+    }
+    return done;
+}
+
+
+__attribute__((target("avx2")))
+static size_t decode_avx2(const unsigned char *in, size_t groups,
+                          unsigned char *out)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(DECODE_LUT_LO, DECODE_LUT_LO);
+    const __m256i lut_hi = _mm256_setr_epi8(DECODE_LUT_HI, DECODE_LUT_HI);
+    const __m256i lut_roll = _mm256_setr_epi8(DECODE_LUT_ROLL,
+                                              DECODE_LUT_ROLL);
+    const __m256i pack = _mm256_setr_epi8(DECODE_PACK, DECODE_PACK);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+    size_t done;
+
+    // each step writes 32 bytes, but only 24 of them are real
+    for (done = 0; done + 11 <= groups; done += 8, in += 32, out += 24)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)in);
+        DECODE_CODES(_mm256, 256);
+        if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bad,
+                                _mm256_setzero_si256())) != 0xffffffffU)
+            break;
+        PACK_CODES(_mm256);
+        v = _mm256_permutevar8x32_epi32(v, lanes);
+        _mm256_storeu_si256((__m256i *)out, v);
+    }
+    return done;
+}
+
+#endif // BASE64_SIMD
+
+
+typedef size_t EncodeFunc(const unsigned char *in, size_t groups, char *out);
+typedef size_t DecodeFunc(const unsigned char *in, size_t groups,
+                          unsigned char *out);
+
+static size_t encode_none(const unsigned char *, size_t, char *)
+{
+    return 0;
+}
+
+static size_t decode_none(const unsigned char *, size_t, unsigned char *)
+{
+    return 0;
+}
+
+static EncodeFunc *encode_vector;
+static DecodeFunc *decode_vector;
+
+
+// picks the fastest block encoders this CPU can run
+static void init_blocks()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        int code = lookup(i);
+        decodes[i] = code < 64 ? code : -1;
+    }
+
+    encode_vector = encode_none;
+    decode_vector = decode_none;
+#ifdef BASE64_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        encode_vector = encode_avx2;
+        decode_vector = decode_avx2;
+    }
+    else if (__builtin_cpu_supports("ssse3"))
+    {
+        encode_vector = encode_ssse3;
+        decode_vector = decode_ssse3;
+    }
+#endif
+}
+
+
+// Encodes as many whole groups as are in the first contiguous part of 'in'.
+static void encode_blocks(WvBuf &in, WvBuf &out)
+{
+    size_t avail = in.optgettable();
+    if (avail > BLOCK_MAX)
+        avail = BLOCK_MAX;
+    size_t groups = avail / 3;
+    if (!groups)
+        return;
+
+    const unsigned char *src = in.get(groups * 3);
+    char *dst = (char *)out.alloc(groups * 4);
+    size_t done = encode_vector(src, groups, dst);
+    encode_scalar(src + done * 3, groups - done, dst + done * 4);
+}
+
+
+// Decodes as many whole groups as are in the first contiguous part of 'in',
+// up to the first whitespace, padding or other surprise.  Returns false if
+// there was nothing it could do.
+static bool decode_blocks(WvBuf &in, WvBuf &out)
+{
+    size_t avail = in.optgettable();
+    if (avail > BLOCK_MAX)
+        avail = BLOCK_MAX;
+    size_t groups = avail / 4;
+    if (!groups)
+        return false;
+
+    const unsigned char *src = in.peek(0, groups * 4);
+    unsigned char *dst = out.alloc(groups * 3);
+    size_t done = decode_vector(src, groups, dst);
+    done += decode_scalar(src + done * 4, groups - done, dst + done * 3);
+    in.skip(done * 4);
+    out.unalloc((groups - done) * 3);
+    return done != 0;
+}
+
+
 /***** WvBase64Encoder *****/
 
 WvBase64Encoder::WvBase64Encoder()
 {
+    if (!encode_vector)
+        init_blocks();
     _reset();
 }
 
@@ -61,6 +366,13 @@ bool WvBase64Encoder::_encode(WvBuf &in, WvBuf &out, bool flush)
     // base 64 encode the entire buffer
     while (in.used() != 0)
     {
+        if (state == ATBIT0 && in.used() >= 3)
+        {
+            encode_blocks(in, out);
+            if (in.used() == 0)
+                break;
+        }
+        
         unsigned char next = in.getch();
         bits = (bits << 8) | next;
         switch (state)
@@ -116,6 +428,8 @@ bool WvBase64Encoder::_finish(WvBuf &out)
 
 WvBase64Decoder::WvBase64Decoder()
 {
+    if (!decode_vector)
+        init_blocks();
     _reset();
 }
 
@@ -133,6 +447,9 @@ bool WvBase64Decoder::_encode(WvBuf &in, WvBuf &out, bool flush)
     // base 64 decode the entire buffer
     while (in.used() != 0)
     {
+        if (state == ATBIT0 && in.used() >= 4 && decode_blocks(in, out))
+            continue;
+        
         unsigned char next = in.getch();
         int symbol = lookup(next);
         switch (symbol)
@@ -46,13 +46,29 @@ bool WvEncoder::encode(WvBuf &inbuf, WvBuf &outbuf,
 }
 
 
+bool WvEncoder::encode_inplace(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    if (!isinplace())
+        return encode(inbuf, outbuf, flush);
+
+    // deliberately not using isok() and isfinished() here
+    bool success = okay && !finished && (inbuf.used() != 0 || flush);
+    if (success)
+        success = _encode_inplace(inbuf, outbuf, flush);
+    return success;
+}
+
+
 bool WvEncoder::finish(WvBuf &outbuf)
 {
     // deliberately not using isok() and isfinished() here
     bool success = okay && !finished;
     if (success)
         success = _finish(outbuf);
-    setfinished();
+    // failing without an error means it ran out of room, so it can try
+    // again once there's some
+    if (success || !okay)
+        setfinished();
     return success;
 }
 
@@ -252,7 +268,7 @@ WvString WvEncoderChain::_geterror() const
 //       individual broken encoders while still processing data
 //       through as much of the chain as possible.
 bool WvEncoderChain::do_encode(WvBuf &in, WvBuf &out, ChainElem *start_after,
-			       bool flush, bool finish)
+			       bool flush, bool finish, bool inplace)
 {
     bool success = true;
     WvBuf *tmpin = &in;
@@ -262,7 +278,14 @@ bool WvEncoderChain::do_encode(WvBuf &in, WvBuf &out, ChainElem *start_after,
     last_run = start_after;
     for (; it.cur() && it.next(); )
     {
-        if (!it->enc->encode(*tmpin, it->out, flush))
+        // the caller's buffer might not be ours to scribble on, but
+        // everything after that is
+        if (inplace || tmpin != &in)
+        {
+            if (!it->enc->encode_inplace(*tmpin, it->out, flush))
+                success = false;
+        }
+        else if (!it->enc->encode(*tmpin, it->out, flush))
             success = false;
         if (finish && !it->enc->finish(it->out))
             success = false;
@@ -280,6 +303,22 @@ bool WvEncoderChain::_encode(WvBuf &in, WvBuf &out, bool flush)
 }
 
 
+bool WvEncoderChain::_isinplace() const
+{
+    ChainElemList::Iter it(const_cast<ChainElemList&>(encoders));
+    for (it.rewind(); it.next(); )
+        if (!it->enc->isinplace())
+            return false;
+    return true;
+}
+
+
+bool WvEncoderChain::_encode_inplace(WvBuf &in, WvBuf &out, bool flush)
+{
+    return do_encode(in, out, NULL, flush, false, true);
+}
+
+
 bool WvEncoderChain::_finish(WvBuf &out)
 {
     WvNullBuf empty;
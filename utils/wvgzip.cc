@@ -12,10 +12,33 @@
 
 
 WvGzipEncoder::WvGzipEncoder(Mode _mode, size_t _out_limit) :
-    out_limit(_out_limit), tmpbuf(ZBUFSIZE), mode(_mode)
+    out_limit(_out_limit), mode(_mode)
 {
     ignore_decompression_errors = false;
     full_flush = false;
+    format = Zlib;
+    level = Z_BEST_SPEED;
+    strategy = Z_DEFAULT_STRATEGY;
+    window_bits = MAX_WBITS;
+    mem_level = 8;
+    new_level = false;
+    init();
+}
+
+
+WvGzipEncoder::WvGzipEncoder(Mode _mode, int _level, Format _format,
+			     Strategy _strategy, int _window_bits,
+			     int _mem_level) :
+    out_limit(0), mode(_mode)
+{
+    ignore_decompression_errors = false;
+    full_flush = false;
+    format = _format;
+    level = _level;
+    strategy = _strategy;
+    window_bits = _window_bits;
+    mem_level = _mem_level;
+    new_level = false;
     init();
 }
 
@@ -35,11 +58,21 @@ void WvGzipEncoder::init()
     zstr->opaque = NULL;
     zstr->msg = NULL;
     
+    // zlib picks the framing from the window size
+    int bits = window_bits;
+    if (format == Raw)
+	bits = -bits;
+    else if (format == Gzip)
+	bits += 16;
+    else if (format == Auto && mode == Inflate)
+	bits += 32;
+    
     int retval;
     if (mode == Deflate)
-	retval = deflateInit(zstr, Z_BEST_SPEED);
+	retval = deflateInit2(zstr, level, Z_DEFLATED, bits, mem_level,
+			      strategy);
     else
-	retval = inflateInit(zstr);
+	retval = inflateInit2(zstr, bits);
     
     if (retval != Z_OK)
     {
@@ -50,6 +83,10 @@ void WvGzipEncoder::init()
     }
     zstr->next_in = zstr->next_out = NULL;
     zstr->avail_in = zstr->avail_out = 0;
+    
+    // with the zlib format, inflate asks for it when it needs it
+    if (dictionary.used() && (mode == Deflate || format == Raw))
+	use_dictionary();
 }
 
 void WvGzipEncoder::close()
@@ -63,10 +100,105 @@ void WvGzipEncoder::close()
 
 }
 
+
+bool WvGzipEncoder::use_dictionary()
+{
+    size_t len = dictionary.used();
+    const Bytef *dict = (const Bytef *)dictionary.peek(0, len);
+    int retval;
+    if (mode == Deflate)
+	retval = deflateSetDictionary(zstr, dict, len);
+    else
+	retval = inflateSetDictionary(zstr, dict, len);
+    
+    if (retval != Z_OK)
+    {
+	seterror("error %s setting gzip dictionary: %s", retval,
+		 zstr->msg ? zstr->msg : "unknown");
+	return false;
+    }
+    return true;
+}
+
+
+bool WvGzipEncoder::set_dictionary(const void *dict, size_t len)
+{
+    dictionary.zap();
+    dictionary.put(dict, len);
+    if (mode == Deflate || format == Raw)
+	return use_dictionary();
+    return true;
+}
+
+
+bool WvGzipEncoder::set_level(int _level, Strategy _strategy)
+{
+    if (_level < Z_NO_COMPRESSION || _level > Z_BEST_COMPRESSION)
+	return false;
+    level = _level;
+    strategy = _strategy;
+    new_level = (mode == Deflate);
+    return true;
+}
+
+
+// Tell zlib about a set_level().  Whatever it already has is compressed
+// the old way first, so this needs somewhere to put it; if there isn't
+// enough room, it returns false and tries again next time.
+bool WvGzipEncoder::apply_level(WvBuf &outbuf)
+{
+    if (!room(outbuf))
+	return false;
+    
+    int retval;
+    do
+    {
+	size_t avail_out = room(outbuf);
+	zstr->next_in = (Bytef *)"";
+	zstr->avail_in = 0;
+	zstr->avail_out = avail_out;
+	zstr->next_out = outbuf.alloc(avail_out);
+	retval = deflateParams(zstr, level, strategy);
+	outbuf.unalloc(zstr->avail_out);
+	output += avail_out - zstr->avail_out;
+    } while (retval == Z_BUF_ERROR && zstr->avail_out == 0
+	     && room(outbuf));
+    
+    if (retval == Z_BUF_ERROR)
+	return false; // not an error: it just needs more room
+    new_level = false;
+    if (retval != Z_OK)
+    {
+	seterror("error %s changing gzip level: %s", retval,
+		 zstr->msg ? zstr->msg : "unknown");
+	return false;
+    }
+    return true;
+}
+
+
+// How much of outbuf to let zlib write into at once: whatever's left at the
+// end of it if that's a decent amount, so we don't waste it.  (A WvDynBuf
+// with nothing left says it's unlimited, which isn't a decent amount.)
+size_t WvGzipEncoder::room(WvBuf &outbuf)
+{
+    size_t avail = outbuf.optallocable();
+    if (avail < ZBUFSIZE || avail >= UNLIMITED_FREE_SPACE)
+	avail = ZBUFSIZE;
+    if (avail > outbuf.free())
+	avail = outbuf.free();
+    if (out_limit && avail > out_limit - output)
+	avail = out_limit - output;
+    return avail;
+}
+
+
 bool WvGzipEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
 {
     bool success;
     output = 0;
+    if (new_level && !apply_level(outbuf))
+	return false;
     for (;;)
     {
         size_t starting_size = inbuf.used();
@@ -90,8 +222,13 @@ bool WvGzipEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
 
 bool WvGzipEncoder::_finish(WvBuf &outbuf)
 {
+    output = 0;
+    if (new_level && !apply_level(outbuf))
+	return false;
     prepare(NULL);
-    return process(outbuf, false, true);
+    // if outbuf filled up before the end, finish() has to try again
+    return process(outbuf, false, true)
+	&& (mode != Deflate || isfinished());
 }
 
 
@@ -128,27 +265,27 @@ bool WvGzipEncoder::process(WvBuf &outbuf, bool flush, bool finish)
     int retval;
     do
     {
-        // process the next chunk
-        tmpbuf.zap();
-        size_t avail_out = tmpbuf.free();
-        if (out_limit)
-            avail_out = tmpbuf.free() < (out_limit - output) ? tmpbuf.free()
-                : (out_limit - output);
+        // process the next chunk, straight into outbuf
+        size_t avail_out = room(outbuf);
+        if (!avail_out)
+        {
+            retval = Z_BUF_ERROR; // no room to do anything
+            break;
+        }
 
         zstr->avail_out = avail_out;
-	zstr->next_out = tmpbuf.alloc(avail_out);
+	zstr->next_out = outbuf.alloc(avail_out);
 	if (mode == Deflate)
 	    retval = deflate(zstr, flushmode);
 	else
 	    retval = inflate(zstr, flushmode);
-	tmpbuf.unalloc(zstr->avail_out);
+	outbuf.unalloc(zstr->avail_out);
 
         output += avail_out - zstr->avail_out;
 
-        // consume pending output
-        outbuf.merge(tmpbuf);
-
-        if (retval == Z_DATA_ERROR && mode == Inflate
+        if (retval == Z_NEED_DICT && dictionary.used())
+            retval = use_dictionary() ? Z_OK : Z_NEED_DICT;
+        else if (retval == Z_DATA_ERROR && mode == Inflate
             && ignore_decompression_errors)
             retval = inflateSync(zstr);
     } while (retval == Z_OK && (!out_limit || (out_limit > output)));
@@ -161,7 +298,8 @@ bool WvGzipEncoder::process(WvBuf &outbuf, bool flush, bool finish)
     {
         seterror("error %s during gzip %s: %s", retval,
             mode == Deflate ? "compression" : "decompression",
-            zstr->msg ? zstr->msg : "unknown");
+            zstr->msg ? zstr->msg
+                : retval == Z_NEED_DICT ? "need a dictionary" : "unknown");
         return false;
     }
 
@@ -7,6 +7,16 @@
 #include "wvhex.h"
 #include <ctype.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) \
+        || defined(__clang__))
+# define HEX_SIMD 1
+# include <immintrin.h>
+#endif
+
+// how much input to handle at once in the block encoders
+#define BLOCK_MAX 65536
+
 
 static inline char tohex(int digit, char alphabase)
 {
@@ -22,11 +32,238 @@ static inline int fromhex(char digit)
     return digit - 'a' + 10;
 }
 
+/***** Block encoding *****/
+
+// These do as much as they can of a contiguous piece of the input in one
+// go; the encoders themselves deal with whatever's left, and with the
+// whitespace and errors.
+
+// the value of each hex digit, and -1 for everything else
+static signed char digits[256];
+
+
+// Encodes 'len' bytes from 'in' to 'out'.
+static void encode_scalar(const unsigned char *in, size_t len, char *out,
+                          char alphabase)
+{
+    for (; len; len--, in++, out += 2)
+    {
+        out[0] = tohex(*in >> 4, alphabase);
+        out[1] = tohex(*in & 15, alphabase);
+    }
+}
+
+
+// Decodes up to 'len' bytes from twice that many digits in 'in', stopping
+// at the first pair that isn't two hex digits.  Returns the number of
+// bytes decoded.
+static size_t decode_scalar(const unsigned char *in, size_t len,
+                            unsigned char *out)
+{
+    size_t done;
+    for (done = 0; done < len; done++, in += 2)
+    {
+        int hi = digits[in[0]], lo = digits[in[1]];
+        if ((hi | lo) < 0)
+            break;
+        out[done] = hi << 4 | lo;
+    }
+    return done;
+}
+
+
+#ifdef HEX_SIMD
+
+// Turns the nibbles in each byte of 'n' into hex digits.
+#define HEX_DIGITS(X, in, n) \
+    X##_add_epi8(X##_add_epi8(n, X##_set1_epi8('0')), \
+        X##_and_si##in(X##_cmpgt_epi8(n, X##_set1_epi8(9)), letters))
+
+__attribute__((target("sse2")))
+static size_t encode_sse2(const unsigned char *in, size_t len, char *out,
+                          char alphabase)
+{
+    const __m128i letters = _mm_set1_epi8(alphabase - '0');
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t done;
+
+    for (done = 0; done + 16 <= len; done += 16, in += 16, out += 32)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)in);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        __m128i lo = _mm_and_si128(v, mask);
+        hi = HEX_DIGITS(_mm, 128, hi);
+        lo = HEX_DIGITS(_mm, 128, lo);
+        _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(out + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return done;
+}
+
+
+__attribute__((target("avx2")))
+static size_t encode_avx2(const unsigned char *in, size_t len, char *out,
+                          char alphabase)
+{
+    const __m256i letters = _mm256_set1_epi8(alphabase - '0');
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t done;
+
+    for (done = 0; done + 32 <= len; done += 32, in += 32, out += 64)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)in);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask);
+        __m256i lo = _mm256_and_si256(v, mask);
+        hi = HEX_DIGITS(_mm256, 256, hi);
+        lo = HEX_DIGITS(_mm256, 256, lo);
+
+        // unpacking works within each 128-bit half, so put them in order
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)out,
+                            _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + 32),
+                            _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return done;
+}
+
+
+// Turns each hex digit in 'v' into its value, and sets 'ok' to all ones
+// where there was one.  Then packs each pair of values into a byte, in the
+// low half of each 16-bit lane.
+#define HEX_VALUES(X, in) \
+    __m##in##i d = X##_sub_epi8(v, X##_set1_epi8('0')); \
+    __m##in##i isnum = X##_and_si##in( \
+        X##_cmpgt_epi8(d, X##_set1_epi8(-1)), \
+        X##_cmpgt_epi8(X##_set1_epi8(10), d)); \
+    __m##in##i l = X##_sub_epi8(X##_or_si##in(v, X##_set1_epi8(0x20)), \
+                                X##_set1_epi8('a')); \
+    __m##in##i isletter = X##_and_si##in( \
+        X##_cmpgt_epi8(l, X##_set1_epi8(-1)), \
+        X##_cmpgt_epi8(X##_set1_epi8(6), l)); \
+    ok = X##_or_si##in(isnum, isletter); \
+    v = X##_or_si##in(X##_and_si##in(d, isnum), \
+        X##_and_si##in(X##_add_epi8(l, X##_set1_epi8(10)), isletter)); \
+    v = X##_and_si##in(X##_or_si##in(X##_slli_epi16(v, 4), \
+                                     X##_srli_epi16(v, 8)), \
+                       X##_set1_epi16(0xff))
+
+__attribute__((target("sse2")))
+static size_t decode_sse2(const unsigned char *in, size_t len,
+                          unsigned char *out)
+{
+    size_t done;
+
+    for (done = 0; done + 16 <= len; done += 16, in += 32, out += 16)
+    {
+        __m128i v, ok, a, b;
+        
+        v = _mm_loadu_si128((const __m128i *)in);
+        {
+            HEX_VALUES(_mm, 128);
+            a = v;
+        }
+        if (_mm_movemask_epi8(ok) != 0xffff)
+            break;
+        v = _mm_loadu_si128((const __m128i *)(in + 16));
+        {
+            HEX_VALUES(_mm, 128);
+            b = v;
+        }
+        if (_mm_movemask_epi8(ok) != 0xffff)
+            break;
+        _mm_storeu_si128((__m128i *)out, _mm_packus_epi16(a, b));
+    }
+    return done;
+}
+
+
+__attribute__((target("avx2")))
+static size_t decode_avx2(const unsigned char *in, size_t len,
+                          unsigned char *out)
+{
+    size_t done;
+
+    for (done = 0; done + 32 <= len; done += 32, in += 64, out += 32)
+    {
+        __m256i v, ok, a, b;
+        
+        v = _mm256_loadu_si256((const __m256i *)in);
+        {
+            HEX_VALUES(_mm256, 256);
+            a = v;
+        }
+        if ((unsigned)_mm256_movemask_epi8(ok) != 0xffffffffU)
+            break;
+        v = _mm256_loadu_si256((const __m256i *)(in + 32));
+        {
+            HEX_VALUES(_mm256, 256);
+            b = v;
+        }
+        if ((unsigned)_mm256_movemask_epi8(ok) != 0xffffffffU)
+            break;
+
+        // packing works within each 128-bit half, so put them in order
+        _mm256_storeu_si256((__m256i *)out, _mm256_permute4x64_epi64(
+                                _mm256_packus_epi16(a, b), 0xd8));
+    }
+    return done;
+}
+
+#endif // HEX_SIMD
+
+
+typedef size_t EncodeFunc(const unsigned char *in, size_t len, char *out,
+                          char alphabase);
+typedef size_t DecodeFunc(const unsigned char *in, size_t len,
+                          unsigned char *out);
+
+static size_t encode_none(const unsigned char *, size_t, char *, char)
+{
+    return 0;
+}
+
+static size_t decode_none(const unsigned char *, size_t, unsigned char *)
+{
+    return 0;
+}
+
+static EncodeFunc *encode_vector;
+static DecodeFunc *decode_vector;
+
+
+// picks the fastest block encoders this CPU can run
+static void init_blocks()
+{
+    for (int i = 0; i < 256; i++)
+        digits[i] = isxdigit(i) ? fromhex(i) : -1;
+
+    encode_vector = encode_none;
+    decode_vector = decode_none;
+#ifdef HEX_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        encode_vector = encode_avx2;
+        decode_vector = decode_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        encode_vector = encode_sse2;
+        decode_vector = decode_sse2;
+    }
+#endif
+}
+
+
 /***** WvHexEncoder *****/
 
 WvHexEncoder::WvHexEncoder(bool use_uppercase) 
 {
     alphabase = (use_uppercase ? 'A' : 'a') - 10;
+    if (!encode_vector)
+        init_blocks();
     _reset();
 }
 
@@ -41,9 +278,13 @@ bool WvHexEncoder::_encode(WvBuf &in, WvBuf &out, bool flush)
 {
     while (in.used() != 0)
     {
-        unsigned char byte = in.getch();
-        out.putch(tohex(byte >> 4, alphabase));
-        out.putch(tohex(byte & 15, alphabase));
+        size_t len = in.optgettable();
+        if (len > BLOCK_MAX)
+            len = BLOCK_MAX;
+        const unsigned char *src = in.get(len);
+        char *dst = (char *)out.alloc(len * 2);
+        size_t done = encode_vector(src, len, dst, alphabase);
+        encode_scalar(src + done, len - done, dst + done * 2, alphabase);
     }
     return true;
 }
@@ -53,6 +294,8 @@ bool WvHexEncoder::_encode(WvBuf &in, WvBuf &out, bool flush)
 
 WvHexDecoder::WvHexDecoder()
 {
+    if (!decode_vector)
+        init_blocks();
     _reset();
 }
 
@@ -69,6 +312,22 @@ bool WvHexDecoder::_encode(WvBuf &in, WvBuf &out, bool flush)
 {
     while (in.used() != 0)
     {
+        // whole pairs of digits, as many as we can
+        size_t len = issecond ? 0 : in.optgettable() / 2;
+        if (len > BLOCK_MAX)
+            len = BLOCK_MAX;
+        if (len)
+        {
+            const unsigned char *src = in.peek(0, len * 2);
+            unsigned char *dst = out.alloc(len);
+            size_t done = decode_vector(src, len, dst);
+            done += decode_scalar(src + done * 2, len - done, dst + done);
+            in.skip(done * 2);
+            out.unalloc(len - done);
+            if (done)
+                continue;
+        }
+        
         char ch = (char) in.getch();
         if (isxdigit(ch))
         {
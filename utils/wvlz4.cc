@@ -0,0 +1,243 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * LZ4 encoder/decoder based on liblz4's frame format.  See wvlz4.h.
+ */
+#include "wvlz4.h"
+#include "wvautoconf.h"
+
+// If liblz4 wasn't installed at compile time, stub this out
+#if !defined(HAVE_LZ4FRAME_H) || !defined(HAVE_LIBLZ4)
+
+WvLz4Encoder::WvLz4Encoder(Mode _mode, int _level) :
+    cctx(NULL), dctx(NULL), mode(_mode), level(_level), started(false)
+{
+    seterror("compiled without LZ4 support");
+}
+
+
+WvLz4Encoder::~WvLz4Encoder()
+{
+}
+
+
+bool WvLz4Encoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    return false;
+}
+
+
+bool WvLz4Encoder::_finish(WvBuf &outbuf)
+{
+    return false;
+}
+
+
+bool WvLz4Encoder::_reset()
+{
+    return false;
+}
+
+#else // HAVE_LZ4FRAME_H
+
+#include <lz4frame.h>
+#include <string.h>
+
+// how much input to compress at a time; the output has to have room for
+// all of it plus whatever was buffered from before, so don't overdo it
+#define LZ4_CHUNK 65536
+
+
+static void getprefs(LZ4F_preferences_t &prefs, int level)
+{
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+    prefs.frameInfo.blockMode = LZ4F_blockLinked;
+    prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    prefs.compressionLevel = level;
+}
+
+
+WvLz4Encoder::WvLz4Encoder(Mode _mode, int _level) :
+    mode(_mode), level(_level)
+{
+    init();
+}
+
+
+WvLz4Encoder::~WvLz4Encoder()
+{
+    close();
+}
+
+
+void WvLz4Encoder::init()
+{
+    size_t retval;
+    cctx = NULL;
+    dctx = NULL;
+    started = false;
+    if (mode == Compress)
+	retval = LZ4F_createCompressionContext(&cctx, LZ4F_VERSION);
+    else
+	retval = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+    check(retval);
+}
+
+
+void WvLz4Encoder::close()
+{
+    if (cctx)
+	LZ4F_freeCompressionContext(cctx);
+    if (dctx)
+	LZ4F_freeDecompressionContext(dctx);
+    cctx = NULL;
+    dctx = NULL;
+}
+
+
+// Returns true if retval isn't an error, and sets the error if it is.
+bool WvLz4Encoder::check(size_t retval)
+{
+    if (!LZ4F_isError(retval))
+	return true;
+    seterror("error during LZ4 %s: %s",
+	     mode == Compress ? "compression" : "decompression",
+	     LZ4F_getErrorName(retval));
+    return false;
+}
+
+
+bool WvLz4Encoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    if (mode == Compress)
+	return compress(inbuf, outbuf, flush);
+    else
+	return decompress(inbuf, outbuf);
+}
+
+
+bool WvLz4Encoder::_finish(WvBuf &outbuf)
+{
+    if (mode == Decompress)
+	return true;
+    if (!begin(outbuf) || !started)
+	return false;
+    
+    // if there's no room, finish() can try again when there is
+    LZ4F_preferences_t prefs;
+    getprefs(prefs, level);
+    size_t avail = LZ4F_compressBound(0, &prefs);
+    if (outbuf.free() < avail)
+	return false;
+    size_t retval = LZ4F_compressEnd(cctx, outbuf.alloc(avail), avail, NULL);
+    outbuf.unalloc(LZ4F_isError(retval) ? avail : avail - retval);
+    return check(retval);
+}
+
+
+bool WvLz4Encoder::_reset()
+{
+    close();
+    init();
+    return true;
+}
+
+
+// Writes the frame header, if we haven't yet.
+bool WvLz4Encoder::begin(WvBuf &outbuf)
+{
+    if (started)
+	return true;
+    if (outbuf.free() < LZ4F_HEADER_SIZE_MAX)
+	return true; // try again when there's room
+
+    LZ4F_preferences_t prefs;
+    getprefs(prefs, level);
+    unsigned char *out = outbuf.alloc(LZ4F_HEADER_SIZE_MAX);
+    size_t retval = LZ4F_compressBegin(cctx, out, LZ4F_HEADER_SIZE_MAX,
+				       &prefs);
+    outbuf.unalloc(LZ4F_isError(retval)
+		   ? LZ4F_HEADER_SIZE_MAX : LZ4F_HEADER_SIZE_MAX - retval);
+    started = check(retval);
+    return started;
+}
+
+
+bool WvLz4Encoder::compress(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    if (!begin(outbuf))
+	return false;
+    if (!started)
+	return true;
+    
+    // liblz4 only promises not to overrun the output if there's room for
+    // the worst case, so we give it exactly that, straight out of outbuf.
+    LZ4F_preferences_t prefs;
+    getprefs(prefs, level);
+    while (inbuf.used())
+    {
+	size_t len = inbuf.optgettable();
+	if (len > LZ4_CHUNK)
+	    len = LZ4_CHUNK;
+	size_t avail = LZ4F_compressBound(len, &prefs);
+	if (outbuf.free() < avail)
+	    return true; // no room; leave the rest for later
+	
+	size_t retval = LZ4F_compressUpdate(cctx, outbuf.alloc(avail), avail,
+					    inbuf.get(len), len, NULL);
+	if (!check(retval))
+	{
+	    outbuf.unalloc(avail);
+	    return false;
+	}
+	outbuf.unalloc(avail - retval);
+    }
+    
+    if (flush)
+    {
+	size_t avail = LZ4F_compressBound(0, &prefs);
+	if (outbuf.free() < avail)
+	    return true;
+	size_t retval = LZ4F_flush(cctx, outbuf.alloc(avail), avail, NULL);
+	outbuf.unalloc(LZ4F_isError(retval) ? avail : avail - retval);
+	return check(retval);
+    }
+    return true;
+}
+
+
+bool WvLz4Encoder::decompress(WvBuf &inbuf, WvBuf &outbuf)
+{
+    for (;;)
+    {
+	// decompress into whatever's left at the end of outbuf, if that's a
+	// decent amount (and not a WvDynBuf's "unlimited")
+	size_t avail = outbuf.optallocable();
+	if (avail < LZ4_CHUNK || avail >= UNLIMITED_FREE_SPACE)
+	    avail = LZ4_CHUNK;
+	if (avail > outbuf.free())
+	    avail = outbuf.free();
+	if (!avail)
+	    return true;
+	
+	size_t len = inbuf.optgettable(), inlen = len, outlen = avail;
+	const void *in = inbuf.get(len);
+	size_t retval = LZ4F_decompress(dctx, outbuf.alloc(avail), &outlen,
+					in, &inlen, NULL);
+	outbuf.unalloc(avail - outlen);
+	inbuf.unget(len - inlen);
+	if (!check(retval))
+	    return false;
+	if (retval == 0)
+	{
+	    setfinished(); // end of the frame
+	    return true;
+	}
+	if (!inbuf.used() && outlen < avail)
+	    return true; // nothing left to get out of it for now
+    }
+}
+
+#endif // HAVE_LZ4FRAME_H
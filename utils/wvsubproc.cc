@@ -7,23 +7,119 @@
  */
 #include "wvsubproc.h"
 #include "wvtimeutils.h"
+#include "wvautoconf.h"
 #include <stdio.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/time.h>
+#include <sys/select.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <assert.h>
+#include <typeinfo>
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+#ifdef HAVE_SYS_SIGNALFD_H
+# include <sys/signalfd.h>
+#endif
 
 #include "wvfork.h"
 
+bool WvSubProc::use_pidfd = true;
+bool WvSubProc::use_spawn = true;
+
+extern char **environ;
+
+// the SIGCHLD signalfd, and how many WvSubProcs are using it
+static int sigchld_fd = -1, sigchld_users = 0;
+static unsigned long sigchld_count = 0;
+
+
+static int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+// pidfds need Linux 5.3 or newer
+static bool pidfds_work()
+{
+    static int works = -1;
+    if (works < 0)
+    {
+	int fd = open_pidfd(getpid());
+	works = (fd >= 0);
+	if (fd >= 0)
+	    close(fd);
+    }
+    return works && WvSubProc::use_pidfd;
+}
+
+
+// Blocks SIGCHLD and opens a signalfd for it instead, if nobody has
+// already.  This has to happen before the fork, or a child that exits
+// right away will be gone before anyone's listening.  Returns true if it
+// worked, in which case you have to sigchld_release() later.
+//
+// Only the calling thread's signal mask changes, so this only works if
+// other threads (if any) have SIGCHLD blocked too.
+static bool sigchld_get()
+{
+#ifdef HAVE_SYS_SIGNALFD_H
+    if (sigchld_fd < 0)
+    {
+	sigset_t ss;
+	sigemptyset(&ss);
+	sigaddset(&ss, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &ss, NULL);
+	sigchld_fd = signalfd(-1, &ss, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (sigchld_fd < 0)
+	{
+	    sigprocmask(SIG_UNBLOCK, &ss, NULL);
+	    return false;
+	}
+    }
+    sigchld_users++;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+// when nobody needs the signalfd, put SIGCHLD back the way it was
+static void sigchld_release()
+{
+    assert(sigchld_users > 0);
+    if (--sigchld_users == 0)
+    {
+	sigset_t ss;
+	sigemptyset(&ss);
+	sigaddset(&ss, SIGCHLD);
+	close(sigchld_fd);
+	sigchld_fd = -1;
+	sigprocmask(SIG_UNBLOCK, &ss, NULL);
+    }
+}
+
+
 void WvSubProc::init()
 {
     pid = -1;
     memlimit = -1;
     running = false;
     estatus = 0;
+    pidfd = -1;
+    sigchld_watch = false;
 }
 
 
@@ -32,6 +128,7 @@ WvSubProc::~WvSubProc()
     // we need to kill the process here, or else we could leave
     // zombies lying around...
     stop(100);
+    unwatch_exit();
 }
 
 
@@ -39,6 +136,16 @@ int WvSubProc::_startv(const char cmd[], const char * const *argv)
 {
     int waitfd = -1;
     
+    if (use_spawn && memlimit <= 0 && can_spawn())
+    {
+	pid = spawn(cmd, argv);
+	if (pid > 0)
+	    return 0;
+	
+	// if that didn't work, try again the old way, so failures (like
+	// the program not existing) look the same as they always have.
+    }
+    
     pid = fork(&waitfd);
     //fprintf(stderr, "pid for '%s' is %d\n", cmd, pid);
     
@@ -76,6 +183,179 @@ int WvSubProc::_startv(const char cmd[], const char * const *argv)
 }
 
 
+bool WvSubProc::can_spawn() const
+{
+    return typeid(*this) == typeid(WvSubProc);
+}
+
+
+// Works out the environment for a new process: ours, with the changes in
+// 'env' applied.  Returns a NULL-terminated array (which you deletev)
+// pointing into 'vars'.
+static char **merged_env(WvStringList &env, WvStringList &vars)
+{
+    for (char **e = environ; e && *e; e++)
+	vars.append(*e);
+    
+    WvStringList::Iter i(env);
+    for (i.rewind(); i.next(); )
+    {
+	WvStringList words;
+	words.splitstrict(*i, "=");
+	WvString name = words.popstr();
+	WvString value = words.join("=");
+	WvString prefix("%s=", name);
+	
+	WvStringList::Iter old(vars);
+	for (old.rewind(); old.next(); )
+	    if (!strncmp(*old, prefix, prefix.len()))
+		break;
+	bool exists = old.cur();
+	
+	if ((name == "LD_LIBRARY_PATH" || name == "LD_PRELOAD") && exists)
+	{
+	    // don't override - merge!
+	    if (!!value)
+		*old = WvString("%s%s:%s", prefix, value,
+				old->cstr() + prefix.len());
+	}
+	else if (!value)
+	{
+	    // no equals or setting to empty string?
+	    // then we must want to unset it!
+	    if (exists)
+		old.xunlink();
+	}
+	else if (exists)
+	    *old = *i;
+	else
+	    vars.append(*i);
+    }
+    
+    char **envp = new char*[vars.count() + 1], **envptr = envp;
+    WvStringList::Iter var(vars);
+    for (var.rewind(); var.next(); )
+	*envptr++ = var->edit();
+    *envptr = NULL;
+    return envp;
+}
+
+
+// Returns the value of 'name' in 'envp', or NULL if it isn't there.
+static const char *getenvp(char **envp, const char *name)
+{
+    size_t len = strlen(name);
+    for (; *envp; envp++)
+	if (!strncmp(*envp, name, len) && (*envp)[len] == '=')
+	    return *envp + len + 1;
+    return NULL;
+}
+
+
+// Finds 'cmd' in the directories in 'path' (or the default path, if
+// that's NULL) like execvp() does.  Returns WvString::null if it isn't
+// anywhere we could run it.
+static WvString search_path(const char *cmd, const char *path)
+{
+    char defpath[256];
+    if (!path)
+    {
+	size_t len = confstr(_CS_PATH, defpath, sizeof(defpath));
+	if (!len || len > sizeof(defpath))
+	    strcpy(defpath, "/bin:/usr/bin");
+	path = defpath;
+    }
+    
+    WvStringList dirs;
+    dirs.splitstrict(path, ":");
+    WvStringList::Iter dir(dirs);
+    for (dir.rewind(); dir.next(); )
+    {
+	WvString file("%s/%s", !*dir ? "." : dir->cstr(), cmd);
+	struct stat st;
+	if (stat(file, &st) == 0 && S_ISREG(st.st_mode)
+	    && access(file, X_OK) == 0)
+	    return file;
+    }
+    return WvString::null;
+}
+
+
+// Does the same thing as fork() and then exec() in _startv(), but
+// without copying our whole address space first.
+pid_t WvSubProc::spawn(const char cmd[], const char * const *argv)
+{
+    running = false;
+    estatus = 0;
+    
+    WvStringList vars;
+    char **envp = merged_env(env, vars);
+    
+    // posix_spawnp() searches our PATH, but exec() after fork() searches
+    // the one in the new environment, so if 'env' changed it, we have to
+    // do the searching ourselves.
+    WvString file;
+    const char *newpath = getenvp(envp, "PATH"), *oldpath = getenv("PATH");
+    if (!strchr(cmd, '/') && (!newpath != !oldpath
+			      || (newpath && strcmp(newpath, oldpath))))
+    {
+	file = search_path(cmd, newpath);
+	if (!file)
+	{
+	    deletev envp;
+	    return -ENOENT; // let fork() and exec() fail the usual way
+	}
+    }
+    
+    bool have_sigchld = !pidfds_work() && sigchld_get();
+    
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr,
+			     POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+    
+    // in its own process group, like setpgid(0,0) in fork()
+    posix_spawnattr_setpgroup(&attr, 0);
+    
+    // and with the same signal mask as us, except for SIGCHLD, if we
+    // blocked that for the signalfd
+    sigset_t mask;
+    sigprocmask(SIG_BLOCK, NULL, &mask);
+    if (sigchld_fd >= 0)
+	sigdelset(&mask, SIGCHLD);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    spawn_actions(actions);
+    
+    pid_t newpid;
+    int err;
+    if (!file)
+	err = posix_spawnp(&newpid, cmd, &actions, &attr,
+			   (char * const *)argv, envp);
+    else
+	err = posix_spawn(&newpid, file, &actions, &attr,
+			  (char * const *)argv, envp);
+    
+    deletev envp;
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    
+    if (err)
+    {
+	if (have_sigchld)
+	    sigchld_release();
+	return -err;
+    }
+    
+    pid = newpid;
+    running = true;
+    watch_exit(have_sigchld);
+    return pid;
+}
+
+
 void WvSubProc::prepare(const char cmd[], ...)
 {
     va_list ap;
@@ -162,11 +442,11 @@ int WvSubProc::start_again()
 
 int WvSubProc::fork(int *waitfd)
 {
-    static WvString ldpreload, ldlibrary;
-    
     running = false;
     estatus = 0;
 
+    bool have_sigchld = !pidfds_work() && sigchld_get();
+
     pid = wvfork_start(waitfd);
 
     if (!pid)
@@ -178,57 +458,102 @@ int WvSubProc::fork(int *waitfd)
 	// main process.
 	setpgid(0,0);
 
-	// set up any extra environment variables
-	WvStringList::Iter i(env);
-	for (i.rewind(); i.next(); )
+	// the signal mask survives exec(), and the new program won't know
+	// we blocked SIGCHLD for the signalfd
+	if (sigchld_fd >= 0)
 	{
-            WvStringList words;
-            words.splitstrict(*i, "=");
-            WvString name = words.popstr();
-            WvString value = words.join("=");
-	    if (name == "LD_LIBRARY_PATH" && getenv("LD_LIBRARY_PATH"))
-	    {
-                if (!!value)
-                {
-                    // don't override - merge!
-                    ldlibrary = WvString("%s=%s:%s", name,
-                            value, getenv("LD_LIBRARY_PATH"));
-                    putenv(ldlibrary.edit());
-                }
-	    }
-	    else if (name == "LD_PRELOAD" && getenv("LD_PRELOAD"))
-	    {
-                if (!!value)
-                {
-                    // don't override - merge!
-                    ldpreload = WvString("%s=%s:%s", name,
-                            value, getenv("LD_PRELOAD"));
-                    putenv(ldpreload.edit());
-                }
-	    }
-	    else if (!value)
-	    {
-	    	// no equals or setting to empty string?
-                // then we must want to unset it!
-	    	// This is evil, but this is the most simple
-	    	unsetenv(name);
-	    } 
-	    else 
-		putenv(i->edit());
+	    sigset_t ss;
+	    sigemptyset(&ss);
+	    sigaddset(&ss, SIGCHLD);
+	    sigprocmask(SIG_UNBLOCK, &ss, NULL);
 	}
+
+	// set up any extra environment variables.  They have to last until
+	// whoever called us gets around to exec().
+	static WvStringList vars;
+	environ = merged_env(env, vars);
     }
     else if (pid > 0)
     {
 	// parent process
 	running = true;
+	watch_exit(have_sigchld);
     }
     else if (pid < 0)
-	return -errno;
+    {
+	int err = errno;
+	if (have_sigchld)
+	    sigchld_release();
+	return -err;
+    }
     
     return pid;
 }
 
 
+void WvSubProc::watch_exit(bool have_sigchld)
+{
+    unwatch_exit();
+    
+    if (pidfds_work())
+    {
+	pidfd = open_pidfd(pid);
+	
+	// WvStreams uses select(), which can't cope with big fds
+	if (pidfd >= FD_SETSIZE)
+	{
+	    close(pidfd);
+	    pidfd = -1;
+	}
+	
+	if (pidfd < 0 && !have_sigchld && (have_sigchld = sigchld_get()))
+	{
+	    // too late to be sure of catching this one's SIGCHLD, so
+	    // make everyone look right away
+	    sigchld_count++;
+	}
+    }
+    
+    sigchld_watch = have_sigchld;
+}
+
+
+void WvSubProc::unwatch_exit()
+{
+    if (pidfd >= 0)
+	close(pidfd);
+    pidfd = -1;
+    if (sigchld_watch)
+	sigchld_release();
+    sigchld_watch = false;
+}
+
+
+int WvSubProc::exitfd() const
+{
+    if (pidfd >= 0)
+	return pidfd;
+    else if (sigchld_watch)
+	return sigchld_fd;
+    else
+	return -1;
+}
+
+
+unsigned long WvSubProc::sigchld_events()
+{
+#ifdef HAVE_SYS_SIGNALFD_H
+    if (sigchld_fd >= 0)
+    {
+	struct signalfd_siginfo info[16];
+	while (read(sigchld_fd, info, sizeof(info)) > 0)
+	    sigchld_count++;
+    }
+#endif
+    return sigchld_count;
+}
+
+
 pid_t WvSubProc::pidfile_pid()
 {
     if (!!pidfile)
@@ -351,6 +676,7 @@ void WvSubProc::wait(time_t msec_delay, bool wait_children)
 		// the main process is dead - save its status.
 		estatus = status;
 		old_pids.append(new pid_t(pid), true);
+		unwatch_exit();
 		
 		pid_t p2 = pidfile_pid();
 		if (pid != p2)
@@ -386,8 +712,19 @@ void WvSubProc::wait(time_t msec_delay, bool wait_children)
 		xrunning = false;
 	}
 
-	// wait a while, so we're not spinning _too_ fast in a loop
-	if (xrunning && msec_delay != 0)
+	// wait a while, so we're not spinning _too_ fast in a loop.  If
+	// it's the main process we're waiting for, its pidfd says exactly
+	// when it's done; its children we can only poll for.
+	if (xrunning && msec_delay != 0 && pid > 0 && pidfd >= 0)
+	{
+	    struct pollfd pfd;
+	    pfd.fd = pidfd;
+	    pfd.events = POLLIN;
+	    gettimeofday(&tv2, &tz);
+	    time_t left = msec_delay - msecdiff(tv2, tv1);
+	    poll(&pfd, 1, msec_delay < 0 ? -1 : (left > 0 ? left : 0));
+	}
+	else if (xrunning && msec_delay != 0)
 	    usleep(50*1000);
 	
 	gettimeofday(&tv2, &tz);
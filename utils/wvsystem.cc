@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
+#include <typeinfo>
 
 WvSystem::~WvSystem()
 {
@@ -56,6 +57,28 @@ int WvSystem::fork(int *waitfd)
 }
 
 
+// our fork() does nothing spawn_actions() can't, but a subclass's might
+bool WvSystem::can_spawn() const
+{
+    return typeid(*this) == typeid(WvSystem);
+}
+
+
+// the same thing, for when WvSubProc uses posix_spawn() instead
+void WvSystem::spawn_actions(posix_spawn_file_actions_t &actions)
+{
+    if (!fdfiles[0].isnull())
+	posix_spawn_file_actions_addopen(&actions, 0, fdfiles[0],
+					 O_RDONLY, 0666);
+    if (!fdfiles[1].isnull())
+	posix_spawn_file_actions_addopen(&actions, 1, fdfiles[1],
+					 O_WRONLY|O_CREAT, 0666);
+    if (!fdfiles[2].isnull())
+	posix_spawn_file_actions_addopen(&actions, 2, fdfiles[2],
+					 O_WRONLY|O_CREAT, 0666);
+}
+
+
 int WvSystem::go()
 {
     if (!started)
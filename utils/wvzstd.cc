@@ -0,0 +1,191 @@
+/*
+ * Worldvisions Weaver Software:
+ *   Copyright (C) 1997-2002 Net Integration Technologies, Inc.
+ *
+ * Zstandard encoder/decoder based on libzstd.  See wvzstd.h.
+ */
+#include "wvzstd.h"
+#include "wvautoconf.h"
+
+// If libzstd wasn't installed at compile time, stub this out
+#if !defined(HAVE_ZSTD_H) || !defined(HAVE_LIBZSTD)
+
+WvZstdEncoder::WvZstdEncoder(Mode _mode, int _level) :
+    cctx(NULL), dctx(NULL), mode(_mode), level(_level)
+{
+    seterror("compiled without Zstandard support");
+}
+
+
+WvZstdEncoder::~WvZstdEncoder()
+{
+}
+
+
+bool WvZstdEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    return false;
+}
+
+
+bool WvZstdEncoder::_finish(WvBuf &outbuf)
+{
+    return false;
+}
+
+
+bool WvZstdEncoder::_reset()
+{
+    return false;
+}
+
+#else // HAVE_ZSTD_H
+
+#include <zstd.h>
+
+
+WvZstdEncoder::WvZstdEncoder(Mode _mode, int _level) :
+    cctx(NULL), dctx(NULL), mode(_mode), level(_level)
+{
+    if (mode == Compress)
+    {
+	cctx = ZSTD_createCCtx();
+	if (cctx
+	    && check(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel,
+					    level)))
+	    check(ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1));
+    }
+    else
+	dctx = ZSTD_createDCtx();
+    
+    if (!cctx && !dctx)
+	seterror("can't allocate Zstandard context");
+}
+
+
+WvZstdEncoder::~WvZstdEncoder()
+{
+    if (cctx)
+	ZSTD_freeCCtx(cctx);
+    if (dctx)
+	ZSTD_freeDCtx(dctx);
+}
+
+
+// Returns true if retval isn't an error, and sets the error if it is.
+bool WvZstdEncoder::check(size_t retval)
+{
+    if (!ZSTD_isError(retval))
+	return true;
+    seterror("error during Zstandard %s: %s",
+	     mode == Compress ? "compression" : "decompression",
+	     ZSTD_getErrorName(retval));
+    return false;
+}
+
+
+// How much of outbuf to let libzstd write into at once: whatever's left at
+// the end of it if that's a decent amount, so we don't waste it.  (A
+// WvDynBuf with nothing left says it's unlimited, which isn't.)
+static size_t room(WvBuf &outbuf)
+{
+    size_t avail = outbuf.optallocable();
+    if (avail < ZSTD_CStreamOutSize() || avail >= UNLIMITED_FREE_SPACE)
+	avail = ZSTD_CStreamOutSize();
+    if (avail > outbuf.free())
+	avail = outbuf.free();
+    return avail;
+}
+
+
+bool WvZstdEncoder::_encode(WvBuf &inbuf, WvBuf &outbuf, bool flush)
+{
+    if (mode == Compress)
+	return compress(inbuf, outbuf, flush ? ZSTD_e_flush : ZSTD_e_continue);
+    else
+	return decompress(inbuf, outbuf);
+}
+
+
+bool WvZstdEncoder::_finish(WvBuf &outbuf)
+{
+    if (mode == Decompress)
+	return true;
+    WvConstInPlaceBuf empty(NULL, 0);
+    return compress(empty, outbuf, ZSTD_e_end);
+}
+
+
+bool WvZstdEncoder::_reset()
+{
+    // keeps the level and so on
+    if (mode == Compress)
+	return check(ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only));
+    else
+	return check(ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only));
+}
+
+
+bool WvZstdEncoder::compress(WvBuf &inbuf, WvBuf &outbuf, int directive)
+{
+    ZSTD_EndDirective end;
+    size_t retval;
+    do
+    {
+	// libzstd wants the same input again until it's all gone, and for
+	// a flush or the end, until it says it's done; only the last bit of
+	// the input gets the flush.
+	size_t len = inbuf.optgettable();
+	ZSTD_inBuffer in = { inbuf.get(len), len, 0 };
+	end = inbuf.used() ? ZSTD_e_continue : (ZSTD_EndDirective)directive;
+	do
+	{
+	    size_t avail = room(outbuf);
+	    if (!avail)
+	    {
+		// no room; leave the rest for later, but finish() has to
+		// know it isn't done
+		inbuf.unget(in.size - in.pos);
+		return directive != ZSTD_e_end;
+	    }
+	    ZSTD_outBuffer out = { outbuf.alloc(avail), avail, 0 };
+	    retval = ZSTD_compressStream2(cctx, &out, &in, end);
+	    outbuf.unalloc(avail - out.pos);
+	    if (!check(retval))
+	    {
+		inbuf.unget(in.size - in.pos);
+		return false;
+	    }
+	} while (in.pos < in.size || (end != ZSTD_e_continue && retval));
+    } while (inbuf.used());
+    return true;
+}
+
+
+bool WvZstdEncoder::decompress(WvBuf &inbuf, WvBuf &outbuf)
+{
+    for (;;)
+    {
+	size_t avail = room(outbuf);
+	if (!avail)
+	    return true;
+	
+	size_t len = inbuf.optgettable();
+	ZSTD_inBuffer in = { inbuf.get(len), len, 0 };
+	ZSTD_outBuffer out = { outbuf.alloc(avail), avail, 0 };
+	size_t retval = ZSTD_decompressStream(dctx, &out, &in);
+	outbuf.unalloc(avail - out.pos);
+	inbuf.unget(in.size - in.pos);
+	if (!check(retval))
+	    return false;
+	if (retval == 0)
+	{
+	    setfinished(); // end of the frame
+	    return true;
+	}
+	if (!inbuf.used() && out.pos < out.size)
+	    return true; // nothing left to get out of it for now
+    }
+}
+
+#endif // HAVE_ZSTD_H